@@ -0,0 +1,134 @@
+// FSZ codec benchmark: compression ratio and encode/decode speed on .FLT files.
+//
+// Without arguments it runs on generated saves (a short flight and a heavily modded aircraft with thousands of
+// L: variables). Pass real files to measure them too:
+//   CodecBench "C:\...\LocalState\LAST.FLT" "C:\...\LocalState\MyFlight.FLT"
+//
+// Build from the repository root (the CMake target comes with the headless build):
+//   g++ -O2 -std=c++17 -IFSAutoSave Benchmarks/CodecBench.cpp FSAutoSave/Compression.cpp -o CodecBench
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Compression.h"
+
+struct Sample {
+    std::string name;
+    std::string data;
+};
+
+// Deterministic pseudo random numbers so every run measures the same input
+static uint64_t benchState = 0x1234567;
+static double benchRandom() {
+    benchState = benchState * 6364136223846793005ull + 1442695040888963407ull;
+    return static_cast<double>(benchState >> 11) / 9007199254740992.0;
+}
+
+static std::string formatNumber(const char* format, double value) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), format, value);
+    return buffer;
+}
+
+// Roughly what MSFS writes: [Main], [Sim.0], [SimVars.0], one [Engine Parameters.1.N] per engine, [LocalVars.0] with
+// the aircraft's L: variables, [FreezeFlags.0], [Systems.0], the flight plan and its waypoints
+static std::string generateFlt(int localVars, int waypoints) {
+    std::ostringstream flt;
+    flt << "[Main]\nTitle=FSAutoSave\nDescription=\nAppVersion=11.0.282174\nFlightVersion=1\nOriginalFlight=\nFlightType=SAVE\n\n";
+    flt << "[Departure]\nICAO=KSEA\nRunwayNumber=16\nRunwayDesignator=LEFT\n\n";
+    flt << "[Destination]\nICAO=KPDX\nRunwayNumber=10\nRunwayDesignator=RIGHT\n\n";
+    flt << "[Sim.0]\nSim=Asobo Cessna 172 Skyhawk G1000\nPilot=Pilot_Female_Casual\nSimRateBeforeActivePause=1\n\n";
+    flt << "[SimVars.0]\nLatitude=N47° 26' " << formatNumber("%.2f", 60 * benchRandom()) << "\"\nLongitude=W122° 18' "
+        << formatNumber("%.2f", 60 * benchRandom()) << "\"\nAltitude=+000" << formatNumber("%.2f", 500 * benchRandom())
+        << "\nPitch=" << formatNumber("%.6f", benchRandom()) << "\nBank=" << formatNumber("%.6f", benchRandom())
+        << "\nHeading=" << formatNumber("%.6f", 360 * benchRandom()) << "\nPVelBodyX=0\nPVelBodyY=0\nPVelBodyZ=0\nSimOnGround=False\nOnPushback=False\n\n";
+
+    for (int engine = 0; engine < 2; ++engine) {
+        flt << "[Engine Parameters.1." << engine << "]\n";
+        for (int i = 1; i <= 12; ++i) {
+            flt << "ThrottleLeverPct." << i << "=" << formatNumber("%.6f", benchRandom()) << "\n";
+        }
+        flt << "PropellerLeverPct=1.000000\nMixtureLeverPct=1.000000\nCowlFlapsPct=0.000000\nMagnetoLeft=True\nMagnetoRight=True\n\n";
+    }
+
+    const char* prefixes[] = { "XMLVAR_", "A32NX_", "FBW_", "WT_CJ4_", "GPS_", "AS1000_PFD_", "LIGHTING_", "ELEC_" };
+    const char* words[] = { "SWITCH", "KNOB", "BRIGHTNESS", "POSITION", "STATE", "ANIM", "SELECTED", "PUSHED", "LIGHT", "MODE" };
+    flt << "[LocalVars.0]\n";
+    for (int i = 0; i < localVars; ++i) {
+        double value = benchRandom() < 0.7 ? static_cast<double>(static_cast<int>(benchRandom() * 3)) : benchRandom() * 1000;
+        flt << prefixes[i % 8] << words[(i / 8) % 10] << "_" << words[(i * 7) % 10] << "_" << i / 80 << "=" << formatNumber("%.6f", value) << "\n";
+    }
+    flt << "\n[FreezeFlags.0]\nLatitudeLongitude=False\nAltitude=False\nAttitude=False\n\n";
+    flt << "[Systems.0]\nAutopilotAvailable=True\nAutopilotMaster=False\nAutopilotHeadingLock=False\nAutopilotAltitudeLock=False\n\n";
+
+    flt << "[ATC_Aircraft.0]\nActiveFlightPlan=True\nRequestedFlightPlan=False\nWaypoint=" << waypoints << "\n\n";
+    flt << "[ATC_ActiveFlightPlan.0]\ntitle=KSEA to KPDX\ndescription=KSEA, KPDX\ntype=IFR\nroutetype=2\ncruising_altitude=12000\n";
+    for (int i = 0; i < waypoints; ++i) {
+        flt << "waypoint." << i << "=, WPT" << i << ", , WPT" << i << ", I, N47° " << formatNumber("%.2f", 60 * benchRandom())
+            << "', W122° " << formatNumber("%.2f", 60 * benchRandom()) << "', +012000.00, \n";
+    }
+    flt << "\n";
+    return flt.str();
+}
+
+static bool readFile(const char* path, std::string& data) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    data = buffer.str();
+    return true;
+}
+
+template <typename F> static double bestSeconds(F run, size_t bytes) {
+    // Enough repetitions for ~64 MB per measurement, best of three
+    int repeat = static_cast<int>(std::max<size_t>(1, (64u << 20) / std::max<size_t>(bytes, 1)));
+    double best = 1e30;
+    for (int round = 0; round < 3; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeat; ++i) {
+            run();
+        }
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeat);
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    std::vector<Sample> samples;
+    samples.push_back({ "generated (short flight)", generateFlt(300, 12) });
+    samples.push_back({ "generated (modded airliner)", generateFlt(6000, 60) });
+    for (int i = 1; i < argc; ++i) {
+        Sample sample;
+        sample.name = argv[i];
+        if (!readFile(argv[i], sample.data)) {
+            printf("Could not read %s\n", argv[i]);
+            return 1;
+        }
+        samples.push_back(std::move(sample));
+    }
+
+    printf("%-40s %10s %10s %7s %12s %12s\n", "Input", "Bytes", "FSZ", "Ratio", "Encode MB/s", "Decode MB/s");
+    for (const Sample& sample : samples) {
+        std::string packed = fszCompress(sample.data);
+        std::string unpacked;
+        if (!fszDecompress(packed, unpacked) || unpacked != sample.data) {
+            printf("%s: round trip FAILED\n", sample.name.c_str());
+            return 1;
+        }
+
+        volatile size_t sink = 0;
+        double encode = bestSeconds([&] { sink = sink + fszCompress(sample.data).size(); }, sample.data.size());
+        double decode = bestSeconds([&] { fszDecompress(packed, unpacked); sink = sink + unpacked.size(); }, sample.data.size());
+        double megabytes = sample.data.size() / (1024.0 * 1024.0);
+        printf("%-40s %10zu %10zu %6.2fx %12.1f %12.1f\n", sample.name.c_str(), sample.data.size(), packed.size(),
+            static_cast<double>(sample.data.size()) / packed.size(), megabytes / encode, megabytes / decode);
+    }
+    return 0;
+}
@@ -0,0 +1,673 @@
+// Micro-benchmarks of what FSAutoSave does around every save: path names, .FLT reads and writes, finalFLTchange from
+// start to end, the closest airport (list scan and airport index) and jetway lookups, the batched geodesy functions
+// (every SIMD level the CPU has, next to the scalar code they replace), the facility database, facility tables, taxi
+// routes, the runway test of every position sample and the gate names.
+//
+// The .FLT inputs are generated with fakeSimFlt (Headless/FakeSim.h), from a short flight (10 KB) to a modded airliner
+// with several MB of [LocalVars.0]. Real files passed on the command line are measured too:
+//   MicroBench [--filter TEXT] [--json FILE] [--corpus DIR] [--quick] [file.FLT ...]
+//
+//   --filter TEXT  only the benchmarks with TEXT in their name
+//   --json FILE    also write the results as JSON, to compare runs and track regressions
+//   --corpus DIR   keep the generated .FLT files in DIR
+//   --quick        short measurements, to check that everything runs
+//
+// Build: the MicroBench target of the CMake build (CMakeLists.txt at the repository root).
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#define dup _dup
+#define dup2 _dup2
+#define close _close
+#define getpid _getpid
+#define NULL_DEVICE "NUL"
+#else
+#include <unistd.h>
+#define NULL_DEVICE "/dev/null"
+#endif
+#include "FSAutoSave.h"
+#include "Globals.h"
+#include "Utility.h"
+#include "AirportIndex.h"
+#include "FacilityDb.h"
+#include "FacilityPlan.h"
+#include "FacilityTable.h"
+#include "TaxiGraph.h"
+#include "RunwayIndex.h"
+#include "FakeSim.h"
+
+namespace fs = std::filesystem;
+
+struct Options {
+    std::string filter;
+    std::string json;
+    std::string corpus;
+    bool quick = false;
+    std::vector<std::string> files;
+};
+
+struct Result {
+    std::string name;
+    std::string input;
+    uint64_t iterations;
+    double nsPerOp;
+    size_t bytesPerOp;      // Input bytes processed per operation, 0 when it does not apply
+};
+
+struct CorpusFile {
+    std::string name;
+    std::string path;
+    std::string data;
+};
+
+static Options options;
+static std::vector<Result> results;
+
+// Deterministic pseudo random numbers so every run measures the same input
+static uint64_t benchState = 0x1234567;
+static double benchRandom() {
+    benchState = benchState * 6364136223846793005ull + 1442695040888963407ull;
+    return static_cast<double>(benchState >> 11) / 9007199254740992.0;
+}
+
+// Runs the benchmark until a round takes long enough, then keeps the best of three rounds. runIterations does n
+// operations and returns the seconds they took (so it can leave its own setup out).
+static void measure(const std::string& name, const std::string& input, size_t bytesPerOp, const std::function<double(uint64_t)>& runIterations) {
+    if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+        return;
+    }
+    double target = options.quick ? 0.01 : 0.2;
+    uint64_t iterations = 1;
+    double seconds = runIterations(iterations);
+    while (seconds < target && iterations < (1ull << 40)) {
+        iterations = seconds > 0 ? std::max<uint64_t>(iterations * 2, static_cast<uint64_t>(iterations * target * 1.2 / seconds)) : iterations * 16;
+        seconds = runIterations(iterations);
+    }
+    double best = seconds;
+    for (int round = 1; round < 3; ++round) {
+        best = std::min(best, runIterations(iterations));
+    }
+
+    Result result = { name, input, iterations, best * 1e9 / iterations, bytesPerOp };
+    results.push_back(result);
+    printf("%-32s %-26s %12.0f ns %10llu", name.c_str(), input.c_str(), result.nsPerOp, static_cast<unsigned long long>(iterations));
+    if (bytesPerOp > 0) {
+        printf(" %10.1f MB/s", bytesPerOp / (1024.0 * 1024.0) / (result.nsPerOp * 1e-9));
+    }
+    printf("\n");
+}
+
+template <typename F> static void bench(const std::string& name, const std::string& input, size_t bytesPerOp, F operation) {
+    measure(name, input, bytesPerOp, [&](uint64_t iterations) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            operation(i);
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    });
+}
+
+// finalFLTchange and friends report to the console like they do in the application, keep that out of the results
+static int quietStdout() {
+    fflush(stdout);
+    int saved = dup(1);
+    int null = open(NULL_DEVICE, O_WRONLY);
+    if (null >= 0) {
+        dup2(null, 1);
+        close(null);
+    }
+    return saved;
+}
+
+static void restoreStdout(int saved) {
+    fflush(stdout);
+    if (saved >= 0) {
+        dup2(saved, 1);
+        close(saved);
+    }
+}
+
+static bool writeFile(const std::string& path, const std::string& data) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    return file.good();
+}
+
+static bool readFile(const std::string& path, std::string& data) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    data = buffer.str();
+    return true;
+}
+
+static std::string sizeName(size_t bytes) {
+    char buffer[32];
+    if (bytes >= 1024 * 1024) {
+        snprintf(buffer, sizeof(buffer), "%.1f MB", bytes / (1024.0 * 1024.0));
+    }
+    else {
+        snprintf(buffer, sizeof(buffer), "%zu KB", bytes / 1024);
+    }
+    return buffer;
+}
+
+// What MSFS leaves behind after a save at the gate (the state FSAutoSave repairs), from 10 KB to 4 MB
+static std::vector<CorpusFile> buildCorpus(const std::string& directory) {
+    std::vector<CorpusFile> corpus;
+    const size_t sizes[] = { 10 << 10, 100 << 10, 1 << 20, 4 << 20 };
+    for (size_t bytes : sizes) {
+        FakeFlight flight;
+        flight.aircraft = bytes > (100 << 10) ? "FlyByWire Airbus A320 Neo" : "Asobo Cessna 172 Skyhawk G1000";
+        flight.firstFlightState = "LANDING_GATE";
+        flight.flightVersion = 7;
+        flight.simTime = 5400;
+        flight.bytes = bytes;
+
+        CorpusFile file;
+        file.data = fakeSimFlt(flight);
+        file.name = "generated " + sizeName(file.data.size());
+        file.path = directory + PATH_SEPARATOR "corpus-" + std::to_string(bytes >> 10) + "KB.FLT";
+        writeFile(file.path, file.data);
+        corpus.push_back(std::move(file));
+    }
+    for (const std::string& path : options.files) {
+        CorpusFile file;
+        if (!readFile(path, file.data)) {
+            printf("Could not read %s\n", path.c_str());
+            continue;
+        }
+        file.name = NormalizePath(path) + " " + sizeName(file.data.size());
+        file.path = path;
+        corpus.push_back(std::move(file));
+    }
+    return corpus;
+}
+
+static void benchPaths() {
+    struct { const char* input; const char* path; } paths[] = {
+        { "aircraft.cfg", "C:\\Users\\Pilot\\AppData\\Local\\Packages\\Microsoft.FlightSimulator_8wekyb3d8bbwe\\LocalCache\\Packages\\Official\\OneStore\\asobo-aircraft-c172sp-as1000\\SimObjects\\Airplanes\\Asobo_C172sp_AS1000\\aircraft.cfg" },
+        { "flight", "C:\\Users\\Pilot\\AppData\\Local\\Packages\\Microsoft.FlightSimulator_8wekyb3d8bbwe\\LocalState\\LAST.FLT" },
+        { "flight (POSIX)", "/home/pilot/.local/share/fsautosave/Missions/Custom/CustomFlight/CustomFlight.FLT" },
+    };
+    for (const auto& path : paths) {
+        std::string fullPath = path.path;
+        volatile size_t sink = 0;
+        bench("NormalizePath", path.input, 0, [&](uint64_t) { sink = sink + NormalizePath(fullPath).size(); });
+    }
+}
+
+// On a copy of every corpus file, the corpus and the files passed on the command line are never modified
+static void benchConfigFiles(const std::vector<CorpusFile>& corpus, const std::string& directory) {
+    std::string path = directory + PATH_SEPARATOR "CONFIG.FLT";
+    for (const CorpusFile& file : corpus) {
+        writeFile(path, file.data);
+        volatile size_t sink = 0;
+        bench("readConfigFile", file.name, file.data.size(), [&](uint64_t) { sink = sink + readConfigFile(path, "Main", "FlightVersion").size(); });
+        bench("readConfigFile (missing)", file.name, file.data.size(), [&](uint64_t) { sink = sink + readConfigFile(path, "Departure", "GateName").size(); });
+
+        // A new value every time, so every call writes the file
+        bench("modifyConfigFile", file.name, file.data.size(), [&](uint64_t i) {
+            std::map<std::string, std::map<std::string, std::string>> changes = {
+                {"Main", {{"FlightVersion", std::to_string(i % 100 + 1)}, {"FlightType", "SAVE"}}},
+                {"Briefing", {{"BriefingText", i % 2 ? "Welcome back!" : "Ready to resume your flight?"}}},
+            };
+            int saved = quietStdout();
+            sink = sink + modifyConfigFile(path, changes).size();
+            restoreStdout(saved);
+        });
+    }
+    std::error_code ec;
+    fs::remove(path, ec);
+}
+
+// The whole final save repair on LAST.FLT and CUSTOMFLIGHT.FLT, from the files as MSFS wrote them
+static void benchFinalFLTchange(const std::vector<CorpusFile>& corpus, const std::string& directory) {
+    lastMOD = directory + PATH_SEPARATOR "LAST.FLT";
+    customFlightmod = directory + PATH_SEPARATOR "CUSTOMFLIGHT.FLT";
+    currentFlightPlan = "";
+    for (const CorpusFile& file : corpus) {
+        measure("finalFLTchange", file.name, file.data.size() * 2, [&](uint64_t iterations) {
+            double seconds = 0;
+            for (uint64_t i = 0; i < iterations; ++i) {
+                writeFile(lastMOD, file.data);
+                writeFile(customFlightmod, file.data);
+                airportICAO = "KSEA";
+                airportName = "Seattle-Tacoma Intl";
+                parkingGate = "GATE_A";
+                parkingGateSuffix = "";
+                parkingNumber = 5;
+                isFinalSave = TRUE;
+
+                int saved = quietStdout();
+                auto start = std::chrono::steady_clock::now();
+                finalFLTchange();
+                seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                restoreStdout(saved);
+            }
+            return seconds;
+        });
+    }
+    isFinalSave = FALSE;
+    std::error_code ec;
+    fs::remove(lastMOD, ec);
+    fs::remove(customFlightmod, ec);
+}
+
+static void benchGeodesy() {
+    // Pairs of positions around KSEA
+    std::vector<double> points(4096);
+    for (size_t i = 0; i < points.size(); i += 4) {
+        points[i] = 47.0 + benchRandom();
+        points[i + 1] = -122.5 + benchRandom();
+        points[i + 2] = 47.0 + benchRandom();
+        points[i + 3] = -122.5 + benchRandom();
+    }
+    volatile double sink = 0;
+    bench("calculateDistanceAndBearing", "random pairs", 0, [&](uint64_t i) {
+        const double* p = &points[(i * 4) % points.size()];
+        sink = sink + calculateDistanceAndBearing(p[0], p[1], p[2], p[3]).distance;
+    });
+    bench("calculateClockPosition", "random bearings", 0, [&](uint64_t i) {
+        sink = sink + calculateClockPosition(points[i % points.size()] * 7.5, 90.0);
+    });
+
+    // The cached airport list MSFS answers with: a few hundred airports in busy areas, thousands over a continent
+    const unsigned airportCounts[] = { 200, 2000, 20000 };
+    for (unsigned count : airportCounts) {
+        std::vector<SIMCONNECT_DATA_FACILITY_AIRPORT> airports(count);
+        for (unsigned i = 0; i < count; ++i) {
+            snprintf(airports[i].Ident, sizeof(airports[i].Ident), "K%04u", i % 10000);
+            snprintf(airports[i].Region, sizeof(airports[i].Region), "K1");
+            airports[i].Latitude = 30.0 + 20.0 * benchRandom();
+            airports[i].Longitude = -125.0 + 50.0 * benchRandom();
+            airports[i].Altitude = 100.0 * benchRandom();
+        }
+        volatile int closest = 0;
+        bench("closestAirport", std::to_string(count) + " airports", count * sizeof(SIMCONNECT_DATA_FACILITY_AIRPORT), [&](uint64_t i) {
+            const double* p = &points[(i * 2) % points.size()];
+            closest = closest + closestAirport(airports.data(), count, p[0], p[1]);
+        });
+
+        // Same airports from the index: one rebuild after they changed, then the queries
+        airportIndexClear();
+        airportIndexAdd(airports.data(), count);
+        AirportIndexEntry nearest;
+        double distance = 0;
+        bench("airportIndexNearest", std::to_string(count) + " airports", 0, [&](uint64_t i) {
+            const double* p = &points[(i * 2) % points.size()];
+            airportIndexNearest(p[0], p[1], nearest, distance);
+            closest = closest + nearest.ident[1];
+        });
+        bench("airportIndex rebuild", std::to_string(count) + " airports", 0, [&](uint64_t i) {
+            airportIndexRemove(&airports[i % count], 1);
+            airportIndexAdd(&airports[i % count], 1);
+            airportIndexNearest(points[0], points[1], nearest, distance);
+        });
+        airportIndexClear();
+    }
+
+    // Jetways of a regional airport and of a hub
+    const unsigned jetwayCounts[] = { 16, 160 };
+    for (unsigned count : jetwayCounts) {
+        std::vector<SIMCONNECT_JETWAY_DATA> jetways(count);
+        for (unsigned i = 0; i < count; ++i) {
+            memset(&jetways[i], 0, sizeof(SIMCONNECT_JETWAY_DATA));
+            snprintf(jetways[i].AirportIcao, sizeof(jetways[i].AirportIcao), "KSEA");
+            jetways[i].ParkingIndex = static_cast<int>(i);
+            jetways[i].Lla.Latitude = 47.44 + 0.02 * benchRandom();
+            jetways[i].Lla.Longitude = -122.31 + 0.02 * benchRandom();
+        }
+        volatile int closest = 0;
+        bench("closestJetway", std::to_string(count) + " jetways", 0, [&](uint64_t i) {
+            const double* p = &points[(i * 2) % points.size()];
+            DistanceAndBearing result;
+            closest = closest + closestJetway(jetways.data(), count, 47.44 + 0.02 * (p[0] - 47.0), -122.31 + 0.02 * (p[1] + 122.5), result);
+        });
+        // What closestJetway did before the batched functions: the distance and bearing of every jetway
+        bench("closestJetway haversine", std::to_string(count) + " jetways", 0, [&](uint64_t i) {
+            const double* p = &points[(i * 2) % points.size()];
+            double latitude = 47.44 + 0.02 * (p[0] - 47.0), longitude = -122.31 + 0.02 * (p[1] + 122.5);
+            DistanceAndBearing best = { DBL_MAX, DBL_MAX };
+            int bestIndex = -1;
+            for (unsigned j = 0; j < count; ++j) {
+                DistanceAndBearing result = calculateDistanceAndBearing(latitude, longitude, jetways[j].Lla.Latitude, jetways[j].Lla.Longitude);
+                if (result.distance < best.distance) {
+                    best = result;
+                    bestIndex = static_cast<int>(j);
+                }
+            }
+            closest = closest + bestIndex;
+        });
+    }
+
+    // The batched functions on precomputed unit vectors (jetways and parkings of a hub, a whole region)
+    const unsigned pointCounts[] = { 160, 4096 };
+    for (unsigned count : pointCounts) {
+        std::vector<double> latitudes(count), longitudes(count), x(count), y(count), z(count), bearings(count);
+        for (unsigned i = 0; i < count; ++i) {
+            latitudes[i] = 47.44 + 0.02 * benchRandom();
+            longitudes[i] = -122.31 + 0.02 * benchRandom();
+        }
+        toUnitVectors(latitudes.data(), longitudes.data(), count, x.data(), y.data(), z.data());
+        std::string input = std::to_string(count) + " points";
+        volatile int closest = 0;
+        GEODESY_SIMD best = geodesySimd();
+        for (int level = GEODESY_SCALAR; level <= best; ++level) {
+            geodesyUseSimd(static_cast<GEODESY_SIMD>(level));
+            bench(std::string("nearestUnitVector ") + geodesySimdName(geodesySimd()), input, count * 3 * sizeof(double), [&](uint64_t i) {
+                const double* p = &points[(i * 2) % points.size()];
+                double chord = 0;
+                closest = closest + nearestUnitVector(x.data(), y.data(), z.data(), count, toUnitVector(47.44 + 0.02 * (p[0] - 47.0), -122.31 + 0.02 * (p[1] + 122.5)), chord);
+            });
+        }
+        geodesyUseSimd(best);
+
+        std::vector<DistanceAndBearing> results(count);
+        std::vector<int> clockPositions(count);
+        bench("calculateDistancesAndBearings", input, 0, [&](uint64_t i) {
+            const double* p = &points[(i * 2) % points.size()];
+            calculateDistancesAndBearings(p[0], p[1], latitudes.data(), longitudes.data(), count, results.data());
+            closest = closest + static_cast<int>(results[0].bearing);
+        });
+        bench("calculateDistanceAndBearing x N", input, 0, [&](uint64_t i) {
+            const double* p = &points[(i * 2) % points.size()];
+            for (unsigned j = 0; j < count; ++j) {
+                results[j] = calculateDistanceAndBearing(p[0], p[1], latitudes[j], longitudes[j]);
+            }
+            closest = closest + static_cast<int>(results[0].bearing);
+        });
+        for (unsigned i = 0; i < count; ++i) {
+            bearings[i] = results[i].bearing;
+        }
+        bench("calculateClockPositions", input, 0, [&](uint64_t i) {
+            calculateClockPositions(bearings.data(), count, static_cast<double>(i % 360), clockPositions.data());
+            closest = closest + clockPositions[0];
+        });
+    }
+}
+
+// Facility database of a long flying career: airports with 40 parkings, every other one with a jetway
+static void benchFacilityDb(const std::string& directory) {
+    const unsigned count = 500;
+    std::string path = directory + PATH_SEPARATOR "facilities.fdb";
+    facilityDbOpen(path, 1, 1);
+    FacilityAirportRecord airport;
+    for (unsigned i = 0; i < count; ++i) {
+        char ident[8];
+        snprintf(ident, sizeof(ident), "K%03u", i);
+        airport.ident = ident;
+        airport.name = "Airport " + airport.ident;
+        airport.latitude = 30.0 + 20.0 * benchRandom();
+        airport.longitude = -125.0 + 50.0 * benchRandom();
+        airport.flags = FACILITY_DB_JETWAYS;
+        airport.parkings.clear();
+        airport.jetways.clear();
+        for (unsigned parking = 0; parking < 40; ++parking) {
+            // Rows of parkings 30 meters apart around the reference point
+            airport.parkings.push_back({ 12 + static_cast<int>(parking % 26), 0, parking + 1, 30.0f * (parking % 8) - 105.0f, 30.0f * (parking / 8) - 60.0f, 20.0f });
+            if (parking % 2 == 1) {
+                airport.jetways.push_back({ static_cast<int>(parking), airport.latitude + 0.01 * benchRandom(), airport.longitude + 0.01 * benchRandom() });
+            }
+        }
+        facilityDbStore(airport);
+    }
+
+    // What a save at a known airport does instead of asking MSFS: the airport, its closest jetway and that parking
+    volatile int closest = 0;
+    bench("facilityDb lookup", std::to_string(count) + " airports", 0, [&](uint64_t i) {
+        char ident[8];
+        snprintf(ident, sizeof(ident), "K%03u", static_cast<unsigned>(i % count));
+        FacilityDbAirport found;
+        FacilityParking parking;
+        DistanceAndBearing result;
+        if (facilityDbFind(ident, found)) {
+            int index = facilityDbClosestJetway(found, found.latitude, found.longitude, result);
+            if (facilityDbParking(found, static_cast<uint32_t>(index), parking)) {
+                closest = closest + static_cast<int>(parking.number);
+            }
+        }
+    });
+    // The parking the aircraft stands on, from anywhere within 150 meters of the reference point
+    bench("facilityDbNearestParking", "40 parkings", 0, [&](uint64_t i) {
+        char ident[8];
+        snprintf(ident, sizeof(ident), "K%03u", static_cast<unsigned>(i % count));
+        FacilityDbAirport found;
+        DistanceAndBearing result;
+        if (facilityDbFind(ident, found)) {
+            closest = closest + facilityDbNearestParking(found, found.latitude + 0.0027 * (benchRandom() - 0.5), found.longitude + 0.0035 * (benchRandom() - 0.5), result);
+        }
+    });
+    bench("facilityDbOpen", std::to_string(count) + " airports", static_cast<size_t>(fs::file_size(path)), [&](uint64_t) {
+        facilityDbOpen(path, 1, 1);
+    });
+    bench("facilityDbStore", std::to_string(count) + " airports", static_cast<size_t>(fs::file_size(path)), [&](uint64_t) {
+        facilityDbStore(airport);
+    });
+    facilityDbClose();
+}
+
+// FREQUENCY items as the dispatcher decodes them (the fields of FacilityPlan), 5 per airport, then the rows of one
+// airport among 100000 as the frequencies command reads them
+static void benchFacilityTable() {
+    FacilityTable table;
+    facilityTableCreate(table, facilityPlanFields(SIMCONNECT_FACILITY_DATA_FREQUENCY));
+    std::vector<char> item(table.itemSize, 0);
+    char owner[8];
+    auto frequency = [&](uint64_t i) {
+        // TYPE, FREQUENCY, NAME
+        int32_t values[2] = { static_cast<int32_t>(i % 5 + 1), static_cast<int32_t>(118000000 + i % 1000 * 25000) };
+        memcpy(item.data(), values, sizeof(values));
+        snprintf(item.data() + 8, 64, "Tower %05u", static_cast<unsigned>(i % 100000));
+        snprintf(owner, sizeof(owner), "K%05u", static_cast<unsigned>(i / 5 % 20000));
+    };
+    bench("facilityTableAppend", "FREQUENCY, " + std::to_string(table.itemSize) + " bytes", table.itemSize, [&](uint64_t i) {
+        frequency(i);
+        facilityTableAppend(table, owner, item.data(), item.size());
+    });
+
+    facilityTableClear(table);
+    for (uint64_t i = 0; i < 100000; ++i) {
+        frequency(i);
+        facilityTableAppend(table, owner, item.data(), item.size());
+    }
+    int ownerColumn = facilityTableColumn(table, "OWNER");
+    volatile size_t sink = 0;
+    bench("facilityTableFind", std::to_string(table.rows) + " frequencies, one airport", 0, [&](uint64_t i) {
+        char ident[8];
+        snprintf(ident, sizeof(ident), "K%05u", static_cast<unsigned>(i * 7919 % 20000));
+        for (size_t row = facilityTableFind(table, ownerColumn, ident, 0); row < table.rows; row = facilityTableFind(table, ownerColumn, ident, row + 1)) {
+            sink = sink + row;
+        }
+    });
+}
+
+// Taxiways of a hub: a grid of taxi points 40 meters apart, a parking next to every fifth one
+static void benchTaxiGraph() {
+    const unsigned side = 60;
+    TaxiGraphRecord record;
+    record.ident = "KHUB";
+    record.latitude = 47.449;
+    record.longitude = -122.309;
+    for (unsigned row = 0; row < side; ++row) {
+        for (unsigned column = 0; column < side; ++column) {
+            int point = static_cast<int>(record.pointX.size());
+            record.pointX.push_back(40.0f * column - 1200.0f);
+            record.pointZ.push_back(40.0f * row - 1200.0f);
+            if (column > 0) {
+                record.paths.push_back({ TAXI_PATH_TAXI, point - 1, point });
+            }
+            if (row > 0) {
+                record.paths.push_back({ TAXI_PATH_TAXI, point - static_cast<int>(side), point });
+            }
+            if (point % 5 == 0) {
+                record.paths.push_back({ TAXI_PATH_PARKING, point, static_cast<int>(record.parkingX.size()) });
+                record.parkingX.push_back(record.pointX.back() + 15.0f);
+                record.parkingZ.push_back(record.pointZ.back() + 15.0f);
+            }
+        }
+    }
+    std::string input = std::to_string(record.pointX.size()) + " points, " + std::to_string(record.parkingX.size()) + " parkings";
+    uint32_t parkings = static_cast<uint32_t>(record.parkingX.size());
+
+    bench("taxiGraphBuild", input, 0, [&](uint64_t) {
+        int saved = quietStdout();
+        taxiGraphBuild(record);
+        restoreStdout(saved);
+    });
+    int saved = quietStdout();
+    taxiGraphBuild(record); // Also when the filter skips the build
+    restoreStdout(saved);
+    volatile double sink = 0;
+    // Anywhere on the airport to any parking
+    bench("taxiGraphRoute", input, 0, [&](uint64_t i) {
+        TaxiRoute route;
+        if (taxiGraphRoute("KHUB", record.latitude + 0.02 * (benchRandom() - 0.5), record.longitude + 0.03 * (benchRandom() - 0.5), static_cast<uint32_t>(i % parkings), route)) {
+            sink = sink + route.distance;
+        }
+    });
+    taxiGraphClear();
+}
+
+// Every position sample: RUNWAY_INDEX_AIRPORTS airports 5 km apart with three crossing runways each, the aircraft
+// anywhere among them (on a runway about one sample in ten)
+static void benchRunwayIndex() {
+    for (unsigned a = 0; a < RUNWAY_INDEX_AIRPORTS; ++a) {
+        double latitude = 47.0 + 0.045 * (a / 8), longitude = -122.0 + 0.066 * (a % 8);
+        RunwayRecord runways[] = {
+            { latitude, longitude, 90.0f, 3000.0f, 45.0f, 9, 0, 27, 0 },
+            { latitude + 0.004, longitude, 160.0f, 2500.0f, 45.0f, 16, 1, 34, 2 },
+            { latitude - 0.004, longitude, 160.0f, 2500.0f, 45.0f, 16, 2, 34, 1 },
+        };
+        char ident[8];
+        snprintf(ident, sizeof(ident), "R%03u", a);
+        runwayIndexStore(ident, runways, 3);
+    }
+    volatile int sink = 0;
+    bench("runwayIndexTest", std::to_string(runwayIndexSize()) + " runways", 0, [&](uint64_t i) {
+        RunwayState state;
+        unsigned a = static_cast<unsigned>(i % RUNWAY_INDEX_AIRPORTS);
+        double latitude = 47.0 + 0.045 * (a / 8) + 0.01 * (benchRandom() - 0.5), longitude = -122.0 + 0.066 * (a % 8) + 0.04 * (benchRandom() - 0.5);
+        sink = sink + runwayIndexTest(latitude, longitude, 360.0 * benchRandom(), true, state);
+    });
+    runwayIndexClear();
+}
+
+static void benchGateNames() {
+    volatile size_t sink = 0;
+    bench("formatGateName", "names 0-40", 0, [&](uint64_t i) { sink = sink + formatGateName(static_cast<int>(i % 41)).gateString.size(); });
+}
+
+static std::string jsonString(const std::string& text) {
+    std::string result = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            result += escaped;
+        }
+        else {
+            result += c;
+        }
+    }
+    return result + "\"";
+}
+
+static bool writeJson(const std::string& path) {
+    std::ofstream json(path, std::ios::trunc);
+    json << "{\n  \"benchmark\": \"MicroBench\",\n  \"quick\": " << (options.quick ? "true" : "false") << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        char numbers[128];
+        snprintf(numbers, sizeof(numbers), "\"iterations\": %llu, \"ns_per_op\": %.1f, \"bytes_per_op\": %zu",
+            static_cast<unsigned long long>(result.iterations), result.nsPerOp, result.bytesPerOp);
+        json << "    {\"name\": " << jsonString(result.name) << ", \"input\": " << jsonString(result.input) << ", " << numbers << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    json << "  ]\n}\n";
+    return json.good();
+}
+
+static bool parseOptions(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        bool value = i + 1 < argc;
+        if (strcmp(argv[i], "--filter") == 0 && value) {
+            options.filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--json") == 0 && value) {
+            options.json = argv[++i];
+        }
+        else if (strcmp(argv[i], "--corpus") == 0 && value) {
+            options.corpus = argv[++i];
+        }
+        else if (strcmp(argv[i], "--quick") == 0) {
+            options.quick = true;
+        }
+        else if (argv[i][0] == '-') {
+            return false;
+        }
+        else {
+            options.files.push_back(argv[i]);
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (!parseOptions(argc, argv)) {
+        printf("Usage: %s [--filter TEXT] [--json FILE] [--corpus DIR] [--quick] [file.FLT ...]\n", argv[0]);
+        return 1;
+    }
+
+    std::string directory = options.corpus.empty() ? (fs::temp_directory_path() / ("fsautosave-bench-" + std::to_string(getpid()))).string() : options.corpus;
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    if (ec) {
+        printf("Could not create %s\n", directory.c_str());
+        return 1;
+    }
+    std::vector<CorpusFile> corpus = buildCorpus(directory);
+
+    printf("%-32s %-26s %15s %10s %15s\n", "Benchmark", "Input", "Time/op", "Iterations", "Throughput");
+    benchPaths();
+    benchConfigFiles(corpus, directory);
+    benchFinalFLTchange(corpus, directory);
+    benchGeodesy();
+    benchFacilityDb(directory);
+    benchFacilityTable();
+    benchTaxiGraph();
+    benchRunwayIndex();
+    benchGateNames();
+
+    bool ok = true;
+    if (!options.json.empty()) {
+        ok = writeJson(options.json);
+        printf("\n%s %s\n", ok ? "Results written to" : "Could not write", options.json.c_str());
+    }
+
+    if (options.corpus.empty()) {
+        fs::remove_all(directory, ec);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,286 @@
+// Save latency: from the key press to LAST.FLT and CUSTOMFLIGHT.FLT being final, what the user waits for when saving
+// or leaving a flight. Runs the real dispatcher against the fake simulator of the headless build (Headless/FakeSim.h),
+// so the whole path is measured: finalSave and its wait for FlightSave, the closest airport, jetway and facility
+// lookups, then finalFLTchange at FACILITY_DATA_END.
+//
+// Saving again at the same gate is served by the gate cache, the airport index and the facility database, so warm saves
+// only ask for the position. Cold saves empty the three on the SimConnect thread before the key press, and pay for the
+// airport list, jetway and facility round trips (the --list-delay, --jetway-delay and --facility-delay answers).
+//
+//   SaveLatencyBench [--saves N] [--cache warm|cold|both] [--trigger hotkey|esc] [--save-delay MS] [--list-delay MS]
+//                    [--jetway-delay MS] [--facility-delay MS] [--reply-delay MS] [--flt-bytes N] [--json FILE]
+//
+//   --saves N            saves to measure, of each kind (default 50)
+//   --cache              measure warm saves, cold saves or both (default), each reported on its own
+//   --trigger            CTRL+ALT+S (hotkey, default) or ESC (the pause menu, a background save)
+//   --save-delay MS      FlightSave until the simulator has written LAST.FLT (default 50)
+//   --list-delay MS      airport list answer (default 2)
+//   --jetway-delay MS    jetway data answer (default 2)
+//   --facility-delay MS  facility data answer (default 2)
+//   --reply-delay MS     every other answer (default 2)
+//   --flt-bytes N        size of the saves the simulator writes (default: a short flight)
+//   --json FILE          also write the settings and the results as JSON
+//
+// Build: the SaveLatencyBench target of the CMake build (CMakeLists.txt at the repository root).
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "AirportIndex.h"
+#include "FacilityDb.h"
+#include "FSAutoSave.h"
+#include "GateCache.h"
+#include "Globals.h"
+#include "Utility.h"
+#include "Metrics.h"
+#include "FakeSim.h"
+
+namespace fs = std::filesystem;
+
+#define BENCH_TIMEOUT 30000     // ms to wait for the client to connect and for every save
+
+struct Options {
+    unsigned saves = 50;
+    bool warm = true;
+    bool cold = true;
+    bool esc = false;
+    FakeSimOptions sim;
+    std::string json;
+};
+
+struct Summary {
+    double min, p50, p90, p99, max, mean;
+};
+
+struct Run {
+    const char* name;
+    bool cold;
+    std::vector<double> latencies;
+    double messagesPerSave;
+    Summary summary;
+};
+
+static bool parseNumber(const char* name, int argc, char** argv, int& i, unsigned& value) {
+    if (strcmp(argv[i], name) != 0 || i + 1 >= argc) {
+        return false;
+    }
+    value = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+    return true;
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        bool value = i + 1 < argc;
+        if (parseNumber("--saves", argc, argv, i, options.saves) ||
+            parseNumber("--save-delay", argc, argv, i, options.sim.saveDelayMs) ||
+            parseNumber("--list-delay", argc, argv, i, options.sim.listDelayMs) ||
+            parseNumber("--jetway-delay", argc, argv, i, options.sim.jetwayDelayMs) ||
+            parseNumber("--facility-delay", argc, argv, i, options.sim.facilityDelayMs) ||
+            parseNumber("--reply-delay", argc, argv, i, options.sim.replyDelayMs)) {
+            continue;
+        }
+        if (strcmp(argv[i], "--trigger") == 0 && value) {
+            std::string trigger = argv[++i];
+            if (trigger != "hotkey" && trigger != "esc") {
+                return false;
+            }
+            options.esc = trigger == "esc";
+        }
+        else if (strcmp(argv[i], "--cache") == 0 && value) {
+            std::string cache = argv[++i];
+            if (cache != "warm" && cache != "cold" && cache != "both") {
+                return false;
+            }
+            options.warm = cache != "cold";
+            options.cold = cache != "warm";
+        }
+        else if (strcmp(argv[i], "--flt-bytes") == 0 && value) {
+            options.sim.fltBytes = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--json") == 0 && value) {
+            options.json = argv[++i];
+        }
+        else {
+            return false;
+        }
+    }
+    return options.saves > 0;
+}
+
+template <typename F> static bool waitFor(F done, unsigned timeoutMs) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return true;
+}
+
+// Nearest rank percentiles
+static Summary summarize(std::vector<double> latencies) {
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        size_t rank = static_cast<size_t>(p / 100.0 * latencies.size() + 0.999999);
+        return latencies[std::min(latencies.size(), std::max<size_t>(rank, 1)) - 1];
+    };
+    double total = 0;
+    for (double latency : latencies) {
+        total += latency;
+    }
+    return { latencies.front(), percentile(50), percentile(90), percentile(99), latencies.back(), total / latencies.size() };
+}
+
+static bool writeJson(const std::string& path, const Options& options, const std::vector<Run>& runs) {
+    std::ofstream json(path, std::ios::trunc);
+    char line[256];
+    json << "{\n  \"benchmark\": \"SaveLatencyBench\",\n";
+    json << "  \"trigger\": \"" << (options.esc ? "esc" : "hotkey") << "\",\n";
+    snprintf(line, sizeof(line), "  \"delays_ms\": {\"save\": %u, \"list\": %u, \"jetway\": %u, \"facility\": %u, \"reply\": %u},\n",
+        options.sim.saveDelayMs, options.sim.listDelayMs, options.sim.jetwayDelayMs, options.sim.facilityDelayMs, options.sim.replyDelayMs);
+    json << line;
+    snprintf(line, sizeof(line), "  \"flt_bytes\": %zu,\n  \"runs\": {", options.sim.fltBytes);
+    json << line;
+    for (size_t r = 0; r < runs.size(); ++r) {
+        const Run& run = runs[r];
+        snprintf(line, sizeof(line), "%s\n    \"%s\": {\"saves\": %zu, \"messages_per_save\": %.1f,\n", r ? "," : "", run.name, run.latencies.size(), run.messagesPerSave);
+        json << line;
+        snprintf(line, sizeof(line), "      \"latency_ms\": {\"min\": %.2f, \"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f, \"max\": %.2f, \"mean\": %.2f},\n",
+            run.summary.min, run.summary.p50, run.summary.p90, run.summary.p99, run.summary.max, run.summary.mean);
+        json << line << "      \"samples_ms\": [";
+        for (size_t i = 0; i < run.latencies.size(); ++i) {
+            snprintf(line, sizeof(line), "%s%.2f", i ? ", " : "", run.latencies[i]);
+            json << line;
+        }
+        json << "]}";
+    }
+    json << "\n  }\n}\n";
+    return json.good();
+}
+
+// Every cache a gate lookup can be answered from, emptied on the SimConnect thread
+static bool emptyLookupCaches() {
+    auto done = std::make_shared<std::atomic<bool>>(false);
+    fakeSimOnClientThread([done] {
+        gateCacheClear();
+        airportIndexClear();
+        facilityDbClear();
+        *done = true;
+    });
+    return waitFor([done] { return done->load(); }, BENCH_TIMEOUT);
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printf("Usage: %s [--saves N] [--cache warm|cold|both] [--trigger hotkey|esc] [--save-delay MS] [--list-delay MS]\n"
+            "       [--jetway-delay MS] [--facility-delay MS] [--reply-delay MS] [--flt-bytes N] [--json FILE]\n", argv[0]);
+        return 1;
+    }
+
+    // Same layout as an MS Store LocalState
+    localStatePath = (fs::temp_directory_path() / ("fsautosave-latency-" + std::to_string(getpid()))).string();
+    pathToMonitor = localStatePath + PATH_SEPARATOR "Missions" PATH_SEPARATOR "Custom" PATH_SEPARATOR "CustomFlight";
+    lastMOD = localStatePath + PATH_SEPARATOR "LAST.FLT";
+    customFlightmod = pathToMonitor + PATH_SEPARATOR "CustomFlight.FLT";
+    autoSaveEnabled = FALSE; // Only the saves we trigger
+
+    std::error_code ec;
+    fs::create_directories(pathToMonitor, ec);
+    FakeFlight flight;
+    flight.aircraft = options.sim.aircraft;
+    flight.bytes = options.sim.fltBytes;
+    std::string text = fakeSimFlt(flight);
+    std::ofstream(lastMOD, std::ios::binary) << text;
+    std::ofstream(customFlightmod, std::ios::binary) << text;
+    options.sim.directory = localStatePath;
+
+    fakeSimStart(options.sim);
+    std::thread simconnect(sc);
+    bool connected = fakeSimWaitForClient(BENCH_TIMEOUT);
+    bool ok = connected;
+    if (ok) {
+        fakeSimLoadFlight(lastMOD);
+        ok = waitFor([] { return metricsSaveRequests(SAVE_SOURCE_INITIAL) > 0; }, BENCH_TIMEOUT);
+    }
+
+    std::vector<Run> runs;
+    if (options.warm) {
+        runs.push_back({ "warm", false, {}, 0.0, {} });
+    }
+    if (options.cold) {
+        runs.push_back({ "cold", true, {}, 0.0, {} });
+    }
+
+    // The first save warms up and is not measured. ESC only saves once the user saved during the flight
+    // (saveDuringPause), so it is a hotkey save
+    for (unsigned i = 0; ok && i <= runs.size() * options.saves; ++i) {
+        Run* run = i > 0 ? &runs[(i - 1) / options.saves] : nullptr;
+        bool esc = options.esc && run != nullptr;
+        if (run != nullptr && run->cold && !emptyLookupCaches()) {
+            ok = false;
+            break;
+        }
+        size_t messagesBefore = fakeSimMessages();
+        uint64_t before = metricsSavesCommitted();
+        auto pressed = std::chrono::steady_clock::now();
+        if (esc) {
+            fakeSimPause(true);
+        }
+        else {
+            fakeSimInput("VK_LCONTROL+VK_LMENU+s");
+        }
+        ok = waitFor([before] { return metricsSavesCommitted() > before; }, BENCH_TIMEOUT);
+        double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pressed).count();
+        if (esc) {
+            fakeSimPause(false);
+        }
+        if (ok && run != nullptr) {
+            run->latencies.push_back(latency);
+            run->messagesPerSave += static_cast<double>(fakeSimMessages() - messagesBefore) / options.saves;
+        }
+    }
+
+    fakeSimQuit();
+    if (!connected) {
+        quit = 1; // Still trying to open the connection
+    }
+    simconnect.join();
+    fs::remove_all(localStatePath, ec);
+
+    size_t measured = 0;
+    for (const Run& run : runs) {
+        measured += run.latencies.size();
+    }
+    if (!ok || measured != runs.size() * options.saves) {
+        fprintf(stderr, "\n[LATENCY] FAILED: %zu/%zu saves committed\n", measured, runs.size() * options.saves);
+        return 1;
+    }
+
+    // The dispatcher prints to stdout, the results go to stderr
+    fprintf(stderr, "\n[LATENCY] %u %s saves of each kind, delays save %u ms, list %u ms, jetway %u ms, facility %u ms, reply %u ms\n",
+        options.saves, options.esc ? "ESC" : "CTRL+ALT+S", options.sim.saveDelayMs, options.sim.listDelayMs, options.sim.jetwayDelayMs,
+        options.sim.facilityDelayMs, options.sim.replyDelayMs);
+    for (Run& run : runs) {
+        run.summary = summarize(run.latencies);
+        fprintf(stderr, "[LATENCY] %s: key press to committed: min %.1f  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f  mean %.1f ms (%.1f SimConnect messages per save)\n",
+            run.name, run.summary.min, run.summary.p50, run.summary.p90, run.summary.p99, run.summary.max, run.summary.mean, run.messagesPerSave);
+    }
+
+    if (!options.json.empty() && !writeJson(options.json, options, runs)) {
+        fprintf(stderr, "[LATENCY] Could not write %s\n", options.json.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AirportIndex.h"
+#include "Geodesy.h"
+
+static std::vector<AirportIndexEntry> entries;
+static std::vector<UnitVector> points;                  // Same order as entries
+static std::vector<std::string> keys;
+static std::unordered_map<std::string, size_t> byKey;   // ident + region -> entries index
+
+// k-d tree: tree[lo, hi) is a node split at its middle element on axes[middle]
+static std::vector<uint32_t> tree;
+static std::vector<uint8_t> axes;
+static bool treeDirty = false;
+
+static std::string airportKey(const SIMCONNECT_DATA_FACILITY_AIRPORT& airport) {
+    return std::string(airport.Ident, strnlen(airport.Ident, sizeof(airport.Ident))) + "/" +
+        std::string(airport.Region, strnlen(airport.Region, sizeof(airport.Region)));
+}
+
+static double axisValue(const UnitVector& point, int axis) {
+    return axis == 0 ? point.x : axis == 1 ? point.y : point.z;
+}
+
+static void buildTree(size_t lo, size_t hi) {
+    if (hi - lo <= 1) {
+        return;
+    }
+    // Split on the axis the points spread the most
+    double low[3] = { 2, 2, 2 }, high[3] = { -2, -2, -2 };
+    for (size_t i = lo; i < hi; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            double value = axisValue(points[tree[i]], axis);
+            low[axis] = std::min(low[axis], value);
+            high[axis] = std::max(high[axis], value);
+        }
+    }
+    int axis = 0;
+    for (int candidate = 1; candidate < 3; ++candidate) {
+        if (high[candidate] - low[candidate] > high[axis] - low[axis]) {
+            axis = candidate;
+        }
+    }
+
+    size_t middle = lo + (hi - lo) / 2;
+    std::nth_element(tree.begin() + lo, tree.begin() + middle, tree.begin() + hi, [axis](uint32_t a, uint32_t b) {
+        return axisValue(points[a], axis) < axisValue(points[b], axis);
+    });
+    axes[middle] = static_cast<uint8_t>(axis);
+    buildTree(lo, middle);
+    buildTree(middle + 1, hi);
+}
+
+static void rebuildTree() {
+    tree.resize(entries.size());
+    axes.assign(entries.size(), 0);
+    for (size_t i = 0; i < tree.size(); ++i) {
+        tree[i] = static_cast<uint32_t>(i);
+    }
+    buildTree(0, tree.size());
+    treeDirty = false;
+}
+
+static void searchTree(size_t lo, size_t hi, const UnitVector& query, uint32_t& best, double& bestChord) {
+    if (lo >= hi) {
+        return;
+    }
+    size_t middle = lo + (hi - lo) / 2;
+    const UnitVector& point = points[tree[middle]];
+    double dx = point.x - query.x, dy = point.y - query.y, dz = point.z - query.z;
+    double chord = dx * dx + dy * dy + dz * dz;
+    if (chord < bestChord) {
+        bestChord = chord;
+        best = tree[middle];
+    }
+    if (hi - lo == 1) {
+        return;
+    }
+
+    // The side of the query first, the other side only if it can hold something closer
+    int axis = axes[middle];
+    double delta = axisValue(query, axis) - axisValue(point, axis);
+    if (delta < 0) {
+        searchTree(lo, middle, query, best, bestChord);
+        if (delta * delta < bestChord) {
+            searchTree(middle + 1, hi, query, best, bestChord);
+        }
+    }
+    else {
+        searchTree(middle + 1, hi, query, best, bestChord);
+        if (delta * delta < bestChord) {
+            searchTree(lo, middle, query, best, bestChord);
+        }
+    }
+}
+
+static void searchRange(size_t lo, size_t hi, const UnitVector& query, double maxChord, std::vector<AirportIndexEntry>& found) {
+    if (lo >= hi) {
+        return;
+    }
+    size_t middle = lo + (hi - lo) / 2;
+    const UnitVector& point = points[tree[middle]];
+    double dx = point.x - query.x, dy = point.y - query.y, dz = point.z - query.z;
+    if (dx * dx + dy * dy + dz * dz <= maxChord) {
+        found.push_back(entries[tree[middle]]);
+    }
+    if (hi - lo == 1) {
+        return;
+    }
+
+    int axis = axes[middle];
+    double delta = axisValue(query, axis) - axisValue(point, axis);
+    if (delta < 0 || delta * delta <= maxChord) {
+        searchRange(lo, middle, query, maxChord, found);
+    }
+    if (delta >= 0 || delta * delta <= maxChord) {
+        searchRange(middle + 1, hi, query, maxChord, found);
+    }
+}
+
+void airportIndexAdd(const SIMCONNECT_DATA_FACILITY_AIRPORT* airports, unsigned count) {
+    for (unsigned i = 0; i < count; ++i) {
+        const SIMCONNECT_DATA_FACILITY_AIRPORT& airport = airports[i];
+        if (airport.Ident[0] == '\0') {
+            continue;
+        }
+        AirportIndexEntry entry = {};
+        memcpy(entry.ident, airport.Ident, strnlen(airport.Ident, sizeof(airport.Ident)));
+        memcpy(entry.region, airport.Region, strnlen(airport.Region, sizeof(airport.Region)));
+        entry.latitude = airport.Latitude;
+        entry.longitude = airport.Longitude;
+        entry.altitude = airport.Altitude;
+
+        // An airport sent again replaces the one we have
+        std::string key = airportKey(airport);
+        auto inserted = byKey.emplace(key, entries.size());
+        if (inserted.second) {
+            entries.push_back(entry);
+            keys.push_back(key);
+            points.push_back(toUnitVector(entry.latitude, entry.longitude));
+        }
+        else {
+            entries[inserted.first->second] = entry;
+            points[inserted.first->second] = toUnitVector(entry.latitude, entry.longitude);
+        }
+    }
+    treeDirty = true;
+}
+
+void airportIndexRemove(const SIMCONNECT_DATA_FACILITY_AIRPORT* airports, unsigned count) {
+    for (unsigned i = 0; i < count; ++i) {
+        auto it = byKey.find(airportKey(airports[i]));
+        if (it == byKey.end()) {
+            continue;
+        }
+        // The last entry takes the place of the removed one
+        size_t index = it->second;
+        size_t last = entries.size() - 1;
+        byKey.erase(it);
+        if (index != last) {
+            entries[index] = entries[last];
+            points[index] = points[last];
+            keys[index] = keys[last];
+            byKey[keys[index]] = index;
+        }
+        entries.pop_back();
+        points.pop_back();
+        keys.pop_back();
+    }
+    treeDirty = true;
+}
+
+void airportIndexClear() {
+    entries.clear();
+    points.clear();
+    keys.clear();
+    byKey.clear();
+    tree.clear();
+    axes.clear();
+    treeDirty = false;
+}
+
+size_t airportIndexSize() {
+    return entries.size();
+}
+
+bool airportIndexNearest(double latitude, double longitude, AirportIndexEntry& nearest, double& distance) {
+    if (entries.empty()) {
+        return false;
+    }
+    if (treeDirty) {
+        rebuildTree();
+    }
+    uint32_t best = 0;
+    double bestChord = 5.0; // Longer than any chord of the unit sphere (4)
+    searchTree(0, tree.size(), toUnitVector(latitude, longitude), best, bestChord);
+    nearest = entries[best];
+    distance = chordToMeters(bestChord);
+    return true;
+}
+
+void airportIndexWithin(double latitude, double longitude, double radius, std::vector<AirportIndexEntry>& airports) {
+    airports.clear();
+    if (entries.empty()) {
+        return;
+    }
+    if (treeDirty) {
+        rebuildTree();
+    }
+    // Squared chord of the radius on the unit sphere
+    double chord = 2 * sin(radius / 6371000 / 2);
+    searchRange(0, tree.size(), toUnitVector(latitude, longitude), chord * chord, airports);
+}
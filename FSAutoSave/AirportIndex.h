@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "SimConnect.h"
+
+// Airports around the user aircraft, so the gate lookup finds the closest one without asking MSFS for its airport list.
+//
+// Filled from the facilities subscription (SimConnect_SubscribeToFacilities_EX1): airports entering the reality bubble
+// are added, the ones leaving it removed. Positions are kept as unit vectors, the closest airport is the one with the
+// shortest chord, which is right at any latitude and across the antimeridian. Queries walk a k-d tree over the unit
+// vectors, rebuilt on the first query after the airports changed.
+//
+// All functions are called from the SimConnect thread.
+
+struct AirportIndexEntry {
+    char ident[8];              // Ident and region, NUL terminated
+    char region[4];
+    double latitude;            // Degrees
+    double longitude;
+    double altitude;            // Meters
+};
+
+void airportIndexAdd(const SIMCONNECT_DATA_FACILITY_AIRPORT* airports, unsigned count);
+void airportIndexRemove(const SIMCONNECT_DATA_FACILITY_AIRPORT* airports, unsigned count);
+void airportIndexClear();
+size_t airportIndexSize();
+
+// Closest airport to the position and its great circle distance in meters, false when the index is empty
+bool airportIndexNearest(double latitude, double longitude, AirportIndexEntry& nearest, double& distance);
+// Airports within radius meters of the position, in no particular order
+void airportIndexWithin(double latitude, double longitude, double radius, std::vector<AirportIndexEntry>& airports);
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include "AutoSave.h"
+
+// Autosave interval per phase, in sim seconds (0 = no autosave in that phase)
+static const double phaseIntervals[PHASE_COUNT] = {
+    0,      // UNKNOWN
+    0,      // PARKED: nothing to lose
+    300,    // TAXI
+    60,     // TAKEOFF
+    120,    // CLIMB
+    900,    // CRUISE
+    180,    // DESCENT
+    60,     // APPROACH
+};
+
+static FLIGHT_PHASE phase = PHASE_UNKNOWN;
+static FLIGHT_PHASE candidate = PHASE_UNKNOWN;
+static int candidateSamples = 0;
+static bool phaseChanged = false;
+
+static int64_t lastSample = 0;
+static double simSecondsSinceSave = 0.0;
+static int64_t lastSaveAt = 0;          // Real time of the last save (any kind)
+static int64_t nextAllowedAt = 0;       // Earliest real time for the next autosave (duty cycle budget)
+static int64_t runStartedAt = 0;
+
+static bool isAirborne(FLIGHT_PHASE value) {
+    return value == PHASE_CLIMB || value == PHASE_CRUISE || value == PHASE_DESCENT || value == PHASE_APPROACH;
+}
+
+// Phase the sample looks like. The current phase widens its own thresholds so we don't bounce on the edges
+static FLIGHT_PHASE classify(const PhaseSample& sample) {
+    if (sample.onGround) {
+        // Holding on the runway is the start of the takeoff (or the end of the landing), not parking
+        if (sample.linedUp) {
+            return isAirborne(phase) ? PHASE_APPROACH : PHASE_TAKEOFF;
+        }
+        if (sample.groundSpeed < (phase == PHASE_PARKED ? 3.0 : 1.0)) {
+            return PHASE_PARKED;
+        }
+        if (sample.groundSpeed < (phase == PHASE_TAKEOFF || phase == PHASE_APPROACH ? 30.0 : 40.0)) {
+            return PHASE_TAXI;
+        }
+        return isAirborne(phase) ? PHASE_APPROACH : PHASE_TAKEOFF; // Landing rollout or takeoff roll
+    }
+
+    double vs = sample.verticalSpeed;
+    if (phase == PHASE_TAKEOFF && sample.altitudeAGL < 1500.0 && vs > 0.0) {
+        return PHASE_TAKEOFF;
+    }
+    if (sample.altitudeAGL < 2500.0 && (vs < -300.0 || phase == PHASE_APPROACH || phase == PHASE_DESCENT)) {
+        return PHASE_APPROACH;
+    }
+    if (vs > (phase == PHASE_CLIMB ? 200.0 : 500.0)) {
+        return PHASE_CLIMB;
+    }
+    if (vs < (phase == PHASE_DESCENT ? -200.0 : -500.0)) {
+        return PHASE_DESCENT;
+    }
+    return PHASE_CRUISE;
+}
+
+void autosaveReset(int64_t now) {
+    phase = PHASE_UNKNOWN;
+    candidate = PHASE_UNKNOWN;
+    candidateSamples = 0;
+    phaseChanged = false;
+    lastSample = now;
+    simSecondsSinceSave = 0.0;
+    lastSaveAt = now;
+    nextAllowedAt = now;
+}
+
+bool autosaveSample(const PhaseSample& sample, int64_t now) {
+    double simRate = std::min(std::max(sample.simRate, 0.0), AUTOSAVE_MAX_SIM_RATE);
+    double elapsed = std::max<int64_t>(now - lastSample, 0) / 1000.0;
+    lastSample = now;
+    simSecondsSinceSave += elapsed * simRate;
+
+    FLIGHT_PHASE observed = classify(sample);
+    if (observed == phase) {
+        candidateSamples = 0;
+    }
+    else {
+        if (observed != candidate) {
+            candidate = observed;
+            candidateSamples = 0;
+        }
+        bool groundChange = isAirborne(phase) != isAirborne(observed) && phase != PHASE_TAKEOFF && observed != PHASE_TAKEOFF;
+        if (++candidateSamples >= (groundChange || phase == PHASE_UNKNOWN ? AUTOSAVE_CONFIRM_GROUND : AUTOSAVE_CONFIRM_SAMPLES)) {
+            phase = observed;
+            candidateSamples = 0;
+            phaseChanged = true;
+        }
+    }
+
+    // Switching to a busier phase shortens the wait right away since the interval is checked against the last save
+    double interval = phaseIntervals[phase];
+    if (interval <= 0.0 || simSecondsSinceSave < interval) {
+        return false;
+    }
+    return now >= nextAllowedAt && now - lastSaveAt >= AUTOSAVE_MIN_INTERVAL * 1000;
+}
+
+void autosaveStarted(int64_t now) {
+    runStartedAt = now;
+    autosaveNoteSave(now);
+}
+
+void autosaveFinished(int64_t now) {
+    // A run that took d ms buys the next one d / AUTOSAVE_MAX_DUTY ms of quiet
+    int64_t duration = std::max<int64_t>(now - runStartedAt, 0);
+    nextAllowedAt = runStartedAt + static_cast<int64_t>(duration / AUTOSAVE_MAX_DUTY);
+}
+
+void autosaveNoteSave(int64_t now) {
+    simSecondsSinceSave = 0.0;
+    lastSaveAt = now;
+}
+
+FLIGHT_PHASE autosavePhase() {
+    return phase;
+}
+
+bool autosavePhaseChanged() {
+    bool changed = phaseChanged;
+    phaseChanged = false;
+    return changed;
+}
+
+const char* flightPhaseName(FLIGHT_PHASE value) {
+    static const char* names[PHASE_COUNT] = { "UNKNOWN", "PARKED", "TAXI", "TAKEOFF", "CLIMB", "CRUISE", "DESCENT", "APPROACH" };
+    return value < PHASE_COUNT ? names[value] : "UNKNOWN";
+}
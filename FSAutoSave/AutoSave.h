@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+// Periodic autosave driven by the flight phase. The REQUEST_POSITION samples (once per second) go through a small
+// phase detector; each phase has its own autosave interval in sim seconds, so at 4x sim rate saves come 4 times as
+// often in real time. A duty cycle budget keeps the time spent saving (FlightSave, the wait for the file and the .FLT
+// fixes, which is mostly I/O) below AUTOSAVE_MAX_DUTY of the wall clock whatever the phase and sim rate ask for.
+
+#define AUTOSAVE_CONFIRM_SAMPLES 5      // Samples a new phase must hold before we switch to it (hysteresis)
+#define AUTOSAVE_CONFIRM_GROUND 2       // Same, for lifting off and touching down (the ground flag does not flicker)
+#define AUTOSAVE_MIN_INTERVAL 30        // Real seconds between autosaves, whatever the sim rate
+#define AUTOSAVE_MAX_DUTY 0.02          // Fraction of the wall clock we may spend saving
+#define AUTOSAVE_MAX_SIM_RATE 16.0
+
+enum FLIGHT_PHASE {
+    PHASE_UNKNOWN,
+    PHASE_PARKED,
+    PHASE_TAXI,
+    PHASE_TAKEOFF,      // Takeoff roll and initial climb
+    PHASE_CLIMB,
+    PHASE_CRUISE,
+    PHASE_DESCENT,
+    PHASE_APPROACH,     // Final descent, pattern work, landing and rollout
+    PHASE_COUNT
+};
+
+struct PhaseSample {
+    bool onGround;
+    bool linedUp;           // On a runway and pointing along it (RunwayIndex.h)
+    double groundSpeed;     // Knots
+    double verticalSpeed;   // Feet per minute
+    double altitudeAGL;     // Feet
+    double simRate;         // 1.0 is real time
+};
+
+// Starts over (new flight). now is steady clock milliseconds for all functions
+void autosaveReset(int64_t now);
+// Feeds one sample. Returns true when an autosave is due
+bool autosaveSample(const PhaseSample& sample, int64_t now);
+// An autosave run started/finished (used for the duty cycle budget)
+void autosaveStarted(int64_t now);
+void autosaveFinished(int64_t now);
+// Any other save also counts as a fresh save for the interval
+void autosaveNoteSave(int64_t now);
+
+FLIGHT_PHASE autosavePhase();
+bool autosavePhaseChanged();    // True once after the detector switched phase
+const char* flightPhaseName(FLIGHT_PHASE phase);
@@ -0,0 +1,320 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include "Catalog.h"
+#include "Hash.h"
+
+#ifdef _WIN32
+static HANDLE catalogFile = INVALID_HANDLE_VALUE;
+static HANDLE catalogMapping = NULL;
+#else
+static int catalogFile = -1;
+#endif
+
+static char* catalogView = nullptr;
+static bool catalogReadOnly = false;
+static uint64_t catalogCapacity = 0;                                // Records the mapping has room for
+static std::unordered_map<uint64_t, uint64_t> catalogNewest;        // aircraftHash -> newest index
+
+static CatalogHeader* catalogHeader() {
+    return reinterpret_cast<CatalogHeader*>(catalogView);
+}
+
+static uint64_t catalogBytes(uint64_t capacity) {
+    return sizeof(CatalogHeader) + capacity * sizeof(CatalogEntry);
+}
+
+static void catalogUnmap() {
+    if (catalogView == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(catalogView);
+    CloseHandle(catalogMapping);
+    catalogMapping = NULL;
+#else
+    munmap(catalogView, catalogBytes(catalogCapacity));
+#endif
+    catalogView = nullptr;
+    catalogCapacity = 0;
+}
+
+// Maps the file with room for capacity records, growing it if it is smaller
+static bool catalogMap(uint64_t capacity) {
+    catalogUnmap();
+    uint64_t bytes = catalogBytes(capacity);
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(catalogFile, &size)) {
+        return false;
+    }
+    if (static_cast<uint64_t>(size.QuadPart) < bytes) {
+        if (catalogReadOnly) {
+            return false;
+        }
+        LARGE_INTEGER end;
+        end.QuadPart = static_cast<LONGLONG>(bytes);
+        if (!SetFilePointerEx(catalogFile, end, NULL, FILE_BEGIN) || !SetEndOfFile(catalogFile)) {
+            return false; // Also fails while another process has the file mapped (-CATALOG running)
+        }
+    }
+    catalogMapping = CreateFileMappingA(catalogFile, NULL, catalogReadOnly ? PAGE_READONLY : PAGE_READWRITE, static_cast<DWORD>(bytes >> 32), static_cast<DWORD>(bytes), NULL);
+    if (catalogMapping == NULL) {
+        return false;
+    }
+    catalogView = static_cast<char*>(MapViewOfFile(catalogMapping, catalogReadOnly ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(bytes)));
+    if (catalogView == nullptr) {
+        CloseHandle(catalogMapping);
+        catalogMapping = NULL;
+        return false;
+    }
+#else
+    struct stat info;
+    if (fstat(catalogFile, &info) != 0) {
+        return false;
+    }
+    if (static_cast<uint64_t>(info.st_size) < bytes && (catalogReadOnly || ftruncate(catalogFile, static_cast<off_t>(bytes)) != 0)) {
+        return false;
+    }
+    void* view = mmap(nullptr, bytes, catalogReadOnly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, catalogFile, 0);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    catalogView = static_cast<char*>(view);
+#endif
+    catalogCapacity = capacity;
+    return true;
+}
+
+static uint64_t catalogFileSize() {
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    return GetFileSizeEx(catalogFile, &size) ? static_cast<uint64_t>(size.QuadPart) : 0;
+#else
+    struct stat info;
+    return fstat(catalogFile, &info) == 0 ? static_cast<uint64_t>(info.st_size) : 0;
+#endif
+}
+
+void catalogClose() {
+    catalogUnmap();
+#ifdef _WIN32
+    if (catalogFile != INVALID_HANDLE_VALUE) {
+        CloseHandle(catalogFile);
+        catalogFile = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (catalogFile >= 0) {
+        close(catalogFile);
+        catalogFile = -1;
+    }
+#endif
+    catalogNewest.clear();
+}
+
+bool catalogOpen(const std::string& path, bool readOnly) {
+    catalogClose();
+    catalogReadOnly = readOnly;
+#ifdef _WIN32
+    catalogFile = readOnly ? CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL)
+                           : CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    bool opened = catalogFile != INVALID_HANDLE_VALUE;
+    bool missing = !opened && GetLastError() == ERROR_FILE_NOT_FOUND;
+#else
+    catalogFile = readOnly ? open(path.c_str(), O_RDONLY) : open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    bool opened = catalogFile >= 0;
+    bool missing = !opened && errno == ENOENT;
+#endif
+    if (!opened) {
+        if (!readOnly || !missing) { // A reader finding no file has nothing to list yet
+            printf("[CATALOG] Could not open %s\n", path.c_str());
+        }
+        return false;
+    }
+
+    uint64_t existing = catalogFileSize();
+    uint64_t capacity = existing > sizeof(CatalogHeader) ? (existing - sizeof(CatalogHeader)) / sizeof(CatalogEntry) : 0;
+    if (readOnly && existing < sizeof(CatalogHeader)) {
+        catalogClose(); // Created by a writer that has not mapped it yet
+        return false;
+    }
+    if (!catalogMap(readOnly ? capacity : std::max<uint64_t>(capacity, CATALOG_GROW))) {
+        printf("[CATALOG] Could not map %s\n", path.c_str());
+        catalogClose();
+        return false;
+    }
+
+    // A reader takes an empty header as is, the writer may not have filled it in yet
+    CatalogHeader* header = catalogHeader();
+    if (!readOnly && (existing < sizeof(CatalogHeader) || header->count == 0)) {
+        memset(header, 0, sizeof(CatalogHeader));
+        memcpy(header->magic, CATALOG_MAGIC, sizeof(header->magic));
+        header->entrySize = sizeof(CatalogEntry);
+    }
+    else if (header->count != 0 && (memcmp(header->magic, CATALOG_MAGIC, sizeof(header->magic)) != 0 || header->entrySize != sizeof(CatalogEntry) || header->count > catalogCapacity)) {
+        printf("[CATALOG] %s has an unknown format, the catalog is disabled\n", path.c_str());
+        catalogClose();
+        return false;
+    }
+
+    for (uint64_t i = 0; i < catalogCount(); ++i) {
+        catalogNewest[catalogAt(i)->aircraftHash] = i;
+    }
+    return true;
+}
+
+// --- .FLT fields ----------------------------------------------------------------------------------------------------
+
+static bool equalsIgnoreCase(const char* a, size_t length, const char* b) {
+    for (size_t i = 0; i < length; ++i) {
+        if (b[i] == '\0' || tolower(static_cast<unsigned char>(a[i])) != tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return b[length] == '\0';
+}
+
+static void copyField(char* target, size_t size, const std::string& value) {
+    size_t length = std::min(value.size(), size - 1);
+    memcpy(target, value.data(), length);
+    target[length] = '\0';
+}
+
+// "N47° 26' 49.32"" style coordinates. The degree sign may be UTF-8 or ANSI, so only the numbers are looked at
+static double parseAngle(const std::string& value) {
+    double parts[3] = { 0, 0, 0 };
+    int count = 0;
+    const char* p = value.c_str();
+    while (*p != '\0' && count < 3) {
+        if ((*p >= '0' && *p <= '9') || *p == '.') {
+            char* end = nullptr;
+            parts[count++] = strtod(p, &end);
+            p = end;
+        }
+        else {
+            ++p;
+        }
+    }
+    double degrees = parts[0] + parts[1] / 60.0 + parts[2] / 3600.0;
+    char hemisphere = value.empty() ? 'N' : static_cast<char>(toupper(static_cast<unsigned char>(value[0])));
+    return hemisphere == 'S' || hemisphere == 'W' ? -degrees : degrees;
+}
+
+void catalogDescribe(const std::string& flt, CatalogEntry& entry) {
+    struct Wanted {
+        const char* section;
+        const char* key;
+        std::string value;
+    } wanted[] = {
+        { "Sim.0", "Sim", "" },
+        { "Main", "FlightVersion", "" },
+        { "Departure", "ICAO", "" },
+        { "Departure", "GateName", "" },
+        { "Departure", "GateNumber", "" },
+        { "Departure", "GateSuffix", "" },
+        { "SimVars.0", "Latitude", "" },
+        { "SimVars.0", "Longitude", "" },
+        { "SimVars.0", "Altitude", "" },
+        { "SimVars.0", "SimOnGround", "" },
+        { "SimScheduler", "SimTime", "" },
+    };
+
+    // One pass over the lines; a value is only taken from the first matching key, like GetPrivateProfileString
+    const char* section = "";
+    size_t sectionLength = 0;
+    size_t pos = 0;
+    while (pos < flt.size()) {
+        size_t end = flt.find('\n', pos);
+        if (end == std::string::npos) {
+            end = flt.size();
+        }
+        size_t lineEnd = end > pos && flt[end - 1] == '\r' ? end - 1 : end;
+        const char* line = flt.data() + pos;
+        size_t length = lineEnd - pos;
+
+        if (length > 1 && line[0] == '[') {
+            const char* close = static_cast<const char*>(memchr(line, ']', length));
+            section = line + 1;
+            sectionLength = close != nullptr ? static_cast<size_t>(close - section) : length - 1;
+        }
+        else {
+            const char* equals = static_cast<const char*>(memchr(line, '=', length));
+            if (equals != nullptr) {
+                size_t keyLength = static_cast<size_t>(equals - line);
+                for (Wanted& field : wanted) {
+                    if (field.value.empty() && equalsIgnoreCase(section, sectionLength, field.section) && equalsIgnoreCase(line, keyLength, field.key)) {
+                        field.value.assign(equals + 1, lineEnd - pos - keyLength - 1);
+                    }
+                }
+            }
+        }
+        pos = end + 1;
+    }
+
+    entry.aircraftHash = hash64(wanted[0].value);
+    copyField(entry.aircraft, sizeof(entry.aircraft), wanted[0].value);
+    entry.flightVersion = static_cast<uint32_t>(strtoul(wanted[1].value.c_str(), nullptr, 10));
+    copyField(entry.departureICAO, sizeof(entry.departureICAO), wanted[2].value);
+    std::string gate = wanted[3].value;
+    if (!wanted[4].value.empty() && wanted[4].value != "0") {
+        gate += " " + wanted[4].value + wanted[5].value;
+    }
+    copyField(entry.departureGate, sizeof(entry.departureGate), gate);
+    entry.latitude = parseAngle(wanted[6].value);
+    entry.longitude = parseAngle(wanted[7].value);
+    entry.altitude = strtod(wanted[8].value.c_str(), nullptr);
+    entry.onGround = wanted[9].value == "True" ? 1 : 0;
+    entry.simTime = static_cast<uint32_t>(strtod(wanted[10].value.c_str(), nullptr));
+}
+
+// --- Entries --------------------------------------------------------------------------------------------------------
+
+bool catalogAppend(const CatalogEntry& entry) {
+    if (catalogView == nullptr || catalogReadOnly) {
+        return false;
+    }
+    uint64_t count = catalogHeader()->count;
+    uint64_t capacity = catalogCapacity;
+    if (count == capacity && !catalogMap(capacity + CATALOG_GROW)) {
+        printf("[CATALOG] Could not grow the catalog, save not listed\n");
+        catalogMap(capacity);
+        return false;
+    }
+
+    memcpy(catalogView + catalogBytes(count), &entry, sizeof(CatalogEntry));
+    std::atomic_thread_fence(std::memory_order_release); // Record before count
+    catalogHeader()->count = count + 1;
+    catalogNewest[entry.aircraftHash] = count;
+    return true;
+}
+
+uint64_t catalogCount() {
+    // A reader's mapping does not follow the writer growing the file
+    return catalogView != nullptr ? std::min(catalogHeader()->count, catalogCapacity) : 0;
+}
+
+const CatalogEntry* catalogAt(uint64_t index) {
+    if (index >= catalogCount()) {
+        return nullptr;
+    }
+    return reinterpret_cast<const CatalogEntry*>(catalogView + catalogBytes(index));
+}
+
+const CatalogEntry* catalogLatestFor(const std::string& aircraft) {
+    auto it = catalogNewest.find(hash64(aircraft));
+    return it != catalogNewest.end() ? catalogAt(it->second) : nullptr;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Catalog of every committed save, so listing saves or finding the last one of an aircraft does not open any .FLT.
+//
+// One file (CATALOG_FILE in the history directory) mapped in memory: a CatalogHeader followed by fixed size
+// CatalogEntry records in commit order. Entries are only appended; the count in the header is updated after the
+// record is written, so a reader mapping the file sees whole records only. The file grows CATALOG_GROW records at a
+// time. Entries outlive the history retention, restoring a generation that was dropped since tells so.
+
+#define CATALOG_FILE "catalog.fsc"
+#define CATALOG_MAGIC "FSACAT01"
+#define CATALOG_GROW 4096
+
+#pragma pack(push, 8)
+struct CatalogHeader {
+    char magic[8];              // CATALOG_MAGIC
+    uint32_t entrySize;         // sizeof(CatalogEntry) of the writer
+    uint32_t reserved;
+    uint64_t count;             // Records in use
+    uint8_t padding[40];
+};
+
+struct CatalogEntry {
+    uint64_t generation;        // History generation holding the files
+    int64_t takenAt;            // Unix time in milliseconds
+    uint64_t aircraftHash;      // hash64 of the full [Sim.0] Sim title (aircraft may be truncated)
+    double latitude;            // Degrees
+    double longitude;
+    double altitude;            // Feet
+    uint32_t simTime;           // [SimScheduler] SimTime, seconds
+    uint32_t flightVersion;     // [Main] FlightVersion
+    uint8_t onGround;
+    uint8_t reserved[7];
+    char aircraft[128];         // Strings are NUL terminated UTF-8
+    char flight[32];
+    char departureICAO[8];
+    char departureGate[24];     // e.g. "GATE_A 12"
+};
+#pragma pack(pop)
+
+static_assert(sizeof(CatalogHeader) == 64, "CatalogHeader is part of the file format");
+static_assert(sizeof(CatalogEntry) == 256, "CatalogEntry is part of the file format");
+
+// readOnly maps the file as it is (an absent file is an empty catalog) and refuses catalogAppend
+bool catalogOpen(const std::string& path, bool readOnly = false);
+void catalogClose();
+
+// Fills entry from the text of a .FLT (aircraft, departure, position, SimTime, FlightVersion)
+void catalogDescribe(const std::string& flt, CatalogEntry& entry);
+bool catalogAppend(const CatalogEntry& entry);
+
+uint64_t catalogCount();
+// Entry index (0 = oldest). Points into the mapping, valid until the next catalogAppend
+const CatalogEntry* catalogAt(uint64_t index);
+// Newest entry of the aircraft with this exact title, nullptr if none
+const CatalogEntry* catalogLatestFor(const std::string& aircraft);
@@ -0,0 +1,440 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "Compression.h"
+#include "Hash.h"
+
+#define FSZ_HASH_BITS_MAX 14
+#define FSZ_HASH_BITS_MIN 8
+#define FSZ_BLOCK_HEADER 12
+
+static inline uint32_t read32(const unsigned char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t hashPosition(const unsigned char* p, int bits) {
+    return (read32(p) * 2654435761u) >> (32 - bits);
+}
+
+static inline size_t matchLength(const unsigned char* a, const unsigned char* b, const unsigned char* end) {
+    const unsigned char* start = b;
+    while (b + 8 <= end) {
+        uint64_t x, y;
+        memcpy(&x, a, 8);
+        memcpy(&y, b, 8);
+        if (x != y) {
+            uint64_t diff = x ^ y;
+            size_t bytes = 0;
+            while ((diff & 0xFF) == 0) { // Little endian: the first differing byte is the lowest one
+                diff >>= 8;
+                ++bytes;
+            }
+            return static_cast<size_t>(b - start) + bytes;
+        }
+        a += 8;
+        b += 8;
+    }
+    while (b < end && *a == *b) {
+        ++a;
+        ++b;
+    }
+    return static_cast<size_t>(b - start);
+}
+
+static inline bool putLength(unsigned char*& op, const unsigned char* oend, size_t length) {
+    while (length >= 255) {
+        if (op >= oend) {
+            return false;
+        }
+        *op++ = 255;
+        length -= 255;
+    }
+    if (op >= oend) {
+        return false;
+    }
+    *op++ = static_cast<unsigned char>(length);
+    return true;
+}
+
+// Writes one sequence. matchLength 0 means literals only (end of block)
+static bool putSequence(unsigned char*& op, const unsigned char* oend, const unsigned char* literals, size_t literalLength, size_t offset, size_t length) {
+    size_t matchCode = length ? length - FSZ_MIN_MATCH : 0;
+    if (op >= oend) {
+        return false;
+    }
+    *op++ = static_cast<unsigned char>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15));
+    if (literalLength >= 15 && !putLength(op, oend, literalLength - 15)) {
+        return false;
+    }
+    if (static_cast<size_t>(oend - op) < literalLength) {
+        return false;
+    }
+    memcpy(op, literals, literalLength);
+    op += literalLength;
+    if (length == 0) {
+        return true;
+    }
+    if (oend - op < 2) {
+        return false;
+    }
+    *op++ = static_cast<unsigned char>(offset & 0xFF);
+    *op++ = static_cast<unsigned char>(offset >> 8);
+    return matchCode < 15 || putLength(op, oend, matchCode - 15);
+}
+
+size_t fszBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+size_t fszCompressBlock(const char* src, size_t size, char* dst, size_t dstCapacity, const char* dictionary, size_t dictionarySize) {
+    // Matches are found in one contiguous buffer: the end of the dictionary followed by the input
+    if (dictionarySize > FSZ_WINDOW) {
+        dictionary += dictionarySize - FSZ_WINDOW;
+        dictionarySize = FSZ_WINDOW;
+    }
+    std::string joined;
+    const unsigned char* base = reinterpret_cast<const unsigned char*>(src);
+    if (dictionarySize > 0) {
+        joined.reserve(dictionarySize + size);
+        joined.assign(dictionary, dictionarySize);
+        joined.append(src, size);
+        base = reinterpret_cast<const unsigned char*>(joined.data());
+    }
+
+    // Small inputs (history chunks are often a single section) get a smaller table, clearing it dominates otherwise
+    int bits = FSZ_HASH_BITS_MIN;
+    while (bits < FSZ_HASH_BITS_MAX && (static_cast<size_t>(1) << bits) < dictionarySize + size) {
+        ++bits;
+    }
+    std::vector<uint32_t> table(static_cast<size_t>(2) << bits, 0); // Two candidates per bucket, position + 1 (0 = empty)
+
+    const unsigned char* ip = base + dictionarySize;
+    const unsigned char* anchor = ip;
+    const unsigned char* end = ip + size;
+    unsigned char* op = reinterpret_cast<unsigned char*>(dst);
+    const unsigned char* oend = op + dstCapacity;
+
+    auto insert = [&](const unsigned char* p) {
+        uint32_t* bucket = &table[static_cast<size_t>(hashPosition(p, bits)) * 2];
+        bucket[1] = bucket[0];
+        bucket[0] = static_cast<uint32_t>(p - base) + 1;
+    };
+
+    // Best of the two candidates at p, without inserting p
+    auto find = [&](const unsigned char* p, size_t& offset) -> size_t {
+        const uint32_t* bucket = &table[static_cast<size_t>(hashPosition(p, bits)) * 2];
+        size_t best = 0;
+        for (int i = 0; i < 2; ++i) {
+            if (bucket[i] == 0) {
+                break;
+            }
+            const unsigned char* candidate = base + bucket[i] - 1;
+            if (static_cast<size_t>(p - candidate) > FSZ_WINDOW || read32(candidate) != read32(p)) {
+                continue;
+            }
+            size_t length = FSZ_MIN_MATCH + matchLength(candidate + FSZ_MIN_MATCH, p + FSZ_MIN_MATCH, end);
+            if (length > best) {
+                best = length;
+                offset = static_cast<size_t>(p - candidate);
+            }
+        }
+        return best;
+    };
+
+    for (const unsigned char* p = base; p + FSZ_MIN_MATCH <= ip; ++p) {
+        insert(p);
+    }
+
+    size_t misses = 0;
+    while (ip + FSZ_MIN_MATCH <= end) {
+        size_t offset = 0;
+        size_t length = find(ip, offset);
+        insert(ip);
+        if (length == 0) {
+            // Skip faster through data that does not compress
+            ip += 1 + (misses++ >> 6);
+            continue;
+        }
+        misses = 0;
+
+        // One step of lazy matching: a longer match one byte later is worth a literal
+        if (ip + 1 + FSZ_MIN_MATCH <= end) {
+            size_t nextOffset = 0;
+            size_t nextLength = find(ip + 1, nextOffset);
+            if (nextLength > length + 1) {
+                insert(ip + 1);
+                ++ip;
+                length = nextLength;
+                offset = nextOffset;
+            }
+        }
+
+        if (!putSequence(op, oend, anchor, static_cast<size_t>(ip - anchor), offset, length)) {
+            return 0;
+        }
+        // Inside a match only the starts of keys and values are indexed (after '\n' and '='), that is where the next
+        // match of key=value text begins, plus the last positions so the following search has fresh candidates
+        const unsigned char* matchEnd = ip + length;
+        for (++ip; ip < matchEnd && ip + FSZ_MIN_MATCH <= end; ++ip) {
+            if (ip[-1] == '\n' || ip[-1] == '=' || ip + 2 >= matchEnd) {
+                insert(ip);
+            }
+        }
+        ip = matchEnd;
+        anchor = ip;
+    }
+
+    if (!putSequence(op, oend, anchor, static_cast<size_t>(end - anchor), 0, 0)) {
+        return 0;
+    }
+    return static_cast<size_t>(op - reinterpret_cast<unsigned char*>(dst));
+}
+
+static inline bool getLength(const unsigned char*& ip, const unsigned char* iend, size_t& length) {
+    unsigned char byte;
+    do {
+        if (ip >= iend) {
+            return false;
+        }
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool fszDecompressBlock(const char* src, size_t size, char* dst, size_t rawSize, size_t dictionarySize) {
+    const unsigned char* ip = reinterpret_cast<const unsigned char*>(src);
+    const unsigned char* iend = ip + size;
+    unsigned char* op = reinterpret_cast<unsigned char*>(dst);
+    unsigned char* ostart = op;
+    unsigned char* oend = op + rawSize;
+
+    while (true) {
+        if (ip >= iend) {
+            return false;
+        }
+        unsigned char token = *ip++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !getLength(ip, iend, literalLength)) {
+            return false;
+        }
+        if (literalLength > static_cast<size_t>(iend - ip) || literalLength > static_cast<size_t>(oend - op)) {
+            return false;
+        }
+        memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        if (ip == iend) {
+            return op == oend; // Last sequence
+        }
+
+        if (iend - ip < 2) {
+            return false;
+        }
+        size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        size_t length = token & 15;
+        if (length == 15 && !getLength(ip, iend, length)) {
+            return false;
+        }
+        length += FSZ_MIN_MATCH;
+        if (offset == 0 || offset > static_cast<size_t>(op - ostart) + dictionarySize || length > static_cast<size_t>(oend - op)) {
+            return false;
+        }
+
+        const unsigned char* match = op - offset;
+        if (offset >= length) {
+            memcpy(op, match, length);
+            op += length;
+        }
+        else if (offset >= 8) {
+            // Overlapping, but 8 byte steps never read bytes this copy has not written yet
+            unsigned char* matchEnd = op + length;
+            while (op + 8 <= matchEnd) {
+                memcpy(op, match, 8);
+                op += 8;
+                match += 8;
+            }
+            while (op < matchEnd) {
+                *op++ = *match++;
+            }
+        }
+        else {
+            for (size_t i = 0; i < length; ++i) { // Repeats the last offset bytes
+                *op++ = *match++;
+            }
+        }
+    }
+}
+
+// --- Streams ------------------------------------------------------------------------------------------------------
+
+static void put32(std::string& out, uint32_t value) {
+    char bytes[4] = { static_cast<char>(value), static_cast<char>(value >> 8), static_cast<char>(value >> 16), static_cast<char>(value >> 24) };
+    out.append(bytes, 4);
+}
+
+static uint32_t get32(const char* p) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(p);
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+static void keepWindow(std::string& history, const char* data, size_t size) {
+    if (size >= FSZ_WINDOW) {
+        history.assign(data + size - FSZ_WINDOW, FSZ_WINDOW);
+        return;
+    }
+    history.append(data, size);
+    if (history.size() > FSZ_WINDOW) {
+        history.erase(0, history.size() - FSZ_WINDOW);
+    }
+}
+
+static void encodeBlock(FszEncoder& encoder, const char* data, size_t size, std::string& out) {
+    size_t headerAt = out.size();
+    put32(out, static_cast<uint32_t>(size));
+    put32(out, 0);
+    put32(out, static_cast<uint32_t>(hash64(data, size)));
+
+    size_t capacity = fszBound(size);
+    out.resize(headerAt + FSZ_BLOCK_HEADER + capacity);
+    size_t stored = fszCompressBlock(data, size, &out[headerAt + FSZ_BLOCK_HEADER], capacity, encoder.history.data(), encoder.history.size());
+    uint32_t storedField = static_cast<uint32_t>(stored);
+    if (stored == 0 || stored >= size) {
+        memcpy(&out[headerAt + FSZ_BLOCK_HEADER], data, size);
+        stored = size;
+        storedField = static_cast<uint32_t>(size) | FSZ_STORED_FLAG;
+    }
+    out.resize(headerAt + FSZ_BLOCK_HEADER + stored);
+    for (int i = 0; i < 4; ++i) {
+        out[headerAt + 4 + i] = static_cast<char>(storedField >> (8 * i));
+    }
+
+    keepWindow(encoder.history, data, size);
+    encoder.blocks++;
+}
+
+void fszEncodeBegin(FszEncoder& encoder, std::string& out) {
+    encoder = FszEncoder();
+    out.append("FSZ1", 4);
+}
+
+void fszEncodeUpdate(FszEncoder& encoder, const char* data, size_t size, std::string& out) {
+    if (!encoder.pending.empty()) {
+        size_t take = std::min(size, FSZ_BLOCK_SIZE - encoder.pending.size());
+        encoder.pending.append(data, take);
+        data += take;
+        size -= take;
+        if (encoder.pending.size() < FSZ_BLOCK_SIZE) {
+            return;
+        }
+        encodeBlock(encoder, encoder.pending.data(), encoder.pending.size(), out);
+        encoder.pending.clear();
+    }
+    while (size >= FSZ_BLOCK_SIZE) {
+        encodeBlock(encoder, data, FSZ_BLOCK_SIZE, out);
+        data += FSZ_BLOCK_SIZE;
+        size -= FSZ_BLOCK_SIZE;
+    }
+    encoder.pending.append(data, size);
+}
+
+void fszEncodeEnd(FszEncoder& encoder, std::string& out) {
+    if (!encoder.pending.empty()) {
+        encodeBlock(encoder, encoder.pending.data(), encoder.pending.size(), out);
+        encoder.pending.clear();
+    }
+    put32(out, 0);
+    put32(out, 0);
+    put32(out, encoder.blocks);
+}
+
+FSZ_STATUS fszDecodeUpdate(FszDecoder& decoder, const char* data, size_t size, std::string& out) {
+    if (decoder.done) {
+        return FSZ_DONE;
+    }
+    decoder.input.append(data, size);
+
+    size_t pos = 0;
+    FSZ_STATUS status = FSZ_NEED_MORE;
+    if (!decoder.started) {
+        if (decoder.input.size() < 4) {
+            return FSZ_NEED_MORE;
+        }
+        if (decoder.input.compare(0, 4, "FSZ1") != 0) {
+            return FSZ_ERROR;
+        }
+        decoder.started = true;
+        pos = 4;
+    }
+
+    std::string block;
+    while (decoder.input.size() - pos >= FSZ_BLOCK_HEADER) {
+        const char* header = decoder.input.data() + pos;
+        uint32_t rawSize = get32(header);
+        uint32_t storedField = get32(header + 4);
+        uint32_t checksum = get32(header + 8);
+
+        if (rawSize == 0) {
+            if (storedField != 0 || checksum != decoder.blocks) {
+                return FSZ_ERROR;
+            }
+            decoder.done = true;
+            status = FSZ_DONE;
+            pos += FSZ_BLOCK_HEADER;
+            break;
+        }
+
+        size_t stored = storedField & ~FSZ_STORED_FLAG;
+        if (rawSize > FSZ_BLOCK_SIZE || stored > fszBound(rawSize)) {
+            return FSZ_ERROR;
+        }
+        if (decoder.input.size() - pos - FSZ_BLOCK_HEADER < stored) {
+            break; // Rest of the block has not arrived yet
+        }
+
+        const char* payload = header + FSZ_BLOCK_HEADER;
+        size_t dictionarySize = decoder.history.size();
+        block.assign(decoder.history);
+        block.resize(dictionarySize + rawSize);
+        if (storedField & FSZ_STORED_FLAG) {
+            if (stored != rawSize) {
+                return FSZ_ERROR;
+            }
+            memcpy(&block[dictionarySize], payload, rawSize);
+        }
+        else if (!fszDecompressBlock(payload, stored, &block[dictionarySize], rawSize, dictionarySize)) {
+            return FSZ_ERROR;
+        }
+        if (static_cast<uint32_t>(hash64(block.data() + dictionarySize, rawSize)) != checksum) {
+            return FSZ_ERROR;
+        }
+
+        out.append(block, dictionarySize, rawSize);
+        keepWindow(decoder.history, block.data() + dictionarySize, rawSize);
+        decoder.blocks++;
+        pos += FSZ_BLOCK_HEADER + stored;
+    }
+
+    decoder.input.erase(0, pos);
+    return status;
+}
+
+std::string fszCompress(const std::string& data) {
+    FszEncoder encoder;
+    std::string out;
+    fszEncodeBegin(encoder, out);
+    fszEncodeUpdate(encoder, data.data(), data.size(), out);
+    fszEncodeEnd(encoder, out);
+    return out;
+}
+
+bool fszDecompress(const std::string& data, std::string& out) {
+    FszDecoder decoder;
+    out.clear();
+    return fszDecodeUpdate(decoder, data.data(), data.size(), out) == FSZ_DONE;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// FSZ: small LZ77 codec for what we archive (snapshots, history chunks). .FLT files are key=value lines that repeat a
+// lot (same keys in every [SimVars.N] / [LocalVars.N] section), so a byte oriented LZ with a 64 KB window, two
+// candidates per hash bucket and one step of lazy matching gets most of the ratio without an entropy coder. Inside a
+// match only the positions after '\n' and '=' are indexed. Benchmarks/CodecBench.cpp measures ratio and speed.
+//
+// Raw blocks (fszCompressBlock / fszDecompressBlock) carry no framing. Sequences are LZ4 style:
+//   token: literal length (high 4 bits) and match length - FSZ_MIN_MATCH (low 4 bits), 15 means "more bytes follow"
+//   [extra literal length bytes] literals [offset, 2 bytes little endian] [extra match length bytes]
+// The last sequence has literals only.
+//
+// Streams (fszEncode* / fszDecode*) are "FSZ1" followed by blocks of up to FSZ_BLOCK_SIZE input bytes:
+//   uint32 raw size, uint32 stored size (high bit set: stored uncompressed), uint32 checksum (low 32 bits of hash64)
+// Matches can reach into the previous block. A block with raw size 0 ends the stream, its checksum field holds the
+// number of blocks so a truncated stream is detected.
+
+#define FSZ_BLOCK_SIZE (64 * 1024)
+#define FSZ_WINDOW 65535
+#define FSZ_MIN_MATCH 4
+#define FSZ_STORED_FLAG 0x80000000u
+
+// Worst case size of a compressed raw block
+size_t fszBound(size_t size);
+
+// Compresses size bytes at src. dictionary (may be empty) is data that came right before src, matches may refer to it
+size_t fszCompressBlock(const char* src, size_t size, char* dst, size_t dstCapacity, const char* dictionary = nullptr, size_t dictionarySize = 0);
+// Decompresses into dst, which must hold exactly rawSize bytes. dst may be preceded by dictionarySize bytes of history
+bool fszDecompressBlock(const char* src, size_t size, char* dst, size_t rawSize, size_t dictionarySize = 0);
+
+struct FszEncoder {
+    std::string pending;    // Input not yet compressed (less than a block)
+    std::string history;    // Last FSZ_WINDOW bytes of input already compressed
+    uint32_t blocks = 0;
+};
+
+struct FszDecoder {
+    std::string input;      // Compressed bytes not consumed yet
+    std::string history;
+    uint32_t blocks = 0;
+    bool started = false;
+    bool done = false;
+};
+
+enum FSZ_STATUS {
+    FSZ_NEED_MORE,  // Feed more input
+    FSZ_DONE,       // End of stream reached and every checksum matched
+    FSZ_ERROR,      // Corrupt or truncated data
+};
+
+void fszEncodeBegin(FszEncoder& encoder, std::string& out);
+void fszEncodeUpdate(FszEncoder& encoder, const char* data, size_t size, std::string& out);
+void fszEncodeEnd(FszEncoder& encoder, std::string& out);
+
+// Appends the decompressed data of every complete block in data to out
+FSZ_STATUS fszDecodeUpdate(FszDecoder& decoder, const char* data, size_t size, std::string& out);
+
+// One shot helpers
+std::string fszCompress(const std::string& data);
+bool fszDecompress(const std::string& data, std::string& out);
@@ -0,0 +1,371 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#endif
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "ControlChannel.h"
+#include "Platform.h"
+
+#ifdef _WIN32
+typedef HANDLE ControlHandle;
+#else
+typedef int ControlHandle;
+#endif
+
+// One client connection. Its thread sleeps on the condition variable until the dispatcher answers its commands
+struct ControlConnection {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::string> replies;
+    uint32_t outstanding = 0;
+};
+
+enum CONTROL_STATE {
+    CONTROL_QUEUED,     // Waiting for the dispatcher
+    CONTROL_SENT,       // Event transmitted, not received yet
+    CONTROL_STARTED,    // Event received, the next completion answers it
+};
+
+struct ControlRequest {
+    std::shared_ptr<ControlConnection> connection;
+    std::string id;
+    std::string argument;
+    CONTROL_COMMAND command;
+    CONTROL_STATE state;
+    std::chrono::steady_clock::time_point received;
+};
+
+static const char* controlCommandNames[CONTROL_COUNT] = { "save", "position", "reload", "fp-load", "rewind", "frequencies" };
+
+// Commands with an argument can't share a run
+static bool controlMerges(CONTROL_COMMAND command) {
+    return command != CONTROL_REWIND && command != CONTROL_FREQUENCIES;
+}
+
+static std::mutex controlMutex;
+static std::vector<ControlRequest> controlRequests;
+static uint32_t controlNextId = 1;
+
+// Connections being served, at most CONTROL_MAX_CONNECTIONS
+static std::mutex sessionMutex;
+static std::condition_variable sessionEnded;
+static uint32_t sessionCount = 0;
+
+static void controlReply(ControlRequest& request, bool ok, const std::string& detail) {
+    long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - request.received).count();
+
+    std::ostringstream line;
+    line << request.id << (ok ? " OK " : " ERROR ") << controlCommandNames[request.command] << " " << elapsed << "ms";
+    if (!detail.empty()) {
+        line << " " << detail;
+    }
+    line << "\n";
+
+    std::lock_guard<std::mutex> lock(request.connection->mutex);
+    request.connection->replies.push_back(line.str());
+    request.connection->outstanding--;
+    request.connection->changed.notify_one();
+}
+
+uint32_t controlTakePending() {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    if (controlRequests.empty()) {
+        return 0;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    uint32_t queued = 0;
+    uint32_t inFlight = 0;
+    for (auto it = controlRequests.begin(); it != controlRequests.end();) {
+        if (now - it->received > std::chrono::seconds(CONTROL_TIMEOUT)) {
+            controlReply(*it, false, "timeout");
+            it = controlRequests.erase(it);
+            continue;
+        }
+        if (it->state == CONTROL_QUEUED) {
+            queued |= 1u << it->command;
+        }
+        else {
+            inFlight |= 1u << it->command;
+        }
+        ++it;
+    }
+
+    // One run per kind: anything already in flight will be picked up once that run completes
+    uint32_t transmit = queued & ~inFlight;
+    uint32_t sent = 0;
+    for (ControlRequest& request : controlRequests) {
+        uint32_t bit = 1u << request.command;
+        if (request.state == CONTROL_QUEUED && (transmit & bit) && (controlMerges(request.command) || !(sent & bit))) {
+            request.state = CONTROL_SENT;
+            sent |= bit;
+        }
+    }
+    return transmit;
+}
+
+void controlStarted(CONTROL_COMMAND command) {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    for (ControlRequest& request : controlRequests) {
+        if (request.command == command && (controlMerges(command) || request.state == CONTROL_SENT)) {
+            request.state = CONTROL_STARTED; // Queued ones too: they were sent before this run started (e.g. by the hotkey)
+        }
+    }
+}
+
+std::string controlArgument(CONTROL_COMMAND command) {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    for (const ControlRequest& request : controlRequests) {
+        if (request.command == command && request.state == CONTROL_STARTED) {
+            return request.argument;
+        }
+    }
+    return "";
+}
+
+void controlComplete(CONTROL_COMMAND command, bool ok, const std::string& detail) {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    for (auto it = controlRequests.begin(); it != controlRequests.end();) {
+        if (it->command == command && it->state == CONTROL_STARTED) {
+            controlReply(*it, ok, detail);
+            it = controlRequests.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+static bool controlParseCommand(const std::string& word, CONTROL_COMMAND& command) {
+    for (int i = 0; i < CONTROL_COUNT; ++i) {
+        if (word == controlCommandNames[i]) {
+            command = static_cast<CONTROL_COMMAND>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Queues every command of the batch (or answers it right away when it can't be parsed)
+static void controlQueueBatch(const std::string& batch, const std::shared_ptr<ControlConnection>& connection) {
+    std::istringstream lines(batch);
+    std::string line;
+    uint32_t accepted = 0;
+
+    std::lock_guard<std::mutex> lock(controlMutex);
+    while (std::getline(lines, line)) {
+        std::istringstream words(line);
+        std::string first, second, third;
+        words >> first >> second >> third;
+        if (first.empty()) {
+            continue;
+        }
+
+        ControlRequest request;
+        request.connection = connection;
+        request.state = CONTROL_QUEUED;
+        request.received = std::chrono::steady_clock::now();
+        std::string name = first;
+        if (controlParseCommand(first, request.command)) {
+            request.id = "#" + std::to_string(controlNextId++);
+            request.argument = second;
+        }
+        else {
+            request.id = first;
+            name = second;
+            request.argument = third;
+        }
+
+        std::lock_guard<std::mutex> connectionLock(connection->mutex);
+        if (name != first && !controlParseCommand(name, request.command)) {
+            connection->replies.push_back(request.id + " ERROR " + (name.empty() ? "-" : name) + " 0ms unknown command\n");
+            continue;
+        }
+        if (accepted == CONTROL_MAX_BATCH) {
+            connection->replies.push_back(request.id + " ERROR " + name + " 0ms batch limit of " + std::to_string(CONTROL_MAX_BATCH) + " commands\n");
+            continue;
+        }
+        connection->outstanding++;
+        accepted++;
+        controlRequests.push_back(request);
+    }
+}
+
+#ifdef _WIN32
+
+std::string controlDefaultEndpoint() {
+    return "\\\\.\\pipe\\FSAutoSave.control";
+}
+
+static int controlRead(ControlHandle handle, char* buffer, int size) {
+    DWORD read = 0;
+    return ReadFile(handle, buffer, static_cast<DWORD>(size), &read, NULL) ? static_cast<int>(read) : -1;
+}
+
+static bool controlWrite(ControlHandle handle, const std::string& text) {
+    DWORD written = 0;
+    return WriteFile(handle, text.data(), static_cast<DWORD>(text.size()), &written, NULL) && written == text.size();
+}
+
+static void controlClose(ControlHandle handle) {
+    FlushFileBuffers(handle);
+    DisconnectNamedPipe(handle);
+    CloseHandle(handle);
+}
+
+#else
+
+std::string controlDefaultEndpoint() {
+    const char* runtimeDir = getenv("XDG_RUNTIME_DIR");
+    return std::string(runtimeDir != nullptr && runtimeDir[0] != '\0' ? runtimeDir : "/tmp") + "/fsautosave-control.sock";
+}
+
+static int controlRead(ControlHandle handle, char* buffer, int size) {
+    return static_cast<int>(recv(handle, buffer, static_cast<size_t>(size), 0));
+}
+
+static bool controlWrite(ControlHandle handle, const std::string& text) {
+    size_t offset = 0;
+    while (offset < text.size()) {
+        ssize_t sent = send(handle, text.data() + offset, text.size() - offset, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        offset += static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+static void controlClose(ControlHandle handle) {
+    close(handle);
+}
+
+#endif
+
+// Reads one batch, then writes the replies as the dispatcher produces them
+static void controlSession(ControlHandle handle) {
+    std::string batch;
+    char buffer[512];
+    while (batch.size() < 16 * 1024 && batch.find("\n\n") == std::string::npos && batch.find("\r\n\r\n") == std::string::npos) {
+        int read = controlRead(handle, buffer, sizeof(buffer));
+        if (read <= 0) {
+            break; // Client closed its side (or went away)
+        }
+        batch.append(buffer, static_cast<size_t>(read));
+    }
+
+    auto connection = std::make_shared<ControlConnection>();
+    controlQueueBatch(batch, connection);
+
+    bool writable = true;
+    std::unique_lock<std::mutex> lock(connection->mutex);
+    while (true) {
+        connection->changed.wait(lock, [&] { return !connection->replies.empty() || connection->outstanding == 0; });
+        std::vector<std::string> replies;
+        replies.swap(connection->replies);
+        bool done = connection->outstanding == 0;
+
+        lock.unlock();
+        for (const std::string& reply : replies) {
+            writable = writable && controlWrite(handle, reply);
+        }
+        lock.lock();
+
+        if (done && connection->replies.empty()) {
+            break;
+        }
+    }
+    lock.unlock();
+    controlClose(handle);
+
+    std::lock_guard<std::mutex> sessionLock(sessionMutex);
+    sessionCount--;
+    sessionEnded.notify_one();
+}
+
+// Waits for a free connection slot, then takes it
+static void controlWaitForSlot() {
+    std::unique_lock<std::mutex> lock(sessionMutex);
+    sessionEnded.wait(lock, [] { return sessionCount < CONTROL_MAX_CONNECTIONS; });
+    sessionCount++;
+}
+
+static void controlReleaseSlot() {
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    sessionCount--;
+    sessionEnded.notify_one();
+}
+
+#ifdef _WIN32
+
+static void controlServer(std::string endpoint) {
+    while (true) {
+        controlWaitForSlot();
+        HANDLE hPipe = CreateNamedPipeA(endpoint.c_str(), PIPE_ACCESS_DUPLEX, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+            PIPE_UNLIMITED_INSTANCES, 4 * 1024, 4 * 1024, 0, NULL);
+        if (hPipe == INVALID_HANDLE_VALUE) {
+            printf("[CONTROL] Could not create %s (%lu). Control channel disabled\n", endpoint.c_str(), GetLastError());
+            controlReleaseSlot();
+            return;
+        }
+
+        // Sleeps here until someone connects, every client gets its own thread (up to CONTROL_MAX_CONNECTIONS) so a slow
+        // save does not block the next one
+        if (ConnectNamedPipe(hPipe, NULL) || GetLastError() == ERROR_PIPE_CONNECTED) {
+            std::thread(controlSession, hPipe).detach();
+        }
+        else {
+            CloseHandle(hPipe);
+            controlReleaseSlot();
+        }
+    }
+}
+
+#else
+
+static void controlServer(int listenSocket) {
+    while (true) {
+        controlWaitForSlot();
+        int client = acceptLocalClient(listenSocket);
+        if (client < 0) {
+            printf("[CONTROL] Could not accept clients (%s). Control channel disabled\n", strerror(errno));
+            controlReleaseSlot();
+            close(listenSocket);
+            return;
+        }
+        // A client that never finishes its batch gives its slot back after CONTROL_TIMEOUT
+        timeval timeout = { CONTROL_TIMEOUT, 0 };
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        std::thread(controlSession, client).detach();
+    }
+}
+
+#endif
+
+bool controlServerStart(const std::string& endpoint) {
+#ifdef _WIN32
+    std::thread(controlServer, endpoint).detach();
+#else
+    int listenSocket = listenLocalSocket(endpoint, 8);
+    if (listenSocket < 0) {
+        printf("[CONTROL] Could not listen on %s (%s). Control channel disabled\n", endpoint.c_str(), strerror(errno));
+        return false;
+    }
+    std::thread(controlServer, listenSocket).detach();
+#endif
+    return true;
+}
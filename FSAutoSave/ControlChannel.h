@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Local command channel so automation can trigger the same paths as the hotkeys.
+//
+// A client connects to the endpoint (a named pipe on Windows, a Unix domain socket elsewhere) and sends one batch of
+// commands, one per line, terminated by an empty line (or by closing its side of a socket):
+//
+//     [id] save | position | reload | fp-load | rewind <minutes> | frequencies [ICAO]
+//
+// Every command gets exactly one reply line when it is done, in completion order:
+//
+//     <id> OK|ERROR <command> <milliseconds>ms [detail]
+//
+// Commands without an id get #<n>. Commands of the same kind that are waiting at the same time (in one batch or from
+// several clients) are served by a single run and complete together. A run started some other way also serves the
+// commands waiting when it starts: a save command is answered by a hotkey, ESC or pause save that started after it
+// arrived, a position command by any gate lookup. One that arrives after its run already started waits for the next
+// run, so a save always reflects a state newer than the request. Only the save's own gate lookup completes a save,
+// once the .FLT files are final. Rewinds and frequencies carry an argument, so they are never merged and run one at a
+// time. frequencies answers with the frequencies of the airport (the closest one when none is given) as
+// "<ICAO> <MHz> <name>, ...", looked up once and kept in the FREQUENCY table of the dispatcher (FacilityTable.h).
+//
+// At most CONTROL_MAX_CONNECTIONS clients are served at a time, the others wait to be accepted. The socket endpoint
+// is only accessible to the user running FSAutoSave.
+
+#define CONTROL_TIMEOUT 60      // Seconds before a command that never completed is answered with ERROR timeout
+#define CONTROL_MAX_BATCH 64    // Commands accepted per connection, the ones after it are answered with ERROR
+#define CONTROL_MAX_CONNECTIONS 8   // Clients served at the same time
+
+enum CONTROL_COMMAND {
+    CONTROL_SAVE,       // EVENT_SITUATION_SAVE (SAVE_REQUEST_CONTROL), completes when the .FLT files are final
+    CONTROL_POSITION,   // EVENT_CLOSEST_AIRPORT, completes when the gate lookup is done
+    CONTROL_RELOAD,     // EVENT_SITUATION_RELOAD
+    CONTROL_FP_LOAD,    // EVENT_FLIGHTPLAN_LOAD
+    CONTROL_REWIND,     // Reload the snapshot taken <minutes> ago (no SimConnect event, runs from the SimConnect loop)
+    CONTROL_FREQUENCIES,    // Frequencies of an airport (no SimConnect event), completes at its FACILITY_DATA_END
+    CONTROL_COUNT
+};
+
+bool controlServerStart(const std::string& endpoint);
+std::string controlDefaultEndpoint();
+
+// Dispatcher side (all three are called from the SimConnect thread)
+
+// Returns a bitmask (1 << CONTROL_COMMAND) of the events to transmit now: queued commands with no run in flight yet.
+// Also answers commands that timed out.
+uint32_t controlTakePending();
+// The event of a command kind was received, so the next completion belongs to it
+void controlStarted(CONTROL_COMMAND command);
+// Argument of the started command of this kind ("" if none)
+std::string controlArgument(CONTROL_COMMAND command);
+// Answers every started command of this kind
+void controlComplete(CONTROL_COMMAND command, bool ok, const std::string& detail = "");
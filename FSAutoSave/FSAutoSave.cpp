@@ -1,11 +1,39 @@
+#ifdef _WIN32
 #define NOMINMAX
 #include <windows.h>
+#endif
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <cmath>
+#include <limits>
 #include <thread>
 #include "FSAutoSave.h"
 #include "Globals.h"
 #include "Utility.h"
+#include "ControlChannel.h"
+#include "AutoSave.h"
+#include "Metrics.h"
+#include "SaveScheduler.h"
+#include "AirportIndex.h"
+#include "FacilityDb.h"
+#include "FacilityPlan.h"
+#include "FacilityPrefetch.h"
+#include "GateCache.h"
+#include "TaxiGraph.h"
+#include "RunwayIndex.h"
+#include "FacilityTable.h"
+#include "Hash.h"
 
 int positionRequester = 0;
+static bool closestAirportPending = FALSE; // The lookup waits for REQUEST_POSITION_ONCE to ask the airport index
+static uint32_t positionRequests = 0; // REQUEST_POSITION_ONCE sent and answered, SimConnect answers them in order
+static uint32_t positionAnswers = 0;
+static uint32_t savePosition = 0; // positionRequests of the save's own lookup (LOOKUP_REQUEST_SAVE), 0 when none
+static bool lookupForSave = FALSE; // The lookup in progress is the save's, its completion completes the save
+static FacilityAirportRecord facilityLookup; // Airport being looked up from MSFS, stored at FACILITY_DATA_END
+static GateCacheEntry lookupGate; // Gate found by the lookup in progress, kept for the next one at GATE_CACHE_DISTANCE
+static FacilityAirportRecord lookupAwaitingPrefetch; // Gate lookup of the airport the prefetch is fetching (ident and position)
 
 void initApp() {
 
@@ -13,20 +41,8 @@ void initApp() {
     std::thread fileMonitorThread(monitorCustomFlightChanges);
     fileMonitorThread.detach();  // Detach the thread to run independently
 
-    // Initilize Facility Definitions (for data I might need)
-    hr = SimConnect_AddToFacilityDefinition(hSimConnect, DEFINITION_FACILITY_AIRPORT, "OPEN AIRPORT");
-    hr = SimConnect_AddToFacilityDefinition(hSimConnect, DEFINITION_FACILITY_AIRPORT, "NAME64");
-    hr = SimConnect_AddToFacilityDefinition(hSimConnect, DEFINITION_FACILITY_AIRPORT, "ICAO");
-
-    hr = SimConnect_AddToFacilityDefinition(hSimConnect, DEFINITION_FACILITY_AIRPORT, "OPEN TAXI_PARKING");
-    hr = SimConnect_AddToFacilityDefinition(hSimConnect, DEFINITION_FACILITY_AIRPORT, "NAME");
-    hr = SimConnect_AddToFacilityDefinition(hSimConnect, DEFINITION_FACILITY_AIRPORT, "SUFFIX");
-    hr = SimConnect_AddToFacilityDefinition(hSimConnect, DEFINITION_FACILITY_AIRPORT, "NUMBER");
-    hr = SimConnect_AddToFacilityDefinition(hSimConnect, DEFINITION_FACILITY_AIRPORT, "CLOSE TAXI_PARKING");
-
-    hr = SimConnect_AddToFacilityDefinition(hSimConnect, DEFINITION_FACILITY_AIRPORT, "CLOSE AIRPORT");
-
-    if (hr != S_OK) {
+    // Initilize Facility Definitions (one per purpose, see FacilityPlan.h)
+    if (!facilityPlanRegister(hSimConnect, DEFINITION_FACILITY_FIRST)) {
         printf("\nFailed to Add to Data Definition\n");
     }
 
@@ -40,15 +56,33 @@ void initApp() {
     hr = SimConnect_AddToDataDefinition(hSimConnect, DEFINITION_POSITION_DATA, "TRAILING EDGE FLAPS LEFT ANGLE", "degrees");
     hr = SimConnect_AddToDataDefinition(hSimConnect, DEFINITION_POSITION_DATA, "PLANE HEADING DEGREES MAGNETIC", "degrees");
     hr = SimConnect_AddToDataDefinition(hSimConnect, DEFINITION_POSITION_DATA, "SIM ON GROUND", "Bool");
+    hr = SimConnect_AddToDataDefinition(hSimConnect, DEFINITION_POSITION_DATA, "VERTICAL SPEED", "feet per minute"); // Used by the flight phase detector
+    hr = SimConnect_AddToDataDefinition(hSimConnect, DEFINITION_POSITION_DATA, "PLANE ALT ABOVE GROUND", "feet");
+    hr = SimConnect_AddToDataDefinition(hSimConnect, DEFINITION_POSITION_DATA, "SIMULATION RATE", "number");
+    hr = SimConnect_AddToDataDefinition(hSimConnect, DEFINITION_POSITION_DATA, "PLANE HEADING DEGREES TRUE", "degrees"); // Runways are in true headings
 
     // To determine where we are in the menus
     hr = SimConnect_AddToDataDefinition(hSimConnect, DEFINITION_CAMERA_STATE, "CAMERA STATE", "number");
 
+    // Just what the runway test needs, it is sent every frame
+    hr = SimConnect_AddToDataDefinition(hSimConnect, DEFINITION_RUNWAY_SAMPLE, "PLANE LATITUDE", "degrees");
+    hr = SimConnect_AddToDataDefinition(hSimConnect, DEFINITION_RUNWAY_SAMPLE, "PLANE LONGITUDE", "degrees");
+    hr = SimConnect_AddToDataDefinition(hSimConnect, DEFINITION_RUNWAY_SAMPLE, "PLANE HEADING DEGREES TRUE", "degrees");
+    hr = SimConnect_AddToDataDefinition(hSimConnect, DEFINITION_RUNWAY_SAMPLE, "SIM ON GROUND", "Bool");
+
     // ZULU Time Data Definition to obtain day of year (not really used as we can get it from the actual system clock)
     // hr = SimConnect_AddToDataDefinition(hSimConnect, DEFINITION_ZULU_TIME, "ZULU DAY OF YEAR", "number");
 
     // One request for the user aircraft position polls every second, the other request for the user aircraft position polls only once
-    // hr = SimConnect_RequestDataOnSimObject(hSimConnect, REQUEST_POSITION, DEFINITION_POSITION_DATA, SIMCONNECT_OBJECT_ID_USER, SIMCONNECT_PERIOD_SECOND, SIMCONNECT_DATA_REQUEST_FLAG_CHANGED);
+    // The periodic one feeds the flight phase detector for the autosave and the facility prefetch, so it is only needed
+    // when one of them is on
+    if ((autoSaveEnabled || facilityPrefetchEnabled) && !DEBUG) {
+        hr = SimConnect_RequestDataOnSimObject(hSimConnect, REQUEST_POSITION, DEFINITION_POSITION_DATA, SIMCONNECT_OBJECT_ID_USER, SIMCONNECT_PERIOD_SECOND, SIMCONNECT_DATA_REQUEST_FLAG_DEFAULT);
+    }
+
+    // The runway test runs on every frame the aircraft moved (or turned), whatever is turned on: the gate lookup of
+    // every save uses it too
+    hr = SimConnect_RequestDataOnSimObject(hSimConnect, REQUEST_RUNWAY_SAMPLE, DEFINITION_RUNWAY_SAMPLE, SIMCONNECT_OBJECT_ID_USER, SIMCONNECT_PERIOD_SIM_FRAME, SIMCONNECT_DATA_REQUEST_FLAG_CHANGED);
 
     // Request data on specific Simvars (e.g. ZULU time or CAMERA STATE)
     hr = SimConnect_RequestDataOnSimObject(hSimConnect, REQUEST_CAMERA_STATE, DEFINITION_CAMERA_STATE, SIMCONNECT_OBJECT_ID_USER, SIMCONNECT_PERIOD_SECOND, SIMCONNECT_DATA_REQUEST_FLAG_CHANGED);
@@ -79,6 +113,10 @@ void initApp() {
     hr = SimConnect_SubscribeToSystemEvent(hSimConnect, EVENT_SIM_CRASHED, "Crashed");
     hr = SimConnect_SubscribeToSystemEvent(hSimConnect, EVENT_SIM_CRASHRESET, "CrashReset");
 
+    // Airports entering and leaving the reality bubble, so the closest airport is known without asking for the list
+    airportIndexClear();
+    hr = SimConnect_SubscribeToFacilities_EX1(hSimConnect, SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT, REQUEST_AIRPORTS_IN_RANGE, REQUEST_AIRPORTS_OUT_OF_RANGE);
+
     // ZULU Client Events. No need to set notification group for them as we don't need info back
     hr = SimConnect_MapClientEventToSimEvent(hSimConnect, EVENT_ZULU_MINUTES_SET, "ZULU_MINUTES_SET");
     hr = SimConnect_MapClientEventToSimEvent(hSimConnect, EVENT_ZULU_HOURS_SET, "ZULU_HOURS_SET");
@@ -97,7 +135,7 @@ void initApp() {
 
     // Input Events
     // hr = SimConnect_MapInputEventToClientEvent_EX1(hSimConnect, INPUT0, "esc", EVENT_SITUATION_SAVE);
-    hr = SimConnect_MapInputEventToClientEvent_EX1(hSimConnect, INPUT0, "VK_LCONTROL+VK_LMENU+s", EVENT_SITUATION_SAVE, 55);
+    hr = SimConnect_MapInputEventToClientEvent_EX1(hSimConnect, INPUT0, "VK_LCONTROL+VK_LMENU+s", EVENT_SITUATION_SAVE, SAVE_REQUEST_USER);
     hr = SimConnect_MapInputEventToClientEvent_EX1(hSimConnect, INPUT0, "VK_LCONTROL+VK_LMENU+p", EVENT_CLOSEST_AIRPORT);
 
     // Disable the following as they are not needed for now. Maybe future use
@@ -126,11 +164,577 @@ void initApp() {
     // hr = SimConnect_SetSystemEventState(hSimConnect, EVENT_RECUR_FRAME, SIMCONNECT_STATE_ON); // Enable it when we need to analyze every frame
 }
 
-void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
+static bool isAutoSaveRun = FALSE; // The run waiting or in flight is an autosave, the flight goes on once it is done
+
+// Autosave done (or given up)
+static void finishAutoSave() {
+    if (!isAutoSaveRun) {
+        return;
+    }
+    isAutoSaveRun = FALSE;
+    autosaveFinished(tickCount());
+}
+
+// The run in flight will never complete
+static void abandonSave(const std::string& reason) {
+    bool autosave = isAutoSaveRun;
+    saveSchedulerCompleted();
+    finishAutoSave();
+    metricsSaveAborted();
+    if (!autosave) {
+        controlComplete(CONTROL_SAVE, false, reason);
+    }
+}
+
+// Runs the save pipeline once for every request the scheduler merged: autoSave() for an autosave, finalSave() else
+static void runSave() {
+    // The flight may have been unloaded while a background request was waiting
+    if (currentFlight != "LAST.FLT" && (isAutoSaveRun || currentFlight != "CUSTOMFLIGHT.FLT")) {
+        if (!isAutoSaveRun) {
+            controlStarted(CONTROL_SAVE);
+        }
+        abandonSave(currentFlight + " can not be saved");
+        return;
+    }
+
+    if (isAutoSaveRun) {
+        autoSave();
+    }
+    else {
+        controlStarted(CONTROL_SAVE);
+        finalSave();
+    }
+    if (DEBUG) {
+        saveSchedulerCompleted(); // Nothing was saved, so there is no lookup to wait for
+        finishAutoSave();
+    }
+}
+
+// Every finalSave() request goes through the save scheduler
+static void requestFinalSave(SAVE_KIND kind) {
+    // Flags are set from the first request on, even while it waits behind an autosave (which does not use them)
+    isFinalSave = TRUE;
+    isFirstSave = FALSE;
+    metricsSaveStarted();
+    autosaveNoteSave(tickCount());
+
+    switch (saveSchedulerRequest(kind, tickCount())) {
+    case SAVE_RUN_NOW:
+        isAutoSaveRun = FALSE; // Takes the place of an autosave that was waiting, if any
+        runSave();
+        break;
+    case SAVE_DEFERRED:
+        break;
+    case SAVE_ABSORBED:
+        printf("[SAVE] Merged with the save already in progress\n");
+        break;
+    }
+}
+
+// Saves LAST.FLT while flying (autoSave), only when nothing else is saving (the next sample will try again)
+static void requestAutoSave() {
+    if (saveSchedulerBusy()) {
+        return;
+    }
+
+    int64_t now = tickCount();
+    printf("\n[AUTOSAVE] Saving (%s)\n", flightPhaseName(autosavePhase()));
+    isAutoSaveRun = TRUE;
+    autosaveStarted(now);
+    metricsSaveStarted();
+    saveSchedulerRequest(SAVE_KIND_BACKGROUND, now); // Runs from the main loop once the window closed, unless a save joins it
+}
+
+// One REQUEST_POSITION sample: track the flight phase and autosave when it is time
+static void autoSaveSample(const AircraftPosition* pS) {
+    // Only while flying LAST.FLT, finalSave() does not save anything else
+    if (!autoSaveEnabled || !flightInitialized || isOnMenuScreen || !isSimRunning || currentFlight != "LAST.FLT") {
+        return;
+    }
+
+    // The scheduler gave up on an autosave that never got its gate lookup (e.g. no airport nearby)
+    if (isAutoSaveRun && !saveSchedulerBusy()) {
+        finishAutoSave();
+    }
+
+    PhaseSample sample;
+    sample.onGround = pS->sim_on_ground != 0.0;
+    sample.linedUp = runwayIndexCurrent().position == RUNWAY_LINED_UP;
+    sample.groundSpeed = pS->airspeed;
+    sample.verticalSpeed = pS->vertical_speed;
+    sample.altitudeAGL = pS->alt_above_ground;
+    sample.simRate = pS->sim_rate;
+
+    bool due = autosaveSample(sample, tickCount());
+    if (autosavePhaseChanged()) {
+        printf("\n[AUTOSAVE] Flight phase: %s\n", flightPhaseName(autosavePhase()));
+    }
+    if (due) {
+        requestAutoSave();
+    }
+}
+
+// "rewind <minutes>" from the control channel: reload the flight from the snapshot taken that long ago
+static void rewindFlight() {
+    controlStarted(CONTROL_REWIND);
+
+    std::string argument = controlArgument(CONTROL_REWIND);
+    char* end = nullptr;
+    double minutes = strtod(argument.c_str(), &end);
+    if (argument.empty() || *end != '\0' || minutes < 0) {
+        controlComplete(CONTROL_REWIND, false, "usage: rewind <minutes>");
+        return;
+    }
+
+    std::string detail;
+    if (!restoreSnapshot(static_cast<int64_t>(minutes * 60), detail)) {
+        controlComplete(CONTROL_REWIND, false, detail);
+        return;
+    }
+    printf("\n[REWIND] Going back %.1f minutes, reloading %s\n", minutes, lastMOD.c_str());
+    hr = SimConnect_FlightLoad(hSimConnect, lastMOD.c_str());
+    controlComplete(CONTROL_REWIND, hr == S_OK, hr == S_OK ? detail : "flight could not be loaded");
+}
+
+// "frequencies [ICAO]" answered from the FREQUENCY table: "<ICAO> <MHz> <name>, ..."
+static void answerFrequencies(const std::string& ident) {
+    const FacilityTable* table = facilityTablesFind(SIMCONNECT_FACILITY_DATA_FREQUENCY, ident.c_str());
+    if (table == nullptr) {
+        controlComplete(CONTROL_FREQUENCIES, false, ident + " frequencies could not be looked up");
+        return;
+    }
+    int owner = facilityTableColumn(*table, "OWNER");
+    int frequency = facilityTableColumn(*table, "FREQUENCY");
+    int name = facilityTableColumn(*table, "NAME");
+    std::string detail = ident;
+    size_t count = 0;
+    for (size_t row = facilityTableFind(*table, owner, ident.c_str(), 0); row < table->rows; row = facilityTableFind(*table, owner, ident.c_str(), row + 1)) {
+        char line[96];
+        snprintf(line, sizeof(line), "%s %.3f %s", count++ == 0 ? "" : ",", facilityTableNumber(*table, frequency, row) / 1000000, facilityTableText(*table, name, row));
+        detail += line;
+    }
+    controlComplete(CONTROL_FREQUENCIES, true, count == 0 ? ident + " has no frequencies" : detail);
+}
+
+// "frequencies [ICAO]" from the control channel: from the table when the airport was looked up before, else asked for
+static void lookupFrequencies() {
+    controlStarted(CONTROL_FREQUENCIES);
+
+    std::string ident = controlArgument(CONTROL_FREQUENCIES);
+    AirportIndexEntry nearest;
+    double distance = 0;
+    if (ident.empty() && (myLatitude != 0 || myLongitude != 0) && airportIndexNearest(myLatitude, myLongitude, nearest, distance)) {
+        ident = nearest.ident;
+    }
+    std::transform(ident.begin(), ident.end(), ident.begin(), [](unsigned char c) { return static_cast<char>(toupper(c)); });
+    if (ident.empty() || ident.size() >= sizeof(nearest.ident)) {
+        controlComplete(CONTROL_FREQUENCIES, false, "usage: frequencies [ICAO]");
+        return;
+    }
+    if (facilityTablesFind(SIMCONNECT_FACILITY_DATA_FREQUENCY, ident.c_str()) != nullptr) {
+        answerFrequencies(ident);
+        return;
+    }
+    if (!facilityPlanRequest(hSimConnect, ident.c_str(), FACILITY_NEED_NAME | FACILITY_NEED_FREQUENCIES, REQUEST_FREQUENCIES)) {
+        controlComplete(CONTROL_FREQUENCIES, false, ident + " frequencies could not be requested");
+    }
+}
+
+// Transmits the events for control channel commands, they take the same path as the hotkeys from here on
+static void runControlCommands(uint32_t commands) {
+    if (commands & (1u << CONTROL_SAVE)) {
+        SimConnect_TransmitClientEvent(hSimConnect, 0, EVENT_SITUATION_SAVE, SAVE_REQUEST_CONTROL, SIMCONNECT_GROUP_PRIORITY_HIGHEST, SIMCONNECT_EVENT_FLAG_GROUPID_IS_PRIORITY);
+    }
+    if (commands & (1u << CONTROL_POSITION)) {
+        SimConnect_TransmitClientEvent(hSimConnect, 0, EVENT_CLOSEST_AIRPORT, 0, SIMCONNECT_GROUP_PRIORITY_HIGHEST, SIMCONNECT_EVENT_FLAG_GROUPID_IS_PRIORITY);
+    }
+    if (commands & (1u << CONTROL_RELOAD)) {
+        SimConnect_TransmitClientEvent(hSimConnect, 0, EVENT_SITUATION_RELOAD, 0, SIMCONNECT_GROUP_PRIORITY_HIGHEST, SIMCONNECT_EVENT_FLAG_GROUPID_IS_PRIORITY);
+    }
+    if (commands & (1u << CONTROL_FP_LOAD)) {
+        SimConnect_TransmitClientEvent(hSimConnect, 0, EVENT_FLIGHTPLAN_LOAD, 0, SIMCONNECT_GROUP_PRIORITY_HIGHEST, SIMCONNECT_EVENT_FLAG_GROUPID_IS_PRIORITY);
+    }
+    if (commands & (1u << CONTROL_REWIND)) {
+        rewindFlight();
+    }
+    if (commands & (1u << CONTROL_FREQUENCIES)) {
+        lookupFrequencies();
+    }
+}
+
+// Name of a SimConnect exception (without the SIMCONNECT_EXCEPTION_ prefix) or nullptr if we don't know it
+static const char* simConnectExceptionName(DWORD exception) {
+    switch (exception) {
+    case SIMCONNECT_EXCEPTION_JETWAY_DATA: return "JETWAY_DATA";
+    case SIMCONNECT_EXCEPTION_DATA_ERROR: return "DATA_ERROR";
+    case SIMCONNECT_EXCEPTION_LOAD_FLIGHTPLAN_FAILED: return "LOAD_FLIGHTPLAN_FAILED";
+    case SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_GET_OBSERVATION: return "WEATHER_UNABLE_TO_GET_OBSERVATION";
+    case SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_CREATE_STATION: return "WEATHER_UNABLE_TO_CREATE_STATION";
+    case SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_REMOVE_STATION: return "WEATHER_UNABLE_TO_REMOVE_STATION";
+    case SIMCONNECT_EXCEPTION_INVALID_DATA_TYPE: return "INVALID_DATA_TYPE";
+    case SIMCONNECT_EXCEPTION_INVALID_DATA_SIZE: return "INVALID_DATA_SIZE";
+    case SIMCONNECT_EXCEPTION_INVALID_ARRAY: return "INVALID_ARRAY";
+    case SIMCONNECT_EXCEPTION_CREATE_OBJECT_FAILED: return "CREATE_OBJECT_FAILED";
+    case SIMCONNECT_EXCEPTION_OPERATION_INVALID_FOR_OBJECT_TYPE: return "OPERATION_INVALID_FOR_OBJECT_TYPE";
+    case SIMCONNECT_EXCEPTION_ILLEGAL_OPERATION: return "ILLEGAL_OPERATION";
+    case SIMCONNECT_EXCEPTION_ALREADY_SUBSCRIBED: return "ALREADY_SUBSCRIBED";
+    case SIMCONNECT_EXCEPTION_INVALID_ENUM: return "INVALID_ENUM";
+    case SIMCONNECT_EXCEPTION_DEFINITION_ERROR: return "DEFINITION_ERROR";
+    case SIMCONNECT_EXCEPTION_DUPLICATE_ID: return "DUPLICATE_ID";
+    case SIMCONNECT_EXCEPTION_DATUM_ID: return "DATUM_ID";
+    case SIMCONNECT_EXCEPTION_OUT_OF_BOUNDS: return "OUT_OF_BOUNDS";
+    case SIMCONNECT_EXCEPTION_ALREADY_CREATED: return "ALREADY_CREATED";
+    case SIMCONNECT_EXCEPTION_OBJECT_OUTSIDE_REALITY_BUBBLE: return "OBJECT_OUTSIDE_REALITY_BUBBLE";
+    case SIMCONNECT_EXCEPTION_OBJECT_CONTAINER: return "OBJECT_CONTAINER";
+    case SIMCONNECT_EXCEPTION_OBJECT_AI: return "OBJECT_AI";
+    case SIMCONNECT_EXCEPTION_OBJECT_ATC: return "OBJECT_ATC";
+    case SIMCONNECT_EXCEPTION_OBJECT_SCHEDULE: return "OBJECT_SCHEDULE";
+    case SIMCONNECT_EXCEPTION_ACTION_NOT_FOUND: return "ACTION_NOT_FOUND";
+    case SIMCONNECT_EXCEPTION_NOT_AN_ACTION: return "NOT_AN_ACTION";
+    case SIMCONNECT_EXCEPTION_INCORRECT_ACTION_PARAMS: return "INCORRECT_ACTION_PARAMS";
+    case SIMCONNECT_EXCEPTION_GET_INPUT_EVENT_FAILED: return "GET_INPUT_EVENT_FAILED";
+    case SIMCONNECT_EXCEPTION_SET_INPUT_EVENT_FAILED: return "SET_INPUT_EVENT_FAILED";
+    case SIMCONNECT_EXCEPTION_TOO_MANY_GROUPS: return "TOO_MANY_GROUPS";
+    case SIMCONNECT_EXCEPTION_NAME_UNRECOGNIZED: return "NAME_UNRECOGNIZED";
+    case SIMCONNECT_EXCEPTION_TOO_MANY_EVENT_NAMES: return "TOO_MANY_EVENT_NAMES";
+    case SIMCONNECT_EXCEPTION_EVENT_ID_DUPLICATE: return "EVENT_ID_DUPLICATE";
+    case SIMCONNECT_EXCEPTION_TOO_MANY_MAPS: return "TOO_MANY_MAPS";
+    case SIMCONNECT_EXCEPTION_TOO_MANY_OBJECTS: return "TOO_MANY_OBJECTS";
+    case SIMCONNECT_EXCEPTION_TOO_MANY_REQUESTS: return "TOO_MANY_REQUESTS";
+    case SIMCONNECT_EXCEPTION_WEATHER_INVALID_PORT: return "WEATHER_INVALID_PORT";
+    case SIMCONNECT_EXCEPTION_WEATHER_INVALID_METAR: return "WEATHER_INVALID_METAR";
+    case SIMCONNECT_EXCEPTION_NONE: return "NONE";
+    case SIMCONNECT_EXCEPTION_ERROR: return "ERROR";
+    case SIMCONNECT_EXCEPTION_SIZE_MISMATCH: return "SIZE_MISMATCH";
+    case SIMCONNECT_EXCEPTION_UNRECOGNIZED_ID: return "UNRECOGNIZED_ID";
+    case SIMCONNECT_EXCEPTION_UNOPENED: return "UNOPENED";
+    case SIMCONNECT_EXCEPTION_VERSION_MISMATCH: return "VERSION_MISMATCH";
+    default: return nullptr;
+    }
+}
+
+// The aircraft is at this parking (the one it stands on or the one of the closest jetway, JetwayDistance and JetwayBearing away)
+// taxiDistance: meters along the taxiways to the parking (TaxiGraph.h), negative when not known
+static void setParkingGate(const char* kind, int name, int suffix, unsigned number, double taxiDistance) {
+    GateInfo gateInfo = formatGateName(name);
+    GateInfo gateSuffixInfo = formatGateName(suffix);
+    int clockPos = calculateClockPosition(JetwayBearing, myHeading);
+
+    parkingGate = gateInfo.gateString;
+    parkingGateSuffix = gateSuffixInfo.gateString;
+    parkingNumber = number;
+
+    lookupGate.hasGate = true;
+    lookupGate.kind = kind;
+    lookupGate.name = name;
+    lookupGate.suffix = suffix;
+    lookupGate.number = number;
+    lookupGate.distance = JetwayDistance;
+    lookupGate.bearing = JetwayBearing;
+    lookupGate.taxiDistance = taxiDistance;
+
+    if (positionRequester == 0) {
+        std::string gateString = std::string("Closest ") + kind + " is " + gateInfo.friendlyName + " " + std::to_string(number) + " at " + airportName + ". Distance from your aircraft is " + std::to_string(int(metersToFeet(JetwayDistance))) + " meters (" + std::to_string(int(JetwayDistance)) + " feet) at your " + std::to_string(clockPos) + " o'clock";
+        if (taxiDistance >= 0) {
+            gateString += ", " + std::to_string(int(taxiDistance)) + " meters taxi";
+        }
+        sendText(hSimConnect, gateString);
+        printf("Closest %s is %s %d\n", kind, gateInfo.friendlyName.c_str(), number);
+        if (taxiDistance >= 0) {
+            printf("[TAXI] %.0f m taxi to %s %u\n", taxiDistance, gateInfo.friendlyName.c_str(), number);
+        }
+    }
+}
+
+// The closest airport lookup is done (airportName, airportICAO and the gate are set): finish the save it was for
+static void completeAirportLookup() {
+    // The next lookup from the same spot gets the same answer (finalFLTchange clears the names)
+    if (!airportICAO.empty()) {
+        lookupGate.latitude = myLatitude;
+        lookupGate.longitude = myLongitude;
+        lookupGate.heading = myHeading;
+        lookupGate.onGround = isSimOnGround;
+        lookupGate.airportICAO = airportICAO;
+        lookupGate.airportName = airportName;
+        gateCacheStore(lookupGate);
+    }
+    lookupGate = GateCacheEntry();
+
+    // Only the save's own lookup completes the save. Any other lookup leaves the files to it while a save is running
+    bool forSave = lookupForSave;
+    lookupForSave = FALSE;
+    if (forSave && isAutoSaveRun) {
+        autosaveFLTchange(); // LAST.FLT only, the flight goes on
+    }
+    else if (forSave || !saveSchedulerBusy()) {
+        finalFLTchange(); // MODIFY the .FLT file to set the FirstFlightState to firstFlightState* but only do it for the final save and when flight is LAST.FLT
+    }
+    if (forSave) {
+        metricsSaveCommitted();
+        if (isFinalSave || isAutoSaveRun) {
+            captureSnapshot(); // Known good copy for crash reloads and rewinds
+        }
+        saveSchedulerCompleted();
+        finishAutoSave();
+    }
+
+    // Answer control commands waiting for this lookup, and for the save when it was the save's
+    controlComplete(CONTROL_POSITION, !airportICAO.empty(), airportICAO.empty() ? "no airport found" : airportICAO + " " + parkingGate + " " + std::to_string(parkingNumber));
+    if (forSave) {
+        controlComplete(CONTROL_SAVE, true, currentFlight);
+    }
+
+    // Reset the counters
+    countJetways = 0;
+
+    // Reset the requester after use
+    positionRequester = 0; // Reset the position requester
+
+    // Reset names after use
+    airportName = "";
+    airportICAO = "";
+
+    JetwayDistance = 0.0;
+    JetwayBearing = 0.0;
+
+    // After using the data, reset the values
+    parkingIndex = -1;
+}
+
+// Airport and gate of the previous lookup, the aircraft has not moved since
+static void replayCachedGate(const GateCacheEntry& cached) {
+    airportName = cached.airportName;
+    airportICAO = cached.airportICAO;
+    if (positionRequester == 0) {
+        printf("Closest airport is %s (%s)\n", cached.airportName.c_str(), cached.airportICAO.c_str());
+    }
+    if (cached.hasGate) {
+        JetwayDistance = cached.distance;
+        JetwayBearing = cached.bearing;
+        setParkingGate(cached.kind, cached.name, cached.suffix, cached.number, cached.taxiDistance);
+    }
+}
+
+// Closest airport from the airport list when the airport index can not answer (no subscription data yet)
+static void requestClosestAirportList() {
+    hr = SimConnect_RequestFacilitiesList_EX1(hSimConnect, SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT, REQUEST_CLOSEST_AIRPORT);
+    if (hr != S_OK) {
+        printf("\nFailed to obtain closest airport to our position\n");
+        controlComplete(CONTROL_POSITION, false, "airport list request failed");
+    }
+}
+
+// Gate of a stored airport for an aircraft on the ground: the parking it stands on, else the one of the closest jetway.
+// None on a runway, the aircraft is about to take off (or just landed)
+static void resolveParkingGate(const FacilityDbAirport& airport) {
+    RunwayState runway;
+    if (runwayIndexTest(myLatitude, myLongitude, myTrueHeading, true, runway) != RUNWAY_NONE) {
+        parkingIndex = -1;
+        if (positionRequester == 0) {
+            std::string runwayString = (runway.position == RUNWAY_LINED_UP ? std::string("Lined up on runway ") : std::string("On runway ")) + runway.runway + " at " + airportName;
+            if (runway.position == RUNWAY_LINED_UP) {
+                runwayString += ", " + std::to_string(int(runway.remaining)) + " meters ahead";
+            }
+            sendText(hSimConnect, runwayString);
+            printf("[RUNWAY] %s\n", runwayString.c_str());
+        }
+        return;
+    }
+
+    DistanceAndBearing target;
+    FacilityParking parking;
+    const char* kind = "Parking";
+    bool atParking = true;
+    parkingIndex = facilityDbNearestParking(airport, myLatitude, myLongitude, target);
+    if (parkingIndex < 0 || !facilityDbParking(airport, static_cast<uint32_t>(parkingIndex), parking) || target.distance > parking.radius) {
+        kind = "Jetway";
+        atParking = false;
+        parkingIndex = facilityDbClosestJetway(airport, myLatitude, myLongitude, target);
+    }
+    if (parkingIndex < 0) {
+        printf("No Jetways found\n");
+        return;
+    }
+    JetwayDistance = target.distance;
+    JetwayBearing = target.bearing;
+
+    // Not at a parking yet: how far it is along the taxiways, once the taxiways of the airport are in (asked for in
+    // the background, the next lookup here has them)
+    double taxiDistance = -1;
+    if (!atParking) {
+        TaxiRoute route;
+        if (taxiGraphRoute(airport.ident, myLatitude, myLongitude, static_cast<uint32_t>(parkingIndex), route)) {
+            taxiDistance = route.distance;
+        }
+        else if (!taxiGraphCached(airport.ident)) {
+            taxiGraphRequest(hSimConnect, REQUEST_TAXI_GRAPH, airport.ident, airport.latitude, airport.longitude);
+        }
+    }
+    if (facilityDbParking(airport, static_cast<uint32_t>(parkingIndex), parking)) {
+        setParkingGate(kind, parking.name, parking.suffix, parking.number, taxiDistance);
+    }
+}
+
+// Name and gate from the facility database, false when the airport (or its parkings and jetways, on the ground) was
+// never looked up
+static bool lookupStoredAirport(const char* ident) {
+    FacilityDbAirport airport;
+    const uint32_t groundFlags = FACILITY_DB_JETWAYS | FACILITY_DB_PARKINGS;
+    if (!facilityDbFind(ident, airport) || (isSimOnGround && (airport.flags & groundFlags) != groundFlags)) {
+        return false;
+    }
+
+    airportName = airport.name;
+    airportICAO = airport.ident;
+    if (positionRequester == 0) {
+        printf("Closest airport is %s (%s)\n", airport.name, airport.ident);
+    }
+
+    if (!isSimOnGround) {
+        printf("You are currently in the air. Not Jetway/Gate data available.\n");
+    }
+    else {
+        resolveParkingGate(airport);
+    }
+    return true;
+}
+
+// The closest airport is known: ask for its jetways (on the ground) and its name, FACILITY_DATA_END completes the lookup.
+// Airports in the facility database complete it right away
+static void requestAirportDetails(const char* closestAirportIdent, double latitude, double longitude, double altitude) {
+    // printf("Closest airport ICAO: %s\n", closestAirportIdent);
+
+    if (lookupStoredAirport(closestAirportIdent)) {
+        completeAirportLookup();
+        return;
+    }
+    // Already on its way, FACILITY_DATA_END of the prefetch comes back here
+    if (facilityPrefetchPending(closestAirportIdent, isSimOnGround)) {
+        printf("[PREFETCH] Waiting for %s\n", closestAirportIdent);
+        lookupAwaitingPrefetch.ident = closestAirportIdent;
+        lookupAwaitingPrefetch.latitude = latitude;
+        lookupAwaitingPrefetch.longitude = longitude;
+        lookupAwaitingPrefetch.altitude = altitude;
+        return;
+    }
+
+    // What comes back is stored at FACILITY_DATA_END
+    facilityLookup = FacilityAirportRecord();
+    facilityLookup.ident = closestAirportIdent;
+    facilityLookup.latitude = latitude;
+    facilityLookup.longitude = longitude;
+    facilityLookup.altitude = altitude;
+
+    if (isSimOnGround) {
+        // Request data only if on the ground
+        handleGroundOperations(closestAirportIdent); // Request Jetway data
+    }
+    else {
+        printf("You are currently in the air. Not Jetway/Gate data available.\n");
+    }
+
+    // Reset names before calling FACILITY DATA. If the request fails, we will have empty strings
+    airportName = "";
+    airportICAO = "";
+
+    // The name, and the parkings for the gate on the ground. In the air that is a couple of messages instead of one
+    // per parking
+    unsigned needs = isSimOnGround ? FACILITY_NEED_NAME | FACILITY_NEED_PARKINGS : FACILITY_NEED_NAME;
+    if (facilityPlanRequest(hSimConnect, closestAirportIdent, needs, FACILITY_DATA_DEF_REQUEST_START + g_RequestCount)) {
+        g_RequestCount++;
+    }
+    else {
+        printf("Failed to obtain airport name\n");
+    }
+}
+
+// Flight recorder entry for every message we receive (request or event ID and its main value when there is one)
+static void recordDispatch(SIMCONNECT_RECV* pData, DWORD cbData) {
+    uint32_t id = 0;
+    uint64_t data = 0;
+
+    switch (pData->dwID) {
+    case SIMCONNECT_RECV_ID_EVENT:
+    case SIMCONNECT_RECV_ID_EVENT_FILENAME:
+    case SIMCONNECT_RECV_ID_EVENT_FRAME: {
+        SIMCONNECT_RECV_EVENT* evt = (SIMCONNECT_RECV_EVENT*)pData;
+        id = evt->uEventID;
+        data = evt->dwData;
+        break;
+    }
+    case SIMCONNECT_RECV_ID_SIMOBJECT_DATA:
+    case SIMCONNECT_RECV_ID_SIMOBJECT_DATA_BYTYPE: {
+        SIMCONNECT_RECV_SIMOBJECT_DATA* pObjData = (SIMCONNECT_RECV_SIMOBJECT_DATA*)pData;
+        id = pObjData->dwRequestID;
+        data = pObjData->dwDefineID;
+        break;
+    }
+    case SIMCONNECT_RECV_ID_SYSTEM_STATE: {
+        SIMCONNECT_RECV_SYSTEM_STATE* pState = (SIMCONNECT_RECV_SYSTEM_STATE*)pData;
+        id = pState->dwRequestID;
+        data = pState->dwInteger;
+        break;
+    }
+    case SIMCONNECT_RECV_ID_FACILITY_DATA: {
+        SIMCONNECT_RECV_FACILITY_DATA* pFacilityData = (SIMCONNECT_RECV_FACILITY_DATA*)pData;
+        id = pFacilityData->UserRequestId;
+        data = pFacilityData->Type;
+        break;
+    }
+    case SIMCONNECT_RECV_ID_FACILITY_DATA_END: {
+        SIMCONNECT_RECV_FACILITY_DATA_END* pFacilityData = (SIMCONNECT_RECV_FACILITY_DATA_END*)pData;
+        id = pFacilityData->RequestId;
+        break;
+    }
+    case SIMCONNECT_RECV_ID_AIRPORT_LIST: {
+        SIMCONNECT_RECV_AIRPORT_LIST* pAirList = (SIMCONNECT_RECV_AIRPORT_LIST*)pData;
+        id = pAirList->dwRequestID;
+        data = pAirList->dwArraySize;
+        break;
+    }
+    case SIMCONNECT_RECV_ID_JETWAY_DATA: {
+        SIMCONNECT_RECV_JETWAY_DATA* pJetwayData = (SIMCONNECT_RECV_JETWAY_DATA*)pData;
+        id = pJetwayData->dwRequestID;
+        data = pJetwayData->dwArraySize;
+        break;
+    }
+    case SIMCONNECT_RECV_ID_EXCEPTION: {
+        SIMCONNECT_RECV_EXCEPTION* except = (SIMCONNECT_RECV_EXCEPTION*)pData;
+        id = except->dwException;
+        data = except->dwSendID;
+        break;
+    }
+    default:
+        break;
+    }
+
+    recorderLog(RECORD_MESSAGE, static_cast<uint16_t>(pData->dwID), cbData, id, data);
+}
+
+// REQUEST_RUNWAY_SAMPLE, every sim frame the aircraft moved. Changes nothing the flight recorder or the live state
+// shows, so it is not logged or published (it would fill the black box within minutes of taxiing)
+static bool runwaySample(SIMCONNECT_RECV* pData) {
+    if (pData->dwID != SIMCONNECT_RECV_ID_SIMOBJECT_DATA || ((SIMCONNECT_RECV_SIMOBJECT_DATA*)pData)->dwRequestID != REQUEST_RUNWAY_SAMPLE) {
+        return false;
+    }
+    RunwaySample* pR = (RunwaySample*)&((SIMCONNECT_RECV_SIMOBJECT_DATA*)pData)->dwData;
+    if (static_cast<int>(pR->latitude) != 0 || static_cast<int>(pR->longitude) != 0) { // Not in the main menu
+        runwayIndexSample(hSimConnect, REQUEST_RUNWAYS, pR->latitude, pR->longitude, pR->true_heading, pR->sim_on_ground != 0.0);
+    }
+    return true;
+}
+
+void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* /*pContext*/)
 {
+    if (runwaySample(pData)) {
+        return;
+    }
+
     if(DEBUG)
         printf("Received callback with data size: %lu bytes\n", cbData); // General data size
 
+    recordDispatch(pData, cbData);
+
     switch (pData->dwID)
     {
 
@@ -141,6 +745,43 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
 
     case SIMCONNECT_RECV_ID_FACILITY_DATA: {
         SIMCONNECT_RECV_FACILITY_DATA* pFacilityData = (SIMCONNECT_RECV_FACILITY_DATA*)pData;
+        facilityPlanReceived(pFacilityData->UserRequestId, cbData);
+
+        if (facilityPrefetchOwns(pFacilityData->UserRequestId)) {
+            if (pFacilityData->Type == SIMCONNECT_FACILITY_DATA_AIRPORT) {
+                facilityPrefetchName(((sAirport*)&pFacilityData->Data)->name);
+            }
+            else if (pFacilityData->Type == SIMCONNECT_FACILITY_DATA_TAXI_PARKING) {
+                sTaxiParkings* taxiparking = (sTaxiParkings*)&pFacilityData->Data;
+                facilityPrefetchParking({ taxiparking->NAME, taxiparking->SUFFIX, taxiparking->NUMBER, taxiparking->BIAS_X, taxiparking->BIAS_Z, taxiparking->RADIUS });
+            }
+            break;
+        }
+        if (runwayIndexOwns(pFacilityData->UserRequestId)) {
+            if (pFacilityData->Type == SIMCONNECT_FACILITY_DATA_RUNWAY) {
+                sRunways* runway = (sRunways*)&pFacilityData->Data;
+                runwayIndexRunway({ runway->LATITUDE, runway->LONGITUDE, runway->HEADING, runway->LENGTH, runway->WIDTH, runway->PRIMARY_NUMBER, runway->PRIMARY_DESIGNATOR, runway->SECONDARY_NUMBER, runway->SECONDARY_DESIGNATOR });
+            }
+            break;
+        }
+        if (pFacilityData->UserRequestId == REQUEST_FREQUENCIES && pFacilityData->Type != SIMCONNECT_FACILITY_DATA_FREQUENCY) {
+            break; // Its AIRPORT item is not the airport of the gate lookup
+        }
+        if (taxiGraphOwns(pFacilityData->UserRequestId)) {
+            if (pFacilityData->Type == SIMCONNECT_FACILITY_DATA_TAXI_PARKING) {
+                sTaxiParkings* taxiparking = (sTaxiParkings*)&pFacilityData->Data;
+                taxiGraphParking(taxiparking->BIAS_X, taxiparking->BIAS_Z);
+            }
+            else if (pFacilityData->Type == SIMCONNECT_FACILITY_DATA_TAXI_POINT) {
+                sTaxiPoints* taxipoint = (sTaxiPoints*)&pFacilityData->Data;
+                taxiGraphPoint(taxipoint->BIAS_X, taxipoint->BIAS_Z);
+            }
+            else if (pFacilityData->Type == SIMCONNECT_FACILITY_DATA_TAXI_PATH) {
+                sTaxiPaths* taxipath = (sTaxiPaths*)&pFacilityData->Data;
+                taxiGraphPath({ taxipath->TYPE, taxipath->START, taxipath->END });
+            }
+            break;
+        }
 
         switch (pFacilityData->Type)
         {
@@ -159,14 +800,12 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
 
         case SIMCONNECT_FACILITY_DATA_RUNWAY:
         {
-            printf("Runway data received. NOT IMPLEMENTED YET\n");
+            // Only the runway index asks for these (runwayIndexOwns above)
             break;
         }
 
         case SIMCONNECT_FACILITY_DATA_JETWAY:
         {
-            sJetways* jetway = (sJetways*)&pFacilityData->Data;
-
             countJetways++;
             break;
         }
@@ -175,49 +814,31 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
         {
             sTaxiParkings* taxiparking = (sTaxiParkings*)&pFacilityData->Data;
 
-            if ((countTaxiParking == parkingIndex) && parkingIndex != NULL) {
-                GateInfo gateInfo = formatGateName(taxiparking->NAME);
-                GateInfo gateSuffixInfo = formatGateName(taxiparking->SUFFIX);
-                int clockPos = calculateClockPosition(JetwayBearing, myHeading);
-
-                parkingGate = gateInfo.gateString;
-                parkingGateSuffix = gateSuffixInfo.gateString;
-                parkingNumber = taxiparking->NUMBER;
-
-                if (positionRequester == 0) {
-                    std::string gateString = "Closest Jetway is " + gateInfo.friendlyName + " " + std::to_string(taxiparking->NUMBER) + " at " + airportName + ". Distance from your aircraft is " + std::to_string(int(metersToFeet(JetwayDistance))) + " meters (" + std::to_string(int(JetwayDistance)) + " feet) at your " + std::to_string(clockPos) + " o'clock";
-                    sendText(hSimConnect, gateString);
-                    printf("Closest Jetway is %s %d\n", gateInfo.friendlyName.c_str(), taxiparking->NUMBER);
-                }
-
-                taxiparking = nullptr;
-            }
-
-            countTaxiParking++;
+            // Resolved with the jetways from the facility database at FACILITY_DATA_END
+            facilityLookup.parkings.push_back({ taxiparking->NAME, taxiparking->SUFFIX, taxiparking->NUMBER, taxiparking->BIAS_X, taxiparking->BIAS_Z, taxiparking->RADIUS });
             break;
         }
 
+        case SIMCONNECT_FACILITY_DATA_TAXI_POINT:
         case SIMCONNECT_FACILITY_DATA_TAXI_PATH:
         {
-            printf("Taxi path data received. NOT IMPLEMENTED YET\n");
+            // Only the taxiway fetch asks for these (taxiGraphOwns above)
             break;
         }
 
         case SIMCONNECT_FACILITY_DATA_FREQUENCY:
-        {
-            printf("Frequency data received. NOT IMPLEMENTED YET\n");
-            break;
-        }
-
         case SIMCONNECT_FACILITY_DATA_VOR:
-        {
-            printf("VOR data received. NOT IMPLEMENTED YET\n");
-            break;
-        }
-
         case SIMCONNECT_FACILITY_DATA_WAYPOINT:
         {
-            printf("Waypoint data received. NOT IMPLEMENTED YET\n");
+            // Into the table of its type, decoded with the fields of the definitions that ask for it (none for VOR and
+            // WAYPOINT yet)
+            DWORD header = static_cast<DWORD>(reinterpret_cast<char*>(&pFacilityData->Data) - reinterpret_cast<char*>(pData));
+            const char* owner = facilityPlanIdent(pFacilityData->UserRequestId);
+            if (cbData < header || !facilityTablesAppend(static_cast<SIMCONNECT_FACILITY_DATA_TYPE>(pFacilityData->Type), owner, &pFacilityData->Data, cbData - header)) {
+                if (DEBUG) {
+                    printf("[FACILITIES] Facility data of type %lu could not be decoded\n", (unsigned long)pFacilityData->Type);
+                }
+            }
             break;
         }
 
@@ -232,25 +853,48 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
         SIMCONNECT_RECV_FACILITY_DATA_END* pFacilityData = (SIMCONNECT_RECV_FACILITY_DATA_END*)pData;
 
         // printf("Request ID %u have been processed succesfully, reset values\n", pFacilityData->RequestId);
+        facilityPlanReceived(pFacilityData->RequestId, cbData);
+        const char* ident = facilityPlanIdent(pFacilityData->RequestId);
+        std::string lookedUp = ident != nullptr ? ident : "";
+        unsigned answered = facilityPlanFinished(pFacilityData->RequestId);
+        if (answered & FACILITY_NEED_FREQUENCIES) {
+            facilityTablesFinished(SIMCONNECT_FACILITY_DATA_FREQUENCY, lookedUp.c_str());
+        }
+        if (pFacilityData->RequestId == REQUEST_FREQUENCIES) {
+            answerFrequencies(lookedUp);
+            break;
+        }
+        if (runwayIndexFinished(hSimConnect, pFacilityData->RequestId, answered)) {
+            break;
+        }
+        if (taxiGraphFinished(pFacilityData->RequestId, answered)) {
+            break;
+        }
+        if (facilityPrefetchFinished(pFacilityData->RequestId, answered)) {
+            // The gate lookup that waited for it now finds the airport stored (or asks MSFS itself)
+            if (!lookupAwaitingPrefetch.ident.empty()) {
+                FacilityAirportRecord waiting = lookupAwaitingPrefetch;
+                lookupAwaitingPrefetch = FacilityAirportRecord();
+                requestAirportDetails(waiting.ident.c_str(), waiting.latitude, waiting.longitude, waiting.altitude);
+            }
+            break;
+        }
+        if (answered & FACILITY_NEED_PARKINGS) {
+            facilityLookup.flags |= FACILITY_DB_PARKINGS;
+        }
 
-        finalFLTchange(); // MODIFY the .FLT file to set the FirstFlightState to firstFlightState* but only do it for the final save and when flight is LAST.FLT
-
-        // Reset the counters
-        countJetways = 0;
-        countTaxiParking = 0;
-
-        // Reset the requester after use
-        positionRequester = 0; // Reset the position requester
-
-        // Reset names after use
-        airportName = "";
-        airportICAO = "";
-
-        JetwayDistance = NULL;
-        JetwayBearing = NULL;
+        // Airports seen for the first time go to the facility database, the next lookup there needs no facility data.
+        // The gate is then resolved from the stored parkings, as for a known airport
+        FacilityDbAirport stored;
+        if (!airportICAO.empty() && airportICAO == facilityLookup.ident) {
+            facilityLookup.name = airportName;
+            if (facilityDbStore(facilityLookup) && facilityDbFind(facilityLookup.ident.c_str(), stored) && isSimOnGround) {
+                resolveParkingGate(stored);
+            }
+        }
+        facilityLookup = FacilityAirportRecord();
 
-        // After using the data, reset the values
-        parkingIndex = NULL;
+        completeAirportLookup();
 
         break;
     }
@@ -259,37 +903,14 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
     {
         SIMCONNECT_RECV_JETWAY_DATA* pJetwayData = (SIMCONNECT_RECV_JETWAY_DATA*)pData;
         unsigned int count = static_cast<unsigned int>(pJetwayData->dwArraySize);
-
-        if (count > 0) {
-
-
-            double closestJetwayDistance = std::numeric_limits<double>::max();
-            double closestJetwayBearing  = std::numeric_limits<double>::max();
-
-            SIMCONNECT_JETWAY_DATA* closestJetway = nullptr;
-            parkingIndex = NULL;  // Initialize the parking index to NULL as 0 is a valid index
-
-            for (unsigned int i = 0; i < count; ++i) {
-                SIMCONNECT_JETWAY_DATA& jetway = pJetwayData->rgData[i];
-                DistanceAndBearing result = calculateDistanceAndBearing(myLatitude, myLongitude, jetway.Lla.Latitude, jetway.Lla.Longitude);
-                if (result.distance < closestJetwayDistance) {
-                    closestJetwayDistance   = result.distance;
-                    closestJetwayBearing    = result.bearing;
-                    closestJetway = &jetway;
-                }
-            }
-  
-            if (closestJetway) {
-                parkingIndex = closestJetway->ParkingIndex;
-                int clockPos = calculateClockPosition(closestJetwayBearing, myHeading);
-                // printf("Closest Jetway is %.0f feet away (%.0f meters) bearing %.0f degrees (your %d o'clock)\n", metersToFeet(closestJetwayDistance), closestJetwayDistance, closestJetwayBearing, clockPos);
-                JetwayDistance = closestJetwayDistance;
-                JetwayBearing = closestJetwayBearing;
-            }
-
+        if (facilityPrefetchJetways(pJetwayData->rgData, count)) {
+            break;
         }
-        else {
-            printf("No Jetways found\n");
+
+        // The closest one is found in the facility database at FACILITY_DATA_END
+        facilityLookup.flags |= FACILITY_DB_JETWAYS;
+        for (unsigned int i = 0; i < count; ++i) {
+            facilityLookup.jetways.push_back({ pJetwayData->rgData[i].ParkingIndex, pJetwayData->rgData[i].Lla.Latitude, pJetwayData->rgData[i].Lla.Longitude });
         }
 
         break;
@@ -313,45 +934,24 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
 
     case SIMCONNECT_RECV_ID_AIRPORT_LIST: {
         SIMCONNECT_RECV_AIRPORT_LIST* pAirList = (SIMCONNECT_RECV_AIRPORT_LIST*)pData;
-        char closestAirportIdent[8] = "";
-        double closestDistance = DBL_MAX;
-
-        if (pAirList->dwArraySize > 0) {
-            SIMCONNECT_DATA_FACILITY_AIRPORT* airports = (SIMCONNECT_DATA_FACILITY_AIRPORT*)(pAirList + 1);
-            for (DWORD i = 0; i < pAirList->dwArraySize; ++i) {
-                if (airports[i].Ident[0] != '\0') {
-                    double distanceSquared = pow(airports[i].Latitude - myLatitude, 2) + pow(airports[i].Longitude - myLongitude, 2);
-                    if (distanceSquared < closestDistance) {
-                        closestDistance = distanceSquared;
-                        strncpy_s(closestAirportIdent, sizeof(closestAirportIdent), airports[i].Ident, _TRUNCATE);
-                    }
-                }
-            }
+        unsigned count = static_cast<unsigned>(pAirList->dwArraySize);
 
-            if (closestAirportIdent[0] != '\0') {
-                // printf("Closest airport ICAO: %s\n", closestAirportIdent);
-
-                if (isSimOnGround) {
-                    // Request data only if on the ground
-                    handleGroundOperations(closestAirportIdent); // Request Jetway data
-                }
-                else {
-                    printf("You are currently in the air. Not Jetway/Gate data available.\n");
-                }
-
-                // Reset names before calling FACILITY DATA. If the request fails, we will have empty strings
-                airportName = "";
-                airportICAO = "";
-
-                // This should be somewhere else... need to investigate DEBUG THIS
-                hr = SimConnect_RequestFacilityData(hSimConnect, DEFINITION_FACILITY_AIRPORT, FACILITY_DATA_DEF_REQUEST_START + g_RequestCount, closestAirportIdent);
-                if (hr == S_OK) {
-                    g_RequestCount++;
-                }
-                else {
-                    printf("Failed to obtain airport name\n");
-                }
+        if (pAirList->dwRequestID == REQUEST_AIRPORTS_IN_RANGE) {
+            airportIndexAdd(pAirList->rgData, count);
+            break;
+        }
+        if (pAirList->dwRequestID == REQUEST_AIRPORTS_OUT_OF_RANGE) {
+            airportIndexRemove(pAirList->rgData, count);
+            break;
+        }
 
+        // REQUEST_CLOSEST_AIRPORT, when the index could not answer
+        if (count > 0) {
+            int closest = closestAirport(pAirList->rgData, count, myLatitude, myLongitude);
+            if (closest >= 0) {
+                char closestAirportIdent[8] = "";
+                strncpy_s(closestAirportIdent, sizeof(closestAirportIdent), pAirList->rgData[closest].Ident, _TRUNCATE);
+                requestAirportDetails(closestAirportIdent, pAirList->rgData[closest].Latitude, pAirList->rgData[closest].Longitude, pAirList->rgData[closest].Altitude);
             }
             else {
                 printf("No airports found. Check cache\n");
@@ -433,10 +1033,24 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
             int lon_int = static_cast<int>(pS->longitude);
 
             if (lat_int == 0 && lon_int == 0) {
-				printf("Aircraft Position: Not available or in Main Menu\n");
-			}
-            else {
-                printf("Latitude: %f - Longitude: %f - Altitude: %.0f feet - Ground Speed: %.0f knots - Heading: %.0f degrees - isOnGround: %.0f\n", pS->latitude, pS->longitude, pS->altitude, pS->airspeed, pS->mag_heading, pS->sim_on_ground);
+                break; // Not available or in Main Menu
+            }
+
+            // Keep our position current (the gate lookup still asks for a fresh one)
+            myLatitude      = pS->latitude;
+            myLongitude     = pS->longitude;
+            myAltitude      = pS->altitude;
+            myIASinFPS      = pS->IASinFPS;
+            myTASinFPS      = pS->TASinFPS;
+            myAirspeed      = pS->airspeed;
+            myFlaps         = pS->flaps;
+            myHeading       = pS->mag_heading;
+            myTrueHeading   = pS->true_heading;
+            isSimOnGround   = pS->sim_on_ground;
+
+            autoSaveSample(pS);
+            if (facilityPrefetchEnabled) {
+                facilityPrefetchPosition(hSimConnect, REQUEST_FACILITY_PREFETCH, REQUEST_TAXI_GRAPH, pS->latitude, pS->longitude, pS->sim_on_ground != 0.0);
             }
             break;
         }
@@ -453,6 +1067,7 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
             myAirspeed      = pS->airspeed;
             myFlaps         = pS->flaps;
             myHeading       = pS->mag_heading;
+            myTrueHeading   = pS->true_heading;
             isSimOnGround   = pS->sim_on_ground;
 
             int lat_int = static_cast<int>(pS->latitude);
@@ -476,6 +1091,31 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
                     }
                 // }
             }
+
+            // The gate lookup waiting for this position. The save's position always starts a lookup of its own, even
+            // when an earlier answer already started one for another request
+            positionAnswers++;
+            bool isSavePosition = savePosition != 0 && positionAnswers >= savePosition;
+            if (isSavePosition) {
+                savePosition = 0;
+            }
+            if (closestAirportPending || isSavePosition) {
+                closestAirportPending = FALSE;
+                lookupForSave = isSavePosition;
+                AirportIndexEntry nearest;
+                GateCacheEntry cached;
+                double distance = 0;
+                if ((lat_int != 0 || lon_int != 0) && gateCacheFind(myLatitude, myLongitude, myHeading, isSimOnGround, cached)) {
+                    replayCachedGate(cached);
+                    completeAirportLookup();
+                }
+                else if ((lat_int != 0 || lon_int != 0) && airportIndexNearest(myLatitude, myLongitude, nearest, distance)) {
+                    requestAirportDetails(nearest.ident, nearest.latitude, nearest.longitude, nearest.altitude);
+                }
+                else {
+                    requestClosestAirportList(); // Same answer as before the index
+                }
+            }
             break;
         }
         case REQUEST_ZULU_TIME:
@@ -526,6 +1166,10 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
                 printf("\n[SITUATION EVENT] No flight loaded\n");
   
             currentStatus();
+            facilityPrefetchFlightLoaded(currentFlight);
+            gateCacheClear();
+            facilityTablesClear();
+            facilityDbFlush(); // Airports looked up during the flight that ended
 
             // Identify if we are in the menu screen by checking if the flight we just loaded is MAINMENU.FLT
             if (currentFlight == "MAINMENU.FLT") {
@@ -554,7 +1198,7 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
                     auto last_modified = fs::last_write_time(currentFlightPath);
                     printf("\nWaiting SAVE to complete... ");
                     while (true) {
-                        Sleep(100); // Check every 100 milliseconds
+                        sleepMs(100); // Check every 100 milliseconds
                         if (hasFileUpdated(currentFlightPath, last_modified)) {
                             printf("Done! SAVE completed\n");
                             break; // File has been updated
@@ -639,6 +1283,7 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
                 printf("\n[CURRENT STATE] No flight currently loaded\n");
 
             currentStatus();
+            facilityPrefetchFlightLoaded(currentFlight);
 
             // Identify if we are in the menu screen by checking if the flight loaded is MAINMENU.FLT
             if (currentFlight == "MAINMENU.FLT") {
@@ -760,6 +1405,7 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
             case EVENT_CLOSEST_AIRPORT: { // CTRL+ALT+P - Request current position, then request the closest airport and gate
 
                 positionRequester = evt->dwData;
+                controlStarted(CONTROL_POSITION); // Any lookup answers pending position commands
 
                 if (positionRequester == 0) {
                     printf("\n[STATUS] Will try to obtain our current position and GATE...\n");
@@ -769,12 +1415,13 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
                 hr = SimConnect_RequestDataOnSimObject(hSimConnect, REQUEST_POSITION_ONCE, DEFINITION_POSITION_DATA, SIMCONNECT_OBJECT_ID_USER, SIMCONNECT_PERIOD_ONCE, SIMCONNECT_DATA_REQUEST_FLAG_DEFAULT);
                 if (hr != S_OK) {
                     printf("\nFailed to obtain our position\n");
+                    controlComplete(CONTROL_POSITION, false, "position request failed");
                 }
                 else {
-                    // Try to obtain ther closest airport to the user aircraft
-                    hr = SimConnect_RequestFacilitiesList_EX1(hSimConnect, SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT, REQUEST_CLOSEST_AIRPORT);
-                    if (hr != S_OK) {
-                        printf("\nFailed to obtain closest airport to our position\n");
+                    closestAirportPending = TRUE; // The previous lookup, the airport index or the airport list answers once the position is in
+                    positionRequests++;
+                    if (evt->dwData == LOOKUP_REQUEST_SAVE) {
+                        savePosition = positionRequests;
                     }
                 }
                 break;
@@ -784,27 +1431,39 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
                 // Only the following Flights are allowed to be saved
                 if (currentFlight == "LAST.FLT" || currentFlight == "CUSTOMFLIGHT.FLT") {
 
-                    if (evt->dwData == 99) { // INITIAL SAVE - Saves triggered by setZuluAndSave (we pass 99 as custom value)
+                    if (evt->dwData == SAVE_REQUEST_INITIAL) { // INITIAL SAVE - Saves triggered by setZuluAndSave (we pass 99 as custom value)
+                        metricsCountSaveRequest(SAVE_SOURCE_INITIAL);
                         firstSave();
+                        autosaveReset(tickCount()); // The autosave interval starts with the flight
                     }
-                    else if (evt->dwData == 55) { // USER USER SAVE (CTRL+ALT+S triggered)
+                    else if (evt->dwData == SAVE_REQUEST_USER) { // USER USER SAVE (CTRL+ALT+S triggered)
+                        metricsCountSaveRequest(SAVE_SOURCE_USER);
                         sendText(hSimConnect, "Flight saved succesfully! you can now quit your session and RESUME the flight by simply loading LAST.FLT in the world map screen.");
-                        finalSave();
+                        requestFinalSave(SAVE_KIND_USER);
                     }
-                    else if (evt->dwData == 98) { // NORMAL SAVE (ESC triggered)
+                    else if (evt->dwData == SAVE_REQUEST_CONTROL) { // Save command from the control channel
+                        metricsCountSaveRequest(SAVE_SOURCE_CONTROL);
+                        printf("\n[CONTROL] Save requested through the control channel\n");
+                        requestFinalSave(SAVE_KIND_USER);
+                    }
+                    else if (evt->dwData == SAVE_REQUEST_PAUSE) { // NORMAL SAVE (ESC triggered)
+                        metricsCountSaveRequest(SAVE_SOURCE_PAUSE);
                         printf("\n[EVENT_SITUATION_SAVE] Final save before exiting.. please wait.\n");
-                        finalSave();
+                        requestFinalSave(SAVE_KIND_EXIT);
                     }
-                    else if (evt->dwData == 0) { // NORMAL SAVE (ESC triggered)
+                    else if (evt->dwData == SAVE_REQUEST_ESC) { // NORMAL SAVE (ESC triggered)
+                        metricsCountSaveRequest(SAVE_SOURCE_ESC);
                         printf("\n[EVENT_SITUATION_SAVE] Final save triggered by pressing ESC key\n");
-                        finalSave();
+                        requestFinalSave(SAVE_KIND_EXIT);
                     }
                     else { // Values for dwData other than 0 or 99 (not implemented yet)
-                        printf("\n[ALERT] FLIGHT SITUATION WAS NOT SAVED. RECEIVED %d AS dwData\n", evt->dwData);
+                        printf("\n[ALERT] FLIGHT SITUATION WAS NOT SAVED. RECEIVED %lu AS dwData\n", evt->dwData);
                     }
                 }
                 else {
                     saveNotAllowed();
+                    controlStarted(CONTROL_SAVE);
+                    controlComplete(CONTROL_SAVE, false, currentFlight.empty() ? "no flight loaded" : currentFlight + " can not be saved");
                 }
                 break;
             }
@@ -812,6 +1471,8 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
                 printf("\n[EVENT_SITUATION_RELOAD] Current flight has been reloaded\n");
                 currentStatus();
                 wasReset = TRUE; // Set the flag so we know the sim was reset (RELOADED)
+                controlStarted(CONTROL_RELOAD);
+                controlComplete(CONTROL_RELOAD, true);
                 break;
             }
             case EVENT_SITUATION_RESET: { // RIGHT CONTROL + r
@@ -828,8 +1489,10 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
             }
             case EVENT_FLIGHTPLAN_LOAD: { // RIGHT ALT + f
                 printf("\n[EVENT_FLIGHTPLAN_LOAD] Flight Plan LAST.PLN has been loaded\n");
-                SimConnect_FlightPlanLoad(hSimConnect, "LAST.PLN");
+                hr = SimConnect_FlightPlanLoad(hSimConnect, "LAST.PLN");
                 // sendText(hSimConnect, "Flight Plan LAST.PLN has been loaded");
+                controlStarted(CONTROL_FP_LOAD);
+                controlComplete(CONTROL_FP_LOAD, hr == S_OK, hr == S_OK ? "LAST.PLN" : "LAST.PLN could not be loaded");
                 break;
             }
             case EVENT_FLIGHTPLAN_DEACTIVATED:
@@ -865,6 +1528,12 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
             case EVENT_SIM_CRASHED: {
 				printf("\n[EVENT_SIM_CRASHED] Aircraft Crashed, will reload your flight on your last SAVE\n");
 
+                // Put back the last committed save first, the file on disk may be older or in the middle of an update
+                std::string detail;
+                if (currentFlight == "LAST.FLT" && !restoreSnapshot(0, detail)) {
+                    printf("[SNAPSHOT] %s, reloading the file on disk\n", detail.c_str());
+                }
+
                 hr = SimConnect_FlightLoad(hSimConnect, currentFlightPath.c_str());
                 if (hr != S_OK) {
 					printf("\nFailed to reload the flight\n");
@@ -899,8 +1568,6 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
             SIMCONNECT_FACILITY_MINIMAL& fm = msg->rgData[i];
             printf("ICAO => Type: %c, Ident: %s, Region: %s, Airport: %s => Lat: %lf, Lat: %lf, Alt: %lf\n", fm.icao.Type, fm.icao.Ident, fm.icao.Region, fm.icao.Airport, fm.lla.Latitude, fm.lla.Longitude, fm.lla.Altitude);
         }
-
-        int randIndex = rand() % msg->dwArraySize;
         break;
     }
 
@@ -925,141 +1592,17 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
                 break;
             }
         }
-        else if (except->dwException == SIMCONNECT_EXCEPTION_DATA_ERROR) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_DATA_ERROR. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_LOAD_FLIGHTPLAN_FAILED) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_LOAD_FLIGHTPLAN_FAILED. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_GET_OBSERVATION) {
-            printf("Exception received for SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_GET_OBSERVATION. Debug here\n");
-        }
-        else if (except->dwException == SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_CREATE_STATION) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_CREATE_STATION. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_REMOVE_STATION) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_REMOVE_STATION. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_INVALID_DATA_TYPE) {
-            printf("Exception received for SIMCONNECT_EXCEPTION_INVALID_DATA_TYPE. Debug here\n");
-        }
-        else if (except->dwException == SIMCONNECT_EXCEPTION_INVALID_DATA_SIZE) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_INVALID_DATA_SIZE. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_INVALID_ARRAY) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_INVALID_ARRAY. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_CREATE_OBJECT_FAILED) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_CREATE_OBJECT_FAILED. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_OPERATION_INVALID_FOR_OBJECT_TYPE) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_OPERATION_INVALID_FOR_OBJECT_TYPE. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_ILLEGAL_OPERATION) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_ILLEGAL_OPERATION. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_ALREADY_SUBSCRIBED) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_ALREADY_SUBSCRIBED. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_INVALID_ENUM) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_INVALID_ENUM. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_DEFINITION_ERROR) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_DEFINITION_ERROR. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_DUPLICATE_ID) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_DUPLICATE_ID. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_DATUM_ID) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_DATUM_ID. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_OUT_OF_BOUNDS) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_OUT_OF_BOUNDS. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_ALREADY_CREATED) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_ALREADY_CREATED. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_OBJECT_OUTSIDE_REALITY_BUBBLE) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_OBJECT_OUTSIDE_REALITY_BUBBLE. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_OBJECT_CONTAINER) {
-            printf("Exception received for SIMCONNECT_EXCEPTION_OBJECT_CONTAINER. Debug here\n");
-        }
-        else if (except->dwException == SIMCONNECT_EXCEPTION_OBJECT_AI) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_OBJECT_AI. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_OBJECT_ATC) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_OBJECT_ATC. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_OBJECT_SCHEDULE) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_OBJECT_SCHEDULE. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_ACTION_NOT_FOUND) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_ACTION_NOT_FOUND. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_NOT_AN_ACTION) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_NOT_AN_ACTION. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_INCORRECT_ACTION_PARAMS) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_INCORRECT_ACTION_PARAMS. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_GET_INPUT_EVENT_FAILED) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_GET_INPUT_EVENT_FAILED. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_SET_INPUT_EVENT_FAILED) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_SET_INPUT_EVENT_FAILED. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_TOO_MANY_GROUPS) {
-            printf("Exception received for SIMCONNECT_EXCEPTION_TOO_MANY_GROUPS. Debug here\n");
-        }
-        else if (except->dwException == SIMCONNECT_EXCEPTION_NAME_UNRECOGNIZED) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_NAME_UNRECOGNIZED. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_TOO_MANY_EVENT_NAMES) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_TOO_MANY_EVENT_NAMES. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_EVENT_ID_DUPLICATE) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_EVENT_ID_DUPLICATE. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_TOO_MANY_MAPS) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_TOO_MANY_MAPS. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_TOO_MANY_OBJECTS) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_TOO_MANY_OBJECTS. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_TOO_MANY_REQUESTS) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_TOO_MANY_REQUESTS. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_WEATHER_INVALID_PORT) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_WEATHER_INVALID_PORT. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_WEATHER_INVALID_METAR) {
-			printf("Exception received for SIMCONNECT_EXCEPTION_WEATHER_INVALID_METAR. Debug here\n");
-		}
-        else if (except->dwException == SIMCONNECT_EXCEPTION_NONE) {
-            printf("Exception received for SIMCONNECT_EXCEPTION_NONE. Debug here\n");
-        }
-        else if (except->dwException == SIMCONNECT_EXCEPTION_ERROR) {
-            printf("Exception received for SIMCONNECT_EXCEPTION_ERROR. Debug here\n");
-        }
-        else if (except->dwException == SIMCONNECT_EXCEPTION_SIZE_MISMATCH) {
-            printf("Exception received for SIMCONNECT_EXCEPTION_SIZE_MISMATCH. Debug here\n");
-        }
-        else if (except->dwException == SIMCONNECT_EXCEPTION_UNRECOGNIZED_ID) {
-            printf("Exception received for SIMCONNECT_EXCEPTION_UNRECOGNIZED_ID. Debug here\n");
-        }
-        else if (except->dwException == SIMCONNECT_EXCEPTION_UNOPENED) {
-            printf("Exception received for SIMCONNECT_EXCEPTION_UNOPENED. Debug here\n");
-        }
-        else if (except->dwException == SIMCONNECT_EXCEPTION_VERSION_MISMATCH) {
-            printf("Exception received for SIMCONNECT_EXCEPTION_VERSION_MISMATCH. Debug here\n");
-        }
-        else if (except->dwException == SIMCONNECT_EXCEPTION_TOO_MANY_REQUESTS) {
-            printf("Exception received for SIMCONNECT_EXCEPTION_TOO_MANY_REQUESTS. Debug here\n");
-        }
         else {
-            printf("Unknown exception received: %d, SendID: %d, Index: %d (ID is %d)\n", except->dwException, except->dwSendID, except->dwIndex, except->dwID);
+            const char* exceptionName = simConnectExceptionName(except->dwException);
+            if (exceptionName != nullptr) {
+                printf("Exception received for SIMCONNECT_EXCEPTION_%s. Debug here\n", exceptionName);
+            }
+            else {
+                printf("Unknown exception received: %lu, SendID: %lu, Index: %lu (ID is %lu)\n", except->dwException, except->dwSendID, except->dwIndex, except->dwID);
+            }
         }
+        metricsCountException(except->dwException, simConnectExceptionName(except->dwException));
+        dumpFlightRecorder(ANOMALY_SIMCONNECT_EXCEPTION, except->dwException, except->dwSendID, except->dwIndex);
         currentStatus();
         break;
     }
@@ -1073,7 +1616,18 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
     case SIMCONNECT_RECV_ID_OPEN:
     {
         SIMCONNECT_RECV_OPEN* openData = (SIMCONNECT_RECV_OPEN*)pData;
-        printf("\n[SIMCONNECT] Connected to Flight Simulator! (%s Version %d.%d - Build %d)\n", openData->szApplicationName, openData->dwApplicationVersionMajor, openData->dwApplicationVersionMinor, openData->dwApplicationBuildMajor);
+        printf("\n[SIMCONNECT] Connected to Flight Simulator! (%s Version %lu.%lu - Build %lu)\n", openData->szApplicationName, openData->dwApplicationVersionMajor, openData->dwApplicationVersionMinor, openData->dwApplicationBuildMajor);
+
+        // Airports looked up in earlier runs, unless they were looked up in another version of the simulator or scenery
+        if (!localStatePath.empty()) {
+            char version[320];
+            snprintf(version, sizeof(version), "%s %lu.%lu.%lu.%lu", openData->szApplicationName, (unsigned long)openData->dwApplicationVersionMajor,
+                (unsigned long)openData->dwApplicationVersionMinor, (unsigned long)openData->dwApplicationBuildMajor, (unsigned long)openData->dwApplicationBuildMinor);
+            facilityDbOpen(localStatePath + PATH_SEPARATOR + FACILITY_DB_FILE, hash64(std::string(version)), facilityDbScenerySignature(CommunityPath));
+            if (facilityDbCount() > 0) {
+                printf("[FACILITIES] %u airports known from earlier flights\n", facilityDbCount());
+            }
+        }
 
         // Fix the MSFS bug when a connection is established
         // fixMSFSbug(customFlightmod); 
@@ -1089,6 +1643,12 @@ void CALLBACK Dispatcher(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext)
         printf("Unhandled data ID: %lu\n", pData->dwID); // Log unhandled data IDs
         break;
     }
+
+    // Log any state flag this message changed
+    recorderTrackFlags(currentStateFlags());
+
+    // Keep the shared live state segment current for overlays and other tools
+    publishLiveState();
 }
 
 void sc()
@@ -1102,19 +1662,47 @@ void sc()
         }
         else {
             printf("Failed to connect to Flight Simulator. Retrying...\n");
-            Sleep(1000); // Wait for 1 second before retrying
+            sleepMs(1000); // Wait for 1 second before retrying
         }
     }
 
     initApp();
 
     if (hSimConnect != NULL) {
+        metricsSetConnected(true);
+
         while (0 == quit) {
-            SimConnect_CallDispatch(hSimConnect, Dispatcher, NULL);
-            Sleep(1);
+            // Same as SimConnect_CallDispatch, but we drain the queue ourselves so we know how deep it was
+            SIMCONNECT_RECV* pData = nullptr;
+            DWORD cbData = 0;
+            uint32_t messages = 0;
+            while (0 == quit && SUCCEEDED(SimConnect_GetNextDispatch(hSimConnect, &pData, &cbData))) {
+                Dispatcher(pData, cbData, NULL);
+                messages++;
+            }
+            metricsDispatchPolled(messages);
+
+            // The save in flight once the simulator wrote LAST.FLT (or gave up on it)
+            if (!flightSavePoll(tickCount())) {
+                abandonSave("LAST.FLT was not written");
+            }
+
+            // Background saves whose coalescing window closed (or a follow up save)
+            if (saveSchedulerPoll(tickCount())) {
+                runSave();
+            }
+
+            // Commands from the control channel, all commands of one batch go out in the same poll
+            uint32_t commands = controlTakePending();
+            if (commands != 0) {
+                runControlCommands(commands);
+            }
+            sleepMs(1);
         }
 
         hr = SimConnect_Close(hSimConnect);
+        metricsSetConnected(false);
+        facilityDbFlush();
         printf("[SIMCONNECT] Disconnected from Flight Simulator!\n");
     }
 }
\ No newline at end of file
@@ -0,0 +1,717 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include "FacilityDb.h"
+#include "Hash.h"
+
+namespace fs = std::filesystem;
+
+#define FACILITY_DB_IDENT 8     // Bytes of an ident in FACILITY_DB_AIRPORT_IDENT
+
+#ifdef _WIN32
+static HANDLE dbMapping = NULL;
+#endif
+
+static const char* dbView = nullptr;
+static uint64_t dbBytes = 0;
+static std::string dbMemory;            // Contents when they could not be written, dbView points into it
+static std::string dbPath;
+static uint64_t dbSimSignature = 0;
+static uint64_t dbScenerySignature = 0;
+
+static std::map<std::string, FacilityAirportRecord> dbPending;  // Stored since the file was written, by ident
+static std::string dbPendingImage;      // dbPending in the file layout, read by the lookups like the file
+static uint32_t dbPendingNew = 0;       // Airports in dbPending the file does not have
+
+// view: the file (dbView) or dbPendingImage
+static const FacilityDbHeader* dbHeader(const char* view) {
+    return reinterpret_cast<const FacilityDbHeader*>(view);
+}
+
+template <typename T> static const T* dbColumn(const char* view, FACILITY_DB_COLUMN column) {
+    return reinterpret_cast<const T*>(view + dbHeader(view)->columns[column]);
+}
+
+static void dbUnmap() {
+    if (dbView == nullptr) {
+        return;
+    }
+    if (!dbMemory.empty()) {
+        dbMemory.clear();
+        dbView = nullptr;
+        dbBytes = 0;
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(dbView);
+    CloseHandle(dbMapping);
+    dbMapping = NULL;
+#else
+    munmap(const_cast<char*>(dbView), dbBytes);
+#endif
+    dbView = nullptr;
+    dbBytes = 0;
+}
+
+// Maps the whole file read only, false when it does not exist or is empty
+static bool dbMap() {
+    dbUnmap();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(dbPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    dbMapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file); // The mapping keeps the file open
+    if (dbMapping == NULL) {
+        return false;
+    }
+    dbView = static_cast<const char*>(MapViewOfFile(dbMapping, FILE_MAP_READ, 0, 0, 0));
+    if (dbView == nullptr) {
+        CloseHandle(dbMapping);
+        dbMapping = NULL;
+        return false;
+    }
+    dbBytes = static_cast<uint64_t>(size.QuadPart);
+#else
+    int file = open(dbPath.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size == 0) {
+        close(file);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, file, 0);
+    close(file); // The mapping keeps the file open
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    dbView = static_cast<const char*>(view);
+    dbBytes = static_cast<uint64_t>(info.st_size);
+#endif
+    return true;
+}
+
+// Every column and every range inside the file, so lookups need no checks
+static bool dbValid() {
+    const FacilityDbHeader* header = dbHeader(dbView);
+    if (dbBytes < sizeof(FacilityDbHeader) || memcmp(header->magic, FACILITY_DB_MAGIC, sizeof(header->magic)) != 0 || header->headerSize != sizeof(FacilityDbHeader)) {
+        return false;
+    }
+    const uint64_t airports = header->airportCount, parkings = header->parkingCount, jetways = header->jetwayCount;
+    const uint64_t sizes[FACILITY_DB_COLUMNS] = {
+        airports * FACILITY_DB_IDENT, airports * 4, airports * 8, airports * 8, airports * 8, airports * 4, airports * 4, airports * 4, airports * 4, airports * 4, airports * 4, airports * 4,
+        parkings * 4, parkings * 4, parkings * 4, parkings * 4, parkings * 4, parkings * 4,
+        jetways * 4, jetways * 8, jetways * 8, jetways * 8, jetways * 8, jetways * 8,
+        header->nodeCount * sizeof(FacilityDbNode), parkings * 4,
+        header->stringBytes,
+    };
+    for (int column = 0; column < FACILITY_DB_COLUMNS; ++column) {
+        if (header->columns[column] % 8 != 0 || header->columns[column] > dbBytes || sizes[column] > dbBytes - header->columns[column]) {
+            return false;
+        }
+    }
+    if (header->stringBytes == 0 || dbView[header->columns[FACILITY_DB_STRINGS] + header->stringBytes - 1] != '\0') {
+        return false;
+    }
+
+    const char* idents = dbColumn<char>(dbView, FACILITY_DB_AIRPORT_IDENT);
+    const uint32_t* names = dbColumn<uint32_t>(dbView, FACILITY_DB_AIRPORT_NAME);
+    const uint32_t* firstParking = dbColumn<uint32_t>(dbView, FACILITY_DB_AIRPORT_FIRST_PARKING);
+    const uint32_t* parkingCount = dbColumn<uint32_t>(dbView, FACILITY_DB_AIRPORT_PARKINGS);
+    const uint32_t* firstJetway = dbColumn<uint32_t>(dbView, FACILITY_DB_AIRPORT_FIRST_JETWAY);
+    const uint32_t* jetwayCount = dbColumn<uint32_t>(dbView, FACILITY_DB_AIRPORT_JETWAYS);
+    const uint32_t* firstNode = dbColumn<uint32_t>(dbView, FACILITY_DB_AIRPORT_FIRST_NODE);
+    const uint32_t* nodeCount = dbColumn<uint32_t>(dbView, FACILITY_DB_AIRPORT_NODES);
+    const FacilityDbNode* nodes = dbColumn<FacilityDbNode>(dbView, FACILITY_DB_NODE);
+    const uint32_t* entries = dbColumn<uint32_t>(dbView, FACILITY_DB_NODE_PARKING);
+    for (uint64_t i = 0; i < airports; ++i) {
+        if (idents[i * FACILITY_DB_IDENT + FACILITY_DB_IDENT - 1] != '\0' || names[i] >= header->stringBytes ||
+            static_cast<uint64_t>(firstParking[i]) + parkingCount[i] > parkings || static_cast<uint64_t>(firstJetway[i]) + jetwayCount[i] > jetways ||
+            static_cast<uint64_t>(firstNode[i]) + nodeCount[i] > header->nodeCount) {
+            return false;
+        }
+        if (i > 0 && strncmp(idents + (i - 1) * FACILITY_DB_IDENT, idents + i * FACILITY_DB_IDENT, FACILITY_DB_IDENT) >= 0) {
+            return false;
+        }
+        // Children come after their parent (no cycles), leaves stay in the parkings of the airport
+        for (uint32_t node = 0; node < nodeCount[i]; ++node) {
+            const FacilityDbNode& tree = nodes[firstNode[i] + node];
+            uint64_t count = tree.count & ~FACILITY_DB_NODE_LEAF;
+            bool leaf = (tree.count & FACILITY_DB_NODE_LEAF) != 0;
+            if (count == 0 || count > FACILITY_DB_FANOUT || (leaf ? tree.first + count > parkingCount[i] : tree.first <= node || tree.first + count > nodeCount[i])) {
+                return false;
+            }
+        }
+        for (uint32_t parking = 0; parking < parkingCount[i]; ++parking) {
+            if (entries[firstParking[i] + parking] >= parkingCount[i]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void facilityDbClose() {
+    facilityDbFlush();
+    dbUnmap();
+    dbPath.clear();
+}
+
+void facilityDbClear() {
+    dbPending.clear();
+    dbPendingImage.clear();
+    dbPendingNew = 0;
+    dbUnmap();
+    std::error_code ec;
+    if (!dbPath.empty()) {
+        fs::remove(dbPath, ec);
+    }
+}
+
+// Contents that could not be written, for this session only
+static void dbKeepInMemory(std::string& file) {
+    dbUnmap();
+    dbMemory.swap(file);
+    dbView = dbMemory.data();
+    dbBytes = dbMemory.size();
+}
+
+bool facilityDbOpen(const std::string& path, uint64_t simSignature, uint64_t scenerySignature) {
+    facilityDbClose();
+    dbPath = path;
+    dbSimSignature = simSignature;
+    dbScenerySignature = scenerySignature;
+
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    if (!dbMap()) {
+        return true; // Nothing stored yet, the first lookup creates the file
+    }
+    if (!dbValid()) {
+        printf("[FACILITIES] %s has an unknown format, it is filled again\n", path.c_str());
+        dbUnmap();
+    }
+    else if (dbHeader(dbView)->simSignature != simSignature || dbHeader(dbView)->scenerySignature != scenerySignature) {
+        printf("[FACILITIES] Simulator or scenery changed since %u airports were stored, they are looked up again\n", dbHeader(dbView)->airportCount);
+        dbUnmap();
+    }
+    else {
+        return true;
+    }
+    fs::remove(path, ec);
+    return true;
+}
+
+uint64_t facilityDbScenerySignature(const std::string& packagesPath) {
+    if (packagesPath.empty()) {
+        return 0;
+    }
+
+    // Community packages, and the official ones (Official\OneStore or Official\Steam)
+    std::error_code ec;
+    std::vector<fs::path> folders = { fs::path(packagesPath) / "Community" };
+    for (const auto& entry : fs::directory_iterator(fs::path(packagesPath) / "Official", ec)) {
+        folders.push_back(entry.path());
+    }
+
+    // A package added, removed or updated (its manifest.json is rewritten) changes the signature
+    std::vector<std::string> packages;
+    for (const fs::path& folder : folders) {
+        for (const auto& entry : fs::directory_iterator(folder, ec)) {
+            fs::path manifest = entry.path() / "manifest.json";
+            std::error_code missing;
+            auto changed = fs::last_write_time(manifest, missing);
+            uintmax_t size = fs::file_size(manifest, missing);
+            packages.push_back(folder.filename().string() + "/" + entry.path().filename().string() + " " +
+                std::to_string(missing ? 0 : static_cast<long long>(changed.time_since_epoch().count())) + " " + std::to_string(missing ? 0 : size));
+        }
+    }
+    std::sort(packages.begin(), packages.end());
+
+    uint64_t signature = hash64(packagesPath);
+    for (const std::string& package : packages) {
+        signature = hash64(package.data(), package.size(), signature);
+    }
+    return signature;
+}
+
+// --- Airports -------------------------------------------------------------------------------------------------------
+
+static uint32_t dbCount(const char* view) {
+    return view != nullptr ? dbHeader(view)->airportCount : 0;
+}
+
+uint32_t facilityDbCount() {
+    return dbCount(dbView) + dbPendingNew;
+}
+
+static const char* dbIdent(const char* view, uint32_t index) {
+    return dbColumn<char>(view, FACILITY_DB_AIRPORT_IDENT) + static_cast<size_t>(index) * FACILITY_DB_IDENT;
+}
+
+static const char* dbAirportView(const FacilityDbAirport& airport) {
+    return airport.pending ? dbPendingImage.data() : dbView;
+}
+
+static void dbAirport(const char* view, uint32_t index, FacilityDbAirport& airport) {
+    airport.index = index;
+    airport.pending = view != dbView;
+    airport.ident = dbIdent(view, index);
+    airport.name = dbColumn<char>(view, FACILITY_DB_STRINGS) + dbColumn<uint32_t>(view, FACILITY_DB_AIRPORT_NAME)[index];
+    airport.latitude = dbColumn<double>(view, FACILITY_DB_AIRPORT_LATITUDE)[index];
+    airport.longitude = dbColumn<double>(view, FACILITY_DB_AIRPORT_LONGITUDE)[index];
+    airport.altitude = dbColumn<double>(view, FACILITY_DB_AIRPORT_ALTITUDE)[index];
+    airport.parkingCount = dbColumn<uint32_t>(view, FACILITY_DB_AIRPORT_PARKINGS)[index];
+    airport.jetwayCount = dbColumn<uint32_t>(view, FACILITY_DB_AIRPORT_JETWAYS)[index];
+    airport.flags = dbColumn<uint32_t>(view, FACILITY_DB_AIRPORT_FLAGS)[index];
+}
+
+// Binary search on the sorted ident column
+static bool dbSearch(const char* view, const char* key, FacilityDbAirport& airport) {
+    uint32_t lo = 0, hi = dbCount(view);
+    while (lo < hi) {
+        uint32_t middle = lo + (hi - lo) / 2;
+        int order = strncmp(dbIdent(view, middle), key, FACILITY_DB_IDENT);
+        if (order == 0) {
+            dbAirport(view, middle, airport);
+            return true;
+        }
+        if (order < 0) {
+            lo = middle + 1;
+        }
+        else {
+            hi = middle;
+        }
+    }
+    return false;
+}
+
+bool facilityDbFind(const char* ident, FacilityDbAirport& airport) {
+    char key[FACILITY_DB_IDENT] = {};
+    strncpy(key, ident, FACILITY_DB_IDENT - 1);
+
+    // The airports not written yet are the newer ones
+    return (!dbPendingImage.empty() && dbSearch(dbPendingImage.data(), key, airport)) || dbSearch(dbView, key, airport);
+}
+
+bool facilityDbParking(const FacilityDbAirport& airport, uint32_t parkingIndex, FacilityParking& parking) {
+    const char* view = dbAirportView(airport);
+    if (parkingIndex >= airport.parkingCount) {
+        return false;
+    }
+    uint32_t i = dbColumn<uint32_t>(view, FACILITY_DB_AIRPORT_FIRST_PARKING)[airport.index] + parkingIndex;
+    parking.name = dbColumn<int32_t>(view, FACILITY_DB_PARKING_NAME)[i];
+    parking.suffix = dbColumn<int32_t>(view, FACILITY_DB_PARKING_SUFFIX)[i];
+    parking.number = dbColumn<uint32_t>(view, FACILITY_DB_PARKING_NUMBER)[i];
+    parking.biasX = dbColumn<float>(view, FACILITY_DB_PARKING_BIAS_X)[i];
+    parking.biasZ = dbColumn<float>(view, FACILITY_DB_PARKING_BIAS_Z)[i];
+    parking.radius = dbColumn<float>(view, FACILITY_DB_PARKING_RADIUS)[i];
+    return true;
+}
+
+int facilityDbClosestJetway(const FacilityDbAirport& airport, double latitude, double longitude, DistanceAndBearing& closest) {
+    const char* view = dbAirportView(airport);
+    uint32_t first = dbColumn<uint32_t>(view, FACILITY_DB_AIRPORT_FIRST_JETWAY)[airport.index];
+    double chord = 0;
+    int closestJetway = nearestUnitVector(dbColumn<double>(view, FACILITY_DB_JETWAY_X) + first, dbColumn<double>(view, FACILITY_DB_JETWAY_Y) + first,
+        dbColumn<double>(view, FACILITY_DB_JETWAY_Z) + first, airport.jetwayCount, toUnitVector(latitude, longitude), chord);
+    if (closestJetway < 0) {
+        closest.distance = DBL_MAX;
+        closest.bearing = DBL_MAX;
+        return -1;
+    }
+    uint32_t i = first + static_cast<uint32_t>(closestJetway);
+    closest = calculateDistanceAndBearing(latitude, longitude, dbColumn<double>(view, FACILITY_DB_JETWAY_LATITUDE)[i], dbColumn<double>(view, FACILITY_DB_JETWAY_LONGITUDE)[i]);
+    return dbColumn<int32_t>(view, FACILITY_DB_JETWAY_PARKING)[i];
+}
+
+// Squared distance from the point to the bounds of the node, 0 inside
+static double nodeDistance(const FacilityDbNode& node, double x, double z) {
+    double dx = x < node.minX ? node.minX - x : x > node.maxX ? x - node.maxX : 0;
+    double dz = z < node.minZ ? node.minZ - z : z > node.maxZ ? z - node.maxZ : 0;
+    return dx * dx + dz * dz;
+}
+
+struct ParkingSearch {
+    const FacilityDbNode* nodes;
+    const uint32_t* entries;
+    const float* biasX;
+    const float* biasZ;
+    double x;
+    double z;
+    int best;
+    double bestDistance;        // Squared
+};
+
+// Closest children first, a subtree only when its bounds are closer than the best parking so far
+static void searchParkings(ParkingSearch& search, uint32_t index) {
+    const FacilityDbNode& node = search.nodes[index];
+    uint32_t count = node.count & ~FACILITY_DB_NODE_LEAF;
+    if ((node.count & FACILITY_DB_NODE_LEAF) != 0) {
+        for (uint32_t i = node.first; i < node.first + count; ++i) {
+            uint32_t parking = search.entries[i];
+            double dx = search.biasX[parking] - search.x, dz = search.biasZ[parking] - search.z;
+            double distance = dx * dx + dz * dz;
+            if (distance < search.bestDistance || (distance == search.bestDistance && static_cast<int>(parking) < search.best)) {
+                search.bestDistance = distance;
+                search.best = static_cast<int>(parking);
+            }
+        }
+        return;
+    }
+    std::pair<double, uint32_t> children[FACILITY_DB_FANOUT];
+    for (uint32_t i = 0; i < count; ++i) {
+        children[i] = { nodeDistance(search.nodes[node.first + i], search.x, search.z), node.first + i };
+    }
+    std::sort(children, children + count);
+    for (uint32_t i = 0; i < count && children[i].first <= search.bestDistance; ++i) {
+        searchParkings(search, children[i].second);
+    }
+}
+
+int facilityDbNearestParking(const FacilityDbAirport& airport, double latitude, double longitude, DistanceAndBearing& nearest) {
+    const char* view = dbAirportView(airport);
+    const double PI = 3.14159265358979323846;
+    const double metersPerDegree = 6371000 * PI / 180;
+    nearest.distance = DBL_MAX;
+    nearest.bearing = DBL_MAX;
+    uint32_t nodes = dbColumn<uint32_t>(view, FACILITY_DB_AIRPORT_NODES)[airport.index];
+    if (nodes == 0) {
+        return -1;
+    }
+
+    // The position in the BIAS_X / BIAS_Z plane of the airport (meters east and north of its reference point)
+    uint32_t firstParking = dbColumn<uint32_t>(view, FACILITY_DB_AIRPORT_FIRST_PARKING)[airport.index];
+    ParkingSearch search;
+    search.nodes = dbColumn<FacilityDbNode>(view, FACILITY_DB_NODE) + dbColumn<uint32_t>(view, FACILITY_DB_AIRPORT_FIRST_NODE)[airport.index];
+    search.entries = dbColumn<uint32_t>(view, FACILITY_DB_NODE_PARKING) + firstParking;
+    search.biasX = dbColumn<float>(view, FACILITY_DB_PARKING_BIAS_X) + firstParking;
+    search.biasZ = dbColumn<float>(view, FACILITY_DB_PARKING_BIAS_Z) + firstParking;
+    search.x = (fmod(longitude - airport.longitude + 540.0, 360.0) - 180.0) * cos(airport.latitude * (PI / 180)) * metersPerDegree;
+    search.z = (latitude - airport.latitude) * metersPerDegree;
+    search.best = -1;
+    search.bestDistance = DBL_MAX;
+    searchParkings(search, 0);
+
+    double dx = search.biasX[search.best] - search.x, dz = search.biasZ[search.best] - search.z;
+    nearest.distance = sqrt(search.bestDistance);
+    nearest.bearing = fmod(atan2(dx, dz) * 180 / PI + 360, 360);
+    return search.best;
+}
+
+// --- Writing --------------------------------------------------------------------------------------------------------
+
+// Columns of the file being written
+struct DbWriter {
+    std::vector<char> idents;
+    std::vector<uint32_t> names, firstParking, parkingCount, firstJetway, jetwayCount, firstNode, nodeCount, flags;
+    std::vector<double> latitudes, longitudes, altitudes;
+    std::vector<int32_t> parkingName, parkingSuffix, jetwayParking;
+    std::vector<uint32_t> parkingNumber;
+    std::vector<float> parkingBiasX, parkingBiasZ, parkingRadius;
+    std::vector<double> jetwayLatitude, jetwayLongitude, jetwayX, jetwayY, jetwayZ;
+    std::vector<FacilityDbNode> nodes;
+    std::vector<uint32_t> nodeParking;
+    std::string strings = std::string(1, '\0');     // Offset 0 is the empty string
+    std::unordered_map<std::string, uint32_t> interned;
+};
+
+static uint32_t dbIntern(DbWriter& writer, const std::string& text) {
+    if (text.empty()) {
+        return 0;
+    }
+    auto inserted = writer.interned.emplace(text, static_cast<uint32_t>(writer.strings.size()));
+    if (inserted.second) {
+        writer.strings.append(text.c_str(), text.size() + 1);
+    }
+    return inserted.first->second;
+}
+
+// One level of a packed R-tree (sort tile recursive): items sorted into vertical slices, each slice by z, then cut into
+// nodes of FACILITY_DB_FANOUT. Returns the nodes; items is left in node order
+static std::vector<FacilityDbNode> packLevel(std::vector<FacilityDbNode>& items, bool leaves) {
+    auto centerX = [](const FacilityDbNode& item) { return item.minX + item.maxX; };
+    auto centerZ = [](const FacilityDbNode& item) { return item.minZ + item.maxZ; };
+    size_t groups = (items.size() + FACILITY_DB_FANOUT - 1) / FACILITY_DB_FANOUT;
+    size_t sliceSize = static_cast<size_t>(ceil(sqrt(static_cast<double>(groups)))) * FACILITY_DB_FANOUT;
+    std::stable_sort(items.begin(), items.end(), [&](const FacilityDbNode& a, const FacilityDbNode& b) { return centerX(a) < centerX(b); });
+    for (size_t slice = 0; slice < items.size(); slice += sliceSize) {
+        std::stable_sort(items.begin() + slice, items.begin() + std::min(items.size(), slice + sliceSize),
+            [&](const FacilityDbNode& a, const FacilityDbNode& b) { return centerZ(a) < centerZ(b); });
+    }
+
+    std::vector<FacilityDbNode> level;
+    for (size_t first = 0; first < items.size(); first += FACILITY_DB_FANOUT) {
+        size_t count = std::min<size_t>(FACILITY_DB_FANOUT, items.size() - first);
+        FacilityDbNode node = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, static_cast<uint32_t>(first), static_cast<uint32_t>(count) | (leaves ? FACILITY_DB_NODE_LEAF : 0) };
+        for (size_t i = first; i < first + count; ++i) {
+            node.minX = std::min(node.minX, items[i].minX);
+            node.minZ = std::min(node.minZ, items[i].minZ);
+            node.maxX = std::max(node.maxX, items[i].maxX);
+            node.maxZ = std::max(node.maxZ, items[i].maxZ);
+        }
+        level.push_back(node);
+    }
+    return level;
+}
+
+// R-tree over the parkings of one airport, root first. Leaf entries are appended to writer.nodeParking
+static void dbWriteParkingTree(DbWriter& writer, const std::vector<FacilityParking>& parkings) {
+    if (parkings.empty()) {
+        return;
+    }
+    // Parkings as points, first holding the parking index
+    std::vector<FacilityDbNode> items;
+    for (size_t i = 0; i < parkings.size(); ++i) {
+        items.push_back({ parkings[i].biasX, parkings[i].biasZ, parkings[i].biasX, parkings[i].biasZ, static_cast<uint32_t>(i), 0 });
+    }
+    std::vector<std::vector<FacilityDbNode>> levels;
+    levels.push_back(packLevel(items, true));
+    for (const FacilityDbNode& item : items) {
+        writer.nodeParking.push_back(item.first);
+    }
+    while (levels.back().size() > 1) {
+        // Sorting a level moves its nodes, not the children they point to
+        std::vector<FacilityDbNode> below = levels.back();
+        levels.back().clear();
+        std::vector<FacilityDbNode> above = packLevel(below, false);
+        levels.back() = below;
+        levels.push_back(above);
+    }
+
+    // Root level first, children indexes relative to the first node of the airport
+    std::vector<uint32_t> offsets(levels.size());
+    uint32_t offset = 0;
+    for (size_t level = levels.size(); level-- > 0;) {
+        offsets[level] = offset;
+        offset += static_cast<uint32_t>(levels[level].size());
+    }
+    for (size_t level = levels.size(); level-- > 0;) {
+        for (FacilityDbNode node : levels[level]) {
+            if (level > 0) {
+                node.first += offsets[level - 1];
+            }
+            writer.nodes.push_back(node);
+        }
+    }
+}
+
+static void dbWriteAirport(DbWriter& writer, const FacilityAirportRecord& airport) {
+    char ident[FACILITY_DB_IDENT] = {};
+    strncpy(ident, airport.ident.c_str(), FACILITY_DB_IDENT - 1);
+    writer.idents.insert(writer.idents.end(), ident, ident + FACILITY_DB_IDENT);
+    writer.names.push_back(dbIntern(writer, airport.name));
+    writer.latitudes.push_back(airport.latitude);
+    writer.longitudes.push_back(airport.longitude);
+    writer.altitudes.push_back(airport.altitude);
+    writer.flags.push_back(airport.flags);
+
+    writer.firstParking.push_back(static_cast<uint32_t>(writer.parkingName.size()));
+    writer.parkingCount.push_back(static_cast<uint32_t>(airport.parkings.size()));
+    for (const FacilityParking& parking : airport.parkings) {
+        writer.parkingName.push_back(parking.name);
+        writer.parkingSuffix.push_back(parking.suffix);
+        writer.parkingNumber.push_back(parking.number);
+        writer.parkingBiasX.push_back(parking.biasX);
+        writer.parkingBiasZ.push_back(parking.biasZ);
+        writer.parkingRadius.push_back(parking.radius);
+    }
+    size_t nodes = writer.nodes.size();
+    dbWriteParkingTree(writer, airport.parkings);
+    writer.firstNode.push_back(static_cast<uint32_t>(nodes));
+    writer.nodeCount.push_back(static_cast<uint32_t>(writer.nodes.size() - nodes));
+
+    writer.firstJetway.push_back(static_cast<uint32_t>(writer.jetwayParking.size()));
+    writer.jetwayCount.push_back(static_cast<uint32_t>(airport.jetways.size()));
+    for (const FacilityJetway& jetway : airport.jetways) {
+        writer.jetwayParking.push_back(jetway.parkingIndex);
+        writer.jetwayLatitude.push_back(jetway.latitude);
+        writer.jetwayLongitude.push_back(jetway.longitude);
+        UnitVector vector = toUnitVector(jetway.latitude, jetway.longitude);
+        writer.jetwayX.push_back(vector.x);
+        writer.jetwayY.push_back(vector.y);
+        writer.jetwayZ.push_back(vector.z);
+    }
+}
+
+// Stored airport back into a record, to be written again
+static void dbReadAirport(const char* view, uint32_t index, FacilityAirportRecord& record) {
+    FacilityDbAirport airport;
+    dbAirport(view, index, airport);
+    record.ident = airport.ident;
+    record.name = airport.name;
+    record.latitude = airport.latitude;
+    record.longitude = airport.longitude;
+    record.altitude = airport.altitude;
+    record.flags = airport.flags;
+    record.parkings.resize(airport.parkingCount);
+    for (uint32_t i = 0; i < airport.parkingCount; ++i) {
+        facilityDbParking(airport, i, record.parkings[i]);
+    }
+    uint32_t first = dbColumn<uint32_t>(view, FACILITY_DB_AIRPORT_FIRST_JETWAY)[index];
+    record.jetways.resize(airport.jetwayCount);
+    for (uint32_t i = 0; i < airport.jetwayCount; ++i) {
+        record.jetways[i].parkingIndex = dbColumn<int32_t>(view, FACILITY_DB_JETWAY_PARKING)[first + i];
+        record.jetways[i].latitude = dbColumn<double>(view, FACILITY_DB_JETWAY_LATITUDE)[first + i];
+        record.jetways[i].longitude = dbColumn<double>(view, FACILITY_DB_JETWAY_LONGITUDE)[first + i];
+    }
+}
+
+template <typename T> static void dbAppendColumn(std::string& file, FacilityDbHeader& header, FACILITY_DB_COLUMN column, const T* data, size_t count) {
+    file.resize((file.size() + 7) & ~static_cast<size_t>(7), '\0');
+    header.columns[column] = file.size();
+    file.append(reinterpret_cast<const char*>(data), count * sizeof(T));
+}
+
+static std::string dbSerialize(const DbWriter& writer) {
+    FacilityDbHeader header = {};
+    memcpy(header.magic, FACILITY_DB_MAGIC, sizeof(header.magic));
+    header.headerSize = sizeof(FacilityDbHeader);
+    header.airportCount = static_cast<uint32_t>(writer.names.size());
+    header.simSignature = dbSimSignature;
+    header.scenerySignature = dbScenerySignature;
+    header.parkingCount = static_cast<uint32_t>(writer.parkingName.size());
+    header.jetwayCount = static_cast<uint32_t>(writer.jetwayParking.size());
+    header.stringBytes = static_cast<uint32_t>(writer.strings.size());
+    header.nodeCount = static_cast<uint32_t>(writer.nodes.size());
+
+    std::string file(sizeof(FacilityDbHeader), '\0');
+    dbAppendColumn(file, header, FACILITY_DB_AIRPORT_IDENT, writer.idents.data(), writer.idents.size());
+    dbAppendColumn(file, header, FACILITY_DB_AIRPORT_NAME, writer.names.data(), writer.names.size());
+    dbAppendColumn(file, header, FACILITY_DB_AIRPORT_LATITUDE, writer.latitudes.data(), writer.latitudes.size());
+    dbAppendColumn(file, header, FACILITY_DB_AIRPORT_LONGITUDE, writer.longitudes.data(), writer.longitudes.size());
+    dbAppendColumn(file, header, FACILITY_DB_AIRPORT_ALTITUDE, writer.altitudes.data(), writer.altitudes.size());
+    dbAppendColumn(file, header, FACILITY_DB_AIRPORT_FIRST_PARKING, writer.firstParking.data(), writer.firstParking.size());
+    dbAppendColumn(file, header, FACILITY_DB_AIRPORT_PARKINGS, writer.parkingCount.data(), writer.parkingCount.size());
+    dbAppendColumn(file, header, FACILITY_DB_AIRPORT_FIRST_JETWAY, writer.firstJetway.data(), writer.firstJetway.size());
+    dbAppendColumn(file, header, FACILITY_DB_AIRPORT_JETWAYS, writer.jetwayCount.data(), writer.jetwayCount.size());
+    dbAppendColumn(file, header, FACILITY_DB_AIRPORT_FIRST_NODE, writer.firstNode.data(), writer.firstNode.size());
+    dbAppendColumn(file, header, FACILITY_DB_AIRPORT_NODES, writer.nodeCount.data(), writer.nodeCount.size());
+    dbAppendColumn(file, header, FACILITY_DB_AIRPORT_FLAGS, writer.flags.data(), writer.flags.size());
+    dbAppendColumn(file, header, FACILITY_DB_PARKING_NAME, writer.parkingName.data(), writer.parkingName.size());
+    dbAppendColumn(file, header, FACILITY_DB_PARKING_SUFFIX, writer.parkingSuffix.data(), writer.parkingSuffix.size());
+    dbAppendColumn(file, header, FACILITY_DB_PARKING_NUMBER, writer.parkingNumber.data(), writer.parkingNumber.size());
+    dbAppendColumn(file, header, FACILITY_DB_PARKING_BIAS_X, writer.parkingBiasX.data(), writer.parkingBiasX.size());
+    dbAppendColumn(file, header, FACILITY_DB_PARKING_BIAS_Z, writer.parkingBiasZ.data(), writer.parkingBiasZ.size());
+    dbAppendColumn(file, header, FACILITY_DB_PARKING_RADIUS, writer.parkingRadius.data(), writer.parkingRadius.size());
+    dbAppendColumn(file, header, FACILITY_DB_JETWAY_PARKING, writer.jetwayParking.data(), writer.jetwayParking.size());
+    dbAppendColumn(file, header, FACILITY_DB_JETWAY_LATITUDE, writer.jetwayLatitude.data(), writer.jetwayLatitude.size());
+    dbAppendColumn(file, header, FACILITY_DB_JETWAY_LONGITUDE, writer.jetwayLongitude.data(), writer.jetwayLongitude.size());
+    dbAppendColumn(file, header, FACILITY_DB_JETWAY_X, writer.jetwayX.data(), writer.jetwayX.size());
+    dbAppendColumn(file, header, FACILITY_DB_JETWAY_Y, writer.jetwayY.data(), writer.jetwayY.size());
+    dbAppendColumn(file, header, FACILITY_DB_JETWAY_Z, writer.jetwayZ.data(), writer.jetwayZ.size());
+    dbAppendColumn(file, header, FACILITY_DB_NODE, writer.nodes.data(), writer.nodes.size());
+    dbAppendColumn(file, header, FACILITY_DB_NODE_PARKING, writer.nodeParking.data(), writer.nodeParking.size());
+    dbAppendColumn(file, header, FACILITY_DB_STRINGS, writer.strings.data(), writer.strings.size());
+    memcpy(&file[0], &header, sizeof(FacilityDbHeader));
+    return file;
+}
+
+bool facilityDbStore(const FacilityAirportRecord& airport) {
+    if (airport.ident.empty()) {
+        return false;
+    }
+    char key[FACILITY_DB_IDENT] = {};
+    strncpy(key, airport.ident.c_str(), FACILITY_DB_IDENT - 1);
+
+    FacilityDbAirport stored;
+    if (dbPending.find(key) == dbPending.end() && !dbSearch(dbView, key, stored)) {
+        dbPendingNew++;
+    }
+    dbPending[key] = airport;
+    if (dbPending.size() >= FACILITY_DB_BATCH) {
+        return facilityDbFlush();
+    }
+
+    // Only the airports not written yet, in the file layout
+    DbWriter writer;
+    for (const auto& pending : dbPending) {
+        dbWriteAirport(writer, pending.second);
+    }
+    dbPendingImage = dbSerialize(writer);
+    return true;
+}
+
+bool facilityDbFlush() {
+    if (dbPending.empty()) {
+        return true;
+    }
+
+    // Stored airports in ident order, the ones not written yet in their place
+    DbWriter writer;
+    auto pending = dbPending.begin();
+    uint32_t count = dbCount(dbView);
+    for (uint32_t i = 0; i < count; ++i) {
+        const char* ident = dbIdent(dbView, i);
+        while (pending != dbPending.end() && strncmp(pending->first.c_str(), ident, FACILITY_DB_IDENT) < 0) {
+            dbWriteAirport(writer, pending->second);
+            ++pending;
+        }
+        if (pending != dbPending.end() && strncmp(pending->first.c_str(), ident, FACILITY_DB_IDENT) == 0) {
+            dbWriteAirport(writer, pending->second); // Replaces the stored one
+            ++pending;
+            continue;
+        }
+        FacilityAirportRecord stored;
+        dbReadAirport(dbView, i, stored);
+        dbWriteAirport(writer, stored);
+    }
+    for (; pending != dbPending.end(); ++pending) {
+        dbWriteAirport(writer, pending->second);
+    }
+    dbPending.clear();
+    dbPendingImage.clear();
+    dbPendingNew = 0;
+    std::string file = dbSerialize(writer);
+    if (dbPath.empty() || !dbMemory.empty()) {
+        dbKeepInMemory(file);
+        return true;
+    }
+
+    // Readers never see a partial file: the new one is renamed over the old one
+    std::string temporary = dbPath + ".tmp";
+    bool written = false;
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(file.data(), static_cast<std::streamsize>(file.size()));
+        written = out.good();
+    }
+    dbUnmap(); // Windows does not replace a mapped file
+    std::error_code ec;
+    if (written) {
+        fs::rename(temporary, dbPath, ec);
+    }
+    if (!written || ec) {
+        printf("[FACILITIES] Could not write %s, airports are kept in memory until FSAutoSave exits\n", dbPath.c_str());
+        fs::remove(temporary, ec);
+        dbKeepInMemory(file);
+        return true;
+    }
+    if (!dbMap() || !dbValid()) {
+        dbKeepInMemory(file);
+    }
+    return true;
+}
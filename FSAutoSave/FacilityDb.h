@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Geodesy.h"
+#include "Platform.h"
+
+// Airports seen in earlier lookups (name, position, parkings and jetways), so the gate lookup of a save at a known
+// airport needs no facility data from MSFS, also after a restart.
+//
+// One file (FACILITY_DB_FILE under localStatePath) mapped read only: a FacilityDbHeader, then one column per field
+// (see FACILITY_DB_COLUMN) at the offsets listed in the header, each 8 byte aligned. Airports are sorted by ident and
+// own a range of the parking and jetway columns, parkings in TAXI_PARKING order so a parking index reads its row
+// directly. Each airport also has a packed R-tree over its parkings (FacilityDbNode, root first) for the parking the
+// aircraft stands on. Names are interned in a string pool, columns refer to them by offset.
+// Lookups read the mapping in place. New airports are kept in memory in the same layout (lookups read them the same
+// way) and written with the file every FACILITY_DB_BATCH airports, at facilityDbFlush and at close: the whole file is
+// rewritten then (next to it, then renamed over it). When the file can not be written the new contents are kept in
+// memory for the rest of the session.
+//
+// The header keeps the simulator version and a signature of the installed scenery packages it was filled with. When
+// either differs at open the file is discarded and filled again.
+//
+// All functions are called from the SimConnect thread.
+
+#define FACILITY_DB_FILE "FSAutoSave" PATH_SEPARATOR "facilities.fdb"  // Under localStatePath
+#define FACILITY_DB_MAGIC "FSAFDB03"
+#define FACILITY_DB_JETWAYS 0x1                         // FacilityDbAirport flags: the jetways were looked up
+#define FACILITY_DB_PARKINGS 0x2                        // The parkings were looked up (not only the name)
+#define FACILITY_DB_NODE_LEAF 0x80000000                // FacilityDbNode count: the node lists parkings
+#define FACILITY_DB_FANOUT 8                            // Children or parkings per FacilityDbNode
+#define FACILITY_DB_BATCH 16                            // Airports stored in memory before the file is rewritten with them
+
+enum FACILITY_DB_COLUMN {
+    FACILITY_DB_AIRPORT_IDENT,          // char[8]
+    FACILITY_DB_AIRPORT_NAME,           // uint32_t string pool offset
+    FACILITY_DB_AIRPORT_LATITUDE,       // double, degrees
+    FACILITY_DB_AIRPORT_LONGITUDE,      // double
+    FACILITY_DB_AIRPORT_ALTITUDE,       // double, meters
+    FACILITY_DB_AIRPORT_FIRST_PARKING,  // uint32_t
+    FACILITY_DB_AIRPORT_PARKINGS,       // uint32_t
+    FACILITY_DB_AIRPORT_FIRST_JETWAY,   // uint32_t
+    FACILITY_DB_AIRPORT_JETWAYS,        // uint32_t
+    FACILITY_DB_AIRPORT_FIRST_NODE,     // uint32_t
+    FACILITY_DB_AIRPORT_NODES,          // uint32_t
+    FACILITY_DB_AIRPORT_FLAGS,          // uint32_t
+    FACILITY_DB_PARKING_NAME,           // int32_t TAXI_PARKING NAME
+    FACILITY_DB_PARKING_SUFFIX,         // int32_t
+    FACILITY_DB_PARKING_NUMBER,         // uint32_t
+    FACILITY_DB_PARKING_BIAS_X,         // float, meters east of the airport reference point
+    FACILITY_DB_PARKING_BIAS_Z,         // float, meters north
+    FACILITY_DB_PARKING_RADIUS,         // float, meters
+    FACILITY_DB_JETWAY_PARKING,         // int32_t parking index
+    FACILITY_DB_JETWAY_LATITUDE,        // double
+    FACILITY_DB_JETWAY_LONGITUDE,       // double
+    FACILITY_DB_JETWAY_X,               // double, unit vector (toUnitVector) for nearestUnitVector
+    FACILITY_DB_JETWAY_Y,               // double
+    FACILITY_DB_JETWAY_Z,               // double
+    FACILITY_DB_NODE,                   // FacilityDbNode
+    FACILITY_DB_NODE_PARKING,           // uint32_t parking index, in leaf order (same range as the parkings)
+    FACILITY_DB_STRINGS,                // NUL terminated UTF-8
+    FACILITY_DB_COLUMNS
+};
+
+#pragma pack(push, 8)
+struct FacilityDbHeader {
+    char magic[8];              // FACILITY_DB_MAGIC
+    uint32_t headerSize;        // sizeof(FacilityDbHeader) of the writer
+    uint32_t airportCount;
+    uint64_t simSignature;      // hash64 of the simulator name and version
+    uint64_t scenerySignature;  // facilityDbScenerySignature
+    uint32_t parkingCount;
+    uint32_t jetwayCount;
+    uint32_t stringBytes;
+    uint32_t nodeCount;
+    uint64_t columns[FACILITY_DB_COLUMNS];  // File offsets
+    uint8_t padding[8];
+};
+
+struct FacilityDbNode {
+    float minX;                 // Bounds of the parkings below, same axes as BIAS_X and BIAS_Z
+    float minZ;
+    float maxX;
+    float maxZ;
+    uint32_t first;             // Leaf: first FACILITY_DB_NODE_PARKING entry, else first child node (airport relative)
+    uint32_t count;             // Entries or children, FACILITY_DB_NODE_LEAF on leaves
+};
+#pragma pack(pop)
+
+static_assert(sizeof(FacilityDbHeader) == 272, "FacilityDbHeader is part of the file format");
+static_assert(sizeof(FacilityDbNode) == 24, "FacilityDbNode is part of the file format");
+
+struct FacilityParking {
+    int name;                   // TAXI_PARKING NAME, SUFFIX and NUMBER
+    int suffix;
+    unsigned number;
+    float biasX;                // TAXI_PARKING BIAS_X, BIAS_Z and RADIUS, meters
+    float biasZ;
+    float radius;
+};
+
+struct FacilityJetway {
+    int parkingIndex;
+    double latitude;
+    double longitude;
+};
+
+// An airport as looked up from MSFS, to be stored
+struct FacilityAirportRecord {
+    std::string ident;
+    std::string name;
+    double latitude = 0;
+    double longitude = 0;
+    double altitude = 0;
+    uint32_t flags = 0;
+    std::vector<FacilityParking> parkings;  // In TAXI_PARKING order, the jetway parking index points into it
+    std::vector<FacilityJetway> jetways;
+};
+
+// A stored airport. Strings point into the mapping, valid until the next facilityDbStore, facilityDbFlush or
+// facilityDbClose
+struct FacilityDbAirport {
+    uint32_t index;
+    bool pending;               // Not written to the file yet
+    const char* ident;
+    const char* name;
+    double latitude;
+    double longitude;
+    double altitude;
+    uint32_t parkingCount;
+    uint32_t jetwayCount;
+    uint32_t flags;
+};
+
+// Opens (or creates) the database; a file filled by another simulator version or scenery is emptied
+bool facilityDbOpen(const std::string& path, uint64_t simSignature, uint64_t scenerySignature);
+void facilityDbClose();
+// Forgets every stored airport (the file is removed), the next lookups ask MSFS again
+void facilityDbClear();
+// Names and last changes of the packages in the Community and Official folders under InstalledPackagesPath
+uint64_t facilityDbScenerySignature(const std::string& packagesPath);
+
+// Adds the airport, or replaces the one with the same ident
+bool facilityDbStore(const FacilityAirportRecord& airport);
+// Writes the airports stored since the last write to the file (facilityDbClose does too)
+bool facilityDbFlush();
+
+uint32_t facilityDbCount();
+bool facilityDbFind(const char* ident, FacilityDbAirport& airport);
+bool facilityDbParking(const FacilityDbAirport& airport, uint32_t parkingIndex, FacilityParking& parking);
+// Parking index of the jetway closest to the position and its distance and bearing, -1 when the airport has none
+int facilityDbClosestJetway(const FacilityDbAirport& airport, double latitude, double longitude, DistanceAndBearing& closest);
+// Parking index of the parking whose center is closest to the position, its distance and bearing, -1 when none
+int facilityDbNearestParking(const FacilityDbAirport& airport, double latitude, double longitude, DistanceAndBearing& nearest);
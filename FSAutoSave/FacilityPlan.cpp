@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include "FacilityPlan.h"
+#include "Globals.h"
+#include "Metrics.h"
+
+// Fields of every block, in the order of the structures in Globals.h
+static const char* const airportFields[] = { "OPEN AIRPORT", "NAME64", "ICAO", nullptr };
+static const char* const parkingFields[] = { "OPEN TAXI_PARKING", "NAME", "SUFFIX", "NUMBER", "BIAS_X", "BIAS_Z", "RADIUS", "CLOSE TAXI_PARKING", nullptr };
+static const char* const runwayFields[] = { "OPEN RUNWAY", "LATITUDE", "LONGITUDE", "ALTITUDE", "HEADING", "LENGTH", "WIDTH",
+    "PRIMARY_NUMBER", "PRIMARY_DESIGNATOR", "SECONDARY_NUMBER", "SECONDARY_DESIGNATOR", "CLOSE RUNWAY", nullptr };
+static const char* const frequencyFields[] = { "OPEN FREQUENCY", "TYPE", "FREQUENCY", "NAME", "CLOSE FREQUENCY", nullptr };
+static const char* const taxiPointFields[] = { "OPEN TAXI_POINT", "TYPE", "BIAS_X", "BIAS_Z", "CLOSE TAXI_POINT", nullptr };
+static const char* const taxiPathFields[] = { "OPEN TAXI_PATH", "TYPE", "WIDTH", "START", "END", "CLOSE TAXI_PATH", nullptr };
+
+struct PlanDefinition {
+    const char* name;
+    unsigned answers;           // FACILITY_NEED flags
+    double bytes;               // Per lookup: an estimate until the definition is used, then the running average
+    uint32_t lookups;
+};
+
+static PlanDefinition definitions[FACILITY_DEFINITION_COUNT] = {
+    { "name", FACILITY_NEED_NAME, 200, 0 },
+    { "parkings", FACILITY_NEED_NAME | FACILITY_NEED_PARKINGS, 8000, 0 },
+    { "runways", FACILITY_NEED_NAME | FACILITY_NEED_RUNWAYS, 600, 0 },
+    { "frequencies", FACILITY_NEED_NAME | FACILITY_NEED_FREQUENCIES, 1500, 0 },
+    { "taxiways", FACILITY_NEED_NAME | FACILITY_NEED_PARKINGS | FACILITY_NEED_TAXIWAYS, 20000, 0 },
+    { "all", FACILITY_NEED_NAME | FACILITY_NEED_PARKINGS | FACILITY_NEED_RUNWAYS | FACILITY_NEED_FREQUENCIES | FACILITY_NEED_TAXIWAYS, 21500, 0 },
+};
+
+struct PlanLookup {
+    FACILITY_DEFINITION definition;
+    std::string ident;
+    uint32_t messages;
+    uint64_t bytes;
+};
+
+static SIMCONNECT_DATA_DEFINITION_ID planFirstDefinition = 0;
+static std::unordered_map<SIMCONNECT_DATA_REQUEST_ID, PlanLookup> lookups;  // Requests waiting for FACILITY_DATA_END
+
+static bool addFields(HANDLE hSimConnect, SIMCONNECT_DATA_DEFINITION_ID define, const char* const* fields) {
+    bool ok = true;
+    for (const char* const* field = fields; *field != nullptr; ++field) {
+        ok = SimConnect_AddToFacilityDefinition(hSimConnect, define, *field) == S_OK && ok;
+    }
+    return ok;
+}
+
+bool facilityPlanRegister(HANDLE hSimConnect, SIMCONNECT_DATA_DEFINITION_ID firstDefinition) {
+    planFirstDefinition = firstDefinition;
+    bool ok = true;
+    for (int definition = 0; definition < FACILITY_DEFINITION_COUNT; ++definition) {
+        SIMCONNECT_DATA_DEFINITION_ID define = firstDefinition + definition;
+        unsigned answers = definitions[definition].answers;
+        ok = addFields(hSimConnect, define, airportFields) && ok;
+        if (answers & FACILITY_NEED_PARKINGS) {
+            ok = addFields(hSimConnect, define, parkingFields) && ok;
+        }
+        if (answers & FACILITY_NEED_RUNWAYS) {
+            ok = addFields(hSimConnect, define, runwayFields) && ok;
+        }
+        if (answers & FACILITY_NEED_FREQUENCIES) {
+            ok = addFields(hSimConnect, define, frequencyFields) && ok;
+        }
+        if (answers & FACILITY_NEED_TAXIWAYS) {
+            ok = addFields(hSimConnect, define, taxiPointFields) && ok;
+            ok = addFields(hSimConnect, define, taxiPathFields) && ok;
+        }
+        ok = SimConnect_AddToFacilityDefinition(hSimConnect, define, "CLOSE AIRPORT") == S_OK && ok;
+    }
+    return ok;
+}
+
+// A definition sends at least what every definition it contains sends: "all" never looks cheaper than "taxiways" because
+// its estimate was not measured yet
+static double planCost(int definition) {
+    double cost = definitions[definition].bytes;
+    for (int contained = 0; contained < FACILITY_DEFINITION_COUNT; ++contained) {
+        if ((definitions[contained].answers & definitions[definition].answers) == definitions[contained].answers) {
+            cost = std::max(cost, definitions[contained].bytes);
+        }
+    }
+    return cost;
+}
+
+bool facilityPlanRequest(HANDLE hSimConnect, const char* ident, unsigned needs, SIMCONNECT_DATA_REQUEST_ID request) {
+    // The cheapest definition answering everything, the smaller one on a tie. "all" answers anything
+    int chosen = -1;
+    for (int definition = 0; definition < FACILITY_DEFINITION_COUNT; ++definition) {
+        if ((definitions[definition].answers & needs) == needs && (chosen < 0 || planCost(definition) < planCost(chosen))) {
+            chosen = definition;
+        }
+    }
+
+    if (SimConnect_RequestFacilityData(hSimConnect, planFirstDefinition + chosen, request, ident) != S_OK) {
+        return false;
+    }
+    lookups[request] = { static_cast<FACILITY_DEFINITION>(chosen), ident, 0, 0 };
+    return true;
+}
+
+const char* const* facilityPlanFields(SIMCONNECT_FACILITY_DATA_TYPE type) {
+    switch (type) {
+    case SIMCONNECT_FACILITY_DATA_AIRPORT: return airportFields;
+    case SIMCONNECT_FACILITY_DATA_TAXI_PARKING: return parkingFields;
+    case SIMCONNECT_FACILITY_DATA_RUNWAY: return runwayFields;
+    case SIMCONNECT_FACILITY_DATA_FREQUENCY: return frequencyFields;
+    case SIMCONNECT_FACILITY_DATA_TAXI_POINT: return taxiPointFields;
+    case SIMCONNECT_FACILITY_DATA_TAXI_PATH: return taxiPathFields;
+    default: return nullptr;
+    }
+}
+
+const char* facilityPlanIdent(SIMCONNECT_DATA_REQUEST_ID request) {
+    auto it = lookups.find(request);
+    return it == lookups.end() ? nullptr : it->second.ident.c_str();
+}
+
+void facilityPlanReceived(SIMCONNECT_DATA_REQUEST_ID request, DWORD bytes) {
+    auto it = lookups.find(request);
+    if (it != lookups.end()) {
+        it->second.messages++;
+        it->second.bytes += bytes;
+    }
+}
+
+unsigned facilityPlanFinished(SIMCONNECT_DATA_REQUEST_ID request) {
+    auto it = lookups.find(request);
+    if (it == lookups.end()) {
+        return 0;
+    }
+    const PlanLookup& lookup = it->second;
+    PlanDefinition& definition = definitions[lookup.definition];
+
+    // Average over the last few lookups, airports differ a lot
+    definition.lookups++;
+    double weight = 1.0 / (definition.lookups < 8 ? definition.lookups : 8);
+    definition.bytes += (static_cast<double>(lookup.bytes) - definition.bytes) * weight;
+
+    if (DEBUG) {
+        printf("[FACILITIES] %s looked up with the %s definition: %u messages, %llu bytes\n", lookup.ident.c_str(), definition.name, lookup.messages, (unsigned long long)lookup.bytes);
+    }
+    metricsAddFacilityLookup(lookup.messages, lookup.bytes);
+
+    unsigned answers = definition.answers;
+    lookups.erase(it);
+    return answers;
+}
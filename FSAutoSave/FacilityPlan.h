@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include "SimConnect.h"
+
+// Facility data requests sized to what a lookup needs.
+//
+// MSFS streams one message per item of every block a facility definition opens, so a definition with TAXI_PARKING
+// costs hundreds of messages at a hub even when only the airport name is needed. There is one definition per purpose
+// instead, every one starting with the same AIRPORT fields (sAirport), and facilityPlanRequest picks the cheapest one
+// that answers all the needs of the lookup: by the bytes the definition took on average so far, or by an estimate
+// until it was used, and never less than a definition it contains. Every lookup is counted (messages and bytes,
+// printed and added to the metrics).
+//
+// All functions are called from the SimConnect thread.
+
+enum FACILITY_NEED {
+    FACILITY_NEED_NAME = 0x1,           // NAME64 and ICAO of the airport
+    FACILITY_NEED_PARKINGS = 0x2,       // TAXI_PARKING (sTaxiParkings)
+    FACILITY_NEED_RUNWAYS = 0x4,        // RUNWAY (sRunways)
+    FACILITY_NEED_FREQUENCIES = 0x8,    // FREQUENCY (sFrequencies)
+    FACILITY_NEED_TAXIWAYS = 0x10,      // TAXI_POINT and TAXI_PATH (sTaxiPoints, sTaxiPaths)
+};
+
+enum FACILITY_DEFINITION {
+    FACILITY_DEFINITION_NAME,
+    FACILITY_DEFINITION_PARKINGS,
+    FACILITY_DEFINITION_RUNWAYS,
+    FACILITY_DEFINITION_FREQUENCIES,
+    FACILITY_DEFINITION_TAXIWAYS,       // With the parkings, paths end at them
+    FACILITY_DEFINITION_ALL,
+    FACILITY_DEFINITION_COUNT
+};
+
+// Adds every definition, FACILITY_DEFINITION_COUNT IDs from firstDefinition
+bool facilityPlanRegister(HANDLE hSimConnect, SIMCONNECT_DATA_DEFINITION_ID firstDefinition);
+// Requests the facility data of the airport with the cheapest definition answering needs (FACILITY_NEED flags)
+bool facilityPlanRequest(HANDLE hSimConnect, const char* ident, unsigned needs, SIMCONNECT_DATA_REQUEST_ID request);
+
+// Fields of the block of that type our definitions ask for ("OPEN <block>" ... "CLOSE <block>", nullptr terminated),
+// nullptr for a type we never ask for. Also the layout of its FACILITY_DATA items (see FacilityTable.h)
+const char* const* facilityPlanFields(SIMCONNECT_FACILITY_DATA_TYPE type);
+// Ident the request looks up, nullptr once FACILITY_DATA_END reported it (or when it is not one of ours)
+const char* facilityPlanIdent(SIMCONNECT_DATA_REQUEST_ID request);
+
+// Every FACILITY_DATA and FACILITY_DATA_END message, counted for the lookup it belongs to
+void facilityPlanReceived(SIMCONNECT_DATA_REQUEST_ID request, DWORD bytes);
+// At FACILITY_DATA_END: reports the lookup and returns what its definition answered (FACILITY_NEED flags, 0 when
+// the request is not one of ours)
+unsigned facilityPlanFinished(SIMCONNECT_DATA_REQUEST_ID request);
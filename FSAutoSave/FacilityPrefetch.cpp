@@ -0,0 +1,125 @@
+#include <cstdio>
+#include <cstring>
+#include "AirportIndex.h"
+#include "FacilityPlan.h"
+#include "FacilityPrefetch.h"
+#include "Globals.h"
+#include "Geodesy.h"
+#include "TaxiGraph.h"
+
+static bool prefetchEnabled = false;
+static bool checked = false;                // Position of the last check is known
+static double checkedLatitude = 0;
+static double checkedLongitude = 0;
+static bool checkedOnGround = false;
+
+// The prefetch in flight, if any
+static bool pending = false;
+static bool pendingOnGround = false;
+static bool jetwaysPending = false;
+static SIMCONNECT_DATA_REQUEST_ID pendingRequest = 0;
+static FacilityAirportRecord record;
+
+void facilityPrefetchFlightLoaded(const std::string& flight) {
+    prefetchEnabled = flight == "LAST.FLT" || flight == "CUSTOMFLIGHT.FLT";
+    checked = false; // The new flight can be anywhere
+}
+
+// Nothing to fetch when the airport is stored with what a gate lookup there needs (see lookupStoredAirport)
+static bool alreadyStored(const char* ident, bool onGround) {
+    const uint32_t groundFlags = FACILITY_DB_JETWAYS | FACILITY_DB_PARKINGS;
+    FacilityDbAirport airport;
+    return facilityDbFind(ident, airport) && (!onGround || (airport.flags & groundFlags) == groundFlags);
+}
+
+void facilityPrefetchPosition(HANDLE hSimConnect, SIMCONNECT_DATA_REQUEST_ID request, SIMCONNECT_DATA_REQUEST_ID taxiRequest, double latitude, double longitude, bool onGround) {
+    if (!prefetchEnabled || pending) {
+        return;
+    }
+    if (checked && onGround == checkedOnGround &&
+        calculateDistanceAndBearing(checkedLatitude, checkedLongitude, latitude, longitude).distance < FACILITY_PREFETCH_DISTANCE) {
+        return;
+    }
+
+    AirportIndexEntry nearest;
+    double distance = 0;
+    if (!airportIndexNearest(latitude, longitude, nearest, distance)) {
+        return; // Checked again once the facilities subscription sent airports
+    }
+    checked = true;
+    checkedLatitude = latitude;
+    checkedLongitude = longitude;
+    checkedOnGround = onGround;
+    if (onGround) {
+        taxiGraphRequest(hSimConnect, taxiRequest, nearest.ident, nearest.latitude, nearest.longitude);
+    }
+    if (alreadyStored(nearest.ident, onGround)) {
+        return;
+    }
+
+    record = FacilityAirportRecord();
+    record.ident = nearest.ident;
+    record.latitude = nearest.latitude;
+    record.longitude = nearest.longitude;
+    record.altitude = nearest.altitude;
+
+    // Jetway data first, so it is in when FACILITY_DATA_END stores the airport
+    jetwaysPending = onGround && SimConnect_RequestJetwayData(hSimConnect, nearest.ident, 0, nullptr) == S_OK;
+    unsigned needs = onGround ? FACILITY_NEED_NAME | FACILITY_NEED_PARKINGS : FACILITY_NEED_NAME;
+    if (!facilityPlanRequest(hSimConnect, nearest.ident, needs, request)) {
+        printf("[PREFETCH] Could not request the facility data of %s\n", nearest.ident);
+        checked = false;
+        return;
+    }
+    if (DEBUG) {
+        printf("[PREFETCH] Fetching %s, %.0f meters away\n", nearest.ident, distance);
+    }
+    pending = true;
+    pendingOnGround = onGround;
+    pendingRequest = request;
+}
+
+bool facilityPrefetchPending(const char* ident, bool onGround) {
+    return pending && record.ident == ident && (pendingOnGround || !onGround);
+}
+
+bool facilityPrefetchOwns(SIMCONNECT_DATA_REQUEST_ID request) {
+    return pending && request == pendingRequest;
+}
+
+void facilityPrefetchName(const char* name) {
+    record.name = name;
+}
+
+void facilityPrefetchParking(const FacilityParking& parking) {
+    record.parkings.push_back(parking);
+}
+
+bool facilityPrefetchJetways(const SIMCONNECT_JETWAY_DATA* jetways, unsigned count) {
+    // An empty answer names no airport, it goes to the prefetch when that is waiting for one
+    if (!jetwaysPending || (count > 0 && strncmp(jetways[0].AirportIcao, record.ident.c_str(), sizeof(jetways[0].AirportIcao)) != 0)) {
+        return false;
+    }
+    jetwaysPending = false;
+    record.flags |= FACILITY_DB_JETWAYS;
+    for (unsigned i = 0; i < count; ++i) {
+        record.jetways.push_back({ jetways[i].ParkingIndex, jetways[i].Lla.Latitude, jetways[i].Lla.Longitude });
+    }
+    return true;
+}
+
+bool facilityPrefetchFinished(SIMCONNECT_DATA_REQUEST_ID request, unsigned answered) {
+    if (!facilityPrefetchOwns(request)) {
+        return false;
+    }
+    pending = false;
+    jetwaysPending = false;
+    if (answered & FACILITY_NEED_PARKINGS) {
+        record.flags |= FACILITY_DB_PARKINGS;
+    }
+    if (!record.name.empty() && facilityDbStore(record) && DEBUG) {
+        printf("[PREFETCH] %s (%s) stored, %zu parkings, %zu jetways\n", record.name.c_str(), record.ident.c_str(), record.parkings.size(), record.jetways.size());
+    }
+    record = FacilityAirportRecord();
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include "FacilityDb.h"
+#include "SimConnect.h"
+
+// Facility data of the airport closest to the aircraft, fetched in the background while a flight that is saved at
+// exit (LAST.FLT or CUSTOMFLIGHT.FLT) runs, so the gate lookup of the final save finds it in the facility database
+// instead of waiting for MSFS after FlightSave.
+//
+// The closest airport (airport index) is checked on the first position sample after the flight loaded, again once the
+// aircraft moved FACILITY_PREFETCH_DISTANCE from there and when it lands or takes off. An airport stored with what a
+// gate lookup there needs is left alone, any other gets the requests of a gate lookup (jetways on the ground, then the
+// facility data, see FacilityPlan.h) under its own request ID, stored at FACILITY_DATA_END. One prefetch at a time.
+// On the ground the taxiways of the airport are fetched too (taxiRequest, see TaxiGraph.h) unless they are in already.
+//
+// All functions are called from the SimConnect thread.
+
+#define FACILITY_PREFETCH_DISTANCE 2000.0   // Meters
+
+// FlightLoaded (NormalizePath of the file): on for LAST.FLT and CUSTOMFLIGHT.FLT, off for anything else
+void facilityPrefetchFlightLoaded(const std::string& flight);
+// Position sample of the user aircraft
+void facilityPrefetchPosition(HANDLE hSimConnect, SIMCONNECT_DATA_REQUEST_ID request, SIMCONNECT_DATA_REQUEST_ID taxiRequest, double latitude, double longitude, bool onGround);
+// A prefetch of this airport is waiting for answers that cover a gate lookup (on the ground or not)
+bool facilityPrefetchPending(const char* ident, bool onGround);
+
+// Answers, from the dispatcher
+bool facilityPrefetchOwns(SIMCONNECT_DATA_REQUEST_ID request);
+void facilityPrefetchName(const char* name);
+void facilityPrefetchParking(const FacilityParking& parking);
+// False when the prefetch is not waiting for jetways of that airport
+bool facilityPrefetchJetways(const SIMCONNECT_JETWAY_DATA* jetways, unsigned count);
+// FACILITY_DATA_END: stores the airport (answered: facilityPlanFinished). False when the request is not the prefetch
+bool facilityPrefetchFinished(SIMCONNECT_DATA_REQUEST_ID request, unsigned answered);
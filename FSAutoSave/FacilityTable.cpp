@@ -0,0 +1,243 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "FacilityPlan.h"
+#include "FacilityTable.h"
+
+struct CatalogField {
+    const char* block;
+    const char* name;
+    FACILITY_FIELD_TYPE type;
+    uint32_t size;
+};
+
+// The MSFS facility fields we know the type of
+static const CatalogField catalog[] = {
+    { "AIRPORT", "LATITUDE", FACILITY_FIELD_FLOAT64, 8 },
+    { "AIRPORT", "LONGITUDE", FACILITY_FIELD_FLOAT64, 8 },
+    { "AIRPORT", "ALTITUDE", FACILITY_FIELD_FLOAT64, 8 },
+    { "AIRPORT", "MAGVAR", FACILITY_FIELD_FLOAT32, 4 },
+    { "AIRPORT", "NAME", FACILITY_FIELD_TEXT, 32 },
+    { "AIRPORT", "NAME64", FACILITY_FIELD_TEXT, 64 },
+    { "AIRPORT", "ICAO", FACILITY_FIELD_TEXT, 8 },
+    { "AIRPORT", "REGION", FACILITY_FIELD_TEXT, 8 },
+    { "AIRPORT", "N_RUNWAYS", FACILITY_FIELD_INT32, 4 },
+    { "AIRPORT", "N_FREQUENCIES", FACILITY_FIELD_INT32, 4 },
+    { "AIRPORT", "N_TAXI_PARKING_SPACES", FACILITY_FIELD_INT32, 4 },
+    { "RUNWAY", "LATITUDE", FACILITY_FIELD_FLOAT64, 8 },
+    { "RUNWAY", "LONGITUDE", FACILITY_FIELD_FLOAT64, 8 },
+    { "RUNWAY", "ALTITUDE", FACILITY_FIELD_FLOAT64, 8 },
+    { "RUNWAY", "HEADING", FACILITY_FIELD_FLOAT32, 4 },
+    { "RUNWAY", "LENGTH", FACILITY_FIELD_FLOAT32, 4 },
+    { "RUNWAY", "WIDTH", FACILITY_FIELD_FLOAT32, 4 },
+    { "RUNWAY", "PATTERN_ALTITUDE", FACILITY_FIELD_FLOAT32, 4 },
+    { "RUNWAY", "SLOPE", FACILITY_FIELD_FLOAT32, 4 },
+    { "RUNWAY", "TRUE_SLOPE", FACILITY_FIELD_FLOAT32, 4 },
+    { "RUNWAY", "SURFACE", FACILITY_FIELD_INT32, 4 },
+    { "RUNWAY", "PRIMARY_NUMBER", FACILITY_FIELD_INT32, 4 },
+    { "RUNWAY", "PRIMARY_DESIGNATOR", FACILITY_FIELD_INT32, 4 },
+    { "RUNWAY", "SECONDARY_NUMBER", FACILITY_FIELD_INT32, 4 },
+    { "RUNWAY", "SECONDARY_DESIGNATOR", FACILITY_FIELD_INT32, 4 },
+    { "FREQUENCY", "TYPE", FACILITY_FIELD_INT32, 4 },
+    { "FREQUENCY", "FREQUENCY", FACILITY_FIELD_INT32, 4 },
+    { "FREQUENCY", "NAME", FACILITY_FIELD_TEXT, 64 },
+    { "TAXI_PARKING", "TYPE", FACILITY_FIELD_INT32, 4 },
+    { "TAXI_PARKING", "TAXI_POINT_TYPE", FACILITY_FIELD_INT32, 4 },
+    { "TAXI_PARKING", "NAME", FACILITY_FIELD_INT32, 4 },
+    { "TAXI_PARKING", "SUFFIX", FACILITY_FIELD_INT32, 4 },
+    { "TAXI_PARKING", "NUMBER", FACILITY_FIELD_UINT32, 4 },
+    { "TAXI_PARKING", "ORIENTATION", FACILITY_FIELD_INT32, 4 },
+    { "TAXI_PARKING", "HEADING", FACILITY_FIELD_FLOAT32, 4 },
+    { "TAXI_PARKING", "RADIUS", FACILITY_FIELD_FLOAT32, 4 },
+    { "TAXI_PARKING", "BIAS_X", FACILITY_FIELD_FLOAT32, 4 },
+    { "TAXI_PARKING", "BIAS_Z", FACILITY_FIELD_FLOAT32, 4 },
+    { "TAXI_PARKING", "N_AIRLINES", FACILITY_FIELD_INT32, 4 },
+    { "TAXI_POINT", "TYPE", FACILITY_FIELD_INT32, 4 },
+    { "TAXI_POINT", "ORIENTATION", FACILITY_FIELD_INT32, 4 },
+    { "TAXI_POINT", "BIAS_X", FACILITY_FIELD_FLOAT32, 4 },
+    { "TAXI_POINT", "BIAS_Z", FACILITY_FIELD_FLOAT32, 4 },
+    { "TAXI_PATH", "TYPE", FACILITY_FIELD_INT32, 4 },
+    { "TAXI_PATH", "WIDTH", FACILITY_FIELD_FLOAT32, 4 },
+    { "TAXI_PATH", "LEFT_HALF_WIDTH", FACILITY_FIELD_FLOAT32, 4 },
+    { "TAXI_PATH", "RIGHT_HALF_WIDTH", FACILITY_FIELD_FLOAT32, 4 },
+    { "TAXI_PATH", "WEIGHT", FACILITY_FIELD_UINT32, 4 },
+    { "TAXI_PATH", "RUNWAY_NUMBER", FACILITY_FIELD_INT32, 4 },
+    { "TAXI_PATH", "RUNWAY_DESIGNATOR", FACILITY_FIELD_INT32, 4 },
+    { "TAXI_PATH", "START", FACILITY_FIELD_INT32, 4 },
+    { "TAXI_PATH", "END", FACILITY_FIELD_INT32, 4 },
+    { "TAXI_PATH", "NAME_INDEX", FACILITY_FIELD_UINT32, 4 },
+};
+
+static const CatalogField* catalogField(const std::string& block, const char* name) {
+    for (const CatalogField& field : catalog) {
+        if (block == field.block && strcmp(name, field.name) == 0) {
+            return &field;
+        }
+    }
+    return nullptr;
+}
+
+static uint32_t valueSize(FACILITY_FIELD_TYPE type) {
+    return type == FACILITY_FIELD_FLOAT64 ? 8 : 4;
+}
+
+static uint32_t intern(FacilityTable& table, const char* text, size_t length) {
+    auto inserted = table.stringIds.emplace(std::string(text, length), static_cast<uint32_t>(table.strings.size()));
+    if (inserted.second) {
+        table.strings.push_back(inserted.first->first);
+    }
+    return inserted.first->second;
+}
+
+bool facilityTableCreate(FacilityTable& table, const char* const* fields) {
+    facilityTableClear(table);
+    table.columns.clear();
+    table.block.clear();
+    table.itemSize = 0;
+    if (fields == nullptr || fields[0] == nullptr || strncmp(fields[0], "OPEN ", 5) != 0) {
+        return false;
+    }
+
+    std::string block = fields[0] + 5;
+    std::vector<FacilityColumn> columns = { { "OWNER", FACILITY_FIELD_TEXT, 0, {} } };
+    uint32_t itemSize = 0;
+    for (const char* const* field = fields + 1; *field != nullptr && strncmp(*field, "CLOSE ", 6) != 0; ++field) {
+        const CatalogField* known = catalogField(block, *field);
+        if (known == nullptr) {
+            printf("[FACILITIES] No column type for %s %s\n", block.c_str(), *field);
+            return false;
+        }
+        columns.push_back({ known->name, known->type, known->size, {} });
+        itemSize += known->size;
+    }
+    table.block = block;
+    table.itemSize = itemSize;
+    table.columns = std::move(columns);
+    return true;
+}
+
+bool facilityTableAppend(FacilityTable& table, const char* owner, const void* item, size_t bytes) {
+    if (table.columns.empty() || bytes < table.itemSize) {
+        return false;
+    }
+    const uint8_t* field = static_cast<const uint8_t*>(item);
+    for (FacilityColumn& column : table.columns) {
+        uint32_t size = valueSize(column.type);
+        size_t at = column.values.size();
+        column.values.resize(at + size);
+        if (column.size == 0) {
+            // OWNER, not in the item
+            uint32_t id = intern(table, owner != nullptr ? owner : "", owner != nullptr ? strlen(owner) : 0);
+            memcpy(&column.values[at], &id, size);
+            continue;
+        }
+        if (column.type == FACILITY_FIELD_TEXT) {
+            const char* text = reinterpret_cast<const char*>(field);
+            uint32_t id = intern(table, text, strnlen(text, column.size));
+            memcpy(&column.values[at], &id, size);
+        }
+        else {
+            memcpy(&column.values[at], field, size);
+        }
+        field += column.size;
+    }
+    table.rows++;
+    return true;
+}
+
+void facilityTableClear(FacilityTable& table) {
+    for (FacilityColumn& column : table.columns) {
+        column.values.clear();
+    }
+    table.rows = 0;
+    table.strings.assign(1, "");
+    table.stringIds.clear();
+    table.stringIds.emplace("", 0);
+}
+
+int facilityTableColumn(const FacilityTable& table, const char* name) {
+    for (size_t i = 0; i < table.columns.size(); ++i) {
+        if (table.columns[i].name == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+uint32_t facilityTableIntern(const FacilityTable& table, const char* text) {
+    auto it = table.stringIds.find(text);
+    return it == table.stringIds.end() ? FACILITY_TABLE_NONE : it->second;
+}
+
+double facilityTableNumber(const FacilityTable& table, int column, size_t row) {
+    switch (table.columns[column].type) {
+    case FACILITY_FIELD_INT32: return facilityTableValues<int32_t>(table, column)[row];
+    case FACILITY_FIELD_UINT32: return facilityTableValues<uint32_t>(table, column)[row];
+    case FACILITY_FIELD_FLOAT32: return facilityTableValues<float>(table, column)[row];
+    case FACILITY_FIELD_FLOAT64: return facilityTableValues<double>(table, column)[row];
+    default: return 0;
+    }
+}
+
+const char* facilityTableText(const FacilityTable& table, int column, size_t row) {
+    if (table.columns[column].type != FACILITY_FIELD_TEXT) {
+        return "";
+    }
+    return table.strings[facilityTableValues<uint32_t>(table, column)[row]].c_str();
+}
+
+size_t facilityTableFind(const FacilityTable& table, int column, const char* text, size_t first) {
+    uint32_t id = facilityTableIntern(table, text);
+    if (id == FACILITY_TABLE_NONE || table.columns[column].type != FACILITY_FIELD_TEXT) {
+        return table.rows;
+    }
+    const uint32_t* ids = facilityTableValues<uint32_t>(table, column);
+    for (size_t row = first; row < table.rows; ++row) {
+        if (ids[row] == id) {
+            return row;
+        }
+    }
+    return table.rows;
+}
+
+struct DispatcherTable {
+    FacilityTable table;
+    std::unordered_set<std::string> complete;   // Owners whose items are all in the table
+};
+static std::unordered_map<int, DispatcherTable> tables;    // By SIMCONNECT_FACILITY_DATA_TYPE
+
+// Made on first use, laid out like the definitions that ask for the type
+static DispatcherTable& dispatcherTable(SIMCONNECT_FACILITY_DATA_TYPE type) {
+    auto it = tables.find(type);
+    if (it == tables.end()) {
+        it = tables.emplace(type, DispatcherTable()).first;
+        facilityTableCreate(it->second.table, facilityPlanFields(type));
+    }
+    return it->second;
+}
+
+bool facilityTablesAppend(SIMCONNECT_FACILITY_DATA_TYPE type, const char* owner, const void* item, size_t bytes) {
+    DispatcherTable& dispatcher = dispatcherTable(type);
+    if (owner != nullptr && dispatcher.complete.count(owner)) {
+        return true; // Looked up again, the rows are in the table already
+    }
+    return facilityTableAppend(dispatcher.table, owner, item, bytes);
+}
+
+void facilityTablesFinished(SIMCONNECT_FACILITY_DATA_TYPE type, const char* owner) {
+    DispatcherTable& dispatcher = dispatcherTable(type);
+    if (!dispatcher.table.columns.empty()) {
+        dispatcher.complete.insert(owner); // Also when it has no items of the type
+    }
+}
+
+const FacilityTable* facilityTablesFind(SIMCONNECT_FACILITY_DATA_TYPE type, const char* owner) {
+    auto it = tables.find(type);
+    return it == tables.end() || !it->second.complete.count(owner) ? nullptr : &it->second.table;
+}
+
+void facilityTablesClear() {
+    tables.clear();
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "SimConnect.h"
+
+// Facility records of any type as columns, so the items MSFS streams need no handler of their own.
+//
+// A table is made from the field list of a block of a facility definition, the same list given to
+// SimConnect_AddToFacilityDefinition ("OPEN VOR", fields, "CLOSE VOR", see facilityPlanFields). The type and size of
+// every field come from a catalogue of the MSFS facility fields, so the layout of an item is known and it is decoded
+// field by field into one array per column: numbers as they are (int32, uint32, float or double), text (idents,
+// regions, names) interned in a string pool of the table, the column holding pool ids. Scans compare integers and
+// never touch the text. Every row also has an OWNER, the ident of the airport (or whatever facility) it came with.
+//
+// The dispatcher keeps one table per facility data type no handler of its own reads (FREQUENCY, VOR, WAYPOINT), made
+// on its first item from facilityPlanFields, emptied when a flight loads. A type no definition asks for has no fields
+// and gets no table. An owner counts as complete once a lookup of it answered the type (FACILITY_DATA_END), the items
+// of a later lookup of it are not added again. The frequencies command of the control channel reads the FREQUENCY
+// table.
+//
+// All functions are called from the SimConnect thread.
+
+#define FACILITY_TABLE_NONE UINT32_MAX  // facilityTableIntern: text not in the table
+
+enum FACILITY_FIELD_TYPE {
+    FACILITY_FIELD_INT32,
+    FACILITY_FIELD_UINT32,
+    FACILITY_FIELD_FLOAT32,
+    FACILITY_FIELD_FLOAT64,
+    FACILITY_FIELD_TEXT,                // char[size] in the item, a uint32_t pool id in the column
+};
+
+struct FacilityColumn {
+    std::string name;
+    FACILITY_FIELD_TYPE type;
+    uint32_t size;                      // Bytes of the field in an item
+    std::vector<uint8_t> values;        // One value per row, 8 bytes for FLOAT64, 4 for anything else
+};
+
+struct FacilityTable {
+    std::string block;                  // FREQUENCY, VOR, WAYPOINT ...
+    uint32_t itemSize = 0;              // Bytes of an item
+    size_t rows = 0;
+    std::vector<FacilityColumn> columns;    // OWNER first, then the fields in definition order
+    std::vector<std::string> strings;       // Interned text, id 0 is ""
+    std::unordered_map<std::string, uint32_t> stringIds;
+};
+
+// Columns from the field list ("OPEN <block>" ... "CLOSE <block>", nullptr terminated). False (and an empty table)
+// when a field is not in the catalogue
+bool facilityTableCreate(FacilityTable& table, const char* const* fields);
+// Decodes one item into a new row. False when it is shorter than the fields
+bool facilityTableAppend(FacilityTable& table, const char* owner, const void* item, size_t bytes);
+void facilityTableClear(FacilityTable& table);
+
+// Column index by field name, -1 when the table has none
+int facilityTableColumn(const FacilityTable& table, const char* name);
+// Pool id of the text, FACILITY_TABLE_NONE when no row has it
+uint32_t facilityTableIntern(const FacilityTable& table, const char* text);
+// Any number column as a double, the text of a text column
+double facilityTableNumber(const FacilityTable& table, int column, size_t row);
+const char* facilityTableText(const FacilityTable& table, int column, size_t row);
+// Next row from first on whose text column holds the text, table.rows when none
+size_t facilityTableFind(const FacilityTable& table, int column, const char* text, size_t first);
+
+// A column as an array, T matching its type (uint32_t pool ids for text)
+template <typename T> const T* facilityTableValues(const FacilityTable& table, int column) {
+    return reinterpret_cast<const T*>(table.columns[column].values.data());
+}
+
+// The tables of the dispatcher. Append is false when the item can not be decoded (no fields for the type, too short)
+bool facilityTablesAppend(SIMCONNECT_FACILITY_DATA_TYPE type, const char* owner, const void* item, size_t bytes);
+void facilityTablesFinished(SIMCONNECT_FACILITY_DATA_TYPE type, const char* owner);
+// The table of the type when the lookup of owner is complete, nullptr otherwise
+const FacilityTable* facilityTablesFind(SIMCONNECT_FACILITY_DATA_TYPE type, const char* owner);
+void facilityTablesClear();
@@ -0,0 +1,242 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <vector>
+#include <filesystem>
+#include "FlightRecorder.h"
+#include "Hash.h"
+
+// Each slot is published with a per-slot sequence number (seqlock style): the writer clears it, fills the slot and then
+// stores the final sequence. A reader that sees the same non zero sequence before and after copying got a clean entry.
+struct RecorderSlot {
+    std::atomic<uint32_t> sequence;
+    uint16_t kind;
+    uint16_t code;
+    uint64_t timestamp;
+    uint32_t arg0;
+    uint32_t arg1;
+    uint64_t arg2;
+};
+
+static_assert((RECORDER_CAPACITY & (RECORDER_CAPACITY - 1)) == 0, "RECORDER_CAPACITY must be a power of two");
+static_assert(sizeof(RecorderEntry) == 32, "RecorderEntry is part of the dump file format");
+
+static RecorderSlot recorderRing[RECORDER_CAPACITY];
+static std::atomic<uint32_t> recorderNext(0);
+static std::atomic<uint32_t> recorderFlags(0);
+static std::atomic<int64_t> recorderLastDump[ANOMALY_COUNT];
+static std::atomic<uint32_t> recorderDumpCount(0);
+
+static const std::chrono::steady_clock::time_point recorderEpoch = std::chrono::steady_clock::now();
+
+static uint64_t recorderClock() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - recorderEpoch).count());
+}
+
+void recorderLog(RECORDER_KIND kind, uint16_t code, uint32_t arg0, uint32_t arg1, uint64_t arg2) {
+    uint32_t sequence = recorderNext.fetch_add(1, std::memory_order_relaxed) + 1; // 0 is reserved for "slot being written"
+    RecorderSlot& slot = recorderRing[(sequence - 1) & (RECORDER_CAPACITY - 1)];
+
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.timestamp = recorderClock();
+    slot.kind = kind;
+    slot.code = code;
+    slot.arg0 = arg0;
+    slot.arg1 = arg1;
+    slot.arg2 = arg2;
+
+    slot.sequence.store(sequence, std::memory_order_release);
+}
+
+void recorderTrackFlags(uint32_t flags) {
+    uint32_t previous = recorderFlags.exchange(flags, std::memory_order_relaxed);
+    uint32_t changed = previous ^ flags;
+
+    // Log one entry per flag that changed since the last call
+    for (uint16_t flag = 0; changed != 0 && flag < FLAG_COUNT; ++flag) {
+        if (changed & (1u << flag)) {
+            recorderLog(RECORD_FLAG, flag, (flags >> flag) & 1u);
+            changed &= ~(1u << flag);
+        }
+    }
+}
+
+static std::vector<RecorderEntry> recorderSnapshot() {
+    std::vector<RecorderEntry> entries;
+    entries.reserve(RECORDER_CAPACITY);
+
+    uint32_t last = recorderNext.load(std::memory_order_acquire);
+    uint32_t first = last > RECORDER_CAPACITY ? last - RECORDER_CAPACITY + 1 : 1;
+
+    for (uint32_t sequence = first; sequence != last + 1; ++sequence) {
+        RecorderSlot& slot = recorderRing[(sequence - 1) & (RECORDER_CAPACITY - 1)];
+
+        uint32_t before = slot.sequence.load(std::memory_order_acquire);
+        RecorderEntry entry;
+        entry.timestamp = slot.timestamp;
+        entry.kind = slot.kind;
+        entry.code = slot.code;
+        entry.arg0 = slot.arg0;
+        entry.arg1 = slot.arg1;
+        entry.arg2 = slot.arg2;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t after = slot.sequence.load(std::memory_order_relaxed);
+
+        // Skip slots being written right now or already reused by a newer event
+        if (before == 0 || before != after || before != sequence) {
+            continue;
+        }
+        entry.sequence = before;
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+static std::string recorderTimeStamp() {
+    std::time_t now = std::time(nullptr);
+    std::tm now_tm = {};
+#ifdef _WIN32
+    gmtime_s(&now_tm, &now);
+#else
+    gmtime_r(&now, &now_tm);
+#endif
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y%m%d_%H%M%S", &now_tm);
+    return buffer;
+}
+
+static const char* recorderAnomalyName(uint16_t anomaly);
+
+std::string recorderDump(const std::string& directory, RECORDER_ANOMALY anomaly, uint32_t arg0, uint32_t arg1, uint64_t arg2) {
+    recorderLog(RECORD_ANOMALY, anomaly, arg0, arg1, arg2);
+
+    // Rate limit so a burst of exceptions does not turn into a burst of files
+    int64_t now = static_cast<int64_t>(recorderClock() / 1000000000ull);
+    int64_t last = recorderLastDump[anomaly].load(std::memory_order_relaxed);
+    if (last != 0 && now - last < RECORDER_DUMP_INTERVAL) {
+        return "";
+    }
+    if (!recorderLastDump[anomaly].compare_exchange_strong(last, now == 0 ? 1 : now)) {
+        return ""; // Another thread is dumping the same anomaly
+    }
+
+    std::vector<RecorderEntry> entries = recorderSnapshot();
+
+    RecorderFileHeader header = {};
+    std::memcpy(header.magic, "FSABBOX1", sizeof(header.magic));
+    header.version = RECORDER_FILE_VERSION;
+    header.entrySize = sizeof(RecorderEntry);
+    header.count = static_cast<uint32_t>(entries.size());
+    header.anomaly = anomaly;
+    header.steadyNow = recorderClock();
+    header.systemNow = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+
+    // The anomaly and a counter in the name, so dumps in the same second (or from an earlier run) are never overwritten
+    std::string stamp = recorderTimeStamp();
+    std::filesystem::path filePath;
+    std::error_code error;
+    do {
+        uint32_t count = recorderDumpCount.fetch_add(1, std::memory_order_relaxed) + 1;
+        filePath = std::filesystem::path(directory) / ("FSAutoSave_BlackBox_" + stamp + "_" + recorderAnomalyName(anomaly) + "_" + std::to_string(count) + ".bin");
+    } while (std::filesystem::exists(filePath, error));
+    std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return "";
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(RecorderEntry)));
+    if (!file) {
+        return "";
+    }
+    return filePath.string();
+}
+
+const char* recorderFlagName(uint16_t flag) {
+    static const char* names[FLAG_COUNT] = {
+        "flightInitialized", "isFinalSave", "isFirstSave", "wasReset", "isOnMenuScreen", "isPauseBeforeStart", "userLoadedPLN",
+        "isFlightPlanActive", "aircraftCrashed", "wasSoftPaused", "wasFullyPaused", "isBUGfixed", "isBUGfixedCustom", "isSimRunning",
+    };
+    return flag < FLAG_COUNT ? names[flag] : "UNKNOWN";
+}
+
+static const char* recorderFileOpName(uint16_t op) {
+    switch (op) {
+    case FILE_OP_READ_KEY: return "READ_KEY";
+    case FILE_OP_MODIFY: return "MODIFY";
+    case FILE_OP_COPY: return "COPY";
+    case FILE_OP_DELETE: return "DELETE";
+    default: return "UNKNOWN";
+    }
+}
+
+static const char* recorderAnomalyName(uint16_t anomaly) {
+    switch (anomaly) {
+    case ANOMALY_UNKNOWN_SITUATION: return "UNKNOWN_SITUATION";
+    case ANOMALY_SIMCONNECT_EXCEPTION: return "SIMCONNECT_EXCEPTION";
+    case ANOMALY_UPDATE_FAILED: return "UPDATE_FAILED";
+    case ANOMALY_SAVE_TIMEOUT: return "SAVE_TIMEOUT";
+    default: return "UNKNOWN";
+    }
+}
+
+// File operations only carry a hash of the (normalized) file name, resolve the ones we know about
+static const char* recorderFileName(uint32_t nameHash) {
+    static const char* knownFiles[] = { "LAST.FLT", "CUSTOMFLIGHT.FLT", "LAST.PLN", "LAST.WX", "LAST.SPB", "CUSTOMFLIGHT.PLN" };
+    for (const char* name : knownFiles) {
+        if (fnv1a32(name, strlen(name)) == nameHash) {
+            return name;
+        }
+    }
+    return nullptr;
+}
+
+bool recorderPrintDump(const std::string& filePath) {
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file) {
+        printf("[ERROR] Could not open %s\n", filePath.c_str());
+        return false;
+    }
+
+    RecorderFileHeader header = {};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, "FSABBOX1", sizeof(header.magic)) != 0 || header.version != RECORDER_FILE_VERSION || header.entrySize != sizeof(RecorderEntry)) {
+        printf("[ERROR] %s is not a FSAutoSave black box file\n", filePath.c_str());
+        return false;
+    }
+
+    printf("\n[BLACKBOX] %s - %u events, triggered by %s\n", filePath.c_str(), header.count, recorderAnomalyName(header.anomaly));
+
+    RecorderEntry entry;
+    for (uint32_t i = 0; i < header.count && file.read(reinterpret_cast<char*>(&entry), sizeof(entry)); ++i) {
+        // Times are printed relative to the moment of the dump
+        double seconds = (static_cast<double>(entry.timestamp) - static_cast<double>(header.steadyNow)) / 1e9;
+
+        switch (entry.kind) {
+        case RECORD_MESSAGE:
+            printf("%10.3f #%-8u MESSAGE  dwID=%u size=%u id=%u dwData=%llu\n", seconds, entry.sequence, entry.code, entry.arg0, entry.arg1, (unsigned long long)entry.arg2);
+            break;
+        case RECORD_FLAG:
+            printf("%10.3f #%-8u FLAG     %s=%s\n", seconds, entry.sequence, recorderFlagName(entry.code), entry.arg0 ? "TRUE" : "FALSE");
+            break;
+        case RECORD_FILE: {
+            const char* name = recorderFileName(entry.arg1);
+            char hashName[16];
+            snprintf(hashName, sizeof(hashName), "%08X", entry.arg1);
+            printf("%10.3f #%-8u FILE     %s %s count=%u %s\n", seconds, entry.sequence, recorderFileOpName(entry.code), name ? name : hashName, entry.arg0, entry.arg2 ? "OK" : "FAILED");
+            break;
+        }
+        case RECORD_ANOMALY:
+            printf("%10.3f #%-8u ANOMALY  %s (%u, %u, %llu)\n", seconds, entry.sequence, recorderAnomalyName(entry.code), entry.arg0, entry.arg1, (unsigned long long)entry.arg2);
+            break;
+        default:
+            printf("%10.3f #%-8u UNKNOWN  kind=%u code=%u\n", seconds, entry.sequence, entry.kind, entry.code);
+            break;
+        }
+    }
+    return true;
+}
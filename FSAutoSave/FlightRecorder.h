@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Flight recorder (black box). Keeps the last RECORDER_CAPACITY events in a fixed ring that is never allocated
+// or locked, so it can stay on all the time. When an anomaly fires the ring is written to a compact binary file.
+
+#define RECORDER_CAPACITY 8192          // Number of events kept (must be a power of two)
+#define RECORDER_DUMP_INTERVAL 10       // Minimum seconds between two dumps for the same anomaly
+
+// What an entry describes. The meaning of code/arg0/arg1/arg2 depends on the kind
+enum RECORDER_KIND : uint16_t {
+    RECORD_MESSAGE = 1,     // SimConnect message (not the runway samples).  code = dwID, arg0 = cbData, arg1 = request/event ID, arg2 = dwData
+    RECORD_FLAG,            // State flag change.   code = RECORDER_FLAG, arg0 = new value
+    RECORD_FILE,            // File operation.      code = RECORDER_FILE_OP, arg0 = keys/bytes, arg1 = file name hash, arg2 = 1 if OK
+    RECORD_ANOMALY,         // Anomaly (dump).      code = RECORDER_ANOMALY, arg0/arg1/arg2 = anomaly details
+};
+
+// State flags tracked by recorderTrackFlags(), one bit each
+enum RECORDER_FLAG : uint16_t {
+    FLAG_FLIGHT_INITIALIZED,
+    FLAG_FINAL_SAVE,
+    FLAG_FIRST_SAVE,
+    FLAG_WAS_RESET,
+    FLAG_ON_MENU_SCREEN,
+    FLAG_PAUSE_BEFORE_START,
+    FLAG_USER_LOADED_PLN,
+    FLAG_FLIGHTPLAN_ACTIVE,
+    FLAG_AIRCRAFT_CRASHED,
+    FLAG_SOFT_PAUSED,
+    FLAG_FULLY_PAUSED,
+    FLAG_BUG_FIXED,
+    FLAG_BUG_FIXED_CUSTOM,
+    FLAG_SIM_RUNNING,
+    FLAG_COUNT
+};
+
+enum RECORDER_FILE_OP : uint16_t {
+    FILE_OP_READ_KEY = 1,
+    FILE_OP_MODIFY,
+    FILE_OP_COPY,
+    FILE_OP_DELETE,
+};
+
+enum RECORDER_ANOMALY : uint16_t {
+    ANOMALY_UNKNOWN_SITUATION = 1,  // "An Unknown situation happened" in firstSave (arg0 = ERROR CODE)
+    ANOMALY_SIMCONNECT_EXCEPTION,   // SIMCONNECT_RECV_ID_EXCEPTION (arg0 = dwException, arg1 = dwSendID, arg2 = dwIndex)
+    ANOMALY_UPDATE_FAILED,          // finalFLTchange could not update a .FLT file (arg1 = file name hash)
+    ANOMALY_SAVE_TIMEOUT,           // The simulator did not write LAST.FLT after SimConnect_FlightSave (arg0 = timeout ms)
+    ANOMALY_COUNT
+};
+
+// Dump file layout (little endian): RecorderFileHeader followed by header.count RecorderEntry records, oldest first
+#pragma pack(push, 1)
+struct RecorderFileHeader {
+    char magic[8];                  // "FSABBOX1"
+    uint32_t version;               // RECORDER_FILE_VERSION
+    uint32_t entrySize;             // sizeof(RecorderEntry)
+    uint32_t count;                 // Number of entries that follow
+    uint16_t anomaly;               // RECORDER_ANOMALY that triggered the dump
+    uint16_t reserved;
+    uint64_t steadyNow;             // recorder clock (ns) when the dump was taken
+    uint64_t systemNow;             // wall clock (ns since epoch) when the dump was taken
+};
+
+struct RecorderEntry {
+    uint64_t timestamp;             // recorder clock (ns)
+    uint32_t sequence;              // Increments by one per event, gaps mean the ring wrapped
+    uint16_t kind;                  // RECORDER_KIND
+    uint16_t code;
+    uint32_t arg0;
+    uint32_t arg1;
+    uint64_t arg2;
+};
+#pragma pack(pop)
+
+#define RECORDER_FILE_VERSION 1
+
+// Thread safe and allocation free. Safe to call from any thread
+void recorderLog(RECORDER_KIND kind, uint16_t code, uint32_t arg0 = 0, uint32_t arg1 = 0, uint64_t arg2 = 0);
+void recorderTrackFlags(uint32_t flags);
+
+// Writes the ring to <directory>/FSAutoSave_BlackBox_<UTC time>_<anomaly>_<n>.bin. Returns the file path or "" if skipped/failed
+std::string recorderDump(const std::string& directory, RECORDER_ANOMALY anomaly, uint32_t arg0 = 0, uint32_t arg1 = 0, uint64_t arg2 = 0);
+
+// Prints a dump file in human readable form (used by -BLACKBOX:<file>)
+bool recorderPrintDump(const std::string& filePath);
+
+const char* recorderFlagName(uint16_t flag);
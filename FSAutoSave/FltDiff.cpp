@@ -0,0 +1,407 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include "FltDiff.h"
+#include "Hash.h"
+
+struct FltKey {
+    std::string name;
+    std::string value;
+};
+
+static std::string lowercase(const std::string& text) {
+    std::string lower(text);
+    for (char& c : lower) {
+        c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    }
+    return lower;
+}
+
+static void trim(const char*& begin, const char*& end) {
+    while (begin < end && (*begin == ' ' || *begin == '\t')) {
+        ++begin;
+    }
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) {
+        --end;
+    }
+}
+
+void fltParse(std::string text, FltDocument& document) {
+    document.text = std::move(text);
+    document.sections.clear();
+
+    const std::string& flt = document.text;
+    size_t pos = 0;
+    while (pos < flt.size()) {
+        size_t end = flt.find('\n', pos);
+        if (end == std::string::npos) {
+            end = flt.size();
+        }
+        const char* line = flt.data() + pos;
+        const char* lineEnd = flt.data() + end;
+        trim(line, lineEnd);
+
+        if (line < lineEnd && *line == '[') {
+            const char* close = static_cast<const char*>(memchr(line, ']', static_cast<size_t>(lineEnd - line)));
+            if (!document.sections.empty()) {
+                document.sections.back().end = pos;
+            }
+            FltSection section;
+            section.name.assign(line + 1, close != nullptr ? close : lineEnd);
+            section.header = pos;
+            section.begin = std::min(end + 1, flt.size());
+            section.end = flt.size();
+            section.hash = 0;
+            document.sections.push_back(std::move(section));
+        }
+        pos = end + 1;
+    }
+
+    for (FltSection& section : document.sections) {
+        section.hash = hash64(flt.data() + section.begin, section.end - section.begin);
+    }
+}
+
+bool fltLoad(const std::string& path, FltDocument& document) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    fltParse(buffer.str(), document);
+    return true;
+}
+
+// Keys of one section in file order. Later duplicates are dropped, the first one is what GetPrivateProfileString reads
+static std::vector<FltKey> sectionKeys(const FltDocument& document, const FltSection& section) {
+    std::vector<FltKey> keys;
+    std::unordered_map<std::string, size_t> seen;
+    const std::string& flt = document.text;
+    size_t pos = section.begin;
+    while (pos < section.end) {
+        size_t end = flt.find('\n', pos);
+        if (end == std::string::npos || end > section.end) {
+            end = section.end;
+        }
+        const char* line = flt.data() + pos;
+        const char* lineEnd = flt.data() + end;
+        const char* equals = static_cast<const char*>(memchr(line, '=', static_cast<size_t>(lineEnd - line)));
+        if (equals != nullptr) {
+            const char* keyEnd = equals;
+            const char* value = equals + 1;
+            trim(line, keyEnd);
+            trim(value, lineEnd);
+            FltKey key;
+            key.name.assign(line, keyEnd);
+            if (!key.name.empty() && key.name[0] != ';' && seen.emplace(lowercase(key.name), keys.size()).second) {
+                key.value.assign(value, lineEnd);
+                keys.push_back(std::move(key));
+            }
+        }
+        pos = end + 1;
+    }
+    return keys;
+}
+
+static std::unordered_map<std::string, size_t> sectionIndex(const FltDocument& document) {
+    std::unordered_map<std::string, size_t> index;
+    for (size_t i = 0; i < document.sections.size(); ++i) {
+        index.emplace(lowercase(document.sections[i].name), i); // First one wins, as for keys
+    }
+    return index;
+}
+
+static bool deletesSection(const std::map<std::string, std::string>& keys) {
+    return keys.size() == 1 && keys.count(FLT_DELETE_SECTION_MARKER) && keys.at(FLT_DELETE_SECTION_MARKER) == FLT_DELETE_MARKER;
+}
+
+bool fltFind(const FltDocument& document, const std::string& section, const std::string& key, std::string& value) {
+    std::string lowerSection = lowercase(section);
+    std::string lowerKey = lowercase(key);
+    for (const FltSection& candidate : document.sections) {
+        if (lowercase(candidate.name) != lowerSection) {
+            continue;
+        }
+        for (const FltKey& entry : sectionKeys(document, candidate)) {
+            if (lowercase(entry.name) == lowerKey) {
+                value = entry.value;
+                return true;
+            }
+        }
+        break;
+    }
+    return false;
+}
+
+bool fltHasSection(const FltDocument& document, const std::string& section) {
+    std::string lowerSection = lowercase(section);
+    for (const FltSection& candidate : document.sections) {
+        if (lowercase(candidate.name) == lowerSection) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string fltValue(const FltDocument& document, const std::string& section, const std::string& key) {
+    std::string value;
+    fltFind(document, section, key, value);
+    return value;
+}
+
+static void diffKeys(const std::string& section, const std::vector<FltKey>& a, const std::vector<FltKey>& b, std::vector<FltChange>& changes) {
+    std::unordered_map<std::string, size_t> inB;
+    for (size_t i = 0; i < b.size(); ++i) {
+        inB.emplace(lowercase(b[i].name), i);
+    }
+    std::vector<bool> matched(b.size(), false);
+    for (const FltKey& key : a) {
+        auto it = inB.find(lowercase(key.name));
+        if (it == inB.end()) {
+            changes.push_back({ FLT_KEY_REMOVED, section, key.name, key.value, "" });
+            continue;
+        }
+        matched[it->second] = true;
+        if (b[it->second].value != key.value) {
+            changes.push_back({ FLT_KEY_MODIFIED, section, key.name, key.value, b[it->second].value });
+        }
+    }
+    for (size_t i = 0; i < b.size(); ++i) {
+        if (!matched[i]) {
+            changes.push_back({ FLT_KEY_ADDED, section, b[i].name, "", b[i].value });
+        }
+    }
+}
+
+std::vector<FltChange> fltDiff(const FltDocument& a, const FltDocument& b) {
+    std::vector<FltChange> changes;
+    std::unordered_map<std::string, size_t> aIndex = sectionIndex(a);
+    std::unordered_map<std::string, size_t> bIndex = sectionIndex(b);
+
+    for (size_t i = 0; i < a.sections.size(); ++i) {
+        const FltSection& section = a.sections[i];
+        std::string lower = lowercase(section.name);
+        if (aIndex[lower] != i) {
+            continue; // Duplicate section, never read
+        }
+        auto it = bIndex.find(lower);
+        if (it == bIndex.end()) {
+            changes.push_back({ FLT_SECTION_REMOVED, section.name, "", std::to_string(sectionKeys(a, section).size()), "" });
+            continue;
+        }
+        const FltSection& other = b.sections[it->second];
+        if (section.hash == other.hash && section.end - section.begin == other.end - other.begin) {
+            continue; // Same text, nothing to compare
+        }
+        diffKeys(section.name, sectionKeys(a, section), sectionKeys(b, other), changes);
+    }
+    for (size_t i = 0; i < b.sections.size(); ++i) {
+        std::string lower = lowercase(b.sections[i].name);
+        if (bIndex[lower] == i && aIndex.find(lower) == aIndex.end()) {
+            changes.push_back({ FLT_SECTION_ADDED, b.sections[i].name, "", "", std::to_string(sectionKeys(b, b.sections[i]).size()) });
+        }
+    }
+    return changes;
+}
+
+std::vector<FltChange> fltPreview(const FltDocument& document, const FltChangeSet& changes) {
+    std::vector<FltChange> preview;
+    std::unordered_map<std::string, size_t> index = sectionIndex(document);
+
+    for (const auto& section : changes) {
+        auto it = index.find(lowercase(section.first));
+        std::vector<FltKey> keys;
+        if (it != index.end()) {
+            keys = sectionKeys(document, document.sections[it->second]);
+        }
+
+        // Same rules as modifyConfigFile
+        if (deletesSection(section.second)) {
+            if (it != index.end()) {
+                preview.push_back({ FLT_SECTION_REMOVED, document.sections[it->second].name, "", std::to_string(keys.size()), "" });
+            }
+            continue;
+        }
+
+        std::unordered_map<std::string, size_t> current;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            current.emplace(lowercase(keys[i].name), i);
+        }
+        for (const auto& key : section.second) {
+            auto existing = current.find(lowercase(key.first));
+            if (key.second == FLT_DELETE_MARKER) {
+                if (existing != current.end()) {
+                    preview.push_back({ FLT_KEY_REMOVED, section.first, key.first, keys[existing->second].value, "" });
+                }
+            }
+            else if (existing == current.end()) {
+                preview.push_back({ FLT_KEY_ADDED, section.first, key.first, "", key.second });
+            }
+            else if (keys[existing->second].value != key.second) {
+                preview.push_back({ FLT_KEY_MODIFIED, section.first, key.first, keys[existing->second].value, key.second });
+            }
+        }
+    }
+    return preview;
+}
+
+std::string fltApply(const FltDocument& document, const FltChangeSet& changes) {
+    const std::string& flt = document.text;
+    const char* newline = flt.find("\r\n") != std::string::npos ? "\r\n" : "\n";
+
+    std::unordered_map<std::string, const std::map<std::string, std::string>*> pending;
+    for (const auto& section : changes) {
+        pending.emplace(lowercase(section.first), &section.second);
+    }
+
+    std::string out;
+    out.reserve(flt.size() + 256);
+    out.append(flt, 0, document.sections.empty() ? flt.size() : document.sections.front().header);
+
+    for (const FltSection& section : document.sections) {
+        auto it = pending.find(lowercase(section.name));
+        if (it == pending.end() || it->second == nullptr) {
+            out.append(flt, section.header, section.end - section.header); // Untouched (or a duplicate of a changed one)
+            continue;
+        }
+        const std::map<std::string, std::string>& keys = *it->second;
+        it->second = nullptr;
+        if (deletesSection(keys)) {
+            continue;
+        }
+
+        std::unordered_map<std::string, const std::pair<const std::string, std::string>*> left;
+        for (const auto& key : keys) {
+            left.emplace(lowercase(key.first), &key);
+        }
+
+        out.append(flt, section.header, section.begin - section.header);
+        size_t lastKeyEnd = out.size(); // New keys go after the last key line
+        size_t pos = section.begin;
+        while (pos < section.end) {
+            size_t end = flt.find('\n', pos);
+            end = end == std::string::npos || end >= section.end ? section.end : end + 1;
+            const char* line = flt.data() + pos;
+            const char* equals = static_cast<const char*>(memchr(line, '=', end - pos));
+            if (equals != nullptr) {
+                const char* keyBegin = line;
+                const char* keyEnd = equals;
+                trim(keyBegin, keyEnd);
+                auto change = left.find(lowercase(std::string(keyBegin, keyEnd)));
+                if (change != left.end()) {
+                    if (change->second->second != FLT_DELETE_MARKER) {
+                        out.append(keyBegin, keyEnd);
+                        out += "=" + change->second->second + newline;
+                        lastKeyEnd = out.size();
+                    }
+                    left.erase(change);
+                    pos = end;
+                    continue;
+                }
+            }
+            out.append(flt, pos, end - pos);
+            if (equals != nullptr) {
+                lastKeyEnd = out.size();
+            }
+            pos = end;
+        }
+
+        std::string added;
+        for (const auto& key : keys) {
+            if (left.count(lowercase(key.first)) && key.second != FLT_DELETE_MARKER) {
+                added += key.first + "=" + key.second + newline;
+            }
+        }
+        if (!added.empty() && lastKeyEnd > 0 && out[lastKeyEnd - 1] != '\n') {
+            added.insert(0, newline); // Last line of the file had no line break
+        }
+        out.insert(lastKeyEnd, added);
+    }
+
+    // Sections the file does not have yet
+    for (const auto& section : changes) {
+        auto it = pending.find(lowercase(section.first));
+        if (it == pending.end() || it->second == nullptr || deletesSection(section.second)) {
+            continue;
+        }
+        it->second = nullptr;
+        std::string lines;
+        for (const auto& key : section.second) {
+            if (key.second != FLT_DELETE_MARKER) {
+                lines += key.first + "=" + key.second + newline;
+            }
+        }
+        if (lines.empty()) {
+            continue;
+        }
+        if (!out.empty() && out.back() != '\n') {
+            out += newline;
+        }
+        out += "[" + section.first + "]" + newline + lines;
+    }
+    return out;
+}
+
+std::vector<FltChange> fltDiffChangeSets(const FltChangeSet& a, const FltChangeSet& b) {
+    std::vector<FltChange> changes;
+    auto keysOf = [](const std::map<std::string, std::string>& section) {
+        std::vector<FltKey> keys;
+        for (const auto& key : section) {
+            keys.push_back({ key.first, key.second });
+        }
+        return keys;
+    };
+
+    for (const auto& section : a) {
+        auto it = b.find(section.first);
+        if (it == b.end()) {
+            changes.push_back({ FLT_SECTION_REMOVED, section.first, "", std::to_string(section.second.size()), "" });
+        }
+        else {
+            diffKeys(section.first, keysOf(section.second), keysOf(it->second), changes);
+        }
+    }
+    for (const auto& section : b) {
+        if (a.find(section.first) == a.end()) {
+            changes.push_back({ FLT_SECTION_ADDED, section.first, "", "", std::to_string(section.second.size()) });
+        }
+    }
+    return changes;
+}
+
+std::string fltFormatChanges(const std::vector<FltChange>& changes) {
+    std::ostringstream out;
+    std::string section;
+    for (const FltChange& change : changes) {
+        switch (change.kind) {
+        case FLT_SECTION_ADDED:
+            out << "+ [" << change.section << "] (" << change.after << " keys)\n";
+            section.clear();
+            continue;
+        case FLT_SECTION_REMOVED:
+            out << "- [" << change.section << "] (" << change.before << " keys)\n";
+            section.clear();
+            continue;
+        default:
+            break;
+        }
+        if (change.section != section) {
+            section = change.section;
+            out << "  [" << section << "]\n";
+        }
+        if (change.kind == FLT_KEY_ADDED) {
+            out << "+   " << change.key << "=" << change.after << "\n";
+        }
+        else if (change.kind == FLT_KEY_REMOVED) {
+            out << "-   " << change.key << "=" << change.before << "\n";
+        }
+        else {
+            out << "~   " << change.key << ": " << change.before << " -> " << change.after << "\n";
+        }
+    }
+    return out.str();
+}
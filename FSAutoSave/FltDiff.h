@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Section and key aware comparison of .FLT files (INI style, names compared without case like GetPrivateProfileString).
+//
+// fltParse only finds the sections and hashes their text. Keys are split out when a section is compared and its hash
+// differs from the other side, so comparing two multi MB saves that differ in a few sections stays close to a single
+// pass over both. fltPreview answers the same question for a change set before modifyConfigFile applies it, and
+// fltApply applies one to a file held in memory (batch tools working on archives).
+
+#define FLT_DELETE_MARKER "!DELETE!"
+#define FLT_DELETE_SECTION_MARKER "!DELETE_SECTION!"
+
+// Changes as modifyConfigFile takes them: section -> key -> value (or the delete markers)
+typedef std::map<std::string, std::map<std::string, std::string>> FltChangeSet;
+
+struct FltSection {
+    std::string name;       // As written, without the brackets
+    uint64_t hash;          // hash64 of the section text (header line excluded)
+    size_t header;          // Start of the [name] line in FltDocument::text
+    size_t begin;           // Section text in FltDocument::text
+    size_t end;
+};
+
+struct FltDocument {
+    std::string text;
+    std::vector<FltSection> sections;
+};
+
+enum FLT_CHANGE {
+    FLT_KEY_ADDED,
+    FLT_KEY_REMOVED,
+    FLT_KEY_MODIFIED,
+    FLT_SECTION_ADDED,
+    FLT_SECTION_REMOVED,
+};
+
+struct FltChange {
+    FLT_CHANGE kind;
+    std::string section;
+    std::string key;        // Empty for section changes
+    std::string before;     // Section changes: number of keys
+    std::string after;
+};
+
+void fltParse(std::string text, FltDocument& document);
+bool fltLoad(const std::string& path, FltDocument& document);
+// Value of a key (empty if missing), the first one when the key or the section is repeated
+std::string fltValue(const FltDocument& document, const std::string& section, const std::string& key);
+// Same, but tells a missing key apart from an empty value
+bool fltFind(const FltDocument& document, const std::string& section, const std::string& key, std::string& value);
+bool fltHasSection(const FltDocument& document, const std::string& section);
+
+// What changes from a to b, in the order of a (then sections only b has)
+std::vector<FltChange> fltDiff(const FltDocument& a, const FltDocument& b);
+// What applying changes to document would actually change (keys that already have the value are left out)
+std::vector<FltChange> fltPreview(const FltDocument& document, const FltChangeSet& changes);
+// Text of document with changes applied, the way WritePrivateProfileString would (values replaced in place, new keys
+// after the last key of their section, new sections at the end of the file)
+std::string fltApply(const FltDocument& document, const FltChangeSet& changes);
+// Differences between two change sets (the delete markers are compared like any other value)
+std::vector<FltChange> fltDiffChangeSets(const FltChangeSet& a, const FltChangeSet& b);
+
+// One line per change, grouped under its section header
+std::string fltFormatChanges(const std::vector<FltChange>& changes);
@@ -0,0 +1,61 @@
+#include <regex>
+#include "FltRepair.h"
+
+bool fltStateIsLanding(const std::string& state) {
+    return state == "LANDING_TAXI" || state == "LANDING_GATE";
+}
+
+bool fltStateNeedsFix(const std::string& state) {
+    return fltStateIsLanding(state) || state == "PREFLIGHT_PUSHBACK" || state.empty();
+}
+
+bool fltLocalVarsNeedReset(const std::string& aircraft) {
+    static const std::regex pattern("PMDG 7\\d{2}-\\d{3}\\w*");
+    return std::regex_match(aircraft, pattern);
+}
+
+FltChangeSet fltStateFix(const std::string& state, const std::string& firstFlightState) {
+    if (fltStateIsLanding(state)) {
+        return {
+            {"Arrival", {{FLT_DELETE_SECTION_MARKER, FLT_DELETE_MARKER}}},
+            {"FreeFlight", {{"FirstFlightState", firstFlightState}}},
+            {"Main", {{"OriginalFlight", ""}}},
+        };
+    }
+    return {
+        {"FreeFlight", {{"FirstFlightState", firstFlightState}}},
+    };
+}
+
+FltChangeSet fltLocalVarsDelete() {
+    return { {"LocalVars.0", {{FLT_DELETE_SECTION_MARKER, FLT_DELETE_MARKER}}} };
+}
+
+FltChangeSet fltLocalVarsReset() {
+    return { {"LocalVars.0", {{"FLT_File_Loaded", "2"}}} };
+}
+
+FLT_REPAIR_STATUS fltRepair(const FltDocument& document, const std::string& firstFlightState, FltRepairResult& result) {
+    result.state = fltValue(document, "FreeFlight", "FirstFlightState");
+    result.changes.clear();
+    result.text.clear();
+    if (!fltHasSection(document, "FreeFlight")) {
+        return FLT_REPAIR_SKIPPED; // A missing state only means something in a free flight save
+    }
+    if (!fltStateNeedsFix(result.state)) {
+        return FLT_REPAIR_NONE;
+    }
+
+    // Same order as fixMSFSbug: LocalVars first, then the state
+    FltDocument current;
+    fltParse(document.text, current);
+    if (fltStateIsLanding(result.state) && fltLocalVarsNeedReset(fltValue(document, "Sim.0", "Sim"))) {
+        fltParse(fltApply(current, fltLocalVarsDelete()), current);
+        fltParse(fltApply(current, fltLocalVarsReset()), current);
+    }
+    fltParse(fltApply(current, fltStateFix(result.state, firstFlightState)), current);
+
+    result.changes = fltDiff(document, current);
+    result.text = std::move(current.text);
+    return result.changes.empty() ? FLT_REPAIR_NONE : FLT_REPAIR_FIXED;
+}
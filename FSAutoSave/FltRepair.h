@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "FltDiff.h"
+
+// Repairs for saves MSFS can not resume from. fixMSFSbug and fixLASTflight apply them to the live files, the batch
+// tool (Tools/FltRepair.cpp) to whole archives of older saves.
+//
+// - FirstFlightState LANDING_TAXI / LANDING_GATE: the save resumes into the end of the previous flight. [Arrival] is
+//   deleted, [Main] OriginalFlight cleared, and PMDG 7x7 aircraft get a fresh [LocalVars.0]
+// - FirstFlightState PREFLIGHT_PUSHBACK or missing: crashes or spawns on the pushback tug
+// In every case FirstFlightState becomes the configured one (PREFLIGHT_GATE unless -FFSTATE: says otherwise).
+// fltRepair leaves files without a [FreeFlight] section alone (missions and other non free flight saves).
+
+bool fltStateNeedsFix(const std::string& state);
+bool fltStateIsLanding(const std::string& state);
+// Aircraft whose [LocalVars.0] has to be reset with a landing state (PMDG 7xx-xxx)
+bool fltLocalVarsNeedReset(const std::string& aircraft);
+
+FltChangeSet fltStateFix(const std::string& state, const std::string& firstFlightState);
+FltChangeSet fltLocalVarsDelete();
+FltChangeSet fltLocalVarsReset();   // Applied after fltLocalVarsDelete
+
+struct FltRepairResult {
+    std::string state;                  // FirstFlightState before the repair
+    std::string text;                   // Repaired file
+    std::vector<FltChange> changes;     // Against the original
+};
+
+enum FLT_REPAIR_STATUS {
+    FLT_REPAIR_NONE,        // Nothing to repair
+    FLT_REPAIR_FIXED,       // result holds the repaired file
+    FLT_REPAIR_SKIPPED,     // Not a free flight save (no [FreeFlight] section)
+};
+
+// Applies every rule to a file in memory
+FLT_REPAIR_STATUS fltRepair(const FltDocument& document, const std::string& firstFlightState, FltRepairResult& result);
@@ -0,0 +1,30 @@
+#include <cmath>
+#include "GateCache.h"
+#include "Geodesy.h"
+#include "Metrics.h"
+
+static GateCacheEntry cached;
+static bool cacheValid = false;
+
+void gateCacheStore(const GateCacheEntry& entry) {
+    cached = entry;
+    cacheValid = !entry.airportICAO.empty();
+}
+
+bool gateCacheFind(double latitude, double longitude, double heading, bool onGround, GateCacheEntry& entry) {
+    bool hit = false;
+    if (cacheValid && onGround == cached.onGround) {
+        double turn = fabs(fmod(heading - cached.heading + 540.0, 360.0) - 180.0);
+        hit = turn <= GATE_CACHE_HEADING &&
+            calculateDistanceAndBearing(cached.latitude, cached.longitude, latitude, longitude).distance <= GATE_CACHE_DISTANCE;
+    }
+    metricsCountGateCache(hit);
+    if (hit) {
+        entry = cached;
+    }
+    return hit;
+}
+
+void gateCacheClear() {
+    cacheValid = false;
+}
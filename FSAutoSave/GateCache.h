@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+
+// The last resolved gate lookup (where the aircraft was, the airport and the gate), reused while the aircraft stays
+// put: saving twice at the gate asks for the position only, not for the airport and its parkings again.
+//
+// A position sample hits when it is within GATE_CACHE_DISTANCE of the stored one, the heading within
+// GATE_CACHE_HEADING and the aircraft still on the ground (or still in the air). Loading a flight empties it. Hits and
+// misses are counted in the metrics.
+//
+// All functions are called from the SimConnect thread.
+
+#define GATE_CACHE_DISTANCE 5.0     // Meters
+#define GATE_CACHE_HEADING 10.0     // Degrees
+
+struct GateCacheEntry {
+    double latitude;                // Aircraft position and heading of the lookup
+    double longitude;
+    double heading;
+    bool onGround;
+    std::string airportICAO;
+    std::string airportName;
+    bool hasGate;                   // The rest is set when the lookup found a gate
+    const char* kind;               // "Parking" or "Jetway"
+    int name;                       // TAXI_PARKING NAME, SUFFIX and NUMBER
+    int suffix;
+    unsigned number;
+    double distance;                // From the aircraft, meters
+    double bearing;
+    double taxiDistance;            // Along the taxiways, meters, negative when not known
+};
+
+void gateCacheStore(const GateCacheEntry& entry);
+// True (and the entry) when the position is close enough to the stored one. Counts a hit or a miss
+bool gateCacheFind(double latitude, double longitude, double heading, bool onGround, GateCacheEntry& entry);
+void gateCacheClear();
@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+#include "Geodesy.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define GEODESY_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define GEODESY_TARGET_AVX2
+#else
+#define GEODESY_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Function to calculate the clock position based on current bearing and heading
+int calculateClockPosition(double bearing, double heading) {
+    // Calculate the relative angle
+    double relativeAngle = bearing - heading;
+
+    // Normalize the angle to be within the range of 0 to 360 degrees
+    relativeAngle = fmod(relativeAngle + 360.0, 360.0);
+
+    // Calculate the clock position
+    int clockPosition = static_cast<int>(round(relativeAngle / 30.0)) % 12;
+
+    // Adjust 0 o'clock to 12 o'clock
+    if (clockPosition == 0) {
+        clockPosition = 12;
+    }
+
+    return clockPosition;
+}
+
+double metersToFeet(double meters) {
+    const double metersToFeetConversionFactor = 3.28084;
+    return meters * metersToFeetConversionFactor;
+}
+
+DistanceAndBearing calculateDistanceAndBearing(double lat1, double lon1, double lat2, double lon2) {
+    const double R = 6371000; // Earth's radius in meters
+    const double PI = 3.14159265358979323846;
+
+    double latRad1 = lat1 * (PI / 180);
+    double latRad2 = lat2 * (PI / 180);
+    double deltaLat = (lat2 - lat1) * (PI / 180);
+    double deltaLon = (lon2 - lon1) * (PI / 180);
+
+    // Calculate the distance
+    double a = sin(deltaLat / 2) * sin(deltaLat / 2) +
+        cos(latRad1) * cos(latRad2) * sin(deltaLon / 2) * sin(deltaLon / 2);
+    double c = 2 * atan2(sqrt(a), sqrt(1 - a));
+    double distance = R * c; // Distance in meters
+
+    // Calculate the bearing
+    double y = sin(deltaLon) * cos(latRad2);
+    double x = cos(latRad1) * sin(latRad2) - sin(latRad1) * cos(latRad2) * cos(deltaLon);
+    double bearingRadians = atan2(y, x);
+    double bearingDegrees = fmod((bearingRadians * 180 / PI + 360), 360); // Convert to degrees and normalize
+
+    // Return both distance and bearing
+    DistanceAndBearing result;
+    result.distance = distance;
+    result.bearing = bearingDegrees;
+    return result;
+}
+
+UnitVector toUnitVector(double latitude, double longitude) {
+    const double PI = 3.14159265358979323846;
+    double latRad = latitude * (PI / 180);
+    double lonRad = longitude * (PI / 180);
+    return { cos(latRad) * cos(lonRad), cos(latRad) * sin(lonRad), sin(latRad) };
+}
+
+double chordToMeters(double chordSquared) {
+    const double R = 6371000; // Earth's radius in meters
+    return 2 * R * asin(std::min(1.0, sqrt(chordSquared) / 2));
+}
+
+int closestAirport(const SIMCONNECT_DATA_FACILITY_AIRPORT* airports, unsigned count, double latitude, double longitude) {
+    int closest = -1;
+    double closestChord = DBL_MAX;
+    UnitVector position = toUnitVector(latitude, longitude);
+    for (unsigned i = 0; i < count; ++i) {
+        if (airports[i].Ident[0] != '\0') {
+            UnitVector airport = toUnitVector(airports[i].Latitude, airports[i].Longitude);
+            double dx = airport.x - position.x, dy = airport.y - position.y, dz = airport.z - position.z;
+            double chord = dx * dx + dy * dy + dz * dz;
+            if (chord < closestChord) {
+                closestChord = chord;
+                closest = static_cast<int>(i);
+            }
+        }
+    }
+    return closest;
+}
+
+int closestJetway(const SIMCONNECT_JETWAY_DATA* jetways, unsigned count, double latitude, double longitude, DistanceAndBearing& closest) {
+    closest.distance = DBL_MAX;
+    closest.bearing = DBL_MAX;
+
+    // Closest by unit vectors, then the distance and bearing of that jetway only
+    static thread_local std::vector<double> vectors;
+    vectors.resize(3 * static_cast<size_t>(count));
+    double* x = vectors.data();
+    double* y = x + count;
+    double* z = y + count;
+    for (unsigned i = 0; i < count; ++i) {
+        UnitVector jetway = toUnitVector(jetways[i].Lla.Latitude, jetways[i].Lla.Longitude);
+        x[i] = jetway.x;
+        y[i] = jetway.y;
+        z[i] = jetway.z;
+    }
+    double chord = 0;
+    int closestIndex = nearestUnitVector(x, y, z, count, toUnitVector(latitude, longitude), chord);
+    if (closestIndex >= 0) {
+        closest = calculateDistanceAndBearing(latitude, longitude, jetways[closestIndex].Lla.Latitude, jetways[closestIndex].Lla.Longitude);
+    }
+    return closestIndex;
+}
+
+// --- Batched --------------------------------------------------------------------------------------------------------
+
+static GEODESY_SIMD bestSimd() {
+#ifdef GEODESY_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int leaves = info[0];
+    __cpuid(info, 1);
+    bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+    if (leaves >= 7 && osSavesAvx) {
+        __cpuidex(info, 7, 0);
+        if ((info[1] & (1 << 5)) != 0) {
+            return GEODESY_AVX2;
+        }
+    }
+#else
+    if (__builtin_cpu_supports("avx2")) {
+        return GEODESY_AVX2;
+    }
+#endif
+    return GEODESY_SSE2; // Every x64 CPU has it
+#else
+    return GEODESY_SCALAR;
+#endif
+}
+
+static GEODESY_SIMD simdInUse = bestSimd();
+
+GEODESY_SIMD geodesySimd() {
+    return simdInUse;
+}
+
+const char* geodesySimdName(GEODESY_SIMD level) {
+    switch (level) {
+    case GEODESY_AVX2: return "AVX2";
+    case GEODESY_SSE2: return "SSE2";
+    default: return "scalar";
+    }
+}
+
+void geodesyUseSimd(GEODESY_SIMD level) {
+    simdInUse = std::min(level, bestSimd());
+}
+
+void toUnitVectors(const double* latitudes, const double* longitudes, size_t count, double* x, double* y, double* z) {
+    for (size_t i = 0; i < count; ++i) {
+        UnitVector vector = toUnitVector(latitudes[i], longitudes[i]);
+        x[i] = vector.x;
+        y[i] = vector.y;
+        z[i] = vector.z;
+    }
+}
+
+// Points [begin, count) one at a time; on equal chords the first point wins, like the vector lanes
+static void nearestScalar(const double* x, const double* y, const double* z, size_t begin, size_t count, const UnitVector& position, int& closest, double& closestChord) {
+    for (size_t i = begin; i < count; ++i) {
+        double dx = x[i] - position.x, dy = y[i] - position.y, dz = z[i] - position.z;
+        double chord = dx * dx + dy * dy + dz * dz;
+        if (chord < closestChord) {
+            closestChord = chord;
+            closest = static_cast<int>(i);
+        }
+    }
+}
+
+// Closest of the lanes of the vector loops (indexes are kept as doubles, exact far beyond any count we see)
+static void reduceLanes(const double* chords, const double* indexes, int lanes, int& closest, double& closestChord) {
+    for (int lane = 0; lane < lanes; ++lane) {
+        if (indexes[lane] < 0) {
+            continue;
+        }
+        int index = static_cast<int>(indexes[lane]);
+        if (chords[lane] < closestChord || (chords[lane] == closestChord && index < closest)) {
+            closestChord = chords[lane];
+            closest = index;
+        }
+    }
+}
+
+#ifdef GEODESY_X86
+static size_t nearestSse2(const double* x, const double* y, const double* z, size_t count, const UnitVector& position, int& closest, double& closestChord) {
+    const __m128d px = _mm_set1_pd(position.x), py = _mm_set1_pd(position.y), pz = _mm_set1_pd(position.z);
+    __m128d best = _mm_set1_pd(DBL_MAX);
+    __m128d bestIndex = _mm_set1_pd(-1);
+    __m128d index = _mm_set_pd(1, 0);
+    const __m128d step = _mm_set1_pd(2);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(x + i), px);
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(y + i), py);
+        __m128d dz = _mm_sub_pd(_mm_loadu_pd(z + i), pz);
+        __m128d chord = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+        __m128d closer = _mm_cmplt_pd(chord, best);
+        best = _mm_or_pd(_mm_and_pd(closer, chord), _mm_andnot_pd(closer, best));
+        bestIndex = _mm_or_pd(_mm_and_pd(closer, index), _mm_andnot_pd(closer, bestIndex));
+        index = _mm_add_pd(index, step);
+    }
+    double chords[2], indexes[2];
+    _mm_storeu_pd(chords, best);
+    _mm_storeu_pd(indexes, bestIndex);
+    reduceLanes(chords, indexes, 2, closest, closestChord);
+    return i;
+}
+
+GEODESY_TARGET_AVX2 static size_t nearestAvx2(const double* x, const double* y, const double* z, size_t count, const UnitVector& position, int& closest, double& closestChord) {
+    const __m256d px = _mm256_set1_pd(position.x), py = _mm256_set1_pd(position.y), pz = _mm256_set1_pd(position.z);
+    __m256d best = _mm256_set1_pd(DBL_MAX);
+    __m256d bestIndex = _mm256_set1_pd(-1);
+    __m256d index = _mm256_set_pd(3, 2, 1, 0);
+    const __m256d step = _mm256_set1_pd(4);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + i), px);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + i), py);
+        __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z + i), pz);
+        __m256d chord = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), _mm256_mul_pd(dz, dz));
+        __m256d closer = _mm256_cmp_pd(chord, best, _CMP_LT_OQ);
+        best = _mm256_blendv_pd(best, chord, closer);
+        bestIndex = _mm256_blendv_pd(bestIndex, index, closer);
+        index = _mm256_add_pd(index, step);
+    }
+    double chords[4], indexes[4];
+    _mm256_storeu_pd(chords, best);
+    _mm256_storeu_pd(indexes, bestIndex);
+    reduceLanes(chords, indexes, 4, closest, closestChord);
+    return i;
+}
+#endif
+
+int nearestUnitVector(const double* x, const double* y, const double* z, size_t count, const UnitVector& position, double& chordSquared) {
+    int closest = -1;
+    double closestChord = DBL_MAX;
+    size_t done = 0;
+#ifdef GEODESY_X86
+    if (simdInUse == GEODESY_AVX2) {
+        done = nearestAvx2(x, y, z, count, position, closest, closestChord);
+    }
+    else if (simdInUse == GEODESY_SSE2) {
+        done = nearestSse2(x, y, z, count, position, closest, closestChord);
+    }
+#endif
+    nearestScalar(x, y, z, done, count, position, closest, closestChord);
+    chordSquared = closestChord;
+    return closest;
+}
+
+// calculateDistanceAndBearing with the trigonometry of the first point done once
+void calculateDistancesAndBearings(double latitude, double longitude, const double* latitudes, const double* longitudes, size_t count, DistanceAndBearing* results) {
+    const double R = 6371000; // Earth's radius in meters
+    const double PI = 3.14159265358979323846;
+
+    double latRad1 = latitude * (PI / 180);
+    double sinLat1 = sin(latRad1);
+    double cosLat1 = cos(latRad1);
+    for (size_t i = 0; i < count; ++i) {
+        double latRad2 = latitudes[i] * (PI / 180);
+        double deltaLat = (latitudes[i] - latitude) * (PI / 180);
+        double deltaLon = (longitudes[i] - longitude) * (PI / 180);
+        double sinLat2 = sin(latRad2);
+        double cosLat2 = cos(latRad2);
+        double sinHalfLat = sin(deltaLat / 2);
+        double sinHalfLon = sin(deltaLon / 2);
+
+        double a = sinHalfLat * sinHalfLat + cosLat1 * cosLat2 * sinHalfLon * sinHalfLon;
+        double c = 2 * atan2(sqrt(a), sqrt(1 - a));
+        results[i].distance = R * c;
+
+        double y = sin(deltaLon) * cosLat2;
+        double x = cosLat1 * sinLat2 - sinLat1 * cosLat2 * cos(deltaLon);
+        results[i].bearing = fmod((atan2(y, x) * 180 / PI + 360), 360);
+    }
+}
+
+void calculateClockPositions(const double* bearings, size_t count, double heading, int* clockPositions) {
+    for (size_t i = 0; i < count; ++i) {
+        clockPositions[i] = calculateClockPosition(bearings[i], heading);
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include "SimConnect.h"
+
+// Distances and bearings on the sphere, for the gate lookup (closest jetway to the aircraft and where it is)
+
+struct DistanceAndBearing { double distance; double bearing; };
+
+// Great circle distance in meters and initial bearing in degrees (0-360) from point 1 to point 2
+DistanceAndBearing calculateDistanceAndBearing(double lat1, double lon1, double lat2, double lon2);
+// 1-12 o'clock of a bearing seen from an aircraft with this heading
+int calculateClockPosition(double bearing, double heading);
+double metersToFeet(double meters);
+
+// Position on the unit sphere (x through 0/0, z through the north pole). Squared chords between unit vectors order
+// points the same way as great circle distances
+struct UnitVector { double x; double y; double z; };
+UnitVector toUnitVector(double latitude, double longitude);
+double chordToMeters(double chordSquared);
+
+// The scans behind the gate lookup. Index of the airport of a facilities list closest to the position, -1 when no
+// entry has an ident
+int closestAirport(const SIMCONNECT_DATA_FACILITY_AIRPORT* airports, unsigned count, double latitude, double longitude);
+// Index of the jetway closest to the position and its distance and bearing, -1 when there are none
+int closestJetway(const SIMCONNECT_JETWAY_DATA* jetways, unsigned count, double latitude, double longitude, DistanceAndBearing& closest);
+
+// Batched versions, one position against arrays of points (jetways, parkings). The nearest point search compares
+// squared chords between unit vectors, 4 points at a time with AVX2 or 2 with SSE2, whichever the CPU has; only the
+// point it picks needs the exact distance and bearing.
+enum GEODESY_SIMD { GEODESY_SCALAR, GEODESY_SSE2, GEODESY_AVX2 };
+GEODESY_SIMD geodesySimd();
+const char* geodesySimdName(GEODESY_SIMD level);
+// Instruction set the batched functions use, the best the CPU has by default (lower it to compare them)
+void geodesyUseSimd(GEODESY_SIMD level);
+
+// Unit vectors of count positions, x, y and z in separate arrays
+void toUnitVectors(const double* latitudes, const double* longitudes, size_t count, double* x, double* y, double* z);
+// Index of the unit vector closest to position and its squared chord, -1 when count is 0
+int nearestUnitVector(const double* x, const double* y, const double* z, size_t count, const UnitVector& position, double& chordSquared);
+void calculateDistancesAndBearings(double latitude, double longitude, const double* latitudes, const double* longitudes, size_t count, DistanceAndBearing* results);
+void calculateClockPositions(const double* bearings, size_t count, double heading, int* clockPositions);
@@ -1,17 +1,25 @@
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 #include "FSAutoSave.h"
 #include "Globals.h"
+#include "FltDiff.h"
 
 std::atomic<bool> isModifyingFile(false);
 SIMCONNECT_DATA_REQUEST_ID FACILITY_DATA_DEF_REQUEST_START	= 100;
 unsigned g_RequestCount										= 0;
 HANDLE hSimConnect											= NULL;
 HANDLE g_hEvent												= NULL;
-HRESULT hr													= NULL;
+HRESULT hr													= S_OK;
 
 bool DEBUG				= FALSE;
 bool minimizeOnStart	= FALSE;
 bool resetSaves			= FALSE;
+bool autoSaveEnabled	= TRUE;
+bool facilityPrefetchEnabled = TRUE;
+bool showHistory		= FALSE;
+unsigned long long restoreGeneration = 0;
+bool showCatalog		= FALSE;
 bool isBUGfixed			= FALSE;
 bool isBUGfixedCustom	= FALSE;
 bool isSteam			= FALSE;
@@ -22,10 +30,9 @@ int quit				= 0;
 int fpDisableCount		= 0;
 int parkingIndex		= 0;
 int countJetways		= 0;
-int countTaxiParking	= 0;
 
-const std::string DELETE_MARKER			= "!DELETE!";
-const std::string DELETE_SECTION_MARKER = "!DELETE_SECTION!";
+const std::string DELETE_MARKER			= FLT_DELETE_MARKER;
+const std::string DELETE_SECTION_MARKER = FLT_DELETE_SECTION_MARKER;
 
 const char* szFileName		 = "Missions\\Custom\\CustomFlight\\CustomFlight";
 const char* szTitle			 = "FSAutoSave generated file";
@@ -39,6 +46,7 @@ double myTASinFPS		= 0.0;
 double myAirspeed		= 0.0;
 double myFlaps			= 0.0;
 double myHeading		= 0.0;
+double myTrueHeading	= 0.0;
 double isSimOnGround	= 0.0;
 double JetwayDistance	= 0.0;
 double JetwayBearing	= 0.0;
@@ -67,6 +75,8 @@ wchar_t GetFPpath[1024];
 
 std::string firstFlightState	= "PREFLIGHT_GATE";
 std::string enableAirportLife	= "False";
+std::string catalogFilter;
+std::string resumeTitle;
 
 bool aircraftCrashed = FALSE;
 bool isOnMenuScreen = FALSE;
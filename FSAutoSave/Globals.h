@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <filesystem>
+#include <string>
 
 // Namespace for filesystem operations
 namespace fs = std::filesystem;
@@ -16,6 +18,11 @@ extern HRESULT hr;
 extern bool DEBUG;
 extern bool minimizeOnStart;
 extern bool resetSaves;
+extern bool autoSaveEnabled;
+extern bool facilityPrefetchEnabled;
+extern bool showHistory;
+extern unsigned long long restoreGeneration;
+extern bool showCatalog;
 extern bool isBUGfixed;
 extern bool isBUGfixedCustom;
 extern bool isSteam;
@@ -26,7 +33,6 @@ extern int quit;
 extern int fpDisableCount;
 extern int parkingIndex;
 extern int countJetways;
-extern int countTaxiParking;
 
 extern const std::string DELETE_MARKER;
 extern const std::string DELETE_SECTION_MARKER;
@@ -43,6 +49,7 @@ extern double myTASinFPS;
 extern double myAirspeed;
 extern double myFlaps;
 extern double myHeading;
+extern double myTrueHeading;
 extern double isSimOnGround;
 extern double JetwayDistance;
 extern double JetwayBearing;
@@ -72,6 +79,8 @@ extern wchar_t GetFPpath[1024];
 
 extern std::string enableAirportLife;
 extern std::string firstFlightState;
+extern std::string catalogFilter;
+extern std::string resumeTitle;
 
 extern bool aircraftCrashed;
 extern bool isOnMenuScreen;
@@ -93,16 +102,31 @@ extern DWORD isSimRunning;
 #define PAUSE_STATE_FLAG_ACTIVE_PAUSE 4
 #define PAUSE_STATE_FLAG_SIM_PAUSE 8
 
+// dwData values we send (or map) with EVENT_SITUATION_SAVE to know where a save came from
+#define SAVE_REQUEST_ESC 0          // ESC key
+#define SAVE_REQUEST_USER 55        // CTRL+ALT+S
+#define SAVE_REQUEST_CONTROL 56     // save command from the control channel
+#define SAVE_REQUEST_PAUSE 98       // saveDuringPause
+#define SAVE_REQUEST_INITIAL 99     // saveAndSetZULU
+
+// dwData of the EVENT_CLOSEST_AIRPORT finalSave() sends: the gate lookup that completes the save
+#define LOOKUP_REQUEST_SAVE 666
+
 // Structs and Enums
 // (Include definitions as they do not create multiple definition errors and are useful across files)
 #pragma pack(push, 1)
 struct sAirport { char name[64]; char icao[8]; };
 struct sJetways { int PARKING_GATE; int PARKING_SUFFIX; int PARKING_SPOT; };
-struct sTaxiParkings { int NAME; int SUFFIX; unsigned NUMBER; };
+struct sTaxiParkings { int NAME; int SUFFIX; unsigned NUMBER; float BIAS_X; float BIAS_Z; float RADIUS; };
+struct sRunways { double LATITUDE; double LONGITUDE; double ALTITUDE; float HEADING; float LENGTH; float WIDTH; int PRIMARY_NUMBER; int PRIMARY_DESIGNATOR; int SECONDARY_NUMBER; int SECONDARY_DESIGNATOR; };
+struct sFrequencies { int TYPE; int FREQUENCY; char NAME[64]; };
+struct sTaxiPoints { int TYPE; float BIAS_X; float BIAS_Z; };
+struct sTaxiPaths { int TYPE; float WIDTH; int START; int END; };
 struct GateInfo { std::string friendlyName; std::string gateString; };
 struct SimDayOfYear { double dayOfYear; };
-struct AircraftPosition { double latitude; double longitude; double altitude; double IASinFPS; double TASinFPS; double airspeed; double flaps; double mag_heading; double sim_on_ground; };
+struct AircraftPosition { double latitude; double longitude; double altitude; double IASinFPS; double TASinFPS; double airspeed; double flaps; double mag_heading; double sim_on_ground; double vertical_speed; double alt_above_ground; double sim_rate; double true_heading; };
 struct CameraState { double state; };
+struct RunwaySample { double latitude; double longitude; double true_heading; double sim_on_ground; };
 
 #pragma pack(pop)
 
@@ -112,7 +136,8 @@ enum DATA_DEFINE_ID {
     DEFINITION_ZULU_TIME,
     DEFINITION_POSITION_DATA,
     DEFINITION_CAMERA_STATE,
-    DEFINITION_FACILITY_AIRPORT,
+    DEFINITION_RUNWAY_SAMPLE,
+    DEFINITION_FACILITY_FIRST,      // FACILITY_DEFINITION_COUNT facility definitions from here (FacilityPlan.h)
 };
 enum DATA_REQUEST_ID {
     REQUEST_SIM_STATE,
@@ -126,6 +151,13 @@ enum DATA_REQUEST_ID {
     REQUEST_CAMERA_STATE,
     REQUEST_CLOSEST_AIRPORT,
     REQUEST_JETWAY_DATA,
+    REQUEST_AIRPORTS_IN_RANGE,      // Facilities subscription, feeds the airport index
+    REQUEST_AIRPORTS_OUT_OF_RANGE,
+    REQUEST_FACILITY_PREFETCH,      // Facility data of the closest airport, fetched ahead of the gate lookup
+    REQUEST_TAXI_GRAPH,             // Taxiways of the airport the aircraft is on the ground at (TaxiGraph.h)
+    REQUEST_RUNWAYS,                // Runways of the airports around the aircraft (RunwayIndex.h)
+    REQUEST_RUNWAY_SAMPLE,          // Position for the runway test, every sim frame it changes
+    REQUEST_FREQUENCIES,            // Frequencies of an airport for the frequencies command of the control channel
 };
 enum EVENT_ID {
     EVENT_FLIGHT_LOAD,
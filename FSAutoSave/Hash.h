@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+// Small, stable (same value on every run and every machine) hash functions
+
+inline uint32_t fnv1a32(const void* data, size_t length) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+inline uint32_t fnv1a32(const std::string& text) {
+    return fnv1a32(text.data(), text.size());
+}
+
+// 64 bit hash for file contents, 8 bytes per step (several GB/s, unlike FNV-1a that works a byte at a time).
+// Words are read in the machine byte order, all platforms we build for are little endian.
+inline uint64_t hash64(const void* data, size_t length, uint64_t seed = 0) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    const uint64_t prime1 = 0x9E3779B185EBCA87ull;
+    const uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+    uint64_t hash = seed ^ (length * prime1);
+
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        hash ^= word * prime2;
+        hash = ((hash << 31) | (hash >> 33)) * prime1;
+    }
+    uint64_t tail = 0;
+    for (size_t shift = 0; i < length; ++i, shift += 8) {
+        tail |= static_cast<uint64_t>(bytes[i]) << shift;
+    }
+    hash ^= tail * prime2;
+
+    // Final avalanche so every input bit affects every output bit
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+inline uint64_t hash64(const std::string& text) {
+    return hash64(text.data(), text.size());
+}
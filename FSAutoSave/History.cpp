@@ -0,0 +1,517 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include "History.h"
+#include "Compression.h"
+#include "Hash.h"
+
+namespace fs = std::filesystem;
+
+typedef std::pair<uint64_t, uint32_t> ChunkKey; // (hash64, length)
+
+struct ManifestFile {
+    std::string name;
+    uint64_t size;
+    uint64_t hash;
+    std::vector<ChunkKey> chunks;
+};
+
+struct Manifest {
+    uint64_t id;
+    int64_t takenAt;
+    std::string flight;
+    std::vector<ManifestFile> files;
+};
+
+static fs::path historyDir;
+static uint32_t packNumber = 0;
+static uint64_t packEnd = 0;
+static std::map<ChunkKey, HistoryIndexRecord> chunkRecords;
+static uint64_t nextGeneration = 1;
+static uint64_t lastContentDigest = 0;  // Of the newest generation, to skip saves identical to it
+
+static fs::path packPath(uint32_t number) {
+    return historyDir / ("chunks-" + std::to_string(number) + ".pack");
+}
+
+static fs::path indexPath(uint32_t number) {
+    return historyDir / ("chunks-" + std::to_string(number) + ".idx");
+}
+
+static fs::path manifestPath(uint64_t id) {
+    return historyDir / (std::to_string(id) + ".gen");
+}
+
+// Writes a small file next to its final name and renames it over, readers see the old or the new version
+static bool writeAtomically(const fs::path& path, const std::string& contents) {
+    fs::path temp = path;
+    temp += ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        out.flush();
+        if (!out) {
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(temp, path, ec);
+    return !ec;
+}
+
+static uint32_t storedBytes(const HistoryIndexRecord& record) {
+    return record.stored == 0 ? record.length : record.stored;
+}
+
+// Reads one chunk from the pack into out (which has room for record.length bytes)
+static bool readChunk(std::ifstream& pack, const HistoryIndexRecord& record, char* out, std::vector<char>& buffer) {
+    pack.seekg(static_cast<std::streamoff>(record.offset));
+    if (storedBytes(record) == record.length) {
+        return static_cast<bool>(pack.read(out, record.length));
+    }
+    buffer.resize(record.stored);
+    return pack.read(buffer.data(), record.stored) && fszDecompressBlock(buffer.data(), buffer.size(), out, record.length);
+}
+
+// --- Chunking -----------------------------------------------------------------------------------------------------
+
+static const uint64_t* gearTable() {
+    static uint64_t table[256];
+    static bool ready = false;
+    if (!ready) {
+        uint64_t state = 0x46534175746F5361ull; // Fixed seed: boundaries must not change between runs
+        for (uint64_t& entry : table) {
+            state += 0x9E3779B97F4A7C15ull; // splitmix64
+            uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            entry = z ^ (z >> 31);
+        }
+        ready = true;
+    }
+    return table;
+}
+
+static constexpr int cdcBits() {
+    int bits = 0;
+    while ((1u << bits) < static_cast<unsigned>(HISTORY_CDC_AVERAGE)) {
+        ++bits;
+    }
+    return bits;
+}
+
+static_assert((HISTORY_CDC_AVERAGE & (HISTORY_CDC_AVERAGE - 1)) == 0, "HISTORY_CDC_AVERAGE must be a power of two");
+
+static bool isFltFile(const std::string& name) {
+    return name.size() > 4 && (name.compare(name.size() - 4, 4, ".FLT") == 0 || name.compare(name.size() - 4, 4, ".flt") == 0);
+}
+
+std::vector<size_t> historyChunkBoundaries(const std::string& name, const std::string& data) {
+    std::vector<size_t> ends;
+
+    if (isFltFile(name)) {
+        // A new chunk starts at every line that opens a section
+        for (size_t pos = data.find("\n["); pos != std::string::npos; pos = data.find("\n[", pos + 1)) {
+            if (pos + 1 > (ends.empty() ? 0 : ends.back())) {
+                ends.push_back(pos + 1);
+            }
+        }
+    }
+    else {
+        // Gear hash content defined chunking
+        const uint64_t* gear = gearTable();
+        const uint64_t mask = static_cast<uint64_t>(HISTORY_CDC_AVERAGE - 1) << (64 - cdcBits()); // Top bits see the whole window
+        size_t start = 0;
+        uint64_t rolling = 0;
+        for (size_t i = 0; i < data.size(); ++i) {
+            rolling = (rolling << 1) + gear[static_cast<unsigned char>(data[i])];
+            size_t length = i + 1 - start;
+            if ((length >= HISTORY_CDC_MIN && (rolling & mask) == 0) || length >= HISTORY_CDC_MAX) {
+                ends.push_back(i + 1);
+                start = i + 1;
+                rolling = 0;
+            }
+        }
+    }
+
+    if (ends.empty() || ends.back() != data.size()) {
+        ends.push_back(data.size());
+    }
+    if (ends.size() > 1 && ends.front() == 0) {
+        ends.erase(ends.begin());
+    }
+    return ends;
+}
+
+// --- Manifests ----------------------------------------------------------------------------------------------------
+
+template <typename T> static void put(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void putString(std::string& out, const std::string& value) {
+    put(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+template <typename T> static bool get(const std::string& in, size_t& pos, T& value) {
+    if (pos + sizeof(value) > in.size()) {
+        return false;
+    }
+    std::memcpy(&value, in.data() + pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+}
+
+static bool getString(const std::string& in, size_t& pos, std::string& value) {
+    uint32_t length = 0;
+    if (!get(in, pos, length) || pos + length > in.size()) {
+        return false;
+    }
+    value.assign(in, pos, length);
+    pos += length;
+    return true;
+}
+
+static std::string serializeManifest(const Manifest& manifest) {
+    std::string out("FSAHGEN1", 8);
+    put(out, manifest.id);
+    put(out, manifest.takenAt);
+    putString(out, manifest.flight);
+    put(out, static_cast<uint32_t>(manifest.files.size()));
+    for (const ManifestFile& file : manifest.files) {
+        putString(out, file.name);
+        put(out, file.size);
+        put(out, file.hash);
+        put(out, static_cast<uint32_t>(file.chunks.size()));
+        for (const ChunkKey& chunk : file.chunks) {
+            put(out, chunk.first);
+            put(out, chunk.second);
+        }
+    }
+    return out;
+}
+
+static bool readManifest(const fs::path& path, Manifest& manifest) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    std::string data = buffer.str();
+
+    size_t pos = 8;
+    uint32_t fileCount = 0;
+    if (data.size() < 8 || data.compare(0, 8, "FSAHGEN1") != 0 || !get(data, pos, manifest.id) || !get(data, pos, manifest.takenAt) ||
+        !getString(data, pos, manifest.flight) || !get(data, pos, fileCount)) {
+        return false;
+    }
+    manifest.files.resize(fileCount);
+    for (ManifestFile& file : manifest.files) {
+        uint32_t chunkCount = 0;
+        if (!getString(data, pos, file.name) || !get(data, pos, file.size) || !get(data, pos, file.hash) || !get(data, pos, chunkCount)) {
+            return false;
+        }
+        file.chunks.resize(chunkCount);
+        for (ChunkKey& chunk : file.chunks) {
+            if (!get(data, pos, chunk.first) || !get(data, pos, chunk.second)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static std::vector<Manifest> readAllManifests() {
+    std::vector<Manifest> manifests;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(historyDir, ec)) {
+        if (entry.path().extension() == ".gen") {
+            Manifest manifest;
+            if (readManifest(entry.path(), manifest)) {
+                manifests.push_back(std::move(manifest));
+            }
+        }
+    }
+    std::sort(manifests.begin(), manifests.end(), [](const Manifest& a, const Manifest& b) { return a.id < b.id; });
+    return manifests;
+}
+
+static uint64_t contentDigest(const Manifest& manifest) {
+    std::string key = manifest.flight;
+    for (const ManifestFile& file : manifest.files) {
+        key += file.name;
+        put(key, file.hash);
+        put(key, file.size);
+    }
+    return hash64(key);
+}
+
+// --- Store --------------------------------------------------------------------------------------------------------
+
+static void loadIndex() {
+    chunkRecords.clear();
+    std::error_code ec;
+    uint64_t packSize = fs::exists(packPath(packNumber), ec) ? fs::file_size(packPath(packNumber), ec) : 0;
+
+    std::ifstream in(indexPath(packNumber), std::ios::binary);
+    HistoryIndexRecord record;
+    while (in.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+        if (record.offset + storedBytes(record) <= packSize) { // Records past the end of the pack come from an interrupted write
+            chunkRecords[ChunkKey(record.hash, record.length)] = record;
+        }
+    }
+    packEnd = packSize;
+}
+
+bool historyOpen(const std::string& directory) {
+    historyDir = fs::path(directory);
+    std::error_code ec;
+    fs::create_directories(historyDir, ec);
+    if (!fs::is_directory(historyDir, ec)) {
+        printf("[HISTORY] Could not create %s\n", historyDir.string().c_str());
+        return false;
+    }
+
+    std::ifstream current(historyDir / "CURRENT");
+    if (!(current >> packNumber) || packNumber == 0) {
+        packNumber = 1;
+        if (!writeAtomically(historyDir / "CURRENT", "1")) {
+            return false;
+        }
+    }
+    loadIndex();
+
+    std::vector<Manifest> manifests = readAllManifests();
+    nextGeneration = manifests.empty() ? 1 : manifests.back().id + 1;
+    lastContentDigest = manifests.empty() ? 0 : contentDigest(manifests.back());
+    return true;
+}
+
+// Keeps the chunks still referenced, in a new pack, once more than half of the pack is garbage
+static void compact(const std::vector<Manifest>& manifests) {
+    std::set<ChunkKey> live;
+    uint64_t liveBytes = 0;
+    for (const Manifest& manifest : manifests) {
+        for (const ManifestFile& file : manifest.files) {
+            for (const ChunkKey& chunk : file.chunks) {
+                auto it = chunkRecords.find(chunk);
+                if (live.insert(chunk).second && it != chunkRecords.end()) {
+                    liveBytes += storedBytes(it->second);
+                }
+            }
+        }
+    }
+    if (packEnd - std::min(packEnd, liveBytes) <= liveBytes) {
+        return;
+    }
+
+    // Copy in pack order so the old pack is read front to back. Chunks are copied as stored, no recompression
+    std::vector<HistoryIndexRecord> ordered;
+    for (const ChunkKey& chunk : live) {
+        auto it = chunkRecords.find(chunk);
+        if (it != chunkRecords.end()) {
+            ordered.push_back(it->second);
+        }
+    }
+    std::sort(ordered.begin(), ordered.end(), [](const HistoryIndexRecord& a, const HistoryIndexRecord& b) { return a.offset < b.offset; });
+
+    uint32_t newNumber = packNumber + 1;
+    std::ifstream oldPack(packPath(packNumber), std::ios::binary);
+    std::ofstream newPack(packPath(newNumber), std::ios::binary | std::ios::trunc);
+    std::ofstream newIndex(indexPath(newNumber), std::ios::binary | std::ios::trunc);
+    std::vector<char> buffer;
+    uint64_t offset = 0;
+    for (HistoryIndexRecord record : ordered) {
+        buffer.resize(storedBytes(record));
+        oldPack.seekg(static_cast<std::streamoff>(record.offset));
+        oldPack.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        newPack.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        record.offset = offset;
+        newIndex.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        offset += buffer.size();
+    }
+    newPack.flush();
+    newIndex.flush();
+    if (!oldPack || !newPack || !newIndex) {
+        printf("[HISTORY] Compaction failed, keeping the current pack\n");
+        return;
+    }
+    newPack.close();
+    newIndex.close();
+    oldPack.close();
+
+    // The switch to the new pack is the rename of CURRENT
+    if (!writeAtomically(historyDir / "CURRENT", std::to_string(newNumber))) {
+        return;
+    }
+    std::error_code ec;
+    fs::remove(packPath(packNumber), ec);
+    fs::remove(indexPath(packNumber), ec);
+    packNumber = newNumber;
+    loadIndex();
+}
+
+// HISTORY_KEEP_RECENT newest generations, then the newest of each day for HISTORY_KEEP_DAYS days
+static void applyRetention(int64_t now) {
+    std::vector<Manifest> manifests = readAllManifests();
+    if (manifests.size() <= HISTORY_KEEP_RECENT) {
+        return;
+    }
+
+    const int64_t day = 24 * 60 * 60 * 1000ll;
+    std::set<int64_t> daysKept;
+    std::vector<Manifest> kept;
+    bool removed = false;
+    for (size_t i = manifests.size(); i-- > 0;) {
+        const Manifest& manifest = manifests[i];
+        int64_t manifestDay = manifest.takenAt / day;
+        bool keep = manifests.size() - i <= HISTORY_KEEP_RECENT ||
+            (manifestDay >= now / day - HISTORY_KEEP_DAYS && daysKept.insert(manifestDay).second);
+        if (keep) {
+            kept.push_back(manifest);
+        }
+        else {
+            std::error_code ec;
+            fs::remove(manifestPath(manifest.id), ec);
+            removed = true;
+        }
+    }
+    if (removed) {
+        compact(kept);
+    }
+}
+
+uint64_t historyCommit(const SaveBundle& bundle) {
+    if (historyDir.empty()) {
+        return 0;
+    }
+
+    Manifest manifest;
+    manifest.id = nextGeneration;
+    manifest.takenAt = bundle.takenAt;
+    manifest.flight = bundle.flight;
+
+    std::ofstream pack(packPath(packNumber), std::ios::binary | std::ios::app);
+    std::vector<HistoryIndexRecord> added;
+    std::vector<char> compressed;
+    for (const SnapshotFile& snapshotFile : bundle.files) {
+        std::string data;
+        if (!snapshotContents(snapshotFile, data)) {
+            printf("[HISTORY] %s is damaged, not stored\n", snapshotFile.name.c_str());
+            continue;
+        }
+        ManifestFile file;
+        file.name = snapshotFile.name;
+        file.size = data.size();
+        file.hash = snapshotFile.hash;
+
+        size_t start = 0;
+        for (size_t end : historyChunkBoundaries(file.name, data)) {
+            ChunkKey key(hash64(data.data() + start, end - start), static_cast<uint32_t>(end - start));
+            if (chunkRecords.find(key) == chunkRecords.end()) {
+                // Stored as is when compression does not save at least a byte
+                compressed.resize(key.second > 0 ? key.second - 1 : 0);
+                size_t stored = fszCompressBlock(data.data() + start, key.second, compressed.data(), compressed.size());
+                if (stored == 0) {
+                    pack.write(data.data() + start, static_cast<std::streamsize>(key.second));
+                }
+                else {
+                    pack.write(compressed.data(), static_cast<std::streamsize>(stored));
+                }
+                HistoryIndexRecord record = { key.first, key.second, static_cast<uint32_t>(stored), packEnd };
+                added.push_back(record);
+                chunkRecords[key] = record;
+                packEnd += storedBytes(record);
+            }
+            file.chunks.push_back(key);
+            start = end;
+        }
+        manifest.files.push_back(std::move(file));
+    }
+
+    uint64_t digest = contentDigest(manifest);
+    if (digest == lastContentDigest && added.empty()) {
+        return 0; // Same as the newest generation
+    }
+
+    // Data first, then the index records pointing at it, then the manifest pointing at the chunks
+    pack.flush();
+    if (!pack) {
+        printf("[HISTORY] Could not write %s\n", packPath(packNumber).string().c_str());
+        loadIndex();
+        return 0;
+    }
+    std::ofstream index(indexPath(packNumber), std::ios::binary | std::ios::app);
+    index.write(reinterpret_cast<const char*>(added.data()), static_cast<std::streamsize>(added.size() * sizeof(HistoryIndexRecord)));
+    index.flush();
+    if (!index || !writeAtomically(manifestPath(manifest.id), serializeManifest(manifest))) {
+        printf("[HISTORY] Could not write generation %llu\n", (unsigned long long)manifest.id);
+        index.close();
+        loadIndex(); // Drops the chunks added above that have no index record on disk
+        return 0;
+    }
+
+    nextGeneration++;
+    lastContentDigest = digest;
+    pack.close();
+    applyRetention(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    return manifest.id;
+}
+
+std::vector<HistoryGeneration> historyList() {
+    std::vector<HistoryGeneration> generations;
+    for (const Manifest& manifest : readAllManifests()) {
+        HistoryGeneration generation;
+        generation.id = manifest.id;
+        generation.takenAt = manifest.takenAt;
+        generation.flight = manifest.flight;
+        generation.bytes = 0;
+        for (const ManifestFile& file : manifest.files) {
+            generation.files.push_back(file.name);
+            generation.bytes += file.size;
+        }
+        generations.push_back(std::move(generation));
+    }
+    return generations;
+}
+
+bool historyRestore(uint64_t id, const std::string& directory) {
+    Manifest manifest;
+    if (historyDir.empty() || !readManifest(manifestPath(id), manifest)) {
+        printf("[HISTORY] Generation %llu not found\n", (unsigned long long)id);
+        return false;
+    }
+
+    std::ifstream pack(packPath(packNumber), std::ios::binary);
+    std::vector<char> buffer;
+    bool ok = true;
+    for (const ManifestFile& file : manifest.files) {
+        std::string data;
+        data.resize(static_cast<size_t>(file.size));
+        size_t pos = 0;
+        for (const ChunkKey& chunk : file.chunks) {
+            auto it = chunkRecords.find(chunk);
+            if (it == chunkRecords.end() || pos + chunk.second > data.size() || !readChunk(pack, it->second, &data[pos], buffer)) {
+                pos = SIZE_MAX;
+                break;
+            }
+            pos += chunk.second;
+        }
+        if (!pack || pos != data.size() || hash64(data) != file.hash) {
+            printf("[HISTORY] %s of generation %llu is damaged, not restored\n", file.name.c_str(), (unsigned long long)id);
+            pack.clear();
+            ok = false;
+            continue;
+        }
+        if (!writeAtomically(fs::path(directory) / file.name, data)) {
+            printf("[HISTORY] Could not write %s\n", (fs::path(directory) / file.name).string().c_str());
+            ok = false;
+        }
+    }
+    return ok;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Platform.h"
+#include "Snapshots.h"
+
+// Save history on disk. Every committed save becomes a generation; the files are split into chunks that are stored
+// once, keyed by (hash64, length), so consecutive saves only add the sections that changed.
+//
+// - .FLT files are split at section headers ([Main], [SimVars.0], ...), one chunk per section
+// - everything else uses content defined chunking (average HISTORY_CDC_AVERAGE bytes) so an insert only changes the
+//   chunks around it
+//
+// Layout under the history directory:
+//   CURRENT             number of the active pack, replaced atomically after a compaction
+//   chunks-<n>.pack     chunk data (each chunk an FSZ block, see Compression.h), append only
+//   chunks-<n>.idx      one HistoryIndexRecord per chunk, appended after its data is in the pack
+//   <id>.gen            manifest of one generation (files, and the chunks that make them up)
+
+#define HISTORY_DIRECTORY "FSAutoSave" PATH_SEPARATOR "History"    // Under localStatePath
+#define HISTORY_KEEP_RECENT 50                      // Generations always kept
+#define HISTORY_KEEP_DAYS 30                        // Beyond that, the newest generation of each day for this many days
+#define HISTORY_CDC_MIN 2048
+#define HISTORY_CDC_AVERAGE 8192                    // Must be a power of two
+#define HISTORY_CDC_MAX 65536
+
+#pragma pack(push, 1)
+struct HistoryIndexRecord {
+    uint64_t hash;
+    uint32_t length;
+    uint32_t stored;        // Bytes in the pack, the chunk is FSZ compressed when smaller than length (0: same as length)
+    uint64_t offset;        // In the pack
+};
+#pragma pack(pop)
+
+struct HistoryGeneration {
+    uint64_t id;
+    int64_t takenAt;        // Unix time in milliseconds
+    std::string flight;
+    std::vector<std::string> files;
+    uint64_t bytes;         // Size of the files once restored
+};
+
+bool historyOpen(const std::string& directory);
+// Stores the bundle as a new generation and applies the retention policy. Returns the generation id (0 on failure)
+uint64_t historyCommit(const SaveBundle& bundle);
+std::vector<HistoryGeneration> historyList();
+// Writes the files of generation id to directory (temp file + rename). Reads only the chunks those files need
+bool historyRestore(uint64_t id, const std::string& directory);
+
+// Chunk boundaries (end offsets) the store would use for a file, exposed for the tools and benchmarks
+std::vector<size_t> historyChunkBoundaries(const std::string& name, const std::string& data);
@@ -0,0 +1,144 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include "LiveState.h"
+
+#ifdef _WIN32
+static const char* liveStateName = "Local\\FSAutoSave.LiveState";
+static HANDLE liveStateMapping = NULL;
+#else
+static const char* liveStateName = "/fsautosave.livestate";
+#endif
+
+static LiveStateSegment* liveStateSegment = nullptr;
+static LiveStateData liveStateLast = {};    // What we published last, to skip writes when nothing changed
+
+static void* liveStateMap(bool writable) {
+#ifdef _WIN32
+    HANDLE hMapping = writable
+        ? CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(LiveStateSegment), liveStateName)
+        : OpenFileMappingA(FILE_MAP_READ, FALSE, liveStateName);
+    if (hMapping == NULL) {
+        return nullptr;
+    }
+    void* view = MapViewOfFile(hMapping, writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, sizeof(LiveStateSegment));
+    if (view == nullptr || !writable) {
+        CloseHandle(hMapping); // A read only view keeps the mapping alive by itself
+    }
+    else {
+        liveStateMapping = hMapping;
+    }
+    return view;
+#else
+    int fd = writable ? shm_open(liveStateName, O_CREAT | O_RDWR, 0644) : shm_open(liveStateName, O_RDONLY, 0);
+    if (fd < 0) {
+        return nullptr;
+    }
+    if (writable && ftruncate(fd, sizeof(LiveStateSegment)) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* view = mmap(nullptr, sizeof(LiveStateSegment), writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return view == MAP_FAILED ? nullptr : view;
+#endif
+}
+
+static void liveStateUnmap(void* view) {
+#ifdef _WIN32
+    UnmapViewOfFile(view);
+#else
+    munmap(view, sizeof(LiveStateSegment));
+#endif
+}
+
+bool liveStateOpen() {
+    if (liveStateSegment != nullptr) {
+        return true;
+    }
+
+    void* view = liveStateMap(true);
+    if (view == nullptr) {
+        printf("[LIVESTATE] Could not create the live state segment. Live state is disabled\n");
+        return false;
+    }
+
+    liveStateSegment = static_cast<LiveStateSegment*>(view);
+    liveStateSegment->sequence.store(1, std::memory_order_relaxed); // Odd: not ready yet
+    liveStateSegment->magic = LIVESTATE_MAGIC;
+    liveStateSegment->version = LIVESTATE_VERSION;
+    liveStateSegment->size = sizeof(LiveStateSegment);
+    std::memset(&liveStateSegment->data, 0, sizeof(liveStateSegment->data));
+    std::memset(&liveStateLast, 0, sizeof(liveStateLast));
+    liveStateSegment->sequence.store(2, std::memory_order_release);
+    return true;
+}
+
+void liveStateClose() {
+    if (liveStateSegment == nullptr) {
+        return;
+    }
+    liveStateUnmap(liveStateSegment);
+    liveStateSegment = nullptr;
+#ifdef _WIN32
+    CloseHandle(liveStateMapping);
+    liveStateMapping = NULL;
+#else
+    shm_unlink(liveStateName);
+#endif
+}
+
+void liveStatePublish(const LiveStateData& data) {
+    if (liveStateSegment == nullptr) {
+        return;
+    }
+
+    // Most messages don't change anything a reader cares about, compare everything except the timestamp
+    const size_t offset = offsetof(LiveStateData, stateFlags);
+    if (std::memcmp(reinterpret_cast<const char*>(&data) + offset, reinterpret_cast<const char*>(&liveStateLast) + offset, sizeof(LiveStateData) - offset) == 0) {
+        return;
+    }
+    liveStateLast = data;
+    liveStateLast.updatedAt = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    uint32_t sequence = liveStateSegment->sequence.load(std::memory_order_relaxed);
+    liveStateSegment->sequence.store(sequence + 1, std::memory_order_relaxed); // Odd: update in progress
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&liveStateSegment->data, &liveStateLast, sizeof(LiveStateData));
+    liveStateSegment->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool liveStateRead(LiveStateData& out) {
+    void* view = liveStateMap(false);
+    if (view == nullptr) {
+        return false;
+    }
+
+    const LiveStateSegment* segment = static_cast<const LiveStateSegment*>(view);
+    bool ok = false;
+    if (segment->magic == LIVESTATE_MAGIC && segment->version == LIVESTATE_VERSION && segment->size >= sizeof(LiveStateSegment)) {
+        for (int attempt = 0; attempt < 1000 && !ok; ++attempt) {
+            uint32_t before = segment->sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::memcpy(&out, &segment->data, sizeof(LiveStateData));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            ok = segment->sequence.load(std::memory_order_relaxed) == before;
+        }
+    }
+
+    liveStateUnmap(view);
+    return ok;
+}
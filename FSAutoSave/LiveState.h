@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Live state shared memory segment for overlays, logbooks and other tools running on the same machine.
+//
+// Windows: file mapping "Local\FSAutoSave.LiveState". Elsewhere: POSIX shared memory "/fsautosave.livestate".
+// The segment is a LiveStateSegment. It is protected by a seqlock, so readers never block us:
+//   1. read sequence (4 bytes at offset 12), if it is odd the dispatcher is writing, try again
+//   2. copy data
+//   3. read sequence again, if it changed the copy is torn, try again
+// Readers must check magic and version, and only rely on the first `size` bytes.
+
+#define LIVESTATE_MAGIC 0x4153534Cu    // "LSSA"
+#define LIVESTATE_VERSION 1             // Bump when fields are removed or change meaning (adding fields at the end is fine)
+
+#pragma pack(push, 8)
+struct LiveStateData {
+    int64_t updatedAt;          // Unix time in milliseconds of the last change
+    uint32_t stateFlags;        // currentStateFlags(), one bit per RECORDER_FLAG
+    uint32_t simRunning;        // 1 when the sim is running (not in menus)
+    double latitude;            // Degrees, last known position
+    double longitude;
+    double altitude;            // Feet
+    double heading;             // Degrees magnetic
+    double airspeed;            // Knots
+    uint32_t onGround;
+    uint32_t gateNumber;        // Nearest gate number (0 if unknown)
+    double gateDistance;        // Meters to the nearest jetway when it was resolved
+    char aircraft[128];         // Names are NUL terminated UTF-8, empty when unknown
+    char flight[64];
+    char flightPlan[64];
+    char airportICAO[8];        // Nearest airport from the last gate lookup
+    char airportName[64];
+    char gate[32];              // e.g. GATE_B
+};
+
+struct LiveStateSegment {
+    uint32_t magic;             // LIVESTATE_MAGIC
+    uint32_t version;           // LIVESTATE_VERSION
+    uint32_t size;              // sizeof(LiveStateSegment) of the writer
+    std::atomic<uint32_t> sequence; // Seqlock: odd while the data is being updated
+    LiveStateData data;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "sequence must be a plain 32 bit value for external readers");
+
+// Writer side (FSAutoSave). liveStatePublish only touches the segment when something changed
+bool liveStateOpen();
+void liveStateClose();
+void liveStatePublish(const LiveStateData& data);
+
+// Reader side (tools). Returns false if there is no segment or it has a different version
+bool liveStateRead(LiveStateData& out);
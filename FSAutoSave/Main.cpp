@@ -10,6 +10,9 @@
 #include "FSAutoSave.h"
 #include "Globals.h"
 #include "Utility.h"
+#include "ControlChannel.h"
+#include "LiveState.h"
+#include "Metrics.h"
 
 int __cdecl _tmain(int argc, _TCHAR* argv[])
 {
@@ -55,12 +58,49 @@ int __cdecl _tmain(int argc, _TCHAR* argv[])
         if (_tcscmp(argv[i], _T("-SILENT")) == 0) {
             minimizeOnStart = TRUE;
         }
+        if (_tcscmp(argv[i], _T("-NOAUTOSAVE")) == 0) {
+            autoSaveEnabled = FALSE;
+            printf("[INFO]  *** Periodic autosave is DISABLED *** \n");
+        }
+        if (_tcscmp(argv[i], _T("-NOPREFETCH")) == 0) {
+            facilityPrefetchEnabled = FALSE;
+        }
+        if (_tcscmp(argv[i], _T("-HISTORY")) == 0) {
+            showHistory = TRUE;
+        }
+        if (_tcsncmp(argv[i], _T("-RESTORE:"), 9) == 0) {
+            restoreGeneration = _tcstoui64(argv[i] + 9, NULL, 10);
+        }
+        if (_tcscmp(argv[i], _T("-CATALOG")) == 0 || _tcsncmp(argv[i], _T("-CATALOG:"), 9) == 0) {
+            showCatalog = TRUE;
+            if (argv[i][8] == _T(':')) {
+                catalogFilter = WideCharToUTF8(argv[i] + 9); // Only aircraft whose title contains it
+            }
+        }
+        if (_tcsncmp(argv[i], _T("-RESUME:"), 8) == 0) {
+            resumeTitle = WideCharToUTF8(argv[i] + 8);
+        }
         if (_tcscmp(argv[i], _T("-RESET")) == 0) {
             resetSaves = TRUE;
         }
         if (wcsncmp(argv[i], L"-SIMBRIEF:", 10) == 0) {
             SafeCopyPath(argv[i] + 10);  // Skip the "-SIMBRIEF:" (10 chars) part and copy the rest (the path) to the global variable GetFPpath
         }
+        if (_tcsncmp(argv[i], _T("-BLACKBOX:"), 10) == 0) {
+            // Print a flight recorder dump and exit
+            recorderPrintDump(WideCharToUTF8(argv[i] + 10));
+            return 0;
+        }
+        if (_tcsncmp(argv[i], _T("-DIFF:"), 6) == 0) {
+            // Print what changed between two .FLT files and exit
+            printFltDiff(WideCharToUTF8(argv[i] + 6), i + 1 < argc ? WideCharToUTF8(argv[i + 1]) : "");
+            return 0;
+        }
+        if (_tcscmp(argv[i], _T("-LIVESTATE")) == 0) {
+            // Print the live state of the running instance and exit
+            printLiveState();
+            return 0;
+        }
         if (_tcsncmp(argv[i], _T("-FFSTATE:"), 9) == 0) {
             // Set the firstFlightState based on the argument provided
             firstFlightState = WideCharToUTF8(argv[i] + 9); // Convert from TCHAR* to std::string
@@ -110,6 +150,26 @@ int __cdecl _tmain(int argc, _TCHAR* argv[])
             waitForEnter();  // Ensure user presses Enter
             return 0;
         }
+
+        // Save history (every committed save is kept as a generation) and its catalog
+        bool historyCommand = showHistory || restoreGeneration != 0 || showCatalog || !resumeTitle.empty();
+        openHistory(historyCommand); // A listing may run next to the instance that writes the catalog
+        if (historyCommand) {
+            if (showHistory) {
+                printHistory();
+            }
+            else if (showCatalog) {
+                printCatalog(catalogFilter);
+            }
+            else if (!resumeTitle.empty()) {
+                resumeAircraft(resumeTitle);
+            }
+            else {
+                restoreHistory(restoreGeneration);
+            }
+            waitForEnter();  // Ensure user presses Enter
+            return 0;
+        }
     }
     else {
         // Check if the user wants to reset the saved situations. We call the function to RESET the saves and then exit the program.
@@ -118,6 +178,11 @@ int __cdecl _tmain(int argc, _TCHAR* argv[])
             waitForEnter();  // Ensure user presses Enter
             return 0;
         }
+        else if (showHistory || restoreGeneration != 0 || showCatalog || !resumeTitle.empty()) {
+            printf("[HISTORY] In order to list or restore saved generations you need to run this program where MSFS is installed\n");
+            waitForEnter();  // Ensure user presses Enter
+            return 0;
+        }
         else {
             printf("[INFO] MSFS is NOT Installed locally, FSAutoSave will RUN over the network, but WILL NOT be able to FIX some of the MSFS Save system bugs.\n");
         }
@@ -148,9 +213,20 @@ int __cdecl _tmain(int argc, _TCHAR* argv[])
         return 1; // Exit the program.
     }
 
+    // Local metrics endpoint (counters and gauges for unattended seats)
+    metricsServerStart(metricsDefaultEndpoint());
+
+    // Local command channel (save, position, reload and fp-load for automation)
+    controlServerStart(controlDefaultEndpoint());
+
+    // Shared memory segment with the current aircraft, flight, position and nearest gate
+    liveStateOpen();
+
     // main program.
     sc();
 
+    liveStateClose();
+
     // Release the mutex when done.
     CloseHandle(hMutex);
 
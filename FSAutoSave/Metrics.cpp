@@ -0,0 +1,315 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#endif
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include "Metrics.h"
+#include "Platform.h"
+
+static const double latencyBuckets[] = { 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0 }; // Seconds
+static const size_t latencyBucketCount = sizeof(latencyBuckets) / sizeof(latencyBuckets[0]);
+
+static const char* saveSourceNames[SAVE_SOURCE_COUNT] = { "initial", "user", "esc", "pause", "control" };
+
+static std::atomic<uint64_t> saveRequests[SAVE_SOURCE_COUNT];
+static std::atomic<uint64_t> savesCommitted(0);
+static std::atomic<int64_t> saveStartedAt(0);                   // ns, 0 when no save is pending
+static std::atomic<uint64_t> saveLatencyBuckets[latencyBucketCount + 1];
+static std::atomic<uint64_t> saveLatencySum(0);                 // us
+static std::atomic<uint64_t> saveLatencyLast(0);                // us
+static std::atomic<uint64_t> saveLatencyMax(0);                 // us
+
+static std::atomic<uint64_t> fileWrites(0);
+static std::atomic<uint64_t> fileBytesWritten(0);
+static std::atomic<uint64_t> fileWritesAvoided(0);
+static std::atomic<uint64_t> savesAvoided(0);
+
+static std::atomic<uint64_t> facilityLookups(0);
+static std::atomic<uint64_t> facilityMessages(0);
+static std::atomic<uint64_t> facilityBytes(0);
+static std::atomic<uint64_t> gateCacheHits(0);
+static std::atomic<uint64_t> gateCacheMisses(0);
+
+static std::atomic<uint64_t> dispatchMessages(0);
+static std::atomic<uint32_t> dispatchQueueDepth(0);
+static std::atomic<uint32_t> dispatchQueueDepthMax(0);
+
+static std::atomic<uint64_t> exceptionCounts[METRICS_MAX_EXCEPTIONS];
+static std::atomic<const char*> exceptionNames[METRICS_MAX_EXCEPTIONS];
+
+static std::atomic<bool> simConnected(false);
+
+static const std::chrono::steady_clock::time_point metricsEpoch = std::chrono::steady_clock::now();
+
+static int64_t metricsClock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - metricsEpoch).count() + 1; // Never 0
+}
+
+static void atomicMax(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void metricsCountSaveRequest(METRIC_SAVE_SOURCE source) {
+    if (source < SAVE_SOURCE_COUNT) {
+        saveRequests[source].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void metricsSaveStarted() {
+    int64_t expected = 0;
+    saveStartedAt.compare_exchange_strong(expected, metricsClock(), std::memory_order_relaxed);
+}
+
+void metricsSaveCommitted() {
+    int64_t startedAt = saveStartedAt.exchange(0, std::memory_order_relaxed);
+    if (startedAt == 0) {
+        return; // Not a save (e.g. CTRL+ALT+P lookup)
+    }
+
+    uint64_t latencyUs = static_cast<uint64_t>((metricsClock() - startedAt) / 1000);
+    double seconds = static_cast<double>(latencyUs) / 1e6;
+
+    size_t bucket = 0;
+    while (bucket < latencyBucketCount && seconds > latencyBuckets[bucket]) {
+        bucket++;
+    }
+    saveLatencyBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    saveLatencySum.fetch_add(latencyUs, std::memory_order_relaxed);
+    saveLatencyLast.store(latencyUs, std::memory_order_relaxed);
+    atomicMax(saveLatencyMax, latencyUs);
+    savesCommitted.fetch_add(1, std::memory_order_relaxed);
+}
+
+void metricsSaveAborted() {
+    saveStartedAt.store(0, std::memory_order_relaxed);
+}
+
+uint64_t metricsSavesCommitted() {
+    return savesCommitted.load(std::memory_order_relaxed);
+}
+
+uint64_t metricsSaveRequests(METRIC_SAVE_SOURCE source) {
+    return saveRequests[source].load(std::memory_order_relaxed);
+}
+
+void metricsAddFileWrite(uint64_t bytes) {
+    fileWrites.fetch_add(1, std::memory_order_relaxed);
+    fileBytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void metricsCountAvoidedWrite() {
+    fileWritesAvoided.fetch_add(1, std::memory_order_relaxed);
+}
+
+void metricsCountAvoidedSave() {
+    savesAvoided.fetch_add(1, std::memory_order_relaxed);
+}
+
+void metricsAddFacilityLookup(uint32_t messages, uint64_t bytes) {
+    facilityLookups.fetch_add(1, std::memory_order_relaxed);
+    facilityMessages.fetch_add(messages, std::memory_order_relaxed);
+    facilityBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void metricsCountGateCache(bool hit) {
+    (hit ? gateCacheHits : gateCacheMisses).fetch_add(1, std::memory_order_relaxed);
+}
+
+void metricsDispatchPolled(uint32_t messages) {
+    if (messages == 0) {
+        // Most polls find the queue empty, keep those to a single load
+        if (dispatchQueueDepth.load(std::memory_order_relaxed) != 0) {
+            dispatchQueueDepth.store(0, std::memory_order_relaxed);
+        }
+        return;
+    }
+    dispatchMessages.fetch_add(messages, std::memory_order_relaxed);
+    dispatchQueueDepth.store(messages, std::memory_order_relaxed);
+    if (messages > dispatchQueueDepthMax.load(std::memory_order_relaxed)) {
+        dispatchQueueDepthMax.store(messages, std::memory_order_relaxed); // Only the dispatcher thread writes it
+    }
+}
+
+void metricsCountException(uint32_t exception, const char* name) {
+    uint32_t slot = exception < METRICS_MAX_EXCEPTIONS ? exception : METRICS_MAX_EXCEPTIONS - 1;
+    exceptionCounts[slot].fetch_add(1, std::memory_order_relaxed);
+    if (name != nullptr && exceptionNames[slot].load(std::memory_order_relaxed) == nullptr) {
+        exceptionNames[slot].store(name, std::memory_order_relaxed);
+    }
+}
+
+void metricsSetConnected(bool connected) {
+    simConnected.store(connected, std::memory_order_relaxed);
+}
+
+static void appendMetric(std::string& out, const char* format, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length > 0) {
+        out.append(line, static_cast<size_t>(length) < sizeof(line) ? static_cast<size_t>(length) : sizeof(line) - 1);
+    }
+}
+
+std::string metricsRender() {
+    std::string out;
+    out.reserve(4096);
+
+    appendMetric(out, "# HELP fsautosave_up_seconds Seconds since FSAutoSave started\n# TYPE fsautosave_up_seconds gauge\n");
+    appendMetric(out, "fsautosave_up_seconds %.3f\n", static_cast<double>(metricsClock()) / 1e9);
+    appendMetric(out, "# HELP fsautosave_simconnect_connected 1 while connected to the simulator\n# TYPE fsautosave_simconnect_connected gauge\n");
+    appendMetric(out, "fsautosave_simconnect_connected %d\n", simConnected.load(std::memory_order_relaxed) ? 1 : 0);
+
+    appendMetric(out, "# HELP fsautosave_save_requests_total Save requests received, by source\n# TYPE fsautosave_save_requests_total counter\n");
+    for (int source = 0; source < SAVE_SOURCE_COUNT; ++source) {
+        appendMetric(out, "fsautosave_save_requests_total{source=\"%s\"} %llu\n", saveSourceNames[source], (unsigned long long)saveRequests[source].load(std::memory_order_relaxed));
+    }
+    appendMetric(out, "# HELP fsautosave_saves_committed_total Saves where LAST.FLT and CUSTOMFLIGHT.FLT were finalized\n# TYPE fsautosave_saves_committed_total counter\n");
+    appendMetric(out, "fsautosave_saves_committed_total %llu\n", (unsigned long long)savesCommitted.load(std::memory_order_relaxed));
+    appendMetric(out, "# HELP fsautosave_saves_avoided_total Save requests merged into another save instead of running on their own\n# TYPE fsautosave_saves_avoided_total counter\n");
+    appendMetric(out, "fsautosave_saves_avoided_total %llu\n", (unsigned long long)savesAvoided.load(std::memory_order_relaxed));
+
+    appendMetric(out, "# HELP fsautosave_save_latency_seconds Time from save trigger to committed files\n# TYPE fsautosave_save_latency_seconds histogram\n");
+    uint64_t cumulative = 0;
+    for (size_t bucket = 0; bucket < latencyBucketCount; ++bucket) {
+        cumulative += saveLatencyBuckets[bucket].load(std::memory_order_relaxed);
+        appendMetric(out, "fsautosave_save_latency_seconds_bucket{le=\"%g\"} %llu\n", latencyBuckets[bucket], (unsigned long long)cumulative);
+    }
+    cumulative += saveLatencyBuckets[latencyBucketCount].load(std::memory_order_relaxed);
+    appendMetric(out, "fsautosave_save_latency_seconds_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)cumulative);
+    appendMetric(out, "fsautosave_save_latency_seconds_sum %.6f\n", static_cast<double>(saveLatencySum.load(std::memory_order_relaxed)) / 1e6);
+    appendMetric(out, "fsautosave_save_latency_seconds_count %llu\n", (unsigned long long)cumulative);
+    appendMetric(out, "# HELP fsautosave_save_latency_last_seconds Latency of the most recent save\n# TYPE fsautosave_save_latency_last_seconds gauge\n");
+    appendMetric(out, "fsautosave_save_latency_last_seconds %.6f\n", static_cast<double>(saveLatencyLast.load(std::memory_order_relaxed)) / 1e6);
+    appendMetric(out, "# HELP fsautosave_save_latency_max_seconds Slowest save so far\n# TYPE fsautosave_save_latency_max_seconds gauge\n");
+    appendMetric(out, "fsautosave_save_latency_max_seconds %.6f\n", static_cast<double>(saveLatencyMax.load(std::memory_order_relaxed)) / 1e6);
+
+    appendMetric(out, "# HELP fsautosave_flt_writes_total .FLT write operations performed\n# TYPE fsautosave_flt_writes_total counter\n");
+    appendMetric(out, "fsautosave_flt_writes_total %llu\n", (unsigned long long)fileWrites.load(std::memory_order_relaxed));
+    appendMetric(out, "# HELP fsautosave_flt_bytes_written_total Bytes written to .FLT files\n# TYPE fsautosave_flt_bytes_written_total counter\n");
+    appendMetric(out, "fsautosave_flt_bytes_written_total %llu\n", (unsigned long long)fileBytesWritten.load(std::memory_order_relaxed));
+    appendMetric(out, "# HELP fsautosave_flt_writes_avoided_total Key writes skipped because the file already had the value, counted once the endpoint was read\n# TYPE fsautosave_flt_writes_avoided_total counter\n");
+    appendMetric(out, "fsautosave_flt_writes_avoided_total %llu\n", (unsigned long long)fileWritesAvoided.load(std::memory_order_relaxed));
+
+    appendMetric(out, "# HELP fsautosave_facility_lookups_total Facility data requests answered by the simulator\n# TYPE fsautosave_facility_lookups_total counter\n");
+    appendMetric(out, "fsautosave_facility_lookups_total %llu\n", (unsigned long long)facilityLookups.load(std::memory_order_relaxed));
+    appendMetric(out, "# HELP fsautosave_facility_messages_total Facility data messages received for those requests\n# TYPE fsautosave_facility_messages_total counter\n");
+    appendMetric(out, "fsautosave_facility_messages_total %llu\n", (unsigned long long)facilityMessages.load(std::memory_order_relaxed));
+    appendMetric(out, "# HELP fsautosave_facility_bytes_total Bytes of those messages\n# TYPE fsautosave_facility_bytes_total counter\n");
+    appendMetric(out, "fsautosave_facility_bytes_total %llu\n", (unsigned long long)facilityBytes.load(std::memory_order_relaxed));
+
+    appendMetric(out, "# HELP fsautosave_gate_cache_total Gate lookups answered from the previous one (hit) or not (miss)\n# TYPE fsautosave_gate_cache_total counter\n");
+    appendMetric(out, "fsautosave_gate_cache_total{result=\"hit\"} %llu\n", (unsigned long long)gateCacheHits.load(std::memory_order_relaxed));
+    appendMetric(out, "fsautosave_gate_cache_total{result=\"miss\"} %llu\n", (unsigned long long)gateCacheMisses.load(std::memory_order_relaxed));
+
+    appendMetric(out, "# HELP fsautosave_dispatch_messages_total SimConnect messages dispatched\n# TYPE fsautosave_dispatch_messages_total counter\n");
+    appendMetric(out, "fsautosave_dispatch_messages_total %llu\n", (unsigned long long)dispatchMessages.load(std::memory_order_relaxed));
+    appendMetric(out, "# HELP fsautosave_dispatch_queue_depth Messages found in the SimConnect queue on the last poll\n# TYPE fsautosave_dispatch_queue_depth gauge\n");
+    appendMetric(out, "fsautosave_dispatch_queue_depth %u\n", dispatchQueueDepth.load(std::memory_order_relaxed));
+    appendMetric(out, "# HELP fsautosave_dispatch_queue_depth_max Deepest SimConnect queue seen on a poll\n# TYPE fsautosave_dispatch_queue_depth_max gauge\n");
+    appendMetric(out, "fsautosave_dispatch_queue_depth_max %u\n", dispatchQueueDepthMax.load(std::memory_order_relaxed));
+
+    appendMetric(out, "# HELP fsautosave_simconnect_exceptions_total SimConnect exceptions received, by type\n# TYPE fsautosave_simconnect_exceptions_total counter\n");
+    for (uint32_t exception = 0; exception < METRICS_MAX_EXCEPTIONS; ++exception) {
+        uint64_t count = exceptionCounts[exception].load(std::memory_order_relaxed);
+        if (count == 0) {
+            continue;
+        }
+        const char* name = exceptionNames[exception].load(std::memory_order_relaxed);
+        if (name != nullptr) {
+            appendMetric(out, "fsautosave_simconnect_exceptions_total{type=\"%s\"} %llu\n", name, (unsigned long long)count);
+        }
+        else {
+            appendMetric(out, "fsautosave_simconnect_exceptions_total{type=\"%u\"} %llu\n", exception, (unsigned long long)count);
+        }
+    }
+
+    return out;
+}
+
+#ifdef _WIN32
+
+std::string metricsDefaultEndpoint() {
+    return "\\\\.\\pipe\\FSAutoSave.metrics";
+}
+
+static void metricsServer(std::string endpoint) {
+    while (true) {
+        HANDLE hPipe = CreateNamedPipeA(endpoint.c_str(), PIPE_ACCESS_OUTBOUND, PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+            PIPE_UNLIMITED_INSTANCES, 64 * 1024, 0, 0, NULL);
+        if (hPipe == INVALID_HANDLE_VALUE) {
+            printf("[METRICS] Could not create %s (%lu). Metrics endpoint disabled\n", endpoint.c_str(), GetLastError());
+            return;
+        }
+
+        // Sleeps here until someone connects
+        BOOL connected = ConnectNamedPipe(hPipe, NULL) ? TRUE : (GetLastError() == ERROR_PIPE_CONNECTED);
+        if (connected) {
+            std::string text = metricsRender();
+            DWORD written = 0;
+            WriteFile(hPipe, text.data(), static_cast<DWORD>(text.size()), &written, NULL);
+            FlushFileBuffers(hPipe);
+            DisconnectNamedPipe(hPipe);
+        }
+        CloseHandle(hPipe);
+    }
+}
+
+#else
+
+std::string metricsDefaultEndpoint() {
+    const char* runtimeDir = getenv("XDG_RUNTIME_DIR");
+    return std::string(runtimeDir != nullptr && runtimeDir[0] != '\0' ? runtimeDir : "/tmp") + "/fsautosave-metrics.sock";
+}
+
+static void metricsServer(int listenSocket) {
+    while (true) {
+        // Sleeps here until someone connects
+        int client = acceptLocalClient(listenSocket);
+        if (client < 0) {
+            printf("[METRICS] Could not accept clients (%s). Metrics endpoint disabled\n", strerror(errno));
+            close(listenSocket);
+            return;
+        }
+        std::string text = metricsRender();
+        size_t offset = 0;
+        while (offset < text.size()) {
+            ssize_t sent = send(client, text.data() + offset, text.size() - offset, MSG_NOSIGNAL);
+            if (sent <= 0) {
+                break;
+            }
+            offset += static_cast<size_t>(sent);
+        }
+        close(client);
+    }
+}
+
+#endif
+
+bool metricsServerStart(const std::string& endpoint) {
+#ifdef _WIN32
+    std::thread(metricsServer, endpoint).detach();
+#else
+    int listenSocket = listenLocalSocket(endpoint, 8);
+    if (listenSocket < 0) {
+        printf("[METRICS] Could not listen on %s (%s). Metrics endpoint disabled\n", endpoint.c_str(), strerror(errno));
+        return false;
+    }
+    std::thread(metricsServer, listenSocket).detach();
+#endif
+    return true;
+}
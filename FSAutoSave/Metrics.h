@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Counters and gauges for unattended seats. Updating a metric is a couple of relaxed atomic operations, so it can be
+// done from the dispatcher or any other thread. The endpoint serves them in the Prometheus text exposition format.
+
+#define METRICS_MAX_EXCEPTIONS 64   // SimConnect exception IDs we keep a counter for (anything above is counted as the last one)
+
+// Where a save request came from (label "source" of fsautosave_save_requests_total)
+enum METRIC_SAVE_SOURCE {
+    SAVE_SOURCE_INITIAL,    // Automatic first save when the flight starts (dwData 99)
+    SAVE_SOURCE_USER,       // CTRL+ALT+S (dwData 55)
+    SAVE_SOURCE_ESC,        // ESC key (dwData 0)
+    SAVE_SOURCE_PAUSE,      // saveDuringPause (dwData 98)
+    SAVE_SOURCE_CONTROL,    // save command from the control channel (dwData 56)
+    SAVE_SOURCE_COUNT
+};
+
+void metricsCountSaveRequest(METRIC_SAVE_SOURCE source);
+void metricsSaveStarted();      // Trigger received. Only the first trigger until the save is committed counts
+void metricsSaveCommitted();    // LAST.FLT and CUSTOMFLIGHT.FLT are final, observes the latency since metricsSaveStarted()
+void metricsSaveAborted();      // The save will not complete (e.g. DEBUG mode)
+uint64_t metricsSavesCommitted();  // Saves committed so far
+uint64_t metricsSaveRequests(METRIC_SAVE_SOURCE source);
+
+void metricsAddFileWrite(uint64_t bytes);
+void metricsCountAvoidedWrite();   // Key left alone by modifyConfigFile because it already had the value
+void metricsCountAvoidedSave();    // Save request merged into another run by the save scheduler
+
+void metricsAddFacilityLookup(uint32_t messages, uint64_t bytes); // Facility data request answered (FacilityPlan.h)
+void metricsCountGateCache(bool hit);   // Gate lookup answered from the last one (GateCache.h), or not
+
+void metricsDispatchPolled(uint32_t messages); // Messages drained from the SimConnect queue in one poll
+void metricsCountException(uint32_t exception, const char* name);
+
+void metricsSetConnected(bool connected);
+
+// Renders every metric in the text exposition format
+std::string metricsRender();
+
+// Serves metricsRender() to every client that connects to the endpoint (a named pipe on Windows, a Unix domain socket
+// elsewhere). The server thread sleeps in accept, so it costs nothing while nobody is connected.
+bool metricsServerStart(const std::string& endpoint);
+std::string metricsDefaultEndpoint();
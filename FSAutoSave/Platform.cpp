@@ -0,0 +1,436 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "Platform.h"
+#include "FltDiff.h"
+
+int64_t tickCount() {
+#ifdef _WIN32
+    return static_cast<int64_t>(GetTickCount64());
+#else
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void sleepMs(unsigned milliseconds) {
+#ifdef _WIN32
+    Sleep(milliseconds);
+#else
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+#endif
+}
+
+std::string get_env_variable(const char* env_var) {
+    std::string result;
+#ifdef _WIN32
+    char* buffer = nullptr;
+    size_t size = 0;
+    errno_t err = _dupenv_s(&buffer, &size, env_var);
+    if (buffer != nullptr) {
+        result = buffer;  // Convert C-style string to std::string
+        free(buffer);     // Free the dynamically allocated memory
+    }
+#else
+    const char* buffer = getenv(env_var);
+    if (buffer != nullptr) {
+        result = buffer;
+    }
+#endif
+    else {
+        printf("%s environment variable not found.\n", env_var);
+    }
+    return result;
+}
+
+#ifdef _WIN32
+
+bool enableANSI() {
+    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (hOut == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    DWORD dwMode = 0;
+    if (!GetConsoleMode(hOut, &dwMode)) {
+        return false;
+    }
+
+    dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+    if (!SetConsoleMode(hOut, dwMode)) {
+        return false;
+    }
+    return true;
+}
+
+std::string WideCharToUTF8(const wchar_t* wideChars) {
+    if (!wideChars) return ""; // Safety check
+
+    // Calculate the required buffer size for the target multi-byte string
+    int bufferSize = WideCharToMultiByte(CP_UTF8, 0, wideChars, -1, nullptr, 0, nullptr, nullptr);
+    if (bufferSize == 0) {
+        // Handle the error, possibly with GetLastError()
+        return "";
+    }
+
+    std::string utf8String(bufferSize - 1, 0); // Allocate string with required buffer size minus null terminator
+    WideCharToMultiByte(CP_UTF8, 0, wideChars, -1, &utf8String[0], bufferSize, nullptr, nullptr);
+
+    return utf8String;
+}
+
+std::string wideToNarrow(const std::wstring& wstr) {
+    if (wstr.empty()) return std::string();
+    int sizeNeeded = WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), NULL, 0, NULL, NULL);
+    std::string strTo(sizeNeeded, 0);
+    WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), &strTo[0], sizeNeeded, NULL, NULL);
+    return strTo;
+}
+
+std::string GetVersionInfo(const std::string& info) {
+    UINT size = 0;
+    LPBYTE lpBuffer = NULL;
+    std::string result;
+
+    DWORD bufferSize = GetFileVersionInfoSizeA("FSAutoSave.exe", NULL); // 'handle' is not needed, pass NULL instead
+    if (bufferSize == 0) {
+        std::cerr << "Error in GetFileVersionInfoSize: " << GetLastError() << std::endl;
+        return {};
+    }
+
+    // Allocate the buffer
+    std::vector<char> buffer(bufferSize);
+
+    // Get the version information.
+    if (!GetFileVersionInfoA("FSAutoSave.exe", 0, bufferSize, buffer.data())) {
+        std::cerr << "Error in GetFileVersionInfo: " << GetLastError() << std::endl;
+        return {};
+    }
+
+    // Get the desired value.
+    if (!VerQueryValueA(buffer.data(), ("\\StringFileInfo\\040904b0\\" + info).c_str(), (LPVOID*)&lpBuffer, &size)) {
+        std::cerr << "Error in VerQueryValue: " << GetLastError() << std::endl;
+        return {};
+    }
+
+    // Copy the value to a string if we found something.
+    if (size > 0) {
+        result.assign((char*)lpBuffer, size - 1); // size - 1 to exclude the null-terminating character
+    }
+    return result;
+}
+
+std::string profileRead(const std::string& path, const std::string& section, const std::string& key, const char* fallback) {
+    char buffer[1024];  // Buffer to hold the value read from the INI file
+    DWORD charsRead = GetPrivateProfileStringA(section.c_str(), key.c_str(), fallback, buffer, sizeof(buffer), path.c_str());
+    return std::string(buffer, charsRead);
+}
+
+bool profileWrite(const std::string& path, const std::string& section, const char* key, const char* value) {
+    return WritePrivateProfileStringA(section.c_str(), key, value, path.c_str()) != FALSE;
+}
+
+bool runProgram(const std::wstring& commandLine) {
+    STARTUPINFO si;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    ZeroMemory(&pi, sizeof(pi));
+
+    // Start the child process.
+    if (!CreateProcess(
+        NULL,           // No module name (use command line)
+        (LPWSTR)commandLine.c_str(), // Command line
+        NULL,           // Process handle not inheritable
+        NULL,           // Thread handle not inheritable
+        FALSE,          // Set handle inheritance to FALSE
+        0,              // No creation flags
+        NULL,           // Use parent's environment block
+        NULL,           // Use parent's starting directory
+        &si,            // Pointer to STARTUPINFO structure
+        &pi)           // Pointer to PROCESS_INFORMATION structure
+        ) {
+        std::cerr << "Process failed (" << GetLastError() << ").\n";
+        return false;
+    }
+
+    // Wait until child process exits.
+    WaitForSingleObject(pi.hProcess, INFINITE);
+
+    // Close process and thread handles.
+    CloseHandle(pi.hProcess);
+    CloseHandle(pi.hThread);
+    return true;
+}
+
+bool watchDirectory(const std::string& directory, const std::function<void(const std::string&)>& changed) {
+    std::wstring wideDirectory(directory.begin(), directory.end());
+
+    HANDLE hDir = CreateFile(wideDirectory.c_str(), FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+
+    if (hDir == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to open directory for monitoring: " << GetLastError() << std::endl;
+        return false;
+    }
+
+    char buffer[1024];
+    DWORD bytesReturned;
+    while (TRUE) {
+        if (ReadDirectoryChangesW(hDir, buffer, sizeof(buffer), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE, &bytesReturned, NULL, NULL)) {
+            FILE_NOTIFY_INFORMATION* pNotify = reinterpret_cast<FILE_NOTIFY_INFORMATION*>(buffer);
+            do {
+                std::wstring changedFileName(pNotify->FileName, pNotify->FileNameLength / sizeof(WCHAR));
+                changed(wideToNarrow(changedFileName));
+
+                pNotify = pNotify->NextEntryOffset ? reinterpret_cast<FILE_NOTIFY_INFORMATION*>((BYTE*)pNotify + pNotify->NextEntryOffset) : NULL;
+            } while (pNotify != NULL);
+        }
+        else {
+            std::cerr << "Failed to read directory changes: " << GetLastError() << std::endl;
+            break; // Exit the loop on failure
+        }
+    }
+
+    CloseHandle(hDir); // Ensure the directory handle is closed properly
+    return true;
+}
+
+#else
+
+bool enableANSI() {
+    return isatty(STDOUT_FILENO) != 0;
+}
+
+// wchar_t is UTF-32 here
+static void appendUTF8(std::string& out, uint32_t c) {
+    if (c < 0x80) {
+        out += static_cast<char>(c);
+    }
+    else if (c < 0x800) {
+        out += static_cast<char>(0xC0 | (c >> 6));
+        out += static_cast<char>(0x80 | (c & 0x3F));
+    }
+    else if (c < 0x10000) {
+        out += static_cast<char>(0xE0 | (c >> 12));
+        out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (c & 0x3F));
+    }
+    else {
+        out += static_cast<char>(0xF0 | (c >> 18));
+        out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (c & 0x3F));
+    }
+}
+
+std::string WideCharToUTF8(const wchar_t* wideChars) {
+    if (!wideChars) return "";
+    return wideToNarrow(wideChars);
+}
+
+std::string wideToNarrow(const std::wstring& wstr) {
+    std::string result;
+    result.reserve(wstr.size());
+    for (wchar_t c : wstr) {
+        appendUTF8(result, static_cast<uint32_t>(c));
+    }
+    return result;
+}
+
+std::string GetVersionInfo(const std::string& /*info*/) {
+    return {}; // No version resource outside the Windows build
+}
+
+std::string profileRead(const std::string& path, const std::string& section, const std::string& key, const char* fallback) {
+    FltDocument document;
+    std::string value;
+    if (!fltLoad(path, document) || !fltFind(document, section, key, value)) {
+        return fallback;
+    }
+    return value;
+}
+
+// Same as WritePrivateProfileStringA: the file is created if needed and rewritten in place
+bool profileWrite(const std::string& path, const std::string& section, const char* key, const char* value) {
+    FltDocument document;
+    fltLoad(path, document);
+
+    FltChangeSet changes;
+    if (key == nullptr) {
+        changes[section][FLT_DELETE_SECTION_MARKER] = FLT_DELETE_MARKER;
+    }
+    else {
+        changes[section][key] = value != nullptr ? value : FLT_DELETE_MARKER;
+    }
+    std::string text = fltApply(document, changes);
+    if (text == document.text) {
+        return true; // Nothing to delete, or the value is already there
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(text.data(), static_cast<std::streamsize>(text.size()));
+    return file.good();
+}
+
+bool runProgram(const std::wstring& commandLine) {
+    int status = std::system(wideToNarrow(commandLine).c_str());
+    if (status != 0) {
+        std::cerr << "Process failed (" << status << ").\n";
+        return false;
+    }
+    return true;
+}
+
+bool watchDirectory(const std::string& directory, const std::function<void(const std::string&)>& changed) {
+    int notify = inotify_init();
+    if (notify < 0 || inotify_add_watch(notify, directory.c_str(), IN_CLOSE_WRITE) < 0) {
+        std::cerr << "Failed to open directory for monitoring: " << errno << std::endl;
+        if (notify >= 0) {
+            close(notify);
+        }
+        return false;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        ssize_t length = read(notify, buffer, sizeof(buffer));
+        if (length <= 0) {
+            std::cerr << "Failed to read directory changes: " << errno << std::endl;
+            break;
+        }
+        for (char* entry = buffer; entry < buffer + length; ) {
+            inotify_event* event = reinterpret_cast<inotify_event*>(entry);
+            if (event->len > 0) {
+                changed(event->name);
+            }
+            entry += sizeof(inotify_event) + event->len;
+        }
+    }
+
+    close(notify);
+    return true;
+}
+
+int listenLocalSocket(const std::string& path, int backlog) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    struct stat existing;
+    if (lstat(path.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            errno = EEXIST; // Not ours to remove
+            return -1;
+        }
+        // Somebody still answering there is another instance, only a socket nobody listens on is left over
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool live = probe >= 0 && connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        if (probe >= 0) {
+            close(probe);
+        }
+        if (live) {
+            errno = EADDRINUSE;
+            return -1;
+        }
+        unlink(path.c_str());
+    }
+
+    int listenSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenSocket < 0) {
+        return -1;
+    }
+    fchmod(listenSocket, 0600); // Linux creates the socket file with the mode of the socket
+    if (bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || chmod(path.c_str(), 0600) != 0 || listen(listenSocket, backlog) != 0) {
+        int error = errno;
+        close(listenSocket);
+        errno = error;
+        return -1;
+    }
+    return listenSocket;
+}
+
+int acceptLocalClient(int listenSocket) {
+    unsigned backoff = 0;
+    while (true) {
+        int client = accept4(listenSocket, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client >= 0) {
+            return client;
+        }
+        switch (errno) {
+        case EINTR:
+        case ECONNABORTED:
+        case EPROTO:
+            continue; // That client is gone, the next one may not be
+        case EMFILE:
+        case ENFILE:
+        case ENOBUFS:
+        case ENOMEM:
+            // Out of descriptors or memory until something else closes or frees them
+            backoff = backoff == 0 ? 10 : std::min(backoff * 2, 1000u);
+            sleepMs(backoff);
+            continue;
+        default:
+            return -1;
+        }
+    }
+}
+
+errno_t strncpy_s(char* destination, size_t size, const char* source, size_t count) {
+    if (destination == nullptr || size == 0) {
+        return EINVAL;
+    }
+    size_t length = strnlen(source, count == _TRUNCATE ? size - 1 : count);
+    if (length >= size) {
+        destination[0] = '\0';
+        return ERANGE;
+    }
+    memcpy(destination, source, length);
+    destination[length] = '\0';
+    return 0;
+}
+
+errno_t wcscpy_s(wchar_t* destination, size_t size, const wchar_t* source) {
+    if (destination == nullptr || source == nullptr || size == 0) {
+        return EINVAL;
+    }
+    size_t length = wcslen(source);
+    if (length >= size) {
+        destination[0] = L'\0';
+        return ERANGE;
+    }
+    wmemcpy(destination, source, length + 1);
+    return 0;
+}
+
+errno_t gmtime_s(std::tm* result, const std::time_t* time) {
+    return gmtime_r(time, result) != nullptr ? 0 : EINVAL;
+}
+
+errno_t localtime_s(std::tm* result, const std::time_t* time) {
+    return localtime_r(time, result) != nullptr ? 0 : EINVAL;
+}
+
+#endif
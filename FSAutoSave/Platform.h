@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <string>
+
+// The few things FSAutoSave needs from the operating system. Everything else (the dispatcher, the .FLT fixes, the
+// save pipeline) only talks to SimConnect and to these functions, so it also builds on Linux against the fake
+// SimConnect transport in Headless/ (see the CMake build).
+
+#ifdef _WIN32
+#define PATH_SEPARATOR "\\"
+#else
+#define PATH_SEPARATOR "/"
+#endif
+
+// Console
+bool enableANSI();
+
+// Strings and environment
+std::string WideCharToUTF8(const wchar_t* wideChars);
+std::string wideToNarrow(const std::wstring& wstr);
+std::string get_env_variable(const char* env_var);
+std::string GetVersionInfo(const std::string& info);   // From the version resource of FSAutoSave.exe
+
+// Time
+int64_t tickCount();                    // Steady clock milliseconds (GetTickCount64)
+void sleepMs(unsigned milliseconds);
+
+// INI files (.FLT, .PLN). GetPrivateProfileStringA / WritePrivateProfileStringA on Windows, FltDiff.h elsewhere.
+// profileRead returns fallback when the key (or the file) is missing. profileWrite with a null value deletes the key,
+// with a null key the whole section
+std::string profileRead(const std::string& path, const std::string& section, const std::string& key, const char* fallback = "");
+bool profileWrite(const std::string& path, const std::string& section, const char* key, const char* value);
+
+// Starts a program and waits for it to exit
+bool runProgram(const std::wstring& commandLine);
+
+// Blocks calling changed(<file name>) every time a file in directory is written. Returns false if it can not watch it
+bool watchDirectory(const std::string& directory, const std::function<void(const std::string&)>& changed);
+
+#ifndef _WIN32
+// Listening Unix domain socket at path that only this user can connect to (0600). A socket file left over from a run
+// that is gone is replaced, one another running instance still listens on is not (errno EADDRINUSE). -1 on failure
+int listenLocalSocket(const std::string& path, int backlog);
+// Next client of a listening socket. Connections that failed while being accepted are skipped, and while the process
+// is out of descriptors or memory it waits (longer every time, up to a second) and tries again. -1 (errno set) when the
+// socket can not accept any more
+int acceptLocalClient(int listenSocket);
+#endif
+
+#ifndef _WIN32
+// The secure CRT functions the Windows build uses (MSVC /sdl), with their truncating semantics
+#define _TRUNCATE ((size_t)-1)
+#define _countof(array) (sizeof(array) / sizeof((array)[0]))
+typedef int errno_t;
+errno_t strncpy_s(char* destination, size_t size, const char* source, size_t count);
+errno_t wcscpy_s(wchar_t* destination, size_t size, const wchar_t* source);
+errno_t gmtime_s(std::tm* result, const std::time_t* time);
+errno_t localtime_s(std::tm* result, const std::time_t* time);
+#endif
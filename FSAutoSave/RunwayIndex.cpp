@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "AirportIndex.h"
+#include "FacilityPlan.h"
+#include "Geodesy.h"
+#include "RunwayIndex.h"
+
+static const double PI = 3.14159265358979323846;
+static const double METERS_PER_DEGREE = 6371000 * PI / 180;
+static const int64_t CELL_COLUMNS = static_cast<int64_t>(360.0 / RUNWAY_INDEX_CELL + 0.5);
+
+struct IndexedRunway {
+    char airport[8];
+    char primary[4];            // "09", "27L"
+    char secondary[4];
+    double latitude;            // Center
+    double longitude;
+    double metersPerDegreeLongitude;
+    double sinHeading;          // Of the primary end, true
+    double cosHeading;
+    double heading;
+    double halfLength;
+    double halfWidth;
+};
+
+static std::vector<IndexedRunway> runways;
+static std::unordered_map<int64_t, std::vector<uint32_t>> cells;       // Cell key -> runways index
+static std::unordered_map<std::string, std::vector<RunwayRecord>> airports; // Also the airports without runways
+
+// Background requests
+static bool checked = false;
+static double checkedLatitude = 0;
+static double checkedLongitude = 0;
+static std::unordered_set<std::string> inRange;        // Airports of the last check
+static std::deque<std::string> wanted;
+static bool pending = false;
+static SIMCONNECT_DATA_REQUEST_ID pendingRequest = 0;
+static std::string pendingIdent;
+static std::vector<RunwayRecord> pendingRunways;
+
+static RunwayState current = { RUNWAY_NONE, "", "", 0 };
+
+static int64_t cellRow(double latitude) {
+    return static_cast<int64_t>(floor((latitude + 90.0) / RUNWAY_INDEX_CELL));
+}
+
+static int64_t cellKey(int64_t row, int64_t column) {
+    return row * CELL_COLUMNS + ((column % CELL_COLUMNS) + CELL_COLUMNS) % CELL_COLUMNS;
+}
+
+static int64_t cellColumn(double longitude) {
+    return static_cast<int64_t>(floor((longitude + 180.0) / RUNWAY_INDEX_CELL));
+}
+
+// "09", "27L", "N" ...
+static void runwayName(int number, int designator, char* name, size_t size) {
+    static const char* const directions[] = { "N", "NE", "E", "SE", "S", "SW", "W", "NW" };
+    static const char* const designators[] = { "", "L", "R", "C", "W", "A", "B" };
+    const char* letter = designator >= 0 && designator < 7 ? designators[designator] : "";
+    if (number >= 37 && number <= 44) {
+        snprintf(name, size, "%s%s", directions[number - 37], letter);
+    }
+    else {
+        snprintf(name, size, "%02d%s", number, letter);
+    }
+}
+
+// Files every runway of every airport again, airports come and go a few at a time
+static void rebuild() {
+    runways.clear();
+    cells.clear();
+    for (const auto& airport : airports) {
+        for (const RunwayRecord& record : airport.second) {
+            IndexedRunway runway = {};
+            snprintf(runway.airport, sizeof(runway.airport), "%s", airport.first.c_str());
+            runwayName(record.primaryNumber, record.primaryDesignator, runway.primary, sizeof(runway.primary));
+            runwayName(record.secondaryNumber, record.secondaryDesignator, runway.secondary, sizeof(runway.secondary));
+            runway.latitude = record.latitude;
+            runway.longitude = record.longitude;
+            runway.metersPerDegreeLongitude = METERS_PER_DEGREE * std::max(0.01, cos(record.latitude * (PI / 180)));
+            runway.heading = record.heading;
+            runway.sinHeading = sin(record.heading * (PI / 180));
+            runway.cosHeading = cos(record.heading * (PI / 180));
+            runway.halfLength = record.length / 2;
+            runway.halfWidth = record.width / 2;
+
+            uint32_t index = static_cast<uint32_t>(runways.size());
+            runways.push_back(runway);
+            double reach = hypot(runway.halfLength, runway.halfWidth);
+            double dLatitude = reach / METERS_PER_DEGREE, dLongitude = reach / runway.metersPerDegreeLongitude;
+            for (int64_t row = cellRow(record.latitude - dLatitude); row <= cellRow(record.latitude + dLatitude); ++row) {
+                for (int64_t column = cellColumn(record.longitude - dLongitude); column <= cellColumn(record.longitude + dLongitude); ++column) {
+                    cells[cellKey(row, column)].push_back(index);
+                }
+            }
+        }
+    }
+}
+
+RUNWAY_POSITION runwayIndexTest(double latitude, double longitude, double heading, bool onGround, RunwayState& state) {
+    state = { RUNWAY_NONE, "", "", 0 };
+    if (!onGround) {
+        return RUNWAY_NONE;
+    }
+    auto cell = cells.find(cellKey(cellRow(latitude), cellColumn(longitude)));
+    if (cell == cells.end()) {
+        return RUNWAY_NONE;
+    }
+
+    for (uint32_t index : cell->second) {
+        const IndexedRunway& runway = runways[index];
+        // Meters east and north of the center, then along the primary heading and across it
+        double x = (fmod(longitude - runway.longitude + 540.0, 360.0) - 180.0) * runway.metersPerDegreeLongitude;
+        double z = (latitude - runway.latitude) * METERS_PER_DEGREE;
+        double along = x * runway.sinHeading + z * runway.cosHeading;
+        double across = x * runway.cosHeading - z * runway.sinHeading;
+        if (fabs(along) > runway.halfLength || fabs(across) > runway.halfWidth) {
+            continue;
+        }
+
+        snprintf(state.airport, sizeof(state.airport), "%s", runway.airport);
+        double turn = fabs(fmod(heading - runway.heading + 540.0, 360.0) - 180.0);
+        if (turn <= RUNWAY_INDEX_ALIGNED) {
+            state.position = RUNWAY_LINED_UP;
+            snprintf(state.runway, sizeof(state.runway), "%s", runway.primary);
+            state.remaining = runway.halfLength - along;
+        }
+        else if (turn >= 180.0 - RUNWAY_INDEX_ALIGNED) {
+            state.position = RUNWAY_LINED_UP;
+            snprintf(state.runway, sizeof(state.runway), "%s", runway.secondary);
+            state.remaining = runway.halfLength + along;
+        }
+        else {
+            state.position = RUNWAY_ON;
+            snprintf(state.runway, sizeof(state.runway), "%s/%s", runway.primary, runway.secondary);
+        }
+        // Lined up on one of crossing runways wins over standing across the other
+        if (state.position == RUNWAY_LINED_UP) {
+            break;
+        }
+    }
+    return state.position;
+}
+
+static void requestNext(HANDLE hSimConnect, SIMCONNECT_DATA_REQUEST_ID request) {
+    while (!pending && !wanted.empty()) {
+        std::string ident = wanted.front();
+        wanted.pop_front();
+        if (airports.find(ident) != airports.end()) {
+            continue;
+        }
+        if (!facilityPlanRequest(hSimConnect, ident.c_str(), FACILITY_NEED_RUNWAYS, request)) {
+            printf("[RUNWAY] Could not request the runways of %s\n", ident.c_str());
+            continue;
+        }
+        pending = true;
+        pendingRequest = request;
+        pendingIdent = ident;
+        pendingRunways.clear();
+    }
+}
+
+// The airports in range, asked for once
+static void requestNearby(HANDLE hSimConnect, SIMCONNECT_DATA_REQUEST_ID request, double latitude, double longitude) {
+    if (checked && calculateDistanceAndBearing(checkedLatitude, checkedLongitude, latitude, longitude).distance < RUNWAY_INDEX_RANGE / 2) {
+        return;
+    }
+    std::vector<AirportIndexEntry> nearby;
+    airportIndexWithin(latitude, longitude, RUNWAY_INDEX_RANGE, nearby);
+    if (nearby.empty() && airportIndexSize() == 0) {
+        return; // Checked again once the facilities subscription sent airports
+    }
+    checked = true;
+    checkedLatitude = latitude;
+    checkedLongitude = longitude;
+
+    inRange.clear();
+    wanted.clear();
+    for (const AirportIndexEntry& airport : nearby) {
+        inRange.insert(airport.ident);
+        if (airports.find(airport.ident) == airports.end() && !(pending && pendingIdent == airport.ident)) {
+            wanted.push_back(airport.ident);
+        }
+    }
+
+    // Too many: the airports we left behind go
+    if (airports.size() + wanted.size() > RUNWAY_INDEX_AIRPORTS) {
+        for (auto it = airports.begin(); it != airports.end();) {
+            it = inRange.count(it->first) ? std::next(it) : airports.erase(it);
+        }
+        rebuild();
+    }
+    requestNext(hSimConnect, request);
+}
+
+RUNWAY_POSITION runwayIndexSample(HANDLE hSimConnect, SIMCONNECT_DATA_REQUEST_ID request, double latitude, double longitude, double heading, bool onGround) {
+    requestNearby(hSimConnect, request, latitude, longitude);
+
+    RunwayState state;
+    runwayIndexTest(latitude, longitude, heading, onGround, state);
+    if (state.position != current.position || strcmp(state.runway, current.runway) != 0) {
+        if (state.position == RUNWAY_LINED_UP) {
+            printf("[RUNWAY] Lined up on %s at %s, %.0f meters ahead\n", state.runway, state.airport, state.remaining);
+        }
+        else if (state.position == RUNWAY_ON) {
+            printf("[RUNWAY] On runway %s at %s\n", state.runway, state.airport);
+        }
+        else {
+            printf("[RUNWAY] Left runway %s at %s\n", current.runway, current.airport);
+        }
+    }
+    current = state;
+    return state.position;
+}
+
+const RunwayState& runwayIndexCurrent() {
+    return current;
+}
+
+void runwayIndexStore(const char* ident, const RunwayRecord* records, unsigned count) {
+    airports[ident].assign(records, records + count);
+    rebuild();
+}
+
+void runwayIndexClear() {
+    airports.clear();
+    runways.clear();
+    cells.clear();
+    checked = false;
+    current = { RUNWAY_NONE, "", "", 0 };
+}
+
+size_t runwayIndexSize() {
+    return runways.size();
+}
+
+bool runwayIndexOwns(SIMCONNECT_DATA_REQUEST_ID request) {
+    return pending && request == pendingRequest;
+}
+
+void runwayIndexRunway(const RunwayRecord& runway) {
+    pendingRunways.push_back(runway);
+}
+
+bool runwayIndexFinished(HANDLE hSimConnect, SIMCONNECT_DATA_REQUEST_ID request, unsigned answered) {
+    if (!runwayIndexOwns(request)) {
+        return false;
+    }
+    pending = false;
+    if (answered & FACILITY_NEED_RUNWAYS) {
+        runwayIndexStore(pendingIdent.c_str(), pendingRunways.data(), static_cast<unsigned>(pendingRunways.size()));
+        printf("[RUNWAY] %s: %zu runways\n", pendingIdent.c_str(), pendingRunways.size());
+    }
+    pendingRunways.clear();
+    requestNext(hSimConnect, request);
+    return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "SimConnect.h"
+
+// Runways of the airports around the aircraft, so every position sample tells whether the aircraft is on a runway and
+// lined up with it ("lined up on 27L", not "parked") without a SimConnect request per sample. The samples are the
+// REQUEST_RUNWAY_SAMPLE ones, sent every sim frame the aircraft moved, whether autosave and prefetch are on or not.
+//
+// The RUNWAY items of the airports within RUNWAY_INDEX_RANGE (airport index) are asked for in the background
+// (FACILITY_NEED_RUNWAYS, a couple of messages per airport, one airport at a time), again once the aircraft moved half
+// that distance. Every runway is an oriented rectangle: center, true heading of the primary end, half length and half
+// width, with the sine and cosine of the heading kept. The rectangles are filed in a uniform grid of
+// RUNWAY_INDEX_CELL degree cells (every cell their bounds touch), so a sample is one hash lookup and a couple of
+// rotations. Only RUNWAY_INDEX_AIRPORTS airports are kept, the ones out of range go first.
+//
+// All functions are called from the SimConnect thread.
+
+#define RUNWAY_INDEX_RANGE 10000.0      // Meters
+#define RUNWAY_INDEX_CELL 0.05          // Degrees
+#define RUNWAY_INDEX_AIRPORTS 64
+#define RUNWAY_INDEX_ALIGNED 15.0       // Degrees between the aircraft and the runway heading to be lined up
+
+// RUNWAY items as looked up from MSFS (sRunways)
+struct RunwayRecord {
+    double latitude;            // Center
+    double longitude;
+    float heading;              // True, of the primary end
+    float length;               // Meters
+    float width;
+    int primaryNumber;          // 1-36, 37-44 for N, NE, ... NW
+    int primaryDesignator;      // 0 NONE, 1 LEFT, 2 RIGHT, 3 CENTER, 4 WATER, 5 A, 6 B
+    int secondaryNumber;
+    int secondaryDesignator;
+};
+
+enum RUNWAY_POSITION {
+    RUNWAY_NONE,                // Not on a runway (or in the air)
+    RUNWAY_ON,                  // On a runway, crossing it or turning
+    RUNWAY_LINED_UP,            // On a runway, pointing along it
+};
+
+struct RunwayState {
+    RUNWAY_POSITION position;
+    char airport[8];            // ICAO
+    char runway[8];             // The end the aircraft points at when lined up ("27L"), both otherwise ("09/27")
+    double remaining;           // Meters of runway ahead when lined up
+};
+
+// Where the aircraft is (heading true, degrees). Tests the runways only, asks nothing
+RUNWAY_POSITION runwayIndexTest(double latitude, double longitude, double heading, bool onGround, RunwayState& state);
+// Position sample: the test, reported when it changes, and the background requests for the runways around
+RUNWAY_POSITION runwayIndexSample(HANDLE hSimConnect, SIMCONNECT_DATA_REQUEST_ID request, double latitude, double longitude, double heading, bool onGround);
+const RunwayState& runwayIndexCurrent();
+
+// Adds (or replaces) the runways of an airport
+void runwayIndexStore(const char* ident, const RunwayRecord* runways, unsigned count);
+void runwayIndexClear();
+size_t runwayIndexSize();
+
+// Answers, from the dispatcher
+bool runwayIndexOwns(SIMCONNECT_DATA_REQUEST_ID request);
+void runwayIndexRunway(const RunwayRecord& runway);
+// FACILITY_DATA_END: stores the runways (answered: facilityPlanFinished) and asks for the next airport. False when the
+// request is not ours
+bool runwayIndexFinished(HANDLE hSimConnect, SIMCONNECT_DATA_REQUEST_ID request, unsigned answered);
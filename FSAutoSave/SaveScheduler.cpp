@@ -0,0 +1,77 @@
+#include <cstdio>
+#include "SaveScheduler.h"
+#include "Metrics.h"
+
+static bool pending = false;        // Background run waiting for the window to close
+static int64_t pendingDue = 0;
+static bool followUp = false;       // Priority run queued behind the one in flight
+static bool inFlight = false;
+static bool inFlightBackground = false;
+static int64_t inFlightSince = 0;
+
+static void startRun(bool background, int64_t now) {
+    inFlight = true;
+    inFlightBackground = background;
+    inFlightSince = now;
+}
+
+static void expireStaleRun(int64_t now) {
+    if (inFlight && now - inFlightSince > SAVE_INFLIGHT_TIMEOUT) {
+        printf("\n[SAVE] Previous save did not complete, no longer waiting for it\n");
+        inFlight = false;
+    }
+}
+
+SAVE_DECISION saveSchedulerRequest(SAVE_KIND kind, int64_t now) {
+    expireStaleRun(now);
+
+    if (inFlight) {
+        // An autosave can not stand in for an exit or user save
+        bool needsOwnRun = kind == SAVE_KIND_USER || (kind == SAVE_KIND_EXIT && inFlightBackground);
+        if (needsOwnRun && !followUp) {
+            followUp = true;
+            return SAVE_DEFERRED;
+        }
+        metricsCountAvoidedSave();
+        return SAVE_ABSORBED;
+    }
+
+    if (pending) {
+        metricsCountAvoidedSave(); // Either this request or the waiting one
+        if (kind == SAVE_KIND_BACKGROUND) {
+            return SAVE_ABSORBED;
+        }
+        pending = false; // Preempted: run now instead of waiting for the window
+    }
+    else if (kind == SAVE_KIND_BACKGROUND) {
+        pending = true;
+        pendingDue = now + SAVE_COALESCE_WINDOW;
+        return SAVE_DEFERRED;
+    }
+
+    startRun(kind == SAVE_KIND_BACKGROUND, now);
+    return SAVE_RUN_NOW;
+}
+
+bool saveSchedulerPoll(int64_t now) {
+    expireStaleRun(now);
+    if (inFlight) {
+        return false;
+    }
+
+    if (followUp || (pending && now >= pendingDue)) {
+        startRun(!followUp, now);
+        followUp = false;
+        pending = false;
+        return true;
+    }
+    return false;
+}
+
+void saveSchedulerCompleted() {
+    inFlight = false;
+}
+
+bool saveSchedulerBusy() {
+    return pending || followUp || inFlight;
+}
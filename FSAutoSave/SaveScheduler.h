@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+// Merges save requests into as few finalSave() runs as possible. One exit can send EVENT_SITUATION_SAVE from the
+// pause (98), from ESC (0) and from the hotkey (55), and each run is a FlightSave, a wait for the file, a gate lookup
+// and a full finalFLTchange.
+//
+// - Exit requests (ESC, pause) run right away. Once a run is in flight they are absorbed by it, unless it is an
+//   autosave: the autosave does not make the exit edits, so they get one follow up run after it.
+// - User requests (hotkey, control channel) run right away too. A run in flight gets one follow up run after it,
+//   since the user may have changed something since the run started.
+// - Background requests (autosave) wait SAVE_COALESCE_WINDOW for others to join, then run once. Any other request
+//   in that window takes their place.
+//
+// Times are steady clock milliseconds supplied by the caller. All functions are called from the SimConnect thread.
+
+#define SAVE_COALESCE_WINDOW 500        // ms a background request waits for others to join
+#define SAVE_INFLIGHT_TIMEOUT 30000     // ms after which a run that never completed is forgotten (e.g. no airport found)
+
+enum SAVE_KIND {
+    SAVE_KIND_EXIT,         // ESC, pause
+    SAVE_KIND_USER,         // Hotkey, control channel
+    SAVE_KIND_BACKGROUND,   // Autosave
+};
+
+enum SAVE_DECISION {
+    SAVE_RUN_NOW,       // Run the save now
+    SAVE_DEFERRED,      // saveSchedulerPoll() will return true when it is due
+    SAVE_ABSORBED,      // Served by a run that is waiting or in flight
+};
+
+SAVE_DECISION saveSchedulerRequest(SAVE_KIND kind, int64_t now);
+bool saveSchedulerPoll(int64_t now);    // True when a deferred run is due, it is then in flight
+void saveSchedulerCompleted();          // The run in flight is done (or will never complete)
+bool saveSchedulerBusy();               // A run is waiting or in flight
@@ -0,0 +1,170 @@
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include "Snapshots.h"
+#include "Compression.h"
+#include "Hash.h"
+
+namespace fs = std::filesystem;
+
+static std::deque<std::shared_ptr<const SaveBundle>> snapshotRing;
+static uint64_t snapshotNextId = 1;
+static std::unordered_map<const std::string*, uint32_t> snapshotRefs;  // Bundles holding each content
+static uint64_t snapshotTotal = 0;  // Unique content, compressed
+
+static bool readWholeFile(const fs::path& path, std::string& contents) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+// Contents we already hold for this file name, so unchanged files cost nothing
+static std::shared_ptr<const std::string> findShared(const std::string& name, uint64_t hash, size_t size) {
+    for (auto it = snapshotRing.rbegin(); it != snapshotRing.rend(); ++it) {
+        for (const SnapshotFile& file : (*it)->files) {
+            if (file.name == name && file.hash == hash && file.size == size) {
+                return file.data;
+            }
+        }
+    }
+    return nullptr;
+}
+
+static bool sameContents(const SaveBundle& a, const SaveBundle& b) {
+    if (a.flight != b.flight || a.files.size() != b.files.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.files.size(); ++i) {
+        if (a.files[i].name != b.files[i].name || a.files[i].data != b.files[i].data) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Keeps snapshotTotal up to date as bundles come and go
+static void addRefs(const SaveBundle& bundle) {
+    for (const SnapshotFile& file : bundle.files) {
+        if (snapshotRefs[file.data.get()]++ == 0) {
+            snapshotTotal += file.data->size();
+        }
+    }
+}
+
+static void releaseRefs(const SaveBundle& bundle) {
+    for (const SnapshotFile& file : bundle.files) {
+        auto ref = snapshotRefs.find(file.data.get());
+        if (--ref->second == 0) {
+            snapshotTotal -= file.data->size();
+            snapshotRefs.erase(ref);
+        }
+    }
+}
+
+uint64_t snapshotBytes() {
+    return snapshotTotal;
+}
+
+bool snapshotCapture(const std::string& directory, const std::vector<std::string>& names, const std::string& flight) {
+    auto bundle = std::make_shared<SaveBundle>();
+    bundle->takenAt = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    bundle->flight = flight;
+
+    for (const std::string& name : names) {
+        std::string contents;
+        if (!readWholeFile(fs::path(directory) / name, contents)) {
+            continue;
+        }
+        SnapshotFile file;
+        file.name = name;
+        file.hash = hash64(contents);
+        file.size = contents.size();
+        file.data = findShared(name, file.hash, contents.size());
+        if (!file.data) {
+            file.data = std::make_shared<const std::string>(fszCompress(contents));
+        }
+        bundle->files.push_back(std::move(file));
+    }
+
+    if (bundle->files.empty() || (!snapshotRing.empty() && sameContents(*snapshotRing.back(), *bundle))) {
+        return false;
+    }
+
+    bundle->id = snapshotNextId++;
+    snapshotRing.push_back(bundle);
+    addRefs(*bundle);
+    while (snapshotRing.size() > SNAPSHOT_CAPACITY || (snapshotRing.size() > 1 && snapshotTotal > SNAPSHOT_MAX_BYTES)) {
+        releaseRefs(*snapshotRing.front());
+        snapshotRing.pop_front();
+    }
+    return true;
+}
+
+std::shared_ptr<const SaveBundle> snapshotLatest() {
+    return snapshotRing.empty() ? nullptr : snapshotRing.back();
+}
+
+std::shared_ptr<const SaveBundle> snapshotOldest() {
+    return snapshotRing.empty() ? nullptr : snapshotRing.front();
+}
+
+std::shared_ptr<const SaveBundle> snapshotAt(int64_t unixMs) {
+    for (auto it = snapshotRing.rbegin(); it != snapshotRing.rend(); ++it) {
+        if ((*it)->takenAt <= unixMs) {
+            return *it;
+        }
+    }
+    return nullptr;
+}
+
+bool snapshotRestore(const SaveBundle& bundle, const std::string& directory) {
+    bool ok = true;
+    for (const SnapshotFile& file : bundle.files) {
+        fs::path target = fs::path(directory) / file.name;
+        fs::path temp = fs::path(directory) / (file.name + SNAPSHOT_TEMP_SUFFIX);
+
+        std::string contents;
+        if (!snapshotContents(file, contents)) {
+            printf("[SNAPSHOT] %s of snapshot %llu is damaged, not restored\n", file.name.c_str(), (unsigned long long)bundle.id);
+            ok = false;
+            continue;
+        }
+
+        {
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+            out.flush();
+            if (!out) {
+                printf("[SNAPSHOT] Could not write %s\n", temp.string().c_str());
+                ok = false;
+                continue;
+            }
+        }
+
+        std::error_code ec;
+        fs::rename(temp, target, ec); // Replaces the target in one step
+        if (ec) {
+            printf("[SNAPSHOT] Could not replace %s (%s)\n", target.string().c_str(), ec.message().c_str());
+            fs::remove(temp, ec);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool snapshotContents(const SnapshotFile& file, std::string& contents) {
+    return fszDecompress(*file.data, contents) && contents.size() == file.size && hash64(contents) == file.hash;
+}
+
+size_t snapshotCount() {
+    return snapshotRing.size();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// In memory ring of the last committed saves (LAST.FLT, .PLN, .WX, .SPB as they were right after finalFLTchange), so a
+// crash reload or a rewind is served from a save we know is complete instead of whatever is on disk at that moment.
+// File contents are shared between bundles when they did not change (usually .WX and .SPB), and a save identical to the
+// previous one is not stored again. Contents are held FSZ compressed (see Compression.h), so the byte limit covers
+// several times more saves.
+
+#define SNAPSHOT_CAPACITY 32                            // Bundles kept
+#define SNAPSHOT_MAX_BYTES (64ull * 1024 * 1024)        // Oldest bundles are dropped beyond this (unique content)
+#define SNAPSHOT_TEMP_SUFFIX ".fsautosave.tmp"
+
+struct SnapshotFile {
+    std::string name;                           // e.g. LAST.FLT
+    uint64_t hash;                              // hash64 of the contents
+    uint64_t size;                              // Of the contents, uncompressed
+    std::shared_ptr<const std::string> data;    // FSZ stream, shared with other bundles holding the same contents
+};
+
+struct SaveBundle {
+    uint64_t id;            // Increments with every stored bundle
+    int64_t takenAt;        // Unix time in milliseconds
+    std::string flight;     // Flight the files belong to
+    std::vector<SnapshotFile> files;
+};
+
+// Reads the files from directory (missing ones are skipped). Returns false if nothing new was stored
+bool snapshotCapture(const std::string& directory, const std::vector<std::string>& names, const std::string& flight);
+
+std::shared_ptr<const SaveBundle> snapshotLatest();
+// Newest bundle taken at or before unixMs, nullptr when they are all newer (the ring does not reach back that far)
+std::shared_ptr<const SaveBundle> snapshotAt(int64_t unixMs);
+std::shared_ptr<const SaveBundle> snapshotOldest();
+
+// Writes every file of the bundle to directory. Each file goes to a temporary file first and is then renamed over the
+// original, so a reader never sees half a file
+bool snapshotRestore(const SaveBundle& bundle, const std::string& directory);
+// Uncompressed contents of a file. False if the stream is damaged
+bool snapshotContents(const SnapshotFile& file, std::string& contents);
+
+size_t snapshotCount();
+uint64_t snapshotBytes();   // Unique content held by the ring, compressed
@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <unordered_map>
+#include "FacilityPlan.h"
+#include "TaxiGraph.h"
+
+struct TaxiGraph {
+    double latitude;
+    double longitude;
+    uint32_t pointCount;
+    std::vector<float> x;           // Nodes: taxi points, then parkings
+    std::vector<float> z;
+    std::vector<uint32_t> first;    // First edge of every node, one past the last edge at the end
+    std::vector<uint32_t> target;
+    std::vector<float> length;
+    uint64_t lastUsed;
+};
+
+static std::unordered_map<std::string, TaxiGraph> graphs;
+static uint64_t useCounter = 0;
+
+// Search state, sized to the largest graph and reused: a node is only valid for the search that stamped it
+struct SearchNode {
+    float cost;                     // From the start node
+    uint32_t parent;
+    uint32_t stamp;
+    bool closed;
+};
+static std::vector<SearchNode> searchNodes;
+static std::vector<std::pair<float, uint32_t>> openNodes;  // Estimated total cost and node, a min heap
+static uint32_t searchStamp = 0;
+
+// The fetch in flight, if any
+static bool pending = false;
+static SIMCONNECT_DATA_REQUEST_ID pendingRequest = 0;
+static TaxiGraphRecord record;
+
+static bool usable(int type) {
+    return type == TAXI_PATH_TAXI || type == TAXI_PATH_RUNWAY || type == TAXI_PATH_PARKING || type == TAXI_PATH_PATH;
+}
+
+void taxiGraphBuild(const TaxiGraphRecord& record) {
+    TaxiGraph graph;
+    graph.latitude = record.latitude;
+    graph.longitude = record.longitude;
+    graph.pointCount = static_cast<uint32_t>(record.pointX.size());
+    graph.x = record.pointX;
+    graph.z = record.pointZ;
+    graph.x.insert(graph.x.end(), record.parkingX.begin(), record.parkingX.end());
+    graph.z.insert(graph.z.end(), record.parkingZ.begin(), record.parkingZ.end());
+    uint32_t nodeCount = static_cast<uint32_t>(graph.x.size());
+
+    // Both ends of every usable path as nodes, paths to points or parkings we did not get are left out
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    edges.reserve(record.paths.size());
+    for (const TaxiGraphPath& path : record.paths) {
+        if (!usable(path.type) || path.start < 0 || path.end < 0) {
+            continue;
+        }
+        uint32_t from = static_cast<uint32_t>(path.start);
+        uint32_t to = path.type == TAXI_PATH_PARKING ? graph.pointCount + static_cast<uint32_t>(path.end) : static_cast<uint32_t>(path.end);
+        if (from < graph.pointCount && to < nodeCount && from != to) {
+            edges.push_back({ from, to });
+        }
+    }
+
+    // Count the edges of every node, turn the counts into offsets, then fill both directions in
+    graph.first.assign(nodeCount + 1, 0);
+    for (const auto& edge : edges) {
+        graph.first[edge.first + 1]++;
+        graph.first[edge.second + 1]++;
+    }
+    for (uint32_t node = 0; node < nodeCount; ++node) {
+        graph.first[node + 1] += graph.first[node];
+    }
+    graph.target.resize(graph.first[nodeCount]);
+    graph.length.resize(graph.first[nodeCount]);
+    std::vector<uint32_t> next(graph.first.begin(), graph.first.end() - 1);
+    for (const auto& edge : edges) {
+        float length = std::hypot(graph.x[edge.second] - graph.x[edge.first], graph.z[edge.second] - graph.z[edge.first]);
+        graph.target[next[edge.first]] = edge.second;
+        graph.length[next[edge.first]++] = length;
+        graph.target[next[edge.second]] = edge.first;
+        graph.length[next[edge.second]++] = length;
+    }
+    graph.lastUsed = ++useCounter;
+
+    // Room for this one: the airport used longest ago goes
+    if (graphs.find(record.ident) == graphs.end() && graphs.size() >= TAXI_GRAPH_CACHE) {
+        auto oldest = std::min_element(graphs.begin(), graphs.end(), [](const auto& a, const auto& b) { return a.second.lastUsed < b.second.lastUsed; });
+        graphs.erase(oldest);
+    }
+    printf("[TAXI] %s: %u taxi points, %zu parkings, %zu paths\n", record.ident.c_str(), graph.pointCount, record.parkingX.size(), edges.size());
+    graphs[record.ident] = std::move(graph);
+}
+
+bool taxiGraphCached(const char* ident) {
+    return graphs.find(ident) != graphs.end();
+}
+
+bool taxiGraphRoute(const char* ident, double latitude, double longitude, uint32_t parkingIndex, TaxiRoute& route) {
+    const double PI = 3.14159265358979323846;
+    const double metersPerDegree = 6371000 * PI / 180;
+    route.distance = DBL_MAX;
+    route.nodes.clear();
+
+    auto it = graphs.find(ident);
+    if (it == graphs.end()) {
+        return false;
+    }
+    TaxiGraph& graph = it->second;
+    graph.lastUsed = ++useCounter;
+    uint32_t nodeCount = static_cast<uint32_t>(graph.x.size());
+    uint32_t goal = graph.pointCount + parkingIndex;
+    if (goal >= nodeCount) {
+        return false;
+    }
+
+    // The position in the BIAS_X / BIAS_Z plane of the airport, joining the graph at the closest node with edges
+    float x = static_cast<float>((fmod(longitude - graph.longitude + 540.0, 360.0) - 180.0) * cos(graph.latitude * (PI / 180)) * metersPerDegree);
+    float z = static_cast<float>((latitude - graph.latitude) * metersPerDegree);
+    uint32_t start = nodeCount;
+    float startDistance = FLT_MAX;
+    for (uint32_t node = 0; node < nodeCount; ++node) {
+        float dx = graph.x[node] - x, dz = graph.z[node] - z;
+        float distance = dx * dx + dz * dz;
+        if (distance < startDistance && graph.first[node + 1] > graph.first[node]) {
+            startDistance = distance;
+            start = node;
+        }
+    }
+    if (start == nodeCount) {
+        return false;
+    }
+
+    if (searchNodes.size() < nodeCount) {
+        searchNodes.resize(nodeCount, { 0, 0, 0, false });
+    }
+    if (++searchStamp == 0) {
+        // Wrapped around, no stamp may look current
+        for (SearchNode& node : searchNodes) {
+            node.stamp = 0;
+        }
+        searchStamp = 1;
+    }
+    auto heuristic = [&](uint32_t node) { return std::hypot(graph.x[goal] - graph.x[node], graph.z[goal] - graph.z[node]); };
+    auto later = std::greater<std::pair<float, uint32_t>>();
+
+    openNodes.clear();
+    searchNodes[start] = { 0, start, searchStamp, false };
+    openNodes.push_back({ heuristic(start), start });
+    bool found = false;
+    while (!openNodes.empty()) {
+        std::pop_heap(openNodes.begin(), openNodes.end(), later);
+        uint32_t node = openNodes.back().second;
+        openNodes.pop_back();
+        SearchNode& current = searchNodes[node];
+        if (current.closed) {
+            continue; // Reached again on a shorter way after it was queued
+        }
+        current.closed = true;
+        if (node == goal) {
+            found = true;
+            break;
+        }
+        for (uint32_t edge = graph.first[node]; edge < graph.first[node + 1]; ++edge) {
+            uint32_t next = graph.target[edge];
+            float cost = current.cost + graph.length[edge];
+            SearchNode& neighbour = searchNodes[next];
+            if (neighbour.stamp != searchStamp) {
+                neighbour = { cost, node, searchStamp, false };
+            }
+            else if (neighbour.closed || cost >= neighbour.cost) {
+                continue;
+            }
+            else {
+                neighbour.cost = cost;
+                neighbour.parent = node;
+            }
+            openNodes.push_back({ cost + heuristic(next), next });
+            std::push_heap(openNodes.begin(), openNodes.end(), later);
+        }
+    }
+    if (!found) {
+        return false;
+    }
+
+    route.distance = std::sqrt(startDistance) + searchNodes[goal].cost;
+    for (uint32_t node = goal; ; node = searchNodes[node].parent) {
+        route.nodes.push_back(node);
+        if (node == start) {
+            break;
+        }
+    }
+    std::reverse(route.nodes.begin(), route.nodes.end());
+    return true;
+}
+
+void taxiGraphClear() {
+    graphs.clear();
+}
+
+bool taxiGraphRequest(HANDLE hSimConnect, SIMCONNECT_DATA_REQUEST_ID request, const char* ident, double latitude, double longitude) {
+    if (pending || taxiGraphCached(ident)) {
+        return false;
+    }
+    if (!facilityPlanRequest(hSimConnect, ident, FACILITY_NEED_PARKINGS | FACILITY_NEED_TAXIWAYS, request)) {
+        printf("[TAXI] Could not request the taxiways of %s\n", ident);
+        return false;
+    }
+    record = TaxiGraphRecord();
+    record.ident = ident;
+    record.latitude = latitude;
+    record.longitude = longitude;
+    pending = true;
+    pendingRequest = request;
+    return true;
+}
+
+bool taxiGraphOwns(SIMCONNECT_DATA_REQUEST_ID request) {
+    return pending && request == pendingRequest;
+}
+
+void taxiGraphParking(float biasX, float biasZ) {
+    record.parkingX.push_back(biasX);
+    record.parkingZ.push_back(biasZ);
+}
+
+void taxiGraphPoint(float biasX, float biasZ) {
+    record.pointX.push_back(biasX);
+    record.pointZ.push_back(biasZ);
+}
+
+void taxiGraphPath(const TaxiGraphPath& path) {
+    record.paths.push_back(path);
+}
+
+bool taxiGraphFinished(SIMCONNECT_DATA_REQUEST_ID request, unsigned answered) {
+    if (!taxiGraphOwns(request)) {
+        return false;
+    }
+    pending = false;
+    if (answered & FACILITY_NEED_TAXIWAYS) {
+        taxiGraphBuild(record);
+    }
+    record = TaxiGraphRecord();
+    return true;
+}
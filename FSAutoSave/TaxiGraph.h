@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "SimConnect.h"
+
+// Taxiways of the airports the aircraft was on the ground at, for the taxi distance and route from the aircraft to a
+// parking ("900 meters taxi to GATE B 12").
+//
+// The graph of an airport is built from its TAXI_POINT, TAXI_PARKING and TAXI_PATH items (FACILITY_NEED_TAXIWAYS, see
+// FacilityPlan.h), fetched in the background under its own request ID like the prefetch. Nodes are the taxi points
+// followed by the parkings, in the BIAS_X / BIAS_Z plane of the airport; every path an aircraft may use (taxi, runway,
+// parking and path types) is an edge both ways, weighted by its length. Edges are kept as a compressed sparse row
+// (first edge of every node, then the targets and lengths of all edges), so a route is an A* search over a few flat
+// arrays with the straight line to the parking as heuristic. The aircraft joins the graph at the closest node.
+//
+// Graphs are kept per ICAO, the TAXI_GRAPH_CACHE airports used last. Nothing is written to disk.
+//
+// All functions are called from the SimConnect thread.
+
+#define TAXI_GRAPH_CACHE 8          // Airports
+
+// TAXI_PATH TYPE
+enum TAXI_PATH_TYPE {
+    TAXI_PATH_NONE,
+    TAXI_PATH_TAXI,
+    TAXI_PATH_RUNWAY,
+    TAXI_PATH_PARKING,              // END is a TAXI_PARKING index, not a TAXI_POINT
+    TAXI_PATH_PATH,
+    TAXI_PATH_CLOSED,
+    TAXI_PATH_VEHICLE,
+    TAXI_PATH_ROAD,
+    TAXI_PATH_PAINTED_LINE,
+};
+
+struct TaxiGraphPath {
+    int type;                       // TAXI_PATH_TYPE
+    int start;                      // TAXI_POINT index
+    int end;                        // TAXI_POINT index, TAXI_PARKING index for TAXI_PATH_PARKING
+};
+
+// Taxiways of an airport as looked up from MSFS, BIAS_X and BIAS_Z in meters
+struct TaxiGraphRecord {
+    std::string ident;
+    double latitude = 0;            // Airport reference point
+    double longitude = 0;
+    std::vector<float> pointX;
+    std::vector<float> pointZ;
+    std::vector<float> parkingX;    // In TAXI_PARKING order, the facility database parking index
+    std::vector<float> parkingZ;
+    std::vector<TaxiGraphPath> paths;
+};
+
+struct TaxiRoute {
+    double distance;                // Meters, from the aircraft to the center of the parking
+    std::vector<uint32_t> nodes;    // Taxi point indexes from where the aircraft joins, the parking last (point count + parking index)
+};
+
+// Builds the graph of the airport and keeps it (replaces the one with the same ident)
+void taxiGraphBuild(const TaxiGraphRecord& record);
+bool taxiGraphCached(const char* ident);
+// Shortest route along the taxiways from the position to the parking, false when the airport has no graph or the
+// parking can not be reached
+bool taxiGraphRoute(const char* ident, double latitude, double longitude, uint32_t parkingIndex, TaxiRoute& route);
+void taxiGraphClear();
+
+// Background fetch of the taxiways of an airport (one at a time), built at FACILITY_DATA_END
+bool taxiGraphRequest(HANDLE hSimConnect, SIMCONNECT_DATA_REQUEST_ID request, const char* ident, double latitude, double longitude);
+// Answers, from the dispatcher
+bool taxiGraphOwns(SIMCONNECT_DATA_REQUEST_ID request);
+void taxiGraphParking(float biasX, float biasZ);
+void taxiGraphPoint(float biasX, float biasZ);
+void taxiGraphPath(const TaxiGraphPath& path);
+// FACILITY_DATA_END: builds the graph (answered: facilityPlanFinished). False when the request is not the fetch
+bool taxiGraphFinished(SIMCONNECT_DATA_REQUEST_ID request, unsigned answered);
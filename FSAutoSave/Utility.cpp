@@ -1,4 +1,11 @@
+#ifdef _WIN32
 #include <Windows.h>
+#endif
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <iomanip>
 #include <regex>
 #include <fstream>
 #include <sstream>
@@ -6,47 +13,30 @@
 #include "FSAutoSave.h"
 #include "Globals.h"
 #include "Utility.h"
+#include "FlightRecorder.h"
+#include "ControlChannel.h"
+#include "Hash.h"
+#include "LiveState.h"
+#include "History.h"
+#include "FltDiff.h"
+#include "FltRepair.h"
+#include "Catalog.h"
+#include "Snapshots.h"
+#include "Metrics.h"
+#include "Platform.h"
 
 namespace fs = std::filesystem;
 
-bool enableANSI() {
-    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-    if (hOut == INVALID_HANDLE_VALUE) {
-        return false;
-    }
-
-    DWORD dwMode = 0;
-    if (!GetConsoleMode(hOut, &dwMode)) {
-        return false;
-    }
-
-    dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
-    if (!SetConsoleMode(hOut, dwMode)) {
-        return false;
-    }
-    return true;
-}
-
-std::string WideCharToUTF8(const wchar_t* wideChars) {
-    if (!wideChars) return ""; // Safety check
-
-    // Calculate the required buffer size for the target multi-byte string
-    int bufferSize = WideCharToMultiByte(CP_UTF8, 0, wideChars, -1, nullptr, 0, nullptr, nullptr);
-    if (bufferSize == 0) {
-        // Handle the error, possibly with GetLastError()
-        return "";
-    }
-
-    std::string utf8String(bufferSize - 1, 0); // Allocate string with required buffer size minus null terminator
-    WideCharToMultiByte(CP_UTF8, 0, wideChars, -1, &utf8String[0], bufferSize, nullptr, nullptr);
-
-    return utf8String;
+// Identifies a file in the flight recorder (hash of the normalized file name, e.g. LAST.FLT)
+static uint32_t recorderFileTag(const std::string& path) {
+    return fnv1a32(NormalizePath(path));
 }
 
 void copyFile(const std::string& source, const std::string& destination) {
     std::ifstream src(source, std::ios::binary);
     std::ofstream dest(destination, std::ios::binary);
     dest << src.rdbuf();
+    recorderLog(RECORD_FILE, FILE_OP_COPY, 0, recorderFileTag(destination), dest.good());
 }
 
 void SafeCopyPath(const wchar_t* source) {
@@ -76,35 +66,7 @@ void getFP() {
         return;
     }
 
-    STARTUPINFO si;
-    PROCESS_INFORMATION pi;
-    ZeroMemory(&si, sizeof(si));
-    si.cb = sizeof(si);
-    ZeroMemory(&pi, sizeof(pi));
-
-    // Start the child process.
-    if (!CreateProcess(
-        NULL,           // No module name (use command line)
-        (LPWSTR)programPath.c_str(), // Command line
-        NULL,           // Process handle not inheritable
-        NULL,           // Thread handle not inheritable
-        FALSE,          // Set handle inheritance to FALSE
-        0,              // No creation flags
-        NULL,           // Use parent's environment block
-        NULL,           // Use parent's starting directory 
-        &si,            // Pointer to STARTUPINFO structure
-        &pi)           // Pointer to PROCESS_INFORMATION structure
-        ) {
-        std::cerr << "Process failed (" << GetLastError() << ").\n";
-        return;
-    }
-
-    // Wait until child process exits.
-    WaitForSingleObject(pi.hProcess, INFINITE);
-
-    // Close process and thread handles.
-    CloseHandle(pi.hProcess);
-    CloseHandle(pi.hThread);
+    runProgram(programPath);
 }
 
 ZuluTime getZuluTime() {
@@ -158,7 +120,9 @@ void deleteAllSavedSituations() {
             }
             else {
                 // In normal mode, actually delete the file
-                if (fs::remove(fullPath)) {
+                bool removed = fs::remove(fullPath);
+                recorderLog(RECORD_FILE, FILE_OP_DELETE, 0, recorderFileTag(fullPath.string()), removed);
+                if (removed) {
                     printf("[RESET] Successfully removed %s\n", fullPath.string().c_str());
                 }
                 else {
@@ -174,22 +138,6 @@ void deleteAllSavedSituations() {
     }
 }
 
-std::string get_env_variable(const char* env_var) {
-    char* buffer = nullptr;
-    size_t size = 0;
-    errno_t err = _dupenv_s(&buffer, &size, env_var);
-
-    std::string result;
-    if (buffer != nullptr) {
-        result = buffer;  // Convert C-style string to std::string
-        free(buffer);     // Free the dynamically allocated memory
-    }
-    else {
-        printf("%s environment variable not found.\n", env_var);
-    }
-    return result;
-}
-
 bool isMSFSDirectoryWritable(const std::string& directoryPath) {
     if (directoryPath.empty()) {
         return false;
@@ -257,8 +205,8 @@ std::string getMSFSdir() {
 	}
 
     // Set lastMOD and customFlightmod based on the installation type above
-    customFlightmod = localStatePath + "\\" + szFileName + ".FLT";
-    lastMOD         = localStatePath + "\\LAST.FLT";
+    customFlightmod = localStatePath + PATH_SEPARATOR + szFileName + ".FLT";
+    lastMOD         = localStatePath + PATH_SEPARATOR "LAST.FLT";
 
     return fspath;
 }
@@ -302,18 +250,20 @@ std::string NormalizePath(const std::string& fullPath) {
     // Identify if the path ends with "aircraft.cfg" in a case-insensitive manner.
     std::string lowerPath = fullPath;
     std::transform(lowerPath.begin(), lowerPath.end(), lowerPath.begin(), ::tolower);
-    size_t cfgPos = lowerPath.rfind("\\aircraft.cfg");
+    // (SimConnect sends Windows paths, the fake simulator of the headless build POSIX ones)
+    size_t cfgPos = lowerPath.rfind("aircraft.cfg");
+    cfgPos = cfgPos != std::string::npos && cfgPos > 0 && (lowerPath[cfgPos - 1] == '\\' || lowerPath[cfgPos - 1] == '/') ? cfgPos - 1 : std::string::npos;
 
     if (cfgPos != std::string::npos) {
         // If the path is for an aircraft, extract the directory name.
-        size_t lastSlashPosBeforeCfg = fullPath.rfind("\\", cfgPos - 1);
+        size_t lastSlashPosBeforeCfg = cfgPos > 0 ? fullPath.find_last_of("\\/", cfgPos - 1) : std::string::npos;
         if (lastSlashPosBeforeCfg != std::string::npos) {
             result = fullPath.substr(lastSlashPosBeforeCfg + 1, cfgPos - lastSlashPosBeforeCfg - 1);
         }
     }
     else {
         // Otherwise, extract the filename for flight loaded and flight plan paths.
-        size_t lastSlashPos = fullPath.rfind("\\");
+        size_t lastSlashPos = fullPath.find_last_of("\\/");
         if (lastSlashPos != std::string::npos) {
             result = fullPath.substr(lastSlashPos + 1);
         }
@@ -324,14 +274,6 @@ std::string NormalizePath(const std::string& fullPath) {
     return result;
 }
 
-std::string wideToNarrow(const std::wstring& wstr) {
-    if (wstr.empty()) return std::string();
-    int sizeNeeded = WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), NULL, 0, NULL, NULL);
-    std::string strTo(sizeNeeded, 0);
-    WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), &strTo[0], sizeNeeded, NULL, NULL);
-    return strTo;
-}
-
 void currentStatus() {
     // Function to return formatted string based on content
     auto formatOutput = [](const std::string& value) -> std::string {
@@ -387,88 +329,114 @@ void sendText(HANDLE hSimConnect, const std::string& text) {
 }
 
 std::string readConfigFile(const std::string& iniFilePath, const std::string& section, const std::string& key) {
-    char buffer[1024];  // Buffer to hold the value read from the INI file
+    std::string value = profileRead(iniFilePath, section, key); // Empty if the key is not found (or an error occurred)
+    recorderLog(RECORD_FILE, FILE_OP_READ_KEY, static_cast<uint32_t>(value.size()), recorderFileTag(iniFilePath), !value.empty());
+    return value;
+}
+
+// Tells an empty value apart from a missing key
+static bool configKeyExists(const std::string& iniFilePath, const std::string& section, const std::string& key) {
+    return profileRead(iniFilePath, section, key, "\x01") != "\x01";
+}
 
-    // Read the value
-    DWORD charsRead = GetPrivateProfileStringA(
-        section.c_str(),  // Section name
-        key.c_str(),      // Key name
-        "",               // Default value if the key is not found (return empty string)
-        buffer,           // Buffer to store the retrieved string
-        sizeof(buffer),   // Size of the buffer
-        iniFilePath.c_str()  // Path to the INI file
-    );
+// Every profileWrite call rewrites the whole file, so account for its full size
+static void countConfigFileWrite(const std::string& filePath) {
+    std::error_code ec;
+    uintmax_t size = fs::file_size(filePath, ec);
+    metricsAddFileWrite(ec ? 0 : static_cast<uint64_t>(size));
+}
 
-    if (charsRead > 0) {
-        return std::string(buffer);  // Return the value read from the file
+// DEBUG: prints the keys modifyConfigFile would touch, without touching them
+static void previewConfigChanges(const std::string& filePath, const FltChangeSet& changes) {
+    FltDocument document;
+    if (!fltLoad(filePath, document)) {
+        printf("[DEBUG] Could not read %s to preview the changes\n", filePath.c_str());
+        return;
     }
-    else {
-        return "";  // Return empty string if the key was not found or an error occurred
+    std::vector<FltChange> preview = fltPreview(document, changes);
+    if (preview.empty()) {
+        printf("[DEBUG] %s already has every value, nothing would change\n", NormalizePath(filePath).c_str());
+        return;
     }
+    printf("[DEBUG] %zu changes would be made to %s:\n%s", preview.size(), NormalizePath(filePath).c_str(), fltFormatChanges(preview).c_str());
 }
 
 std::string modifyConfigFile(const std::string& filePath, const std::map<std::string, std::map<std::string, std::string>>& inputChanges) {
 
+    uint32_t keyCount = 0;
+    for (const auto& section : inputChanges) {
+        keyCount += static_cast<uint32_t>(section.second.size());
+    }
+
     if (!DEBUG) {
         for (const auto& section : inputChanges) {
             const auto& sectionName = section.first;
 
             // Check if the entire section should be deleted
             if (section.second.size() == 1 && section.second.count(DELETE_SECTION_MARKER) && section.second.at(DELETE_SECTION_MARKER) == DELETE_MARKER) {
-                if (!WritePrivateProfileStringA(sectionName.c_str(), NULL, NULL, filePath.c_str())) {
+                if (!profileWrite(filePath, sectionName, NULL, NULL)) {
                     std::cout << "Failed to delete section: " << sectionName << std::endl;
+                    recorderLog(RECORD_FILE, FILE_OP_MODIFY, keyCount, recorderFileTag(filePath), 0);
                     return "";  // If deletion fails, return an empty string immediately
                 }
+                countConfigFileWrite(filePath);
                 continue;  // Skip further processing for this section as it has been deleted
             }
 
             // Process keys for deletion or modification if the section is not marked for complete deletion
             for (const auto& key : section.second) {
                 if (key.second == DELETE_MARKER) {
-                    if (!WritePrivateProfileStringA(sectionName.c_str(), key.first.c_str(), NULL, filePath.c_str())) {
+                    if (!configKeyExists(filePath, sectionName, key.first)) {
+                        metricsCountAvoidedWrite(); // Nothing to delete
+                        continue;
+                    }
+                    if (!profileWrite(filePath, sectionName, key.first.c_str(), NULL)) {
                         std::cout << "Failed to delete key: " << key.first << " in section: " << sectionName << std::endl;
+                        recorderLog(RECORD_FILE, FILE_OP_MODIFY, keyCount, recorderFileTag(filePath), 0);
                         return "";  // If deletion fails, return an empty string immediately
                     }
+                    countConfigFileWrite(filePath);
                 }
                 else {
+                    // Skip keys that already have the value we want (an empty value could also be a missing key, so always write those).
+                    // The read parses the file once, a write would also rewrite all of it
+                    if (!key.second.empty() && readConfigFile(filePath, sectionName, key.first) == key.second) {
+                        metricsCountAvoidedWrite();
+                        continue;
+                    }
+
                     // Write or modify the key
-                    if (!WritePrivateProfileStringA(sectionName.c_str(), key.first.c_str(), key.second.c_str(), filePath.c_str())) {
+                    if (!profileWrite(filePath, sectionName, key.first.c_str(), key.second.c_str())) {
                         std::cout << "Failed to write key: " << key.first << " in section: " << sectionName << std::endl;
+                        recorderLog(RECORD_FILE, FILE_OP_MODIFY, keyCount, recorderFileTag(filePath), 0);
                         return "";  // If writing fails, return an empty string
                     }
+                    countConfigFileWrite(filePath);
                 }
             }
         }
     }
     else {
         printf("\n[DEBUG] ********* [ %s READ OK, NO modifications were made as we are in DEBUG mode ] *********\n", filePath.c_str());
+        previewConfigChanges(filePath, inputChanges);
         return "";
     }
+    recorderLog(RECORD_FILE, FILE_OP_MODIFY, keyCount, recorderFileTag(filePath), 1);
     return filePath;  // Return the file path if all operations are successful
 }
 
 void fixLASTflight(const std::string& filePath) {
     // Removes the LocalVars section entirely 
 
-    // Regex pattern
-    std::regex pattern("PMDG 7\\d{2}-\\d{3}\\w*");
-    std::map<std::string, std::map<std::string, std::string>> fixLAST;
-
     // Check condition
-    if (std::regex_match(currentAircraft, pattern)) {
+    if (fltLocalVarsNeedReset(currentAircraft)) {
         std::string MODfile = filePath;
         if (!DEBUG) {
-            fixLAST = {
-                {"LocalVars.0", {{"!DELETE_SECTION!", "!DELETE!"}}},    // Used to DELETE entire section. 
-            };
-            std::string applyFIX = modifyConfigFile(MODfile, fixLAST);
+            std::string applyFIX = modifyConfigFile(MODfile, fltLocalVarsDelete()); // Used to DELETE entire section.
             MODfile = NormalizePath(MODfile);
             if (!applyFIX.empty()) {
                 printf("\n[FIX] Removed [LocalVars.0] section from LAST.FLT and added a new one\n");
-                fixLAST = {
-                    {"LocalVars.0", {{"FLT_File_Loaded", "2"}}},  
-                };
-                modifyConfigFile(filePath, fixLAST);
+                modifyConfigFile(filePath, fltLocalVarsReset());
             }
             else {
                 printf("\n[ERROR] ********* [ %s READ OK, BUT FAILED TO FIX BUG ] *********\n", MODfile.c_str());
@@ -496,27 +464,12 @@ void fixMSFSbug(const std::string& filePath) {
 
     ffSTATE = readConfigFile(MODfile, "FreeFlight", "FirstFlightState");
     if (!DEBUG) {
-        if (ffSTATE == "LANDING_TAXI" || ffSTATE == "LANDING_GATE" || ffSTATE == "PREFLIGHT_PUSHBACK" || ffSTATE.empty() ) {
-            std::map<std::string, std::map<std::string, std::string>> fixState;
+        if (fltStateNeedsFix(ffSTATE)) {
+            std::map<std::string, std::map<std::string, std::string>> fixState = fltStateFix(ffSTATE, firstFlightState);
 
-            if (ffSTATE == "PREFLIGHT_PUSHBACK") { // If the FirstFlightState is set to PREFLIGHT_PUSHBACK
-                fixState = {
-                    {"FreeFlight", {{"FirstFlightState", firstFlightState}} }, // Change the FirstFlightState to firstFlightState* to avoid the MSFS bug/crash
-                };
-            }
-            else if (ffSTATE == "LANDING_TAXI" || ffSTATE == "LANDING_GATE") { // If the FirstFlightState is set to LANDING_TAXI or LANDING_GATE
-                fixState = {
-                    {"Arrival", {{"!DELETE_SECTION!", "!DELETE!"}}},    // Used to DELETE entire section. 
-                    {"FreeFlight", {{"FirstFlightState", firstFlightState}} }, // Change the FirstFlightState to firstFlightState* to avoid the MSFS bug/crash
-                    {"Main", {{"OriginalFlight", ""}} },
-                };
+            if (fltStateIsLanding(ffSTATE)) {
                 fixLASTflight(MODfile); // Remove the LocalVars section entirely but only if ffSTATE is LANDING_TAXI or LANDING_GATE
             }
-            else { // If the FirstFlightState is empty
-                fixState = {
-					{"FreeFlight", {{"FirstFlightState", firstFlightState}} }, // Change the FirstFlightState to firstFlightState* to avoid the MSFS bug/crash
-				};
-			}
 
             std::string applyFIX = modifyConfigFile(MODfile, fixState);
             MODfile = NormalizePath(MODfile);
@@ -549,6 +502,9 @@ void fixMSFSbug(const std::string& filePath) {
     }
     else {
         printf("\n[DEBUG] ********* [ %s READ OK, FirstFlightState: %s - NO modifications were made as we are in DEBUG mode ] *********\n", MODfile.c_str(), ffSTATE.c_str());
+        if (fltStateNeedsFix(ffSTATE)) {
+            previewConfigChanges(MODfile, fltStateFix(ffSTATE, firstFlightState));
+        }
     }
     MODfile = NormalizePath(MODfile);
     printf("\n[ERROR] ********* [ FAILED TO READ %s ] *********\n", MODfile.c_str());
@@ -575,7 +531,8 @@ std::string formatDuration(int totalSeconds) {
     return ss.str();
 }
 
-void finalFLTchange() {
+// Autosave: LAST.FLT only, with the edits of a regular save (no exit edits, the FlightVersion is bumped at the exit)
+static void changeFLTfiles(bool autosave) {
     // This will ALSO execute on the first run of the program to set the initial state of the .FLT files or when exiting a flight, so check for MAINMENU.FLT or empty string 
     // if you want to skip any of the conditions below 
 
@@ -737,13 +694,17 @@ void finalFLTchange() {
         }},
     };
 
+    if (autosave) {
+        finalsave1["Main"].erase("FlightVersion");
+    }
+
     // Fix the MSFS bug where the FirstFlightState is set to LANDING_TAXI or LANDING_GATE in LAST.FLT
     fixMSFSbug(lastMOD);
 
     // Remove [LocalVars.0] section from LAST.FLT
     // fixLASTflight(lastMOD);
 
-    if (isBUGfixed && isFinalSave) {
+    if (isBUGfixed && isFinalSave && !autosave) {
         isBUGfixed = FALSE; // Reset the flag
         local_lastMOD = modifyConfigFile(lastMOD, finalsave);
     }
@@ -752,26 +713,39 @@ void finalFLTchange() {
     }
 
     // Fix the MSFS bug where the FirstFlightState is set to LANDING_TAXI or LANDING_GATE in CUSTOMFLIGHT.FLT
-    fixMSFSbug(customFlightmod);
-    if (isBUGfixedCustom && isFinalSave) {
-        isBUGfixedCustom = FALSE; // Reset the flag
-        local_customFlightmod = modifyConfigFile(customFlightmod, finalsave);
-    }
-    else {
-        local_customFlightmod = modifyConfigFile(customFlightmod, finalsave2);
+    if (!autosave) {
+        fixMSFSbug(customFlightmod);
+        if (isBUGfixedCustom && isFinalSave) {
+            isBUGfixedCustom = FALSE; // Reset the flag
+            local_customFlightmod = modifyConfigFile(customFlightmod, finalsave);
+        }
+        else {
+            local_customFlightmod = modifyConfigFile(customFlightmod, finalsave2);
+        }
     }
 
+    // modifyConfigFile returns an empty path when a write failed (and always in DEBUG, where nothing is written)
+    bool lastUpdated = !local_lastMOD.empty();
+    bool customUpdated = !local_customFlightmod.empty();
+
     local_lastMOD = NormalizePath(lastMOD);
-    if (!local_lastMOD.empty())
+    if (lastUpdated)
         printf("\n[FLIGHT SITUATION] ********* \033[35m [ UPDATED %s ] \033[0m *********\n", local_lastMOD.c_str());
-    else
+    else if (!DEBUG) {
         printf("\n[ERROR] ********* \033[31m [ %s UPDATE FAILED ] \033[0m *********\n", local_lastMOD.c_str());
+        dumpFlightRecorder(ANOMALY_UPDATE_FAILED, 0, recorderFileTag(lastMOD));
+    }
 
     local_customFlightmod = NormalizePath(customFlightmod);
-    if (!local_customFlightmod.empty())
+    if (autosave) {
+        // CUSTOMFLIGHT.FLT was left alone
+    }
+    else if (customUpdated)
         printf("\n[FLIGHT SITUATION] ********* \033[35m [ UPDATED %s ] \033[0m *********\n", local_customFlightmod.c_str());
-    else
+    else if (!DEBUG) {
         printf("\n[ERROR] ********* \033[31m [ %s UPDATE FAILED ] \033[0m *********\n", local_customFlightmod.c_str());
+        dumpFlightRecorder(ANOMALY_UPDATE_FAILED, 0, recorderFileTag(customFlightmod));
+    }
 
     // Reset the variables as we are done with them
     airportICAO.clear();        // Reset the airport name
@@ -781,6 +755,14 @@ void finalFLTchange() {
     parkingNumber = 0;          // Reset the parking number
 }
 
+void finalFLTchange() {
+    changeFLTfiles(false);
+}
+
+void autosaveFLTchange() {
+    changeFLTfiles(true);
+}
+
 void initialFLTchange() { // We just wrap the finalFLTchange() function here as we only need to call it once
     // We use the counter to track how many times the sim engine is running while on the menu screen
     if (currentFlight == "MAINMENU.FLT" || currentFlight == "") {
@@ -835,7 +817,7 @@ void saveAndSetZULU() {
             }
 
             // Save the situation
-            SimConnect_TransmitClientEvent(hSimConnect, 0, EVENT_SITUATION_SAVE, 99, SIMCONNECT_GROUP_PRIORITY_HIGHEST, SIMCONNECT_EVENT_FLAG_GROUPID_IS_PRIORITY);
+            SimConnect_TransmitClientEvent(hSimConnect, 0, EVENT_SITUATION_SAVE, SAVE_REQUEST_INITIAL, SIMCONNECT_GROUP_PRIORITY_HIGHEST, SIMCONNECT_EVENT_FLAG_GROUPID_IS_PRIORITY);
         }
         else {
             if (!DEBUG) {
@@ -886,58 +868,6 @@ void simStatus(bool running) {
     }
 }
 
-// Function to calculate the clock position based on current bearing and heading
-int calculateClockPosition(double bearing, double heading) {
-    // Calculate the relative angle
-    double relativeAngle = bearing - heading;
-
-    // Normalize the angle to be within the range of 0 to 360 degrees
-    relativeAngle = fmod(relativeAngle + 360.0, 360.0);
-
-    // Calculate the clock position
-    int clockPosition = static_cast<int>(round(relativeAngle / 30.0)) % 12;
-
-    // Adjust 0 o'clock to 12 o'clock
-    if (clockPosition == 0) {
-        clockPosition = 12;
-    }
-
-    return clockPosition;
-}
-
-double metersToFeet(double meters) {
-    const double metersToFeetConversionFactor = 3.28084;
-    return meters * metersToFeetConversionFactor;
-}
-
-DistanceAndBearing calculateDistanceAndBearing(double lat1, double lon1, double lat2, double lon2) {
-    const double R = 6371000; // Earth's radius in meters
-    const double PI = 3.14159265358979323846;
-
-    double latRad1 = lat1 * (PI / 180);
-    double latRad2 = lat2 * (PI / 180);
-    double deltaLat = (lat2 - lat1) * (PI / 180);
-    double deltaLon = (lon2 - lon1) * (PI / 180);
-
-    // Calculate the distance
-    double a = sin(deltaLat / 2) * sin(deltaLat / 2) +
-        cos(latRad1) * cos(latRad2) * sin(deltaLon / 2) * sin(deltaLon / 2);
-    double c = 2 * atan2(sqrt(a), sqrt(1 - a));
-    double distance = R * c; // Distance in meters
-
-    // Calculate the bearing
-    double y = sin(deltaLon) * cos(latRad2);
-    double x = cos(latRad1) * sin(latRad2) - sin(latRad1) * cos(latRad2) * cos(deltaLon);
-    double bearingRadians = atan2(y, x);
-    double bearingDegrees = fmod((bearingRadians * 180 / PI + 360), 360); // Convert to degrees and normalize
-
-    // Return both distance and bearing
-    DistanceAndBearing result;
-    result.distance = distance;
-    result.bearing = bearingDegrees;
-    return result;
-}
-
 void handleGroundOperations(const char* airportIdent) {
     hr = SimConnect_RequestJetwayData(hSimConnect, airportIdent, 0, nullptr);
     if (hr != S_OK) {
@@ -1005,10 +935,12 @@ void firstSave() {
         }
         else {
             printf("An Unknown situation happened - ERROR CODE: 3\n"); // This is a random ERROR CODE just for tracking edge cases
+            dumpFlightRecorder(ANOMALY_UNKNOWN_SITUATION, 3);
         }
     }
     else { // Can't think of any other edge case
         printf("An Unknown situation happened - ERROR CODE: 4\n"); // This is a random ERROR CODE just for tracking edge cases
+        dumpFlightRecorder(ANOMALY_UNKNOWN_SITUATION, 4);
     }
 }
 
@@ -1019,6 +951,44 @@ bool hasFileUpdated(const fs::path& file_path, const fs::file_time_type& old_tim
     return current_time != old_time;
 }
 
+// SimConnect_FlightSave of LAST.FLT in progress: the gate lookup goes out once the simulator wrote it
+static bool flightSaveWaiting = false;
+static fs::file_time_type flightSaveWrittenAt;
+static int64_t flightSaveStartedAt = 0;
+
+static void requestSaveLookup() {
+    // Get the current position and the closest airport (including gate)
+    SimConnect_TransmitClientEvent(hSimConnect, 0, EVENT_CLOSEST_AIRPORT, LOOKUP_REQUEST_SAVE, SIMCONNECT_GROUP_PRIORITY_HIGHEST, SIMCONNECT_EVENT_FLAG_GROUPID_IS_PRIORITY);
+}
+
+static void startFlightSave() {
+    std::error_code ec;
+    flightSaveWrittenAt = fs::last_write_time(currentFlightPath, ec);
+    SimConnect_FlightSave(hSimConnect, "LAST.FLT", "My previous flight", "FSAutoSave Generated File", 0);
+    printf("\nWaiting SAVE to complete... ");
+    flightSaveWaiting = true;
+    flightSaveStartedAt = tickCount();
+}
+
+bool flightSavePoll(int64_t now) {
+    if (!flightSaveWaiting) {
+        return true;
+    }
+    if (hasFileUpdated(currentFlightPath, flightSaveWrittenAt)) {
+        flightSaveWaiting = false;
+        printf("Done! SAVE completed\n");
+        requestSaveLookup();
+        return true;
+    }
+    if (now - flightSaveStartedAt > SAVE_WRITE_TIMEOUT) {
+        flightSaveWaiting = false;
+        printf("\n[ERROR] ********* \033[31m [ LAST.FLT WAS NOT WRITTEN WITHIN %d SECONDS, SAVE ABANDONED ] \033[0m *********\n", SAVE_WRITE_TIMEOUT / 1000);
+        dumpFlightRecorder(ANOMALY_SAVE_TIMEOUT, SAVE_WRITE_TIMEOUT);
+        return false;
+    }
+    return true;
+}
+
 void finalSave() {
     // printf("\n[NOTICE] Saving... (check confirmation below)\n");
     isFinalSave = TRUE;
@@ -1028,24 +998,28 @@ void finalSave() {
     if (!DEBUG) {
 
         if (currentFlight == "LAST.FLT") {
-            auto last_modified = fs::last_write_time(currentFlightPath);
-            SimConnect_FlightSave(hSimConnect, "LAST.FLT", "My previous flight", "FSAutoSave Generated File", 0);
-            printf("\nWaiting SAVE to complete... ");
-            while (true) {
-                Sleep(100); // Check every 100 milliseconds
-                if (hasFileUpdated(currentFlightPath, last_modified)) {
-                    printf("Done! SAVE completed\n");
-                    break; // File has been updated
-                }
-            }
+            startFlightSave(); // flightSavePoll() sends the gate lookup
+        }
+        else {
+            requestSaveLookup();
         }
 
-        // Get the current position and the closest airport (including gate)
-        SimConnect_TransmitClientEvent(hSimConnect, 0, EVENT_CLOSEST_AIRPORT, 666, SIMCONNECT_GROUP_PRIORITY_HIGHEST, SIMCONNECT_EVENT_FLAG_GROUPID_IS_PRIORITY);
+    }
+    else {
+        printf("\n[DEBUG] Will skip saving as we are in DEBUG mode\n");
+        metricsSaveAborted();
+        controlComplete(CONTROL_SAVE, false, "DEBUG mode");
+    }
+}
 
+void autoSave() {
+    // The flight goes on: the save flags stay as they are and the lookup ends in autosaveFLTchange()
+    if (!DEBUG) {
+        startFlightSave();
     }
     else {
         printf("\n[DEBUG] Will skip saving as we are in DEBUG mode\n");
+        metricsSaveAborted();
     }
 }
 
@@ -1053,7 +1027,7 @@ void fixCustomFlight() {
 
     // If user loads a CustomFlight.FLT we assume he/she wants to start a flight from the GATE
     std::string narrowFile = "CustomFlight.FLT";
-    std::string customFlightfile = pathToMonitor + "\\" + narrowFile;
+    std::string customFlightfile = pathToMonitor + PATH_SEPARATOR + narrowFile;
 
     // Read the current setting from the file so we can set the one that corresponds to the actual state
     std::string gateSTATE = readConfigFile(customFlightfile, "FreeFlight", "FirstFlightState");
@@ -1099,48 +1073,17 @@ void fixCustomFlight() {
 }
 
 int monitorCustomFlightChanges() {
-    std::wstring widepathToMonitor(pathToMonitor.begin(), pathToMonitor.end());
-    LPCWSTR directoryPath = widepathToMonitor.c_str();
-
-    HANDLE hDir = CreateFile(directoryPath, FILE_LIST_DIRECTORY,
-        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
-        NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
-
-    if (hDir == INVALID_HANDLE_VALUE) {
-        std::cerr << "Failed to open directory for monitoring: " << GetLastError() << std::endl;
-        return 1;
-    }
-
-    char buffer[1024];
-    DWORD bytesReturned;
-    while (TRUE) {
-        if (ReadDirectoryChangesW(hDir, buffer, sizeof(buffer), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE, &bytesReturned, NULL, NULL)) {
-            FILE_NOTIFY_INFORMATION* pNotify = reinterpret_cast<FILE_NOTIFY_INFORMATION*>(buffer);
-            do {
-
-                std::wstring changedFileName(pNotify->FileName, pNotify->FileNameLength / sizeof(WCHAR));
-                std::string narrowFile = wideToNarrow(changedFileName);
-
-                // We can have different logic for different files here. This one is just for CustomFlight.FLT in the MSFSPathtoMonitor
-                if (narrowFile == "CustomFlight.FLT") {
-                    // Modify CustomFlight.FLT file to fix MSFS bug
-                    fixCustomFlight();
-                }
-                else {
-					// printf("\n[INFO] File %s changed but no action taken\n", narrowFile.c_str());
-				}
-
-                pNotify = pNotify->NextEntryOffset ? reinterpret_cast<FILE_NOTIFY_INFORMATION*>((BYTE*)pNotify + pNotify->NextEntryOffset) : NULL;
-            } while (pNotify != NULL);
+    bool watched = watchDirectory(pathToMonitor, [](const std::string& narrowFile) {
+        // We can have different logic for different files here. This one is just for CustomFlight.FLT in the MSFSPathtoMonitor
+        if (narrowFile == "CustomFlight.FLT") {
+            // Modify CustomFlight.FLT file to fix MSFS bug
+            fixCustomFlight();
         }
         else {
-            std::cerr << "Failed to read directory changes: " << GetLastError() << std::endl;
-            break; // Exit the loop on failure
+            // printf("\n[INFO] File %s changed but no action taken\n", narrowFile.c_str());
         }
-    }
-
-    CloseHandle(hDir); // Ensure the directory handle is closed properly
-    return 0;
+    });
+    return watched ? 0 : 1;
 }
 
 GateInfo formatGateName(int name) {
@@ -1174,6 +1117,252 @@ GateInfo formatGateName(int name) {
     return result;
 }
 
+// Packs the state flags we track in the flight recorder (one bit per RECORDER_FLAG)
+uint32_t currentStateFlags() {
+    uint32_t flags = 0;
+    flags |= (flightInitialized ? 1u : 0u) << FLAG_FLIGHT_INITIALIZED;
+    flags |= (isFinalSave ? 1u : 0u) << FLAG_FINAL_SAVE;
+    flags |= (isFirstSave ? 1u : 0u) << FLAG_FIRST_SAVE;
+    flags |= (wasReset ? 1u : 0u) << FLAG_WAS_RESET;
+    flags |= (isOnMenuScreen ? 1u : 0u) << FLAG_ON_MENU_SCREEN;
+    flags |= (isPauseBeforeStart ? 1u : 0u) << FLAG_PAUSE_BEFORE_START;
+    flags |= (userLoadedPLN ? 1u : 0u) << FLAG_USER_LOADED_PLN;
+    flags |= (isFlightPlanActive ? 1u : 0u) << FLAG_FLIGHTPLAN_ACTIVE;
+    flags |= (aircraftCrashed ? 1u : 0u) << FLAG_AIRCRAFT_CRASHED;
+    flags |= (wasSoftPaused ? 1u : 0u) << FLAG_SOFT_PAUSED;
+    flags |= (wasFullyPaused ? 1u : 0u) << FLAG_FULLY_PAUSED;
+    flags |= (isBUGfixed ? 1u : 0u) << FLAG_BUG_FIXED;
+    flags |= (isBUGfixedCustom ? 1u : 0u) << FLAG_BUG_FIXED_CUSTOM;
+    flags |= (isSimRunning ? 1u : 0u) << FLAG_SIM_RUNNING;
+    return flags;
+}
+
+// The gate lookup clears airportICAO/parkingGate once the save is done, readers still want the last one we found
+static std::string liveAirportICAO;
+static std::string liveAirportName;
+static std::string liveGate;
+static unsigned liveGateNumber = 0;
+static double liveGateDistance = 0.0;
+
+static void copyLiveString(char* destination, size_t size, const std::string& source) {
+    size_t length = (std::min)(source.size(), size - 1);
+    memcpy(destination, source.data(), length);
+    destination[length] = '\0';
+}
+
+// Called after every dispatched message (but the runway samples), the segment is only written when something changed
+void publishLiveState() {
+    if (!airportICAO.empty()) {
+        liveAirportICAO = airportICAO;
+        liveAirportName = airportName;
+    }
+    if (!parkingGate.empty()) {
+        liveGate = parkingGate;
+        liveGateNumber = parkingNumber;
+        liveGateDistance = JetwayDistance;
+    }
+
+    LiveStateData data = {};
+    data.stateFlags = currentStateFlags();
+    data.simRunning = isSimRunning ? 1 : 0;
+    data.latitude = myLatitude;
+    data.longitude = myLongitude;
+    data.altitude = myAltitude;
+    data.heading = myHeading;
+    data.airspeed = myAirspeed;
+    data.onGround = isSimOnGround != 0.0 ? 1 : 0;
+    data.gateNumber = liveGateNumber;
+    data.gateDistance = liveGateDistance;
+    copyLiveString(data.aircraft, sizeof(data.aircraft), currentAircraft);
+    copyLiveString(data.flight, sizeof(data.flight), currentFlight);
+    copyLiveString(data.flightPlan, sizeof(data.flightPlan), currentFlightPlan);
+    copyLiveString(data.airportICAO, sizeof(data.airportICAO), liveAirportICAO);
+    copyLiveString(data.airportName, sizeof(data.airportName), liveAirportName);
+    copyLiveString(data.gate, sizeof(data.gate), liveGate);
+    liveStatePublish(data);
+}
+
+// Every file of every set in fileSets
+static std::vector<std::string> situationFiles() {
+    std::vector<std::string> names;
+    for (const auto& pair : fileSets) {
+        names.insert(names.end(), pair.second.begin(), pair.second.end());
+    }
+    return names;
+}
+
+// Lists the save in the catalog, described from the LAST.FLT we already hold in memory
+static void catalogSave(const SaveBundle& bundle, uint64_t generation) {
+    for (const SnapshotFile& file : bundle.files) {
+        std::string contents;
+        if (file.name != bundle.flight || !snapshotContents(file, contents)) {
+            continue;
+        }
+        CatalogEntry entry = {};
+        entry.generation = generation;
+        entry.takenAt = bundle.takenAt;
+        strncpy_s(entry.flight, sizeof(entry.flight), bundle.flight.c_str(), _TRUNCATE);
+        catalogDescribe(contents, entry);
+        catalogAppend(entry);
+        return;
+    }
+}
+
+// Keeps the files we just committed in memory (only LAST.FLT flights, the only ones finalSave writes)
+void captureSnapshot() {
+    if (currentFlight != "LAST.FLT" || localStatePath.empty()) {
+        return;
+    }
+    if (snapshotCapture(localStatePath, situationFiles(), currentFlight)) {
+        printf("[SNAPSHOT] Save #%llu kept in memory (%zu snapshots, %llu KB)\n", (unsigned long long)snapshotLatest()->id, snapshotCount(), (unsigned long long)(snapshotBytes() / 1024));
+
+        // Same contents go to the history on disk, only the sections that changed are written
+        uint64_t generation = historyCommit(*snapshotLatest());
+        if (generation != 0) {
+            printf("[HISTORY] Stored as generation %llu\n", (unsigned long long)generation);
+            catalogSave(*snapshotLatest(), generation);
+        }
+    }
+}
+
+bool openHistory(bool readOnly) {
+    std::string directory = localStatePath + PATH_SEPARATOR + HISTORY_DIRECTORY;
+    if (!historyOpen(directory)) {
+        return false;
+    }
+    return catalogOpen(directory + PATH_SEPARATOR + CATALOG_FILE, readOnly);
+}
+
+static std::string formatUnixMs(int64_t unixMs) {
+    std::time_t takenAt = static_cast<std::time_t>(unixMs / 1000);
+    std::tm local_tm = {};
+    localtime_s(&local_tm, &takenAt);
+    char when[32];
+    std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &local_tm);
+    return when;
+}
+
+// -CATALOG[:<aircraft>]
+void printCatalog(const std::string& aircraftFilter) {
+    uint64_t count = catalogCount();
+    printf("\n[CATALOG] %llu saves listed in %s" PATH_SEPARATOR "%s" PATH_SEPARATOR "%s\n", (unsigned long long)count, localStatePath.c_str(), HISTORY_DIRECTORY, CATALOG_FILE);
+
+    // Titles are matched without case, like the .FLT keys they come from
+    std::string filter = aircraftFilter;
+    std::transform(filter.begin(), filter.end(), filter.begin(), ::tolower);
+    for (uint64_t i = 0; i < count; ++i) {
+        const CatalogEntry* entry = catalogAt(i);
+        std::string aircraft = entry->aircraft;
+        std::transform(aircraft.begin(), aircraft.end(), aircraft.begin(), ::tolower);
+        if (!filter.empty() && aircraft.find(filter) == std::string::npos) {
+            continue;
+        }
+        printf("%8llu  %s  %-40.40s %-4s %-12s %9.4f %10.4f %6.0f ft  %s  v%u\n", (unsigned long long)entry->generation, formatUnixMs(entry->takenAt).c_str(),
+            entry->aircraft, entry->departureICAO, entry->departureGate, entry->latitude, entry->longitude, entry->altitude,
+            formatDuration(static_cast<int>(entry->simTime)).c_str(), entry->flightVersion);
+    }
+    if (count != 0) {
+        printf("\nRestore one with -RESTORE:<generation>, or the last save of an aircraft with -RESUME:\"<aircraft title>\"\n");
+    }
+}
+
+// -RESUME:<aircraft title>
+bool resumeAircraft(const std::string& aircraft) {
+    const CatalogEntry* entry = catalogLatestFor(aircraft);
+    if (entry == nullptr) {
+        printf("[CATALOG] No save of %s. Use -CATALOG to see the aircraft titles\n", aircraft.c_str());
+        return false;
+    }
+    printf("[CATALOG] Last save of %s: generation %llu from %s at %s %s\n", aircraft.c_str(), (unsigned long long)entry->generation,
+        formatUnixMs(entry->takenAt).c_str(), entry->departureICAO[0] != '\0' ? entry->departureICAO : "enroute", entry->departureGate);
+    return restoreHistory(entry->generation);
+}
+
+// -HISTORY
+void printHistory() {
+    std::vector<HistoryGeneration> generations = historyList();
+    printf("\n[HISTORY] %zu saved generations in %s" PATH_SEPARATOR "%s\n", generations.size(), localStatePath.c_str(), HISTORY_DIRECTORY);
+    for (const HistoryGeneration& generation : generations) {
+        printf("%8llu  %s  %-16s %zu files, %llu KB\n", (unsigned long long)generation.id, formatUnixMs(generation.takenAt).c_str(), generation.flight.c_str(), generation.files.size(), (unsigned long long)(generation.bytes / 1024));
+    }
+    if (!generations.empty()) {
+        printf("\nRestore one with -RESTORE:<generation>\n");
+    }
+}
+
+// -RESTORE:<generation>
+bool restoreHistory(unsigned long long generation) {
+    if (!historyRestore(generation, localStatePath)) {
+        return false;
+    }
+    printf("[HISTORY] Generation %llu restored to %s. Load LAST.FLT in the world map to continue from it.\n", generation, localStatePath.c_str());
+    return true;
+}
+
+// Puts back the files of the newest snapshot at least secondsAgo old. The caller reloads the flight
+bool restoreSnapshot(int64_t secondsAgo, std::string& detail) {
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    std::shared_ptr<const SaveBundle> bundle = secondsAgo > 0 ? snapshotAt(now - secondsAgo * 1000) : snapshotLatest();
+    std::shared_ptr<const SaveBundle> oldest = snapshotOldest();
+    if (!bundle && oldest && oldest->flight == currentFlight) {
+        detail = "oldest snapshot is from " + std::to_string((now - oldest->takenAt) / 1000) + "s ago";
+        return false;
+    }
+    if (!bundle || bundle->flight != currentFlight) {
+        detail = "no snapshot of " + currentFlight;
+        return false;
+    }
+    if (!snapshotRestore(*bundle, localStatePath)) {
+        detail = "snapshot could not be written";
+        return false;
+    }
+    detail = "snapshot #" + std::to_string(bundle->id) + " from " + std::to_string((now - bundle->takenAt) / 1000) + "s ago";
+    printf("[SNAPSHOT] Restored %s\n", detail.c_str());
+    return true;
+}
+
+// -DIFF:<first.FLT> <second.FLT>
+void printFltDiff(const std::string& first, const std::string& second) {
+    FltDocument a, b;
+    if (!fltLoad(first, a)) {
+        printf("[DIFF] Could not read %s\n", first.c_str());
+        return;
+    }
+    if (!fltLoad(second, b)) {
+        printf("[DIFF] Could not read %s\n", second.c_str());
+        return;
+    }
+    std::vector<FltChange> changes = fltDiff(a, b);
+    printf("[DIFF] %s -> %s: %zu changes\n%s", first.c_str(), second.c_str(), changes.size(), fltFormatChanges(changes).c_str());
+}
+
+// Reads the segment of a running instance, the same way an overlay would
+void printLiveState() {
+    LiveStateData data;
+    if (!liveStateRead(data)) {
+        printf("[LIVESTATE] FSAutoSave is not running (or is a different version)\n");
+        return;
+    }
+    printf("[LIVESTATE] Aircraft: %s\n", data.aircraft);
+    printf("[LIVESTATE] Flight: %s - Flight plan: %s\n", data.flight, data.flightPlan);
+    printf("[LIVESTATE] Latitude: %f - Longitude: %f - Altitude: %.0f feet - Airspeed: %.0f knots - Heading: %.0f degrees - isOnGround: %u\n", data.latitude, data.longitude, data.altitude, data.airspeed, data.heading, data.onGround);
+    if (data.airportICAO[0] != '\0') {
+        printf("[LIVESTATE] Nearest airport: %s (%s) - Gate: %s %u (%.0f meters)\n", data.airportICAO, data.airportName, data.gate, data.gateNumber, data.gateDistance);
+    }
+    printf("[LIVESTATE] Sim running: %s - Flags: 0x%08X - Updated: %lld\n", data.simRunning ? "TRUE" : "FALSE", data.stateFlags, (long long)data.updatedAt);
+}
+
+// Writes the flight recorder next to the saves (or the current directory when running over the network)
+void dumpFlightRecorder(RECORDER_ANOMALY anomaly, uint32_t arg0, uint32_t arg1, uint64_t arg2) {
+    recorderTrackFlags(currentStateFlags()); // Make sure the latest flag changes are in the dump
+
+    std::string directory = localStatePath.empty() ? "." : localStatePath;
+    std::string dumpFile = recorderDump(directory, anomaly, arg0, arg1, arg2);
+    if (!dumpFile.empty()) {
+        printf("[BLACKBOX] Recent events saved to %s\n", dumpFile.c_str());
+    }
+}
+
 void waitForEnter() {
     printf("Press ENTER to exit...");
     char buffer[10];  // Larger buffer to accommodate Enter key and extra characters if needed
@@ -1194,7 +1383,7 @@ void saveDuringPause() {
     else if ((!isOnMenuScreen && !isFirstSave && isFinalSave) || !flightInitialized) { // This is the case when we are in the sim and we press ESC
 
         // Save the situation (without needing to press CTRL+ALT+S or ESC)
-        SimConnect_TransmitClientEvent(hSimConnect, 0, EVENT_SITUATION_SAVE, 98, SIMCONNECT_GROUP_PRIORITY_HIGHEST, SIMCONNECT_EVENT_FLAG_GROUPID_IS_PRIORITY);
+        SimConnect_TransmitClientEvent(hSimConnect, 0, EVENT_SITUATION_SAVE, SAVE_REQUEST_PAUSE, SIMCONNECT_GROUP_PRIORITY_HIGHEST, SIMCONNECT_EVENT_FLAG_GROUPID_IS_PRIORITY);
 
     }
     else {
@@ -1202,36 +1391,3 @@ void saveDuringPause() {
         currentStatus();
     }
 }
-
-std::string GetVersionInfo(const std::string& info) {
-    UINT size = 0;
-    LPBYTE lpBuffer = NULL;
-    std::string result;
-
-    DWORD bufferSize = GetFileVersionInfoSizeA("FSAutoSave.exe", NULL); // 'handle' is not needed, pass NULL instead
-    if (bufferSize == 0) {
-        std::cerr << "Error in GetFileVersionInfoSize: " << GetLastError() << std::endl;
-        return {};
-    }
-
-    // Allocate the buffer
-    std::vector<char> buffer(bufferSize);
-
-    // Get the version information.
-    if (!GetFileVersionInfoA("FSAutoSave.exe", 0, bufferSize, buffer.data())) {
-        std::cerr << "Error in GetFileVersionInfo: " << GetLastError() << std::endl;
-        return {};
-    }
-
-    // Get the desired value.
-    if (!VerQueryValueA(buffer.data(), ("\\StringFileInfo\\040904b0\\" + info).c_str(), (LPVOID*)&lpBuffer, &size)) {
-        std::cerr << "Error in VerQueryValue: " << GetLastError() << std::endl;
-        return {};
-    }
-
-    // Copy the value to a string if we found something.
-    if (size > 0) {
-        result.assign((char*)lpBuffer, size - 1); // size - 1 to exclude the null-terminating character
-    }
-    return result;
-}
\ No newline at end of file
@@ -1,25 +1,27 @@
 #pragma once
 
 #include <map>
+#include "FlightRecorder.h"
+#include "Platform.h"
+#include "Geodesy.h"
+
+#define SAVE_WRITE_TIMEOUT 15000    // ms the simulator gets to write LAST.FLT after SimConnect_FlightSave
 
 // Declare utility functions
-bool enableANSI();
 bool isMSFSDirectoryWritable(const std::string& directoryPath);
 
 int monitorCustomFlightChanges();
-int calculateClockPosition(double bearing, double heading);
 
 std::string formatDuration(int totalSeconds);
-std::string get_env_variable(const char* env_var);
 std::string getMSFSdir();
 std::string getCommunityPath(const std::string& user_cfg_path);
 std::string NormalizePath(const std::string& fullPath);
-std::string wideToNarrow(const std::wstring& wstr);
-std::string GetVersionInfo(const std::string& info);
-std::string WideCharToUTF8(const wchar_t* wideChars);
+std::string readConfigFile(const std::string& iniFilePath, const std::string& section, const std::string& key);
+std::string modifyConfigFile(const std::string& filePath, const std::map<std::string, std::map<std::string, std::string>>& inputChanges);
 
 bool hasFileUpdated(const fs::path& file_path, const fs::file_time_type& old_time);
 void finalFLTchange();
+void autosaveFLTchange();
 void copyFile(const std::string& source, const std::string& destination);
 void handleGroundOperations(const char* airportIdent);
 void simStatus(bool running);
@@ -35,14 +37,26 @@ void currentStatus();
 void saveAndSetZULU();
 void firstSave();
 void finalSave();
+void autoSave();            // Mid-flight save of LAST.FLT, CUSTOMFLIGHT.FLT and the exit edits are left alone
+// Waits for the simulator to write LAST.FLT after finalSave() or autoSave(), then sends the gate lookup. False when it
+// was not written within SAVE_WRITE_TIMEOUT, the save is then given up. Called from the main loop
+bool flightSavePoll(int64_t now);
 void fixCustomFlight();
 void waitForEnter();
 void saveDuringPause();
+void dumpFlightRecorder(RECORDER_ANOMALY anomaly, uint32_t arg0 = 0, uint32_t arg1 = 0, uint64_t arg2 = 0);
 
-double metersToFeet(double meters);
-
-struct DistanceAndBearing { double distance; double bearing; };
-DistanceAndBearing calculateDistanceAndBearing(double lat1, double lon1, double lat2, double lon2);
+uint32_t currentStateFlags();
+void publishLiveState();
+void printLiveState();
+void captureSnapshot();
+bool restoreSnapshot(int64_t secondsAgo, std::string& detail);
+bool openHistory(bool readOnly = false); // readOnly: -CATALOG and the other listings, nothing is committed
+void printHistory();
+bool restoreHistory(unsigned long long generation);
+void printCatalog(const std::string& aircraftFilter);
+bool resumeAircraft(const std::string& aircraft);
+void printFltDiff(const std::string& first, const std::string& second);
 
 // Time structure to represent Zulu time
 struct ZuluTime {
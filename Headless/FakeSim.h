@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+// In-process flight simulator behind the SimConnect functions of the headless build (FakeSimConnect.cpp).
+//
+// Answers come from a simulator thread, in the order they were asked for and after the configured delays, so the
+// dispatcher sees them the way it would from MSFS: FlightSave writes LAST.FLT a while later (finalSave blocks on it),
+// the closest airport lookup is an airport list, jetway data and one facility data set per request.
+//
+// The world is a few airports around the user aircraft, every one with rows of parkings, every other parking with a
+// jetway, a taxiway in front of every row, a runway south of the parkings and a few frequencies. The aircraft is parked
+// at a jetway of the airport in the middle of the list.
+
+struct FakeParking {
+    int name;                   // TAXI_PARKING NAME (12 = GATE_A ... 37 = GATE_Z)
+    int suffix;
+    unsigned number;
+    double latitude;
+    double longitude;
+    bool jetway;
+};
+
+struct FakeRunway {
+    double latitude;            // Center
+    double longitude;
+    float heading;              // True, of the primary end
+    float length;               // Meters
+    float width;
+    int primaryNumber;          // Runway number of the primary end, 9 for 09/27
+};
+
+struct FakeFrequency {
+    int type;                   // FREQUENCY TYPE: 1 ATIS, 5 GROUND, 6 TOWER, ...
+    int frequency;              // Hz
+    std::string name;
+};
+
+struct FakeTaxiPoint {
+    int type;                   // TAXI_POINT TYPE: 1 NORMAL, 2 HOLD_SHORT
+    double latitude;
+    double longitude;
+};
+
+struct FakeTaxiPath {
+    int type;                   // TAXI_PATH TYPE: 1 TAXI, 3 PARKING (END is a parking index)
+    int start;                  // Taxi point index
+    int end;
+    float width;                // Meters
+};
+
+struct FakeAirport {
+    std::string ident;
+    std::string region;
+    std::string name;
+    double latitude;
+    double longitude;
+    double altitude;
+    std::vector<FakeParking> parkings;
+    std::vector<FakeRunway> runways;
+    std::vector<FakeFrequency> frequencies;
+    std::vector<FakeTaxiPoint> taxiPoints;
+    std::vector<FakeTaxiPath> taxiPaths;
+};
+
+struct FakeSimOptions {
+    std::string directory;          // Where FlightSave writes (LocalState)
+    std::string aircraft = "Asobo Cessna 172 Skyhawk G1000";
+    unsigned saveDelayMs = 50;      // FlightSave until LAST.FLT is written
+    unsigned listDelayMs = 2;       // RequestFacilitiesList_EX1 until the airport list
+    unsigned jetwayDelayMs = 2;     // RequestJetwayData until the jetway data
+    unsigned facilityDelayMs = 2;   // RequestFacilityData until the facility data
+    unsigned replyDelayMs = 2;      // Every other answer (states, position, events)
+    unsigned airports = 8;
+    unsigned parkings = 40;         // Per airport
+    size_t fltBytes = 0;            // Size of the saves it writes (0: a short flight)
+};
+
+// What goes into a generated .FLT
+struct FakeFlight {
+    std::string aircraft;
+    std::string firstFlightState = "PREFLIGHT_GATE";
+    std::string departure;          // ICAO, empty for none
+    unsigned flightVersion = 1;
+    double simTime = 1200;          // [SimScheduler] SimTime in seconds
+    size_t bytes = 0;               // Grown with [LocalVars.0] L: variables up to this size
+};
+
+std::string fakeSimFlt(const FakeFlight& flight);
+
+// Call before SimConnect_Open (sc())
+void fakeSimStart(const FakeSimOptions& options);
+const std::vector<FakeAirport>& fakeSimAirports();
+const FakeAirport& fakeSimHomeAirport();
+const FakeParking& fakeSimParkedAt();       // Parking of the user aircraft at fakeSimHomeAirport()
+
+// Waits until FSAutoSave is connected and set up (it turned its input group on, the end of initApp)
+bool fakeSimWaitForClient(unsigned timeoutMs);
+
+// What the user does in the simulator
+void fakeSimLoadFlight(const std::string& path);     // FlightLoaded, then SimStart once the flight is running
+void fakeSimInput(const std::string& keys);          // Mapped input events, e.g. "VK_LCONTROL+VK_LMENU+s"
+void fakeSimPause(bool paused);                       // ESC: the pause menu opens (Pause_EX1 sim paused), or closes
+void fakeSimQuit();                                   // Closing MSFS, sends QUIT
+
+// Messages sent so far (benchmarks and checks)
+size_t fakeSimMessages();
+// Runs task on the SimConnect thread of FSAutoSave, at its next SimConnect_GetNextDispatch (e.g. to empty its caches)
+void fakeSimOnClientThread(const std::function<void()>& task);
@@ -0,0 +1,932 @@
+// SimConnect functions of the headless build, answered by an in-process simulator (see FakeSim.h)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "SimConnect.h"
+#include "FakeSim.h"
+
+namespace fs = std::filesystem;
+
+struct SimAction {
+    int64_t due;
+    uint64_t sequence;
+    std::function<void()> run;
+    bool operator<(const SimAction& other) const {
+        return due != other.due ? due > other.due : sequence > other.sequence; // Earliest first, FIFO when due together
+    }
+};
+
+struct DataRequest {
+    DWORD request;
+    DWORD define;
+    bool changedOnly;
+    std::vector<double> last;
+};
+
+// Everything below is guarded by simMutex. Actions run on the simulator thread with it held
+static std::mutex simMutex;
+static std::condition_variable simWake;
+static std::condition_variable clientReady;
+static std::thread simThread;
+static bool simStarted = false;
+static bool simStopping = false;
+static std::priority_queue<SimAction> actions;
+static uint64_t actionSequence = 0;
+static std::deque<std::vector<char>> messages;
+static std::vector<std::function<void()>> clientTasks;    // fakeSimOnClientThread
+static std::vector<char> dispatched;        // Message returned by the last SimConnect_GetNextDispatch
+static size_t messagesSent = 0;
+
+static FakeSimOptions simOptions;
+static std::vector<FakeAirport> world;
+static size_t homeAirport = 0;
+static size_t parkedAt = 0;
+static std::string flightPath;
+static std::string flightPlanPath;
+static unsigned savedVersion = 1;
+static bool simRunning = false;
+static double cameraState = 11;             // 11 loading, 2 cockpit, 12 world map
+static uint32_t uniqueRequest = 0;
+
+// What the client registered
+static std::map<std::string, DWORD> systemEvents;                       // "SimStart" -> client event
+static std::map<std::string, std::pair<DWORD, DWORD>> inputEvents;      // "VK_LCONTROL+VK_LMENU+s" -> event, data
+static std::set<DWORD> inputGroupsOn;
+static std::map<DWORD, DWORD> inputEventGroups;                         // client event -> input group
+static std::map<DWORD, DWORD> notifiedEvents;                           // client event -> notification group
+static std::map<DWORD, std::vector<std::string>> dataDefinitions;       // datum names, all FLOAT64
+static std::map<DWORD, std::vector<std::string>> facilityDefinitions;
+static std::vector<DataRequest> periodicRequests;
+
+static const HANDLE simHandle = reinterpret_cast<HANDLE>(static_cast<intptr_t>(0x5C));
+
+static int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void schedule(unsigned delayMs, std::function<void()> run) {
+    actions.push({ nowMs() + delayMs, actionSequence++, std::move(run) });
+    simWake.notify_one();
+}
+
+static void simLoop() {
+    std::unique_lock<std::mutex> lock(simMutex);
+    while (!(simStopping && actions.empty())) {
+        if (actions.empty()) {
+            simWake.wait(lock);
+            continue;
+        }
+        int64_t wait = actions.top().due - nowMs();
+        if (wait > 0) {
+            simWake.wait_for(lock, std::chrono::milliseconds(wait));
+            continue;
+        }
+        std::function<void()> run = actions.top().run;
+        actions.pop();
+        run();
+    }
+}
+
+template <typename T> static std::vector<char> newMessage(SIMCONNECT_RECV_ID id, size_t extra = 0) {
+    std::vector<char> buffer(sizeof(T) + extra, 0);
+    SIMCONNECT_RECV* recv = reinterpret_cast<SIMCONNECT_RECV*>(buffer.data());
+    recv->dwSize = static_cast<DWORD>(buffer.size());
+    recv->dwVersion = 6;
+    recv->dwID = id;
+    return buffer;
+}
+
+template <typename T> static T* messageAs(std::vector<char>& buffer) {
+    return reinterpret_cast<T*>(buffer.data());
+}
+
+static void send(std::vector<char> message) {
+    messages.push_back(std::move(message));
+    messagesSent++;
+}
+
+static void sendException(SIMCONNECT_EXCEPTION exception, DWORD index = 0) {
+    std::vector<char> message = newMessage<SIMCONNECT_RECV_EXCEPTION>(SIMCONNECT_RECV_ID_EXCEPTION);
+    messageAs<SIMCONNECT_RECV_EXCEPTION>(message)->dwException = exception;
+    messageAs<SIMCONNECT_RECV_EXCEPTION>(message)->dwIndex = index;
+    send(std::move(message));
+}
+
+static void sendEvent(DWORD eventID, DWORD data, DWORD group = SIMCONNECT_UNUSED) {
+    std::vector<char> message = newMessage<SIMCONNECT_RECV_EVENT>(SIMCONNECT_RECV_ID_EVENT);
+    SIMCONNECT_RECV_EVENT* evt = messageAs<SIMCONNECT_RECV_EVENT>(message);
+    evt->uGroupID = group;
+    evt->uEventID = eventID;
+    evt->dwData = data;
+    send(std::move(message));
+}
+
+static void sendSystemEvent(const char* name, DWORD data = 0) {
+    auto it = systemEvents.find(name);
+    if (it != systemEvents.end()) {
+        sendEvent(it->second, data);
+    }
+}
+
+static void sendSystemFileEvent(const char* name, const std::string& fileName) {
+    auto it = systemEvents.find(name);
+    if (it == systemEvents.end()) {
+        return;
+    }
+    std::vector<char> message = newMessage<SIMCONNECT_RECV_EVENT_FILENAME>(SIMCONNECT_RECV_ID_EVENT_FILENAME);
+    SIMCONNECT_RECV_EVENT_FILENAME* evt = messageAs<SIMCONNECT_RECV_EVENT_FILENAME>(message);
+    evt->uGroupID = SIMCONNECT_UNUSED;
+    evt->uEventID = it->second;
+    snprintf(evt->szFileName, sizeof(evt->szFileName), "%s", fileName.c_str());
+    send(std::move(message));
+}
+
+// World
+
+static std::string airportIdent(size_t index) {
+    std::string ident = "K";
+    for (int i = 0; i < 3; ++i) {
+        ident += static_cast<char>('A' + (index / static_cast<size_t>(std::pow(26, 2 - i))) % 26);
+    }
+    return ident;
+}
+
+static void buildWorld() {
+    world.clear();
+    unsigned airports = std::max(2u, simOptions.airports);
+    unsigned parkings = std::max(2u, simOptions.parkings);
+    homeAirport = airports / 2; // Anywhere but the first entry of the airport list
+    parkedAt = std::min<size_t>(5, parkings - 1) | 1; // A parking with a jetway, never index 0
+
+    const double homeLatitude = 47.4490;
+    const double homeLongitude = -122.3090;
+    unsigned side = static_cast<unsigned>(std::ceil(std::sqrt(static_cast<double>(airports))));
+    for (unsigned a = 0; a < airports; ++a) {
+        FakeAirport airport;
+        airport.ident = airportIdent(a);
+        airport.region = "K1";
+        airport.name = a == homeAirport ? "Headless International" : "Fake Field " + std::to_string(a);
+        // Grid 0.25 degrees apart, home airport at the aircraft
+        int row = static_cast<int>(a / side) - static_cast<int>(homeAirport / side);
+        int column = static_cast<int>(a % side) - static_cast<int>(homeAirport % side);
+        airport.latitude = homeLatitude + 0.25 * row;
+        airport.longitude = homeLongitude + 0.25 * column;
+        airport.altitude = 130 + 10 * (a % 7);
+
+        // Rows of ten parkings about 30 m apart, GATE_A 1 .. GATE_A 10, GATE_B 1 ..
+        for (unsigned p = 0; p < parkings; ++p) {
+            FakeParking parking;
+            parking.name = 12 + static_cast<int>((p / 10) % 26);
+            parking.suffix = 0;
+            parking.number = p % 10 + 1;
+            parking.latitude = airport.latitude + 0.0003 * (p / 10);
+            parking.longitude = airport.longitude + 0.0004 * (p % 10);
+            parking.jetway = (p % 2) == 1;
+            airport.parkings.push_back(parking);
+        }
+        // A taxiway halfway in front of every row, joined at both ends, every parking on it straight ahead. The first
+        // one leads to a holding point of the runway
+        unsigned columns = std::min(parkings, 10u);
+        unsigned rows = (parkings + 9) / 10;
+        for (unsigned r = 0; r < rows; ++r) {
+            for (unsigned c = 0; c < columns; ++c) {
+                int point = static_cast<int>(airport.taxiPoints.size());
+                airport.taxiPoints.push_back({ 1, airport.latitude + 0.0003 * r - 0.00015, airport.longitude + 0.0004 * c });
+                if (c > 0) {
+                    airport.taxiPaths.push_back({ 1, point - 1, point, 23.0f });
+                }
+                if (r > 0 && (c == 0 || c == columns - 1)) {
+                    airport.taxiPaths.push_back({ 1, point - static_cast<int>(columns), point, 23.0f });
+                }
+            }
+        }
+        for (unsigned p = 0; p < parkings; ++p) {
+            airport.taxiPaths.push_back({ 3, static_cast<int>((p / 10) * columns + p % 10), static_cast<int>(p), 15.0f });
+        }
+        airport.taxiPoints.push_back({ 2, airport.latitude - 0.0020, airport.longitude });
+        airport.taxiPaths.push_back({ 1, 0, static_cast<int>(airport.taxiPoints.size() - 1), 23.0f });
+        // 09/27 south of the parkings
+        airport.runways.push_back({ airport.latitude - 0.0025, airport.longitude + 0.002, 90.0f, 2500.0f, 45.0f, 9 });
+        airport.frequencies.push_back({ 1, 127050000, airport.name + " ATIS" });
+        airport.frequencies.push_back({ 5, 121700000, airport.name + " Ground" });
+        airport.frequencies.push_back({ 6, 118300000, airport.name + " Tower" });
+        world.push_back(std::move(airport));
+    }
+}
+
+static const FakeAirport* findAirport(const char* ident) {
+    for (const FakeAirport& airport : world) {
+        if (ident != nullptr && airport.ident == ident) {
+            return &airport;
+        }
+    }
+    return nullptr;
+}
+
+// SimVar values of the user aircraft, parked at its gate with the engines off
+static double datumValue(const std::string& name, const std::string& units) {
+    const FakeAirport& airport = world[homeAirport];
+    const FakeParking& parking = airport.parkings[parkedAt];
+    if (name == "PLANE LATITUDE") return flightPath.empty() ? 0 : parking.latitude;
+    if (name == "PLANE LONGITUDE") return flightPath.empty() ? 0 : parking.longitude;
+    if (name == "PLANE ALTITUDE") return airport.altitude;
+    if (name == "PLANE HEADING DEGREES MAGNETIC") return 90;
+    if (name == "PLANE HEADING DEGREES TRUE") return 90;
+    if (name == "SIM ON GROUND") return 1;
+    if (name == "SIMULATION RATE") return 1;
+    if (name == "CAMERA STATE") return cameraState;
+    (void)units;
+    return 0;
+}
+
+static std::vector<double> definitionValues(DWORD define) {
+    std::vector<double> values;
+    auto it = dataDefinitions.find(define);
+    if (it != dataDefinitions.end()) {
+        for (const std::string& datum : it->second) {
+            values.push_back(datumValue(datum.substr(0, datum.find('\x1f')), datum.substr(datum.find('\x1f') + 1)));
+        }
+    }
+    return values;
+}
+
+static void sendData(DWORD request, DWORD define, const std::vector<double>& values) {
+    std::vector<char> message = newMessage<SIMCONNECT_RECV_SIMOBJECT_DATA>(SIMCONNECT_RECV_ID_SIMOBJECT_DATA, values.size() * sizeof(double));
+    SIMCONNECT_RECV_SIMOBJECT_DATA* data = messageAs<SIMCONNECT_RECV_SIMOBJECT_DATA>(message);
+    data->dwRequestID = request;
+    data->dwObjectID = SIMCONNECT_OBJECT_ID_USER;
+    data->dwDefineID = define;
+    data->dwentrynumber = 1;
+    data->dwoutof = 1;
+    data->dwDefineCount = static_cast<DWORD>(values.size());
+    memcpy(&data->dwData, values.data(), values.size() * sizeof(double));
+    send(std::move(message));
+}
+
+// SIMCONNECT_PERIOD_SECOND requests (SIMCONNECT_DATA_REQUEST_FLAG_CHANGED ones only when a value changed)
+static void sendPeriodicData() {
+    for (DataRequest& request : periodicRequests) {
+        std::vector<double> values = definitionValues(request.define);
+        if (!request.changedOnly || values != request.last) {
+            sendData(request.request, request.define, values);
+            request.last = values;
+        }
+    }
+}
+
+static void periodicTick() {
+    if (simStopping) {
+        return;
+    }
+    sendPeriodicData();
+    schedule(1000, periodicTick);
+}
+
+// Facilities
+
+static bool appendText(std::string& data, const std::string& text, size_t size) {
+    std::string field(size, '\0');
+    memcpy(&field[0], text.data(), std::min(text.size(), size - 1));
+    data += field;
+    return true;
+}
+
+template <typename T> static bool appendValue(std::string& data, T value) {
+    data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    return true;
+}
+
+static bool airportField(std::string& data, const std::string& field, const FakeAirport& airport) {
+    if (field == "NAME64") return appendText(data, airport.name, 64);
+    if (field == "NAME") return appendText(data, airport.name, 32);
+    if (field == "ICAO") return appendText(data, airport.ident, 8);
+    if (field == "REGION") return appendText(data, airport.region, 8);
+    if (field == "LATITUDE") return appendValue(data, airport.latitude);
+    if (field == "LONGITUDE") return appendValue(data, airport.longitude);
+    if (field == "ALTITUDE") return appendValue(data, airport.altitude);
+    if (field == "N_TAXI_PARKING_SPACES") return appendValue(data, static_cast<int32_t>(airport.parkings.size()));
+    return false;
+}
+
+static bool parkingField(std::string& data, const std::string& field, const FakeAirport& airport, const FakeParking& parking) {
+    if (field == "NAME") return appendValue(data, static_cast<int32_t>(parking.name));
+    if (field == "SUFFIX") return appendValue(data, static_cast<int32_t>(parking.suffix));
+    if (field == "NUMBER") return appendValue(data, static_cast<uint32_t>(parking.number));
+    if (field == "TYPE") return appendValue(data, static_cast<int32_t>(parking.jetway ? 10 : 4)); // GATE_HEAVY, RAMP_GA_LARGE
+    if (field == "HEADING") return appendValue(data, 90.0f);
+    if (field == "RADIUS") return appendValue(data, 20.0f);
+    // Meters east and north of the airport reference point
+    if (field == "BIAS_X") return appendValue(data, static_cast<float>((parking.longitude - airport.longitude) * 111320.0 * std::cos(airport.latitude * M_PI / 180)));
+    if (field == "BIAS_Z") return appendValue(data, static_cast<float>((parking.latitude - airport.latitude) * 110540.0));
+    return false;
+}
+
+static bool taxiPointField(std::string& data, const std::string& field, const FakeAirport& airport, const FakeTaxiPoint& point) {
+    if (field == "TYPE") return appendValue(data, static_cast<int32_t>(point.type));
+    if (field == "ORIENTATION") return appendValue(data, static_cast<int32_t>(0)); // FORWARD
+    if (field == "BIAS_X") return appendValue(data, static_cast<float>((point.longitude - airport.longitude) * 111320.0 * std::cos(airport.latitude * M_PI / 180)));
+    if (field == "BIAS_Z") return appendValue(data, static_cast<float>((point.latitude - airport.latitude) * 110540.0));
+    return false;
+}
+
+static bool taxiPathField(std::string& data, const std::string& field, const FakeTaxiPath& path) {
+    if (field == "TYPE") return appendValue(data, static_cast<int32_t>(path.type));
+    if (field == "WIDTH") return appendValue(data, path.width);
+    if (field == "START") return appendValue(data, static_cast<int32_t>(path.start));
+    if (field == "END") return appendValue(data, static_cast<int32_t>(path.end));
+    if (field == "NAME_INDEX") return appendValue(data, static_cast<uint32_t>(0));
+    return false;
+}
+
+static bool runwayField(std::string& data, const std::string& field, const FakeAirport& airport, const FakeRunway& runway) {
+    int secondary = (runway.primaryNumber + 17) % 36 + 1;
+    if (field == "LATITUDE") return appendValue(data, runway.latitude);
+    if (field == "LONGITUDE") return appendValue(data, runway.longitude);
+    if (field == "ALTITUDE") return appendValue(data, airport.altitude);
+    if (field == "HEADING") return appendValue(data, runway.heading);
+    if (field == "LENGTH") return appendValue(data, runway.length);
+    if (field == "WIDTH") return appendValue(data, runway.width);
+    if (field == "PRIMARY_NUMBER") return appendValue(data, static_cast<int32_t>(runway.primaryNumber));
+    if (field == "PRIMARY_DESIGNATOR") return appendValue(data, static_cast<int32_t>(0)); // NONE
+    if (field == "SECONDARY_NUMBER") return appendValue(data, static_cast<int32_t>(secondary));
+    if (field == "SECONDARY_DESIGNATOR") return appendValue(data, static_cast<int32_t>(0));
+    return false;
+}
+
+static bool frequencyField(std::string& data, const std::string& field, const FakeFrequency& frequency) {
+    if (field == "TYPE") return appendValue(data, static_cast<int32_t>(frequency.type));
+    if (field == "FREQUENCY") return appendValue(data, static_cast<int32_t>(frequency.frequency));
+    if (field == "NAME") return appendText(data, frequency.name, 64);
+    return false;
+}
+
+static void sendFacilityItem(DWORD request, DWORD parent, SIMCONNECT_FACILITY_DATA_TYPE type, bool listItem, size_t index, size_t size, const std::string& data) {
+    std::vector<char> message = newMessage<SIMCONNECT_RECV_FACILITY_DATA>(SIMCONNECT_RECV_ID_FACILITY_DATA, data.size());
+    SIMCONNECT_RECV_FACILITY_DATA* item = messageAs<SIMCONNECT_RECV_FACILITY_DATA>(message);
+    item->UserRequestId = request;
+    item->UniqueRequestId = ++uniqueRequest;
+    item->ParentUniqueRequestId = parent;
+    item->Type = type;
+    item->IsListItem = listItem;
+    item->ItemIndex = static_cast<DWORD>(index);
+    item->ListSize = static_cast<DWORD>(size);
+    memcpy(&item->Data, data.data(), data.size());
+    send(std::move(message));
+}
+
+// Blocks the fake facility data has, with the items of an airport
+static const char* const facilityBlocks[] = { "TAXI_PARKING", "RUNWAY", "FREQUENCY", "TAXI_POINT", "TAXI_PATH" };
+
+static bool facilityBlock(const std::string& field, const char* prefix, std::string& block) {
+    for (const char* name : facilityBlocks) {
+        if (field == std::string(prefix) + name) {
+            block = name;
+            return true;
+        }
+    }
+    return false;
+}
+
+static SIMCONNECT_FACILITY_DATA_TYPE facilityBlockType(const std::string& block) {
+    if (block == "TAXI_PARKING") return SIMCONNECT_FACILITY_DATA_TAXI_PARKING;
+    if (block == "RUNWAY") return SIMCONNECT_FACILITY_DATA_RUNWAY;
+    if (block == "FREQUENCY") return SIMCONNECT_FACILITY_DATA_FREQUENCY;
+    if (block == "TAXI_POINT") return SIMCONNECT_FACILITY_DATA_TAXI_POINT;
+    return SIMCONNECT_FACILITY_DATA_TAXI_PATH;
+}
+
+static size_t facilityBlockSize(const FakeAirport& airport, SIMCONNECT_FACILITY_DATA_TYPE type) {
+    switch (type) {
+    case SIMCONNECT_FACILITY_DATA_TAXI_PARKING: return airport.parkings.size();
+    case SIMCONNECT_FACILITY_DATA_RUNWAY: return airport.runways.size();
+    case SIMCONNECT_FACILITY_DATA_FREQUENCY: return airport.frequencies.size();
+    case SIMCONNECT_FACILITY_DATA_TAXI_POINT: return airport.taxiPoints.size();
+    default: return airport.taxiPaths.size();
+    }
+}
+
+static bool facilityBlockField(std::string& data, const std::string& field, const FakeAirport& airport, SIMCONNECT_FACILITY_DATA_TYPE type, size_t i) {
+    switch (type) {
+    case SIMCONNECT_FACILITY_DATA_TAXI_PARKING: return parkingField(data, field, airport, airport.parkings[i]);
+    case SIMCONNECT_FACILITY_DATA_RUNWAY: return runwayField(data, field, airport, airport.runways[i]);
+    case SIMCONNECT_FACILITY_DATA_FREQUENCY: return frequencyField(data, field, airport.frequencies[i]);
+    case SIMCONNECT_FACILITY_DATA_TAXI_POINT: return taxiPointField(data, field, airport, airport.taxiPoints[i]);
+    default: return taxiPathField(data, field, airport.taxiPaths[i]);
+    }
+}
+
+// One AIRPORT item, then one item per parking, runway, frequency, taxi point or taxi path of every block of these,
+// then the end (what MSFS does for definitions made of these). Anything else in the definition is a DEFINITION_ERROR
+static void sendFacilityData(DWORD define, DWORD request, const std::string& ident) {
+    const FakeAirport* airport = findAirport(ident.c_str());
+    const std::vector<std::string>& fields = facilityDefinitions[define];
+
+    struct Block { std::string type; std::vector<std::string> fields; };
+    std::string airportData;
+    std::vector<Block> blocks;
+    bool inBlock = false;
+    bool known = true;
+    for (const std::string& field : fields) {
+        std::string block;
+        if (field == "OPEN AIRPORT" || field == "CLOSE AIRPORT") {
+            continue;
+        }
+        if (facilityBlock(field, "OPEN ", block)) {
+            blocks.push_back({ block, {} });
+            inBlock = true;
+            continue;
+        }
+        if (facilityBlock(field, "CLOSE ", block)) {
+            inBlock = false;
+            continue;
+        }
+        if (inBlock) {
+            blocks.back().fields.push_back(field);
+        }
+        else if (airport != nullptr && !airportField(airportData, field, *airport)) {
+            known = false;
+        }
+    }
+    if (!known) {
+        sendException(SIMCONNECT_EXCEPTION_DEFINITION_ERROR);
+        return;
+    }
+
+    if (airport != nullptr) {
+        sendFacilityItem(request, 0, SIMCONNECT_FACILITY_DATA_AIRPORT, false, 0, 1, airportData);
+        uint32_t parent = uniqueRequest;
+        for (const Block& block : blocks) {
+            SIMCONNECT_FACILITY_DATA_TYPE type = facilityBlockType(block.type);
+            size_t size = facilityBlockSize(*airport, type);
+            for (size_t i = 0; i < size; ++i) {
+                std::string itemData;
+                for (const std::string& field : block.fields) {
+                    if (!facilityBlockField(itemData, field, *airport, type, i)) {
+                        sendException(SIMCONNECT_EXCEPTION_DEFINITION_ERROR);
+                        return;
+                    }
+                }
+                sendFacilityItem(request, parent, type, true, i, size, itemData);
+            }
+        }
+    }
+
+    std::vector<char> end = newMessage<SIMCONNECT_RECV_FACILITY_DATA_END>(SIMCONNECT_RECV_ID_FACILITY_DATA_END);
+    messageAs<SIMCONNECT_RECV_FACILITY_DATA_END>(end)->RequestId = request;
+    send(std::move(end));
+}
+
+// Every airport in the reality bubble. The entry after the last one is left zeroed
+static void sendAirportList(DWORD request) {
+    size_t count = world.size();
+    std::vector<char> message = newMessage<SIMCONNECT_RECV_AIRPORT_LIST>(SIMCONNECT_RECV_ID_AIRPORT_LIST, count * sizeof(SIMCONNECT_DATA_FACILITY_AIRPORT));
+    SIMCONNECT_RECV_AIRPORT_LIST* list = messageAs<SIMCONNECT_RECV_AIRPORT_LIST>(message);
+    list->dwRequestID = request;
+    list->dwArraySize = static_cast<DWORD>(count);
+    list->dwEntryNumber = 0;
+    list->dwOutOf = 1;
+    for (size_t i = 0; i < count; ++i) {
+        SIMCONNECT_DATA_FACILITY_AIRPORT& entry = list->rgData[i];
+        snprintf(entry.Ident, sizeof(entry.Ident), "%s", world[i].ident.c_str());
+        memcpy(entry.Region, world[i].region.data(), std::min(world[i].region.size(), sizeof(entry.Region)));
+        entry.Latitude = world[i].latitude;
+        entry.Longitude = world[i].longitude;
+        entry.Altitude = world[i].altitude;
+    }
+    send(std::move(message));
+}
+
+static void sendJetwayData(const std::string& ident) {
+    const FakeAirport* airport = findAirport(ident.c_str());
+    if (airport == nullptr) {
+        sendException(SIMCONNECT_EXCEPTION_JETWAY_DATA, 1); // Incorrect ICAO or airport not spawned
+        return;
+    }
+
+    std::vector<size_t> jetways;
+    for (size_t i = 0; i < airport->parkings.size(); ++i) {
+        if (airport->parkings[i].jetway) {
+            jetways.push_back(i);
+        }
+    }
+    std::vector<char> message = newMessage<SIMCONNECT_RECV_JETWAY_DATA>(SIMCONNECT_RECV_ID_JETWAY_DATA, jetways.size() * sizeof(SIMCONNECT_JETWAY_DATA));
+    SIMCONNECT_RECV_JETWAY_DATA* list = messageAs<SIMCONNECT_RECV_JETWAY_DATA>(message);
+    list->dwRequestID = SIMCONNECT_UNUSED;
+    list->dwArraySize = static_cast<DWORD>(jetways.size());
+    list->dwOutOf = 1;
+    for (size_t i = 0; i < jetways.size(); ++i) {
+        const FakeParking& parking = airport->parkings[jetways[i]];
+        SIMCONNECT_JETWAY_DATA& jetway = list->rgData[i];
+        snprintf(jetway.AirportIcao, sizeof(jetway.AirportIcao), "%s", airport->ident.c_str());
+        jetway.ParkingIndex = static_cast<int>(jetways[i]);
+        jetway.Lla.Latitude = parking.latitude;
+        jetway.Lla.Longitude = parking.longitude;
+        jetway.Lla.Altitude = airport->altitude;
+        jetway.Pbh.Heading = 90;
+    }
+    send(std::move(message));
+}
+
+// Flights
+
+std::string fakeSimFlt(const FakeFlight& flight) {
+    std::ostringstream flt;
+    flt << "[Main]\nTitle=Headless flight\nDescription=\nAppVersion=11.0.282174\nFlightVersion=" << flight.flightVersion
+        << "\nOriginalFlight=\nFlightType=SAVE\n\n";
+    flt << "[Briefing]\nBriefingText=\n\n";
+    if (!flight.departure.empty()) {
+        flt << "[Departure]\nICAO=" << flight.departure << "\nGateName=\nGateNumber=0\nGateSuffix=\n\n";
+    }
+    flt << "[Arrival]\nICAO=KPDX\nRunwayNumber=10\nRunwayDesignator=RIGHT\n\n";
+    flt << "[FreeFlight]\nFirstFlightState=" << flight.firstFlightState << "\n\n";
+    flt << "[LivingWorld]\nAirportLife=False\n\n";
+    flt << "[Weather]\nUseLiveWeather=True\nUseWeatherFile=False\nWeatherPresetFile=\n\n";
+    flt << "[SimScheduler]\nSimTime=" << static_cast<long long>(flight.simTime) << "\n\n";
+    flt << "[Sim.0]\nSim=" << flight.aircraft << "\nPilot=Pilot_Female_Casual\n\n";
+    flt << "[SimVars.0]\nLatitude=N47° 26' 56.40\"\nLongitude=W122° 18' 32.40\"\nAltitude=+000433.00\nHeading=90.000000\n"
+        << "ZVelBodyAxis=0\nSimOnGround=True\nOnPushback=False\n\n";
+    flt << "[SimVarForSpawningInTheAir]\nIAS=0\nAltitude=0\nFlapsDegree=0\n\n";
+    flt << "[ATC_Aircraft.0]\nActiveFlightPlan=False\nRequestedFlightPlan=False\n\n";
+
+    // Aircraft L: variables make the difference between a 10 KB and a multi MB save
+    std::string text = flt.str();
+    text += "[LocalVars.0]\n";
+    const char* prefixes[] = { "XMLVAR_", "A32NX_", "FBW_", "WT_CJ4_", "GPS_", "AS1000_PFD_", "LIGHTING_", "ELEC_" };
+    const char* words[] = { "SWITCH", "KNOB", "BRIGHTNESS", "POSITION", "STATE", "ANIM", "SELECTED", "PUSHED", "LIGHT", "MODE" };
+    char line[96];
+    for (unsigned i = 0; i < 20 || text.size() < flight.bytes; ++i) {
+        snprintf(line, sizeof(line), "%s%s_%s_%u=%u.000000\n", prefixes[i % 8], words[(i / 8) % 10], words[(i * 7) % 10], i / 80, (i * 2654435761u) % 3);
+        text += line;
+    }
+    text += "\n";
+    return text;
+}
+
+// What MSFS leaves after a save at the gate: the landing state FSAutoSave has to repair
+static void writeSave(const std::string& path) {
+    FakeFlight flight;
+    flight.aircraft = simOptions.aircraft;
+    flight.firstFlightState = "LANDING_GATE";
+    flight.flightVersion = ++savedVersion;
+    flight.bytes = simOptions.fltBytes;
+
+    std::error_code ec;
+    fs::file_time_type before = fs::last_write_time(path, ec);
+    bool existed = !ec;
+    std::string temp = path + ".fakesim";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out << fakeSimFlt(flight);
+    }
+    fs::rename(temp, path, ec);
+    // finalSave waits for the modification time to change, make sure it does on coarse clocks too
+    if (existed && fs::last_write_time(path, ec) == before) {
+        fs::last_write_time(path, before + std::chrono::milliseconds(1), ec);
+    }
+}
+
+static void loadFlight(const std::string& path) {
+    flightPath = path;
+    cameraState = 11;
+    sendSystemFileEvent("FlightLoaded", path);
+    schedule(simOptions.replyDelayMs, [] {
+        simRunning = true;
+        cameraState = 2;
+        sendSystemEvent("SimStart");
+        sendPeriodicData();
+    });
+}
+
+// Public interface
+
+void fakeSimStart(const FakeSimOptions& options) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    if (simStarted) {
+        return;
+    }
+    simOptions = options;
+    buildWorld();
+    simStarted = true;
+    simThread = std::thread(simLoop);
+}
+
+const std::vector<FakeAirport>& fakeSimAirports() {
+    return world;
+}
+
+const FakeAirport& fakeSimHomeAirport() {
+    return world[homeAirport];
+}
+
+const FakeParking& fakeSimParkedAt() {
+    return world[homeAirport].parkings[parkedAt];
+}
+
+bool fakeSimWaitForClient(unsigned timeoutMs) {
+    std::unique_lock<std::mutex> lock(simMutex);
+    return clientReady.wait_for(lock, std::chrono::milliseconds(timeoutMs), [] { return !inputGroupsOn.empty(); });
+}
+
+void fakeSimLoadFlight(const std::string& path) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    schedule(simOptions.replyDelayMs, [path] { loadFlight(path); });
+}
+
+void fakeSimInput(const std::string& keys) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    auto it = inputEvents.find(keys);
+    if (it == inputEvents.end() || !inputGroupsOn.count(inputEventGroups[it->second.first])) {
+        return;
+    }
+    DWORD eventID = it->second.first;
+    DWORD data = it->second.second;
+    schedule(simOptions.replyDelayMs, [eventID, data] { sendEvent(eventID, data, notifiedEvents.count(eventID) ? notifiedEvents[eventID] : SIMCONNECT_UNUSED); });
+}
+
+void fakeSimPause(bool paused) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    schedule(simOptions.replyDelayMs, [paused] { sendSystemEvent("Pause_EX1", paused ? 8 : 0); }); // PAUSE_STATE_FLAG_SIM_PAUSE
+}
+
+void fakeSimQuit() {
+    {
+        std::lock_guard<std::mutex> lock(simMutex);
+        if (!simStarted) {
+            return;
+        }
+        schedule(simOptions.replyDelayMs, [] {
+            simRunning = false;
+            send(newMessage<SIMCONNECT_RECV_QUIT>(SIMCONNECT_RECV_ID_QUIT));
+        });
+        simStopping = true;
+    }
+    simThread.join();
+}
+
+size_t fakeSimMessages() {
+    std::lock_guard<std::mutex> lock(simMutex);
+    return messagesSent;
+}
+
+void fakeSimOnClientThread(const std::function<void()>& task) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    clientTasks.push_back(task);
+}
+
+// SimConnect
+
+HRESULT SimConnect_Open(HANDLE* phSimConnect, LPCSTR, HWND, DWORD, HANDLE, DWORD) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    if (!simStarted || simStopping) {
+        return E_FAIL;
+    }
+    *phSimConnect = simHandle;
+    schedule(simOptions.replyDelayMs, [] {
+        std::vector<char> message = newMessage<SIMCONNECT_RECV_OPEN>(SIMCONNECT_RECV_ID_OPEN);
+        SIMCONNECT_RECV_OPEN* open = messageAs<SIMCONNECT_RECV_OPEN>(message);
+        snprintf(open->szApplicationName, sizeof(open->szApplicationName), "KittyHawk (headless)");
+        open->dwApplicationVersionMajor = 11;
+        open->dwApplicationBuildMajor = 282174;
+        open->dwSimConnectVersionMajor = 11;
+        send(std::move(message));
+    });
+    schedule(1000, periodicTick);
+    return S_OK;
+}
+
+HRESULT SimConnect_Close(HANDLE) {
+    return S_OK;
+}
+
+HRESULT SimConnect_GetNextDispatch(HANDLE, SIMCONNECT_RECV** ppData, DWORD* pcbData) {
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(simMutex);
+        tasks.swap(clientTasks);
+    }
+    for (const std::function<void()>& task : tasks) {
+        task(); // Without the lock, the task may call into SimConnect
+    }
+
+    std::lock_guard<std::mutex> lock(simMutex);
+    if (messages.empty()) {
+        return E_FAIL;
+    }
+    dispatched = std::move(messages.front());
+    messages.pop_front();
+    *ppData = reinterpret_cast<SIMCONNECT_RECV*>(dispatched.data());
+    *pcbData = static_cast<DWORD>(dispatched.size());
+    return S_OK;
+}
+
+HRESULT SimConnect_CallDispatch(HANDLE hSimConnect, DispatchProc pfcnDispatch, void* pContext) {
+    SIMCONNECT_RECV* pData = nullptr;
+    DWORD cbData = 0;
+    while (SUCCEEDED(SimConnect_GetNextDispatch(hSimConnect, &pData, &cbData))) {
+        pfcnDispatch(pData, cbData, pContext);
+    }
+    return S_OK;
+}
+
+HRESULT SimConnect_AddToDataDefinition(HANDLE, SIMCONNECT_DATA_DEFINITION_ID DefineID, const char* DatumName, const char* UnitsName, SIMCONNECT_DATATYPE, float, DWORD) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    dataDefinitions[DefineID].push_back(std::string(DatumName) + '\x1f' + (UnitsName != nullptr ? UnitsName : ""));
+    return S_OK;
+}
+
+HRESULT SimConnect_RequestDataOnSimObject(HANDLE, SIMCONNECT_DATA_REQUEST_ID RequestID, SIMCONNECT_DATA_DEFINITION_ID DefineID, SIMCONNECT_OBJECT_ID, SIMCONNECT_PERIOD Period, DWORD Flags, DWORD, DWORD, DWORD) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    periodicRequests.erase(std::remove_if(periodicRequests.begin(), periodicRequests.end(), [&](const DataRequest& request) { return request.request == RequestID; }), periodicRequests.end());
+    if (Period == SIMCONNECT_PERIOD_ONCE) {
+        schedule(simOptions.replyDelayMs, [RequestID, DefineID] { sendData(RequestID, DefineID, definitionValues(DefineID)); });
+    }
+    else if (Period != SIMCONNECT_PERIOD_NEVER) {
+        // Frame periods are answered every second as well
+        periodicRequests.push_back({ RequestID, DefineID, (Flags & SIMCONNECT_DATA_REQUEST_FLAG_CHANGED) != 0, {} });
+    }
+    return S_OK;
+}
+
+HRESULT SimConnect_RequestDataOnSimObjectType(HANDLE, SIMCONNECT_DATA_REQUEST_ID RequestID, SIMCONNECT_DATA_DEFINITION_ID DefineID, DWORD, SIMCONNECT_SIMOBJECT_TYPE) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    schedule(simOptions.replyDelayMs, [RequestID, DefineID] {
+        sendData(RequestID, DefineID, definitionValues(DefineID));
+        messageAs<SIMCONNECT_RECV>(messages.back())->dwID = SIMCONNECT_RECV_ID_SIMOBJECT_DATA_BYTYPE;
+    });
+    return S_OK;
+}
+
+HRESULT SimConnect_RequestSystemState(HANDLE, SIMCONNECT_DATA_REQUEST_ID RequestID, const char* szState) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    std::string state = szState;
+    schedule(simOptions.replyDelayMs, [RequestID, state] {
+        std::vector<char> message = newMessage<SIMCONNECT_RECV_SYSTEM_STATE>(SIMCONNECT_RECV_ID_SYSTEM_STATE);
+        SIMCONNECT_RECV_SYSTEM_STATE* answer = messageAs<SIMCONNECT_RECV_SYSTEM_STATE>(message);
+        answer->dwRequestID = RequestID;
+        if (state == "AircraftLoaded") {
+            snprintf(answer->szString, sizeof(answer->szString), "SimObjects/Airplanes/%s/aircraft.CFG", simOptions.aircraft.c_str());
+        }
+        else if (state == "FlightLoaded") {
+            snprintf(answer->szString, sizeof(answer->szString), "%s", flightPath.c_str());
+        }
+        else if (state == "FlightPlan") {
+            snprintf(answer->szString, sizeof(answer->szString), "%s", flightPlanPath.c_str());
+        }
+        else if (state == "Sim") {
+            answer->dwInteger = simRunning ? 1 : 0;
+        }
+        send(std::move(message));
+    });
+    return S_OK;
+}
+
+HRESULT SimConnect_SubscribeToSystemEvent(HANDLE, SIMCONNECT_CLIENT_EVENT_ID EventID, const char* SystemEventName) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    systemEvents[SystemEventName] = EventID;
+    return S_OK;
+}
+
+HRESULT SimConnect_SetSystemEventState(HANDLE, SIMCONNECT_CLIENT_EVENT_ID, SIMCONNECT_STATE) {
+    return S_OK;
+}
+
+HRESULT SimConnect_MapClientEventToSimEvent(HANDLE, SIMCONNECT_CLIENT_EVENT_ID, const char*) {
+    return S_OK;
+}
+
+HRESULT SimConnect_MapInputEventToClientEvent_EX1(HANDLE, SIMCONNECT_INPUT_GROUP_ID GroupID, const char* szInputDefinition, SIMCONNECT_CLIENT_EVENT_ID DownEventID, DWORD DownValue, SIMCONNECT_CLIENT_EVENT_ID, DWORD, BOOL) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    inputEvents[szInputDefinition] = { DownEventID, DownValue };
+    inputEventGroups[DownEventID] = GroupID;
+    return S_OK;
+}
+
+HRESULT SimConnect_AddClientEventToNotificationGroup(HANDLE, SIMCONNECT_NOTIFICATION_GROUP_ID GroupID, SIMCONNECT_CLIENT_EVENT_ID EventID, BOOL) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    notifiedEvents[EventID] = GroupID;
+    return S_OK;
+}
+
+HRESULT SimConnect_SetNotificationGroupPriority(HANDLE, SIMCONNECT_NOTIFICATION_GROUP_ID, DWORD) {
+    return S_OK;
+}
+
+HRESULT SimConnect_SetInputGroupState(HANDLE, SIMCONNECT_INPUT_GROUP_ID GroupID, DWORD dwState) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    if (dwState == SIMCONNECT_STATE_ON) {
+        inputGroupsOn.insert(GroupID);
+        clientReady.notify_all();
+    }
+    else {
+        inputGroupsOn.erase(GroupID);
+    }
+    return S_OK;
+}
+
+// Client events come back to the client only when they are in one of its notification groups
+HRESULT SimConnect_TransmitClientEvent(HANDLE, SIMCONNECT_OBJECT_ID, SIMCONNECT_CLIENT_EVENT_ID EventID, DWORD dwData, SIMCONNECT_NOTIFICATION_GROUP_ID, DWORD) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    auto it = notifiedEvents.find(EventID);
+    if (it != notifiedEvents.end()) {
+        DWORD group = it->second;
+        schedule(simOptions.replyDelayMs, [EventID, dwData, group] { sendEvent(EventID, dwData, group); });
+    }
+    return S_OK;
+}
+
+HRESULT SimConnect_AddToFacilityDefinition(HANDLE, SIMCONNECT_DATA_DEFINITION_ID DefineID, const char* FieldName) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    facilityDefinitions[DefineID].push_back(FieldName);
+    return S_OK;
+}
+
+HRESULT SimConnect_RequestFacilityData(HANDLE, SIMCONNECT_DATA_DEFINITION_ID DefineID, SIMCONNECT_DATA_REQUEST_ID RequestID, const char* ICAO, const char*) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    std::string ident = ICAO;
+    schedule(simOptions.facilityDelayMs, [DefineID, RequestID, ident] { sendFacilityData(DefineID, RequestID, ident); });
+    return S_OK;
+}
+
+HRESULT SimConnect_RequestFacilitiesList_EX1(HANDLE, SIMCONNECT_FACILITY_LIST_TYPE type, SIMCONNECT_DATA_REQUEST_ID RequestID) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    if (type != SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT) {
+        return E_FAIL;
+    }
+    schedule(simOptions.listDelayMs, [RequestID] { sendAirportList(RequestID); });
+    return S_OK;
+}
+
+// The whole world is in the reality bubble and stays there: the subscription gets every airport once
+HRESULT SimConnect_SubscribeToFacilities_EX1(HANDLE, SIMCONNECT_FACILITY_LIST_TYPE type, SIMCONNECT_DATA_REQUEST_ID newElemInRangeRequestID, SIMCONNECT_DATA_REQUEST_ID) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    if (type != SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT) {
+        return E_FAIL;
+    }
+    if (newElemInRangeRequestID != static_cast<SIMCONNECT_DATA_REQUEST_ID>(-1)) {
+        schedule(simOptions.listDelayMs, [newElemInRangeRequestID] { sendAirportList(newElemInRangeRequestID); });
+    }
+    return S_OK;
+}
+
+HRESULT SimConnect_UnsubscribeToFacilities_EX1(HANDLE, SIMCONNECT_FACILITY_LIST_TYPE, bool, bool) {
+    return S_OK;
+}
+
+HRESULT SimConnect_RequestJetwayData(HANDLE, const char* AirportIcao, DWORD, int*) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    std::string ident = AirportIcao;
+    schedule(simOptions.jetwayDelayMs, [ident] { sendJetwayData(ident); });
+    return S_OK;
+}
+
+HRESULT SimConnect_FlightLoad(HANDLE, const char* szFileName) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    std::string path = szFileName;
+    schedule(simOptions.replyDelayMs, [path] { loadFlight(path); });
+    return S_OK;
+}
+
+// Relative names go to the LocalState directory, like MSFS does
+HRESULT SimConnect_FlightSave(HANDLE, const char* szFileName, const char*, const char*, DWORD) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    std::string path = fs::path(szFileName).is_absolute() ? szFileName : (fs::path(simOptions.directory) / szFileName).string();
+    schedule(simOptions.saveDelayMs, [path] {
+        writeSave(path);
+        sendSystemFileEvent("FlightSaved", path);
+    });
+    return S_OK;
+}
+
+HRESULT SimConnect_FlightPlanLoad(HANDLE, const char* szFileName) {
+    std::lock_guard<std::mutex> lock(simMutex);
+    std::string path = szFileName;
+    schedule(simOptions.replyDelayMs, [path] {
+        flightPlanPath = path.empty() ? "" : (fs::path(simOptions.directory) / path).string();
+        if (path.empty()) {
+            sendSystemEvent("FlightPlanDeactivated");
+        }
+        else {
+            sendSystemFileEvent("FlightPlanActivated", flightPlanPath);
+        }
+    });
+    return S_OK;
+}
+
+HRESULT SimConnect_Text(HANDLE, SIMCONNECT_TEXT_TYPE, float, SIMCONNECT_CLIENT_EVENT_ID, DWORD, void*) {
+    return S_OK;
+}
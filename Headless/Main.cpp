@@ -0,0 +1,188 @@
+// FSAutoSave headless: runs the real dispatcher and save pipeline on Linux against the fake simulator (FakeSim.h).
+//
+//   fsautosave_headless [--flights N] [--save-delay MS] [--reply-delay MS] [--flt-bytes N] [--directory DIR] [--keep]
+//
+//   --flights N       saves to make with CTRL+ALT+S (default 3)
+//   --save-delay MS   time the simulator takes to write LAST.FLT (default 50)
+//   --reply-delay MS  time the simulator takes for every other answer (default 2)
+//   --flt-bytes N     size of the saves the simulator writes (default: a short flight)
+//   --directory DIR   LocalState directory to use (default: a new one in the temp directory)
+//   --keep            do not delete the directory at the end
+//
+// Loads LAST.FLT, lets the initial save run, then presses the hotkey for every save and waits for FSAutoSave to
+// commit it. At the end LAST.FLT must have the repaired FirstFlightState and the gate the aircraft is parked at.
+// Exit code 0 when it does and every save was committed, 1 otherwise.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "FSAutoSave.h"
+#include "Globals.h"
+#include "Utility.h"
+#include "Metrics.h"
+#include "FltDiff.h"
+#include "FakeSim.h"
+
+namespace fs = std::filesystem;
+
+#define HEADLESS_TIMEOUT 10000  // ms to wait for the client to connect and for every save
+
+struct Options {
+    unsigned flights = 3;
+    FakeSimOptions sim;
+    std::string directory;
+    bool keep = false;
+};
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        bool value = i + 1 < argc;
+        if (strcmp(argv[i], "--flights") == 0 && value) {
+            options.flights = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--save-delay") == 0 && value) {
+            options.sim.saveDelayMs = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--reply-delay") == 0 && value) {
+            options.sim.replyDelayMs = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--flt-bytes") == 0 && value) {
+            options.sim.fltBytes = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--directory") == 0 && value) {
+            options.directory = argv[++i];
+        }
+        else if (strcmp(argv[i], "--keep") == 0) {
+            options.keep = true;
+        }
+        else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool writeFile(const std::string& path, const std::string& contents) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << contents;
+    return out.good();
+}
+
+template <typename F> static bool waitFor(F done, unsigned timeoutMs) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// The save FSAutoSave left behind
+static bool checkSave(const std::string& path) {
+    FltDocument document;
+    if (!fltLoad(path, document)) {
+        printf("[HEADLESS] Could not read %s\n", path.c_str());
+        return false;
+    }
+
+    const FakeParking& parking = fakeSimParkedAt();
+    std::string arrival;
+    struct Expected { const char* section; const char* key; std::string value; } expected[] = {
+        { "FreeFlight", "FirstFlightState", firstFlightState },
+        { "Departure", "ICAO", fakeSimHomeAirport().ident },
+        { "Departure", "GateName", formatGateName(parking.name).gateString },
+        { "Departure", "GateNumber", std::to_string(parking.number) },
+        { "Main", "MissionLocation", fakeSimHomeAirport().name },
+    };
+    bool ok = true;
+    for (const Expected& check : expected) {
+        std::string value = fltValue(document, check.section, check.key);
+        if (value != check.value) {
+            printf("[HEADLESS] [%s] %s is \"%s\", expected \"%s\"\n", check.section, check.key, value.c_str(), check.value.c_str());
+            ok = false;
+        }
+    }
+    if (fltFind(document, "Arrival", "ICAO", arrival)) {
+        printf("[HEADLESS] [Arrival] is still there\n");
+        ok = false;
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printf("Usage: %s [--flights N] [--save-delay MS] [--reply-delay MS] [--flt-bytes N] [--directory DIR] [--keep]\n", argv[0]);
+        return 1;
+    }
+    if (options.directory.empty()) {
+        options.directory = (fs::temp_directory_path() / ("fsautosave-headless-" + std::to_string(getpid()))).string();
+    }
+
+    // Same layout as an MS Store LocalState
+    localStatePath = options.directory;
+    pathToMonitor = localStatePath + PATH_SEPARATOR "Missions" PATH_SEPARATOR "Custom" PATH_SEPARATOR "CustomFlight";
+    lastMOD = localStatePath + PATH_SEPARATOR "LAST.FLT";
+    customFlightmod = pathToMonitor + PATH_SEPARATOR "CustomFlight.FLT";
+    autoSaveEnabled = FALSE; // Saves come from the hotkey only, one at a time
+
+    std::error_code ec;
+    fs::create_directories(pathToMonitor, ec);
+    FakeFlight flight;
+    flight.aircraft = options.sim.aircraft;
+    flight.bytes = options.sim.fltBytes;
+    if (ec || !writeFile(lastMOD, fakeSimFlt(flight)) || !writeFile(customFlightmod, fakeSimFlt(flight))) {
+        printf("[HEADLESS] Could not create the flights in %s\n", localStatePath.c_str());
+        return 1;
+    }
+    options.sim.directory = localStatePath;
+    openHistory();
+
+    fakeSimStart(options.sim);
+    std::thread simconnect(sc);
+    bool connected = fakeSimWaitForClient(HEADLESS_TIMEOUT);
+    bool ok = connected;
+
+    // Initial save (dwData 99) once the flight is running
+    if (ok) {
+        fakeSimLoadFlight(lastMOD);
+        ok = waitFor([] { return metricsSaveRequests(SAVE_SOURCE_INITIAL) > 0; }, HEADLESS_TIMEOUT);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    unsigned committed = 0;
+    for (unsigned i = 0; ok && i < options.flights; ++i) {
+        uint64_t before = metricsSavesCommitted();
+        auto pressed = std::chrono::steady_clock::now();
+        fakeSimInput("VK_LCONTROL+VK_LMENU+s");
+        ok = waitFor([before] { return metricsSavesCommitted() > before; }, HEADLESS_TIMEOUT);
+        if (ok) {
+            committed++;
+            printf("[HEADLESS] Save %u committed in %.1f ms\n", committed, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pressed).count());
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    fakeSimQuit();
+    if (!connected) {
+        quit = 1; // Still trying to open the connection
+    }
+    simconnect.join();
+
+    ok = ok && checkSave(lastMOD);
+    printf("\n[HEADLESS] %u/%u saves committed in %.2f s, %zu SimConnect messages: %s\n", committed, options.flights, seconds, fakeSimMessages(), ok ? "PASSED" : "FAILED");
+
+    if (!options.keep) {
+        fs::remove_all(localStatePath, ec);
+    }
+    return ok ? 0 : 1;
+}
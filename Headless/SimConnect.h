@@ -0,0 +1,324 @@
+#pragma once
+
+// Stand-in for the MSFS SDK SimConnect.h on Linux. Same names, IDs and message layouts as far as FSAutoSave uses
+// them, plus the few Win32 base types the SDK header brings along. FakeSimConnect.cpp implements the functions.
+
+#include <cstdint>
+
+typedef void* HANDLE;
+typedef void* HWND;
+typedef unsigned long DWORD;
+typedef long HRESULT;
+typedef int BOOL;
+typedef const char* LPCSTR;
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+#define S_OK ((HRESULT)0)
+#define E_FAIL ((HRESULT)(int32_t)0x80004005)  // HRESULTs are 32 bits, long is not
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+#define CALLBACK
+
+typedef DWORD SIMCONNECT_OBJECT_ID;
+typedef DWORD SIMCONNECT_CLIENT_EVENT_ID;
+typedef DWORD SIMCONNECT_NOTIFICATION_GROUP_ID;
+typedef DWORD SIMCONNECT_INPUT_GROUP_ID;
+typedef DWORD SIMCONNECT_DATA_DEFINITION_ID;
+typedef DWORD SIMCONNECT_DATA_REQUEST_ID;
+
+#define SIMCONNECT_OBJECT_ID_USER 0
+#define SIMCONNECT_UNUSED ((DWORD)-1)
+
+#define SIMCONNECT_GROUP_PRIORITY_HIGHEST 1
+#define SIMCONNECT_GROUP_PRIORITY_DEFAULT 2000000000
+
+#define SIMCONNECT_EVENT_FLAG_DEFAULT 0x00000000
+#define SIMCONNECT_EVENT_FLAG_GROUPID_IS_PRIORITY 0x00000010
+
+#define SIMCONNECT_DATA_REQUEST_FLAG_DEFAULT 0x00000000
+#define SIMCONNECT_DATA_REQUEST_FLAG_CHANGED 0x00000001
+
+enum SIMCONNECT_RECV_ID {
+    SIMCONNECT_RECV_ID_NULL,
+    SIMCONNECT_RECV_ID_EXCEPTION,
+    SIMCONNECT_RECV_ID_OPEN,
+    SIMCONNECT_RECV_ID_QUIT,
+    SIMCONNECT_RECV_ID_EVENT,
+    SIMCONNECT_RECV_ID_EVENT_OBJECT_ADDREMOVE,
+    SIMCONNECT_RECV_ID_EVENT_FILENAME,
+    SIMCONNECT_RECV_ID_EVENT_FRAME,
+    SIMCONNECT_RECV_ID_SIMOBJECT_DATA,
+    SIMCONNECT_RECV_ID_SIMOBJECT_DATA_BYTYPE,
+    SIMCONNECT_RECV_ID_WEATHER_OBSERVATION,
+    SIMCONNECT_RECV_ID_CLOUD_STATE,
+    SIMCONNECT_RECV_ID_ASSIGNED_OBJECT_ID,
+    SIMCONNECT_RECV_ID_RESERVED_KEY,
+    SIMCONNECT_RECV_ID_CUSTOM_ACTION,
+    SIMCONNECT_RECV_ID_SYSTEM_STATE,
+    SIMCONNECT_RECV_ID_CLIENT_DATA,
+    SIMCONNECT_RECV_ID_EVENT_WEATHER_MODE,
+    SIMCONNECT_RECV_ID_AIRPORT_LIST,
+    SIMCONNECT_RECV_ID_VOR_LIST,
+    SIMCONNECT_RECV_ID_NDB_LIST,
+    SIMCONNECT_RECV_ID_WAYPOINT_LIST,
+    SIMCONNECT_RECV_ID_EVENT_MULTIPLAYER_SERVER_STARTED,
+    SIMCONNECT_RECV_ID_EVENT_MULTIPLAYER_CLIENT_STARTED,
+    SIMCONNECT_RECV_ID_EVENT_MULTIPLAYER_SESSION_ENDED,
+    SIMCONNECT_RECV_ID_EVENT_RACE_END,
+    SIMCONNECT_RECV_ID_EVENT_RACE_LAP,
+    SIMCONNECT_RECV_ID_EVENT_EX1,
+    SIMCONNECT_RECV_ID_FACILITY_DATA,
+    SIMCONNECT_RECV_ID_FACILITY_DATA_END,
+    SIMCONNECT_RECV_ID_FACILITY_MINIMAL_LIST,
+    SIMCONNECT_RECV_ID_JETWAY_DATA,
+};
+
+enum SIMCONNECT_EXCEPTION {
+    SIMCONNECT_EXCEPTION_NONE,
+    SIMCONNECT_EXCEPTION_ERROR,
+    SIMCONNECT_EXCEPTION_SIZE_MISMATCH,
+    SIMCONNECT_EXCEPTION_UNRECOGNIZED_ID,
+    SIMCONNECT_EXCEPTION_UNOPENED,
+    SIMCONNECT_EXCEPTION_VERSION_MISMATCH,
+    SIMCONNECT_EXCEPTION_TOO_MANY_GROUPS,
+    SIMCONNECT_EXCEPTION_NAME_UNRECOGNIZED,
+    SIMCONNECT_EXCEPTION_TOO_MANY_EVENT_NAMES,
+    SIMCONNECT_EXCEPTION_EVENT_ID_DUPLICATE,
+    SIMCONNECT_EXCEPTION_TOO_MANY_MAPS,
+    SIMCONNECT_EXCEPTION_TOO_MANY_OBJECTS,
+    SIMCONNECT_EXCEPTION_TOO_MANY_REQUESTS,
+    SIMCONNECT_EXCEPTION_WEATHER_INVALID_PORT,
+    SIMCONNECT_EXCEPTION_WEATHER_INVALID_METAR,
+    SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_GET_OBSERVATION,
+    SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_CREATE_STATION,
+    SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_REMOVE_STATION,
+    SIMCONNECT_EXCEPTION_INVALID_DATA_TYPE,
+    SIMCONNECT_EXCEPTION_INVALID_DATA_SIZE,
+    SIMCONNECT_EXCEPTION_DATA_ERROR,
+    SIMCONNECT_EXCEPTION_INVALID_ARRAY,
+    SIMCONNECT_EXCEPTION_CREATE_OBJECT_FAILED,
+    SIMCONNECT_EXCEPTION_LOAD_FLIGHTPLAN_FAILED,
+    SIMCONNECT_EXCEPTION_OPERATION_INVALID_FOR_OBJECT_TYPE,
+    SIMCONNECT_EXCEPTION_ILLEGAL_OPERATION,
+    SIMCONNECT_EXCEPTION_ALREADY_SUBSCRIBED,
+    SIMCONNECT_EXCEPTION_INVALID_ENUM,
+    SIMCONNECT_EXCEPTION_DEFINITION_ERROR,
+    SIMCONNECT_EXCEPTION_DUPLICATE_ID,
+    SIMCONNECT_EXCEPTION_DATUM_ID,
+    SIMCONNECT_EXCEPTION_OUT_OF_BOUNDS,
+    SIMCONNECT_EXCEPTION_ALREADY_CREATED,
+    SIMCONNECT_EXCEPTION_OBJECT_OUTSIDE_REALITY_BUBBLE,
+    SIMCONNECT_EXCEPTION_OBJECT_CONTAINER,
+    SIMCONNECT_EXCEPTION_OBJECT_AI,
+    SIMCONNECT_EXCEPTION_OBJECT_ATC,
+    SIMCONNECT_EXCEPTION_OBJECT_SCHEDULE,
+    SIMCONNECT_EXCEPTION_JETWAY_DATA,
+    SIMCONNECT_EXCEPTION_ACTION_NOT_FOUND,
+    SIMCONNECT_EXCEPTION_NOT_AN_ACTION,
+    SIMCONNECT_EXCEPTION_INCORRECT_ACTION_PARAMS,
+    SIMCONNECT_EXCEPTION_GET_INPUT_EVENT_FAILED,
+    SIMCONNECT_EXCEPTION_SET_INPUT_EVENT_FAILED,
+};
+
+enum SIMCONNECT_PERIOD {
+    SIMCONNECT_PERIOD_NEVER,
+    SIMCONNECT_PERIOD_ONCE,
+    SIMCONNECT_PERIOD_VISUAL_FRAME,
+    SIMCONNECT_PERIOD_SIM_FRAME,
+    SIMCONNECT_PERIOD_SECOND,
+};
+
+enum SIMCONNECT_SIMOBJECT_TYPE {
+    SIMCONNECT_SIMOBJECT_TYPE_USER,
+    SIMCONNECT_SIMOBJECT_TYPE_ALL,
+    SIMCONNECT_SIMOBJECT_TYPE_AIRCRAFT,
+    SIMCONNECT_SIMOBJECT_TYPE_HELICOPTER,
+    SIMCONNECT_SIMOBJECT_TYPE_BOAT,
+    SIMCONNECT_SIMOBJECT_TYPE_GROUND,
+};
+
+enum SIMCONNECT_FACILITY_LIST_TYPE {
+    SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT,
+    SIMCONNECT_FACILITY_LIST_TYPE_WAYPOINT,
+    SIMCONNECT_FACILITY_LIST_TYPE_NDB,
+    SIMCONNECT_FACILITY_LIST_TYPE_VOR,
+    SIMCONNECT_FACILITY_LIST_TYPE_COUNT,
+};
+
+enum SIMCONNECT_FACILITY_DATA_TYPE {
+    SIMCONNECT_FACILITY_DATA_AIRPORT,
+    SIMCONNECT_FACILITY_DATA_RUNWAY,
+    SIMCONNECT_FACILITY_DATA_START,
+    SIMCONNECT_FACILITY_DATA_FREQUENCY,
+    SIMCONNECT_FACILITY_DATA_HELIPAD,
+    SIMCONNECT_FACILITY_DATA_APPROACH,
+    SIMCONNECT_FACILITY_DATA_APPROACH_TRANSITION,
+    SIMCONNECT_FACILITY_DATA_APPROACH_LEG,
+    SIMCONNECT_FACILITY_DATA_FINAL_APPROACH_LEG,
+    SIMCONNECT_FACILITY_DATA_MISSED_APPROACH_LEG,
+    SIMCONNECT_FACILITY_DATA_DEPARTURE,
+    SIMCONNECT_FACILITY_DATA_ARRIVAL,
+    SIMCONNECT_FACILITY_DATA_RUNWAY_TRANSITION,
+    SIMCONNECT_FACILITY_DATA_ENROUTE_TRANSITION,
+    SIMCONNECT_FACILITY_DATA_TAXI_POINT,
+    SIMCONNECT_FACILITY_DATA_TAXI_PARKING,
+    SIMCONNECT_FACILITY_DATA_TAXI_PATH,
+    SIMCONNECT_FACILITY_DATA_TAXI_NAME,
+    SIMCONNECT_FACILITY_DATA_JETWAY,
+    SIMCONNECT_FACILITY_DATA_VOR,
+    SIMCONNECT_FACILITY_DATA_NDB,
+    SIMCONNECT_FACILITY_DATA_WAYPOINT,
+    SIMCONNECT_FACILITY_DATA_ROUTE,
+};
+
+enum SIMCONNECT_TEXT_TYPE {
+    SIMCONNECT_TEXT_TYPE_SCROLL_BLACK,
+    SIMCONNECT_TEXT_TYPE_PRINT_BLACK = 0x100,
+    SIMCONNECT_TEXT_TYPE_PRINT_WHITE,
+};
+
+enum SIMCONNECT_STATE {
+    SIMCONNECT_STATE_OFF,
+    SIMCONNECT_STATE_ON,
+};
+
+enum SIMCONNECT_DATATYPE {
+    SIMCONNECT_DATATYPE_INVALID,
+    SIMCONNECT_DATATYPE_INT32,
+    SIMCONNECT_DATATYPE_INT64,
+    SIMCONNECT_DATATYPE_FLOAT32,
+    SIMCONNECT_DATATYPE_FLOAT64,
+};
+
+#pragma pack(push, 1)
+
+struct SIMCONNECT_RECV { DWORD dwSize; DWORD dwVersion; DWORD dwID; };
+
+struct SIMCONNECT_RECV_EXCEPTION : SIMCONNECT_RECV { DWORD dwException; DWORD dwSendID; DWORD dwIndex; };
+
+struct SIMCONNECT_RECV_OPEN : SIMCONNECT_RECV {
+    char szApplicationName[256];
+    DWORD dwApplicationVersionMajor;
+    DWORD dwApplicationVersionMinor;
+    DWORD dwApplicationBuildMajor;
+    DWORD dwApplicationBuildMinor;
+    DWORD dwSimConnectVersionMajor;
+    DWORD dwSimConnectVersionMinor;
+    DWORD dwSimConnectBuildMajor;
+    DWORD dwSimConnectBuildMinor;
+    DWORD dwReserved1;
+    DWORD dwReserved2;
+};
+
+struct SIMCONNECT_RECV_QUIT : SIMCONNECT_RECV {};
+
+struct SIMCONNECT_RECV_EVENT : SIMCONNECT_RECV { DWORD uGroupID; DWORD uEventID; DWORD dwData; };
+struct SIMCONNECT_RECV_EVENT_FILENAME : SIMCONNECT_RECV_EVENT { char szFileName[260]; DWORD dwFlags; };
+struct SIMCONNECT_RECV_EVENT_FRAME : SIMCONNECT_RECV_EVENT { float fFrameRate; float fSimSpeed; };
+
+struct SIMCONNECT_RECV_SIMOBJECT_DATA : SIMCONNECT_RECV {
+    DWORD dwRequestID;
+    DWORD dwObjectID;
+    DWORD dwDefineID;
+    DWORD dwFlags;
+    DWORD dwentrynumber;
+    DWORD dwoutof;
+    DWORD dwDefineCount;
+    DWORD dwData;
+};
+struct SIMCONNECT_RECV_SIMOBJECT_DATA_BYTYPE : SIMCONNECT_RECV_SIMOBJECT_DATA {};
+
+struct SIMCONNECT_RECV_SYSTEM_STATE : SIMCONNECT_RECV { DWORD dwRequestID; DWORD dwInteger; float fFloat; char szString[260]; };
+
+struct SIMCONNECT_RECV_FACILITIES_LIST : SIMCONNECT_RECV { DWORD dwRequestID; DWORD dwArraySize; DWORD dwEntryNumber; DWORD dwOutOf; };
+
+struct SIMCONNECT_DATA_FACILITY_AIRPORT { char Ident[6]; char Region[3]; double Latitude; double Longitude; double Altitude; };
+struct SIMCONNECT_RECV_AIRPORT_LIST : SIMCONNECT_RECV_FACILITIES_LIST { SIMCONNECT_DATA_FACILITY_AIRPORT rgData[1]; };
+
+struct SIMCONNECT_RECV_FACILITY_DATA : SIMCONNECT_RECV {
+    DWORD UserRequestId;
+    DWORD UniqueRequestId;
+    DWORD ParentUniqueRequestId;
+    DWORD Type;
+    DWORD IsListItem;
+    DWORD ItemIndex;
+    DWORD ListSize;
+    DWORD Data;
+};
+struct SIMCONNECT_RECV_FACILITY_DATA_END : SIMCONNECT_RECV { DWORD RequestId; };
+
+struct SIMCONNECT_DATA_LATLONALT { double Latitude; double Longitude; double Altitude; };
+struct SIMCONNECT_DATA_PBH { float Pitch; float Bank; float Heading; };
+struct SIMCONNECT_DATA_XYZ { double x; double y; double z; };
+
+struct SIMCONNECT_JETWAY_DATA {
+    char AirportIcao[8];
+    int ParkingIndex;
+    SIMCONNECT_DATA_LATLONALT Lla;
+    SIMCONNECT_DATA_PBH Pbh;
+    int Status;
+    int Door;
+    SIMCONNECT_DATA_XYZ ExitDoorRelativePos;
+    SIMCONNECT_DATA_XYZ MainHandlePos;
+    SIMCONNECT_DATA_XYZ SecondaryHandle;
+    SIMCONNECT_DATA_XYZ WheelGroundLock;
+    DWORD JetwayObjectId;
+    DWORD AttachedObjectId;
+};
+struct SIMCONNECT_RECV_JETWAY_DATA : SIMCONNECT_RECV_FACILITIES_LIST { SIMCONNECT_JETWAY_DATA rgData[1]; };
+
+struct SIMCONNECT_ICAO { char Type; char Ident[9]; char Region[3]; char Airport[5]; };
+struct SIMCONNECT_FACILITY_MINIMAL { SIMCONNECT_ICAO icao; SIMCONNECT_DATA_LATLONALT lla; };
+struct SIMCONNECT_RECV_FACILITY_MINIMAL_LIST : SIMCONNECT_RECV_FACILITIES_LIST { SIMCONNECT_FACILITY_MINIMAL rgData[1]; };
+
+#pragma pack(pop)
+
+typedef void (CALLBACK *DispatchProc)(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext);
+
+HRESULT SimConnect_Open(HANDLE* phSimConnect, LPCSTR szName, HWND hWnd, DWORD UserEventWin32, HANDLE hEventHandle, DWORD ConfigIndex);
+HRESULT SimConnect_Close(HANDLE hSimConnect);
+HRESULT SimConnect_CallDispatch(HANDLE hSimConnect, DispatchProc pfcnDispatch, void* pContext);
+HRESULT SimConnect_GetNextDispatch(HANDLE hSimConnect, SIMCONNECT_RECV** ppData, DWORD* pcbData);
+
+HRESULT SimConnect_AddToDataDefinition(HANDLE hSimConnect, SIMCONNECT_DATA_DEFINITION_ID DefineID, const char* DatumName, const char* UnitsName,
+    SIMCONNECT_DATATYPE DatumType = SIMCONNECT_DATATYPE_FLOAT64, float fEpsilon = 0, DWORD DatumID = SIMCONNECT_UNUSED);
+HRESULT SimConnect_RequestDataOnSimObject(HANDLE hSimConnect, SIMCONNECT_DATA_REQUEST_ID RequestID, SIMCONNECT_DATA_DEFINITION_ID DefineID,
+    SIMCONNECT_OBJECT_ID ObjectID, SIMCONNECT_PERIOD Period, DWORD Flags = 0, DWORD origin = 0, DWORD interval = 0, DWORD limit = 0);
+HRESULT SimConnect_RequestDataOnSimObjectType(HANDLE hSimConnect, SIMCONNECT_DATA_REQUEST_ID RequestID, SIMCONNECT_DATA_DEFINITION_ID DefineID,
+    DWORD dwRadiusMeters, SIMCONNECT_SIMOBJECT_TYPE type);
+
+HRESULT SimConnect_RequestSystemState(HANDLE hSimConnect, SIMCONNECT_DATA_REQUEST_ID RequestID, const char* szState);
+HRESULT SimConnect_SubscribeToSystemEvent(HANDLE hSimConnect, SIMCONNECT_CLIENT_EVENT_ID EventID, const char* SystemEventName);
+HRESULT SimConnect_SetSystemEventState(HANDLE hSimConnect, SIMCONNECT_CLIENT_EVENT_ID EventID, SIMCONNECT_STATE dwState);
+
+HRESULT SimConnect_MapClientEventToSimEvent(HANDLE hSimConnect, SIMCONNECT_CLIENT_EVENT_ID EventID, const char* EventName = "");
+HRESULT SimConnect_MapInputEventToClientEvent_EX1(HANDLE hSimConnect, SIMCONNECT_INPUT_GROUP_ID GroupID, const char* szInputDefinition,
+    SIMCONNECT_CLIENT_EVENT_ID DownEventID, DWORD DownValue = 0, SIMCONNECT_CLIENT_EVENT_ID UpEventID = (SIMCONNECT_CLIENT_EVENT_ID)SIMCONNECT_UNUSED,
+    DWORD UpValue = 0, BOOL bMaskable = FALSE);
+HRESULT SimConnect_AddClientEventToNotificationGroup(HANDLE hSimConnect, SIMCONNECT_NOTIFICATION_GROUP_ID GroupID, SIMCONNECT_CLIENT_EVENT_ID EventID,
+    BOOL bMaskable = FALSE);
+HRESULT SimConnect_SetNotificationGroupPriority(HANDLE hSimConnect, SIMCONNECT_NOTIFICATION_GROUP_ID GroupID, DWORD uPriority);
+HRESULT SimConnect_SetInputGroupState(HANDLE hSimConnect, SIMCONNECT_INPUT_GROUP_ID GroupID, DWORD dwState);
+HRESULT SimConnect_TransmitClientEvent(HANDLE hSimConnect, SIMCONNECT_OBJECT_ID ObjectID, SIMCONNECT_CLIENT_EVENT_ID EventID, DWORD dwData,
+    SIMCONNECT_NOTIFICATION_GROUP_ID GroupID, DWORD Flags);
+
+HRESULT SimConnect_AddToFacilityDefinition(HANDLE hSimConnect, SIMCONNECT_DATA_DEFINITION_ID DefineID, const char* FieldName);
+HRESULT SimConnect_RequestFacilityData(HANDLE hSimConnect, SIMCONNECT_DATA_DEFINITION_ID DefineID, SIMCONNECT_DATA_REQUEST_ID RequestID,
+    const char* ICAO, const char* Region = "");
+HRESULT SimConnect_RequestFacilitiesList_EX1(HANDLE hSimConnect, SIMCONNECT_FACILITY_LIST_TYPE type, SIMCONNECT_DATA_REQUEST_ID RequestID);
+HRESULT SimConnect_SubscribeToFacilities_EX1(HANDLE hSimConnect, SIMCONNECT_FACILITY_LIST_TYPE type,
+    SIMCONNECT_DATA_REQUEST_ID newElemInRangeRequestID = (SIMCONNECT_DATA_REQUEST_ID)-1, SIMCONNECT_DATA_REQUEST_ID oldElemOutRangeRequestID = (SIMCONNECT_DATA_REQUEST_ID)-1);
+HRESULT SimConnect_UnsubscribeToFacilities_EX1(HANDLE hSimConnect, SIMCONNECT_FACILITY_LIST_TYPE type, bool bUnsubscribeNewInRange, bool bUnsubscribeOldOutRange);
+HRESULT SimConnect_RequestJetwayData(HANDLE hSimConnect, const char* AirportIcao, DWORD ArrayCount, int* Indexes);
+
+HRESULT SimConnect_FlightLoad(HANDLE hSimConnect, const char* szFileName);
+HRESULT SimConnect_FlightSave(HANDLE hSimConnect, const char* szFileName, const char* szTitle, const char* szDescription, DWORD Flags);
+HRESULT SimConnect_FlightPlanLoad(HANDLE hSimConnect, const char* szFileName);
+
+HRESULT SimConnect_Text(HANDLE hSimConnect, SIMCONNECT_TEXT_TYPE type, float fTimeSeconds, SIMCONNECT_CLIENT_EVENT_ID EventID, DWORD cbUnitSize,
+    void* pDataSet);
@@ -0,0 +1,945 @@
+// CoreTests: behavior tests of the FSAutoSave core that need no simulator (codec, save scheduler, flight phase
+// detector, .FLT comparison and repair, save history, airport index, facility database, taxi routes, runway test).
+// Prints one line per failed check, exit code 0 when every check passed.
+//
+//   CoreTests [--filter TEXT]
+//
+// Build and run: the CoreTests target of the CMake build (CMakeLists.txt at the repository root), `ctest` runs it
+// together with the headless save test.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "AirportIndex.h"
+#include "AutoSave.h"
+#include "Compression.h"
+#include "FacilityDb.h"
+#include "FakeSim.h"
+#include "FltDiff.h"
+#include "FltRepair.h"
+#include "Geodesy.h"
+#include "Hash.h"
+#include "History.h"
+#include "RunwayIndex.h"
+#include "SaveScheduler.h"
+#include "TaxiGraph.h"
+
+namespace fs = std::filesystem;
+
+static int checks = 0;
+static int failures = 0;
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+static void check(bool passed, const char* what, const char* file, int line) {
+    checks++;
+    if (!passed) {
+        failures++;
+        printf("[FAIL] %s:%d %s\n", file, line, what);
+    }
+}
+
+// Empty directory of a test under the temporary directory
+static std::string testDirectory(const char* name) {
+    fs::path path = fs::temp_directory_path() / (std::string("FSAutoSaveCoreTests-") + name);
+    std::error_code ec;
+    fs::remove_all(path, ec);
+    fs::create_directories(path, ec);
+    return path.string();
+}
+
+static std::string readFile(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+// --- Codec ----------------------------------------------------------------------------------------------------------
+
+static void codecRoundTrip() {
+    FakeFlight flight;
+    flight.aircraft = "PMDG 737-800";
+    flight.bytes = 3 * 1024 * 1024;
+    std::vector<std::string> inputs = { "", "x", std::string(100000, 'a'), fakeSimFlt(flight) };
+
+    // Incompressible data ends up in stored blocks
+    std::string noise(70000, '\0');
+    uint32_t state = 1;
+    for (char& c : noise) {
+        state = state * 1664525u + 1013904223u;
+        c = static_cast<char>(state >> 24);
+    }
+    inputs.push_back(noise);
+
+    for (const std::string& input : inputs) {
+        std::string compressed = fszCompress(input);
+        std::string output;
+        CHECK(fszDecompress(compressed, output));
+        CHECK(output == input);
+    }
+
+    const std::string& flt = inputs[3];
+    std::string compressed = fszCompress(flt);
+    CHECK(compressed.size() < flt.size() / 2);
+
+    // Fed in small pieces, as the pipe reader does
+    FszDecoder decoder;
+    std::string output;
+    FSZ_STATUS status = FSZ_NEED_MORE;
+    for (size_t pos = 0; pos < compressed.size() && status == FSZ_NEED_MORE; pos += 4093) {
+        status = fszDecodeUpdate(decoder, compressed.data() + pos, std::min<size_t>(4093, compressed.size() - pos), output);
+    }
+    CHECK(status == FSZ_DONE);
+    CHECK(output == flt);
+
+    // A flipped byte is caught by the checksums, a truncated stream is never done
+    std::string corrupt = compressed;
+    corrupt[corrupt.size() / 2] ^= 0x40;
+    CHECK(!fszDecompress(corrupt, output));
+    CHECK(!fszDecompress(compressed.substr(0, compressed.size() - 1), output));
+
+    // Blocks with a dictionary
+    std::string dictionary = flt.substr(0, 60000);
+    std::string block = flt.substr(60000, 60000);
+    std::vector<char> packed(fszBound(block.size()));
+    size_t size = fszCompressBlock(block.data(), block.size(), packed.data(), packed.size(), dictionary.data(), dictionary.size());
+    CHECK(size > 0);
+    std::string unpacked = dictionary + std::string(block.size(), '\0');
+    CHECK(fszDecompressBlock(packed.data(), size, &unpacked[dictionary.size()], block.size(), dictionary.size()));
+    CHECK(unpacked.substr(dictionary.size()) == block);
+}
+
+// --- Save scheduler -------------------------------------------------------------------------------------------------
+
+// Runs the scheduler back to idle so every test starts from the same state
+static void schedulerDrain(int64_t& now) {
+    for (int i = 0; i < 4 && saveSchedulerBusy(); ++i) {
+        saveSchedulerCompleted();
+        now += SAVE_COALESCE_WINDOW + 1;
+        saveSchedulerPoll(now);
+        saveSchedulerCompleted();
+    }
+}
+
+static void schedulerCoalescing() {
+    int64_t now = 1000000;
+    schedulerDrain(now);
+
+    // Autosaves within the window become one run, when the window closes
+    CHECK(saveSchedulerRequest(SAVE_KIND_BACKGROUND, now) == SAVE_DEFERRED);
+    CHECK(saveSchedulerRequest(SAVE_KIND_BACKGROUND, now + 100) == SAVE_ABSORBED);
+    CHECK(!saveSchedulerPoll(now + SAVE_COALESCE_WINDOW - 1));
+    CHECK(saveSchedulerPoll(now + SAVE_COALESCE_WINDOW));
+    CHECK(!saveSchedulerPoll(now + SAVE_COALESCE_WINDOW + 1));
+    saveSchedulerCompleted();
+    CHECK(!saveSchedulerBusy());
+
+    // An exit request takes the place of a waiting autosave and runs now
+    now += 10000;
+    CHECK(saveSchedulerRequest(SAVE_KIND_BACKGROUND, now) == SAVE_DEFERRED);
+    CHECK(saveSchedulerRequest(SAVE_KIND_EXIT, now + 10) == SAVE_RUN_NOW);
+    CHECK(!saveSchedulerPoll(now + SAVE_COALESCE_WINDOW));
+
+    // The other exit events of the same exit are absorbed by the run in flight
+    CHECK(saveSchedulerRequest(SAVE_KIND_EXIT, now + 20) == SAVE_ABSORBED);
+    CHECK(saveSchedulerRequest(SAVE_KIND_BACKGROUND, now + 30) == SAVE_ABSORBED);
+    saveSchedulerCompleted();
+    CHECK(!saveSchedulerPoll(now + 40));
+    CHECK(!saveSchedulerBusy());
+
+    // A user request behind a run in flight gets one follow up run, more requests join it
+    now += 10000;
+    CHECK(saveSchedulerRequest(SAVE_KIND_EXIT, now) == SAVE_RUN_NOW);
+    CHECK(saveSchedulerRequest(SAVE_KIND_USER, now + 10) == SAVE_DEFERRED);
+    CHECK(saveSchedulerRequest(SAVE_KIND_USER, now + 20) == SAVE_ABSORBED);
+    CHECK(!saveSchedulerPoll(now + 30));
+    saveSchedulerCompleted();
+    CHECK(saveSchedulerPoll(now + 40));
+    saveSchedulerCompleted();
+    CHECK(!saveSchedulerBusy());
+
+    // An autosave in flight does not make the exit edits, the exit gets its own run after it
+    now += 10000;
+    CHECK(saveSchedulerRequest(SAVE_KIND_BACKGROUND, now) == SAVE_DEFERRED);
+    CHECK(saveSchedulerPoll(now + SAVE_COALESCE_WINDOW));
+    CHECK(saveSchedulerRequest(SAVE_KIND_EXIT, now + SAVE_COALESCE_WINDOW + 10) == SAVE_DEFERRED);
+    saveSchedulerCompleted();
+    CHECK(saveSchedulerPoll(now + SAVE_COALESCE_WINDOW + 20));
+    saveSchedulerCompleted();
+
+    // A run that never completes is forgotten
+    now += 10000;
+    CHECK(saveSchedulerRequest(SAVE_KIND_EXIT, now) == SAVE_RUN_NOW);
+    CHECK(saveSchedulerRequest(SAVE_KIND_EXIT, now + SAVE_INFLIGHT_TIMEOUT + 1) == SAVE_RUN_NOW);
+    saveSchedulerCompleted();
+    CHECK(!saveSchedulerBusy());
+}
+
+// --- Flight phase detector ------------------------------------------------------------------------------------------
+
+static FLIGHT_PHASE feed(const PhaseSample& sample, int count, int64_t& now) {
+    for (int i = 0; i < count; ++i) {
+        now += 1000;
+        autosaveSample(sample, now);
+    }
+    return autosavePhase();
+}
+
+static void phaseDetector() {
+    int64_t now = 0;
+    autosaveReset(now);
+    CHECK(autosavePhase() == PHASE_UNKNOWN);
+
+    PhaseSample parked = { true, false, 0.0, 0.0, 0.0, 1.0 };
+    PhaseSample taxi = { true, false, 15.0, 0.0, 0.0, 1.0 };
+    PhaseSample lineUp = { true, true, 0.0, 0.0, 0.0, 1.0 };
+    PhaseSample climb = { false, false, 180.0, 1800.0, 4000.0, 1.0 };
+    PhaseSample cruise = { false, false, 450.0, 0.0, 35000.0, 1.0 };
+    PhaseSample descent = { false, false, 400.0, -1500.0, 20000.0, 1.0 };
+    PhaseSample approach = { false, false, 140.0, -700.0, 1500.0, 1.0 };
+
+    CHECK(feed(parked, AUTOSAVE_CONFIRM_GROUND, now) == PHASE_PARKED);
+    CHECK(autosavePhaseChanged());
+    CHECK(!autosavePhaseChanged());
+
+    // Hysteresis: a new phase has to hold for AUTOSAVE_CONFIRM_SAMPLES samples
+    CHECK(feed(taxi, AUTOSAVE_CONFIRM_SAMPLES - 1, now) == PHASE_PARKED);
+    CHECK(feed(taxi, 1, now) == PHASE_TAXI);
+    CHECK(feed(parked, 1, now) == PHASE_TAXI);
+    CHECK(feed(taxi, AUTOSAVE_CONFIRM_SAMPLES, now) == PHASE_TAXI);
+
+    // Holding on the runway is the takeoff, not parking
+    CHECK(feed(lineUp, AUTOSAVE_CONFIRM_SAMPLES, now) == PHASE_TAKEOFF);
+    CHECK(feed(climb, AUTOSAVE_CONFIRM_SAMPLES, now) == PHASE_CLIMB);
+    CHECK(feed(cruise, AUTOSAVE_CONFIRM_SAMPLES, now) == PHASE_CRUISE);
+    CHECK(feed(descent, AUTOSAVE_CONFIRM_SAMPLES, now) == PHASE_DESCENT);
+    CHECK(feed(approach, AUTOSAVE_CONFIRM_SAMPLES, now) == PHASE_APPROACH);
+
+    // Touching down: the rollout stays APPROACH, then taxi and parking
+    PhaseSample rollout = { true, false, 90.0, 0.0, 0.0, 1.0 };
+    CHECK(feed(rollout, AUTOSAVE_CONFIRM_GROUND, now) == PHASE_APPROACH);
+    CHECK(feed(taxi, AUTOSAVE_CONFIRM_SAMPLES, now) == PHASE_TAXI);
+    CHECK(feed(parked, AUTOSAVE_CONFIRM_SAMPLES, now) == PHASE_PARKED);
+    CHECK(std::string(flightPhaseName(PHASE_APPROACH)) == "APPROACH");
+
+    // No autosave while parked; in cruise one is due every 900 sim seconds, sooner in real time at 4x
+    autosaveReset(0);
+    now = 0;
+    bool due = false;
+    for (int i = 0; i < 2000 && !due; ++i) {
+        now += 1000;
+        due = autosaveSample(parked, now);
+    }
+    CHECK(!due);
+
+    autosaveReset(0);
+    now = 0;
+    PhaseSample fast = cruise;
+    fast.simRate = 4.0;
+    int64_t dueAt = 0;
+    for (int i = 0; i < 2000 && dueAt == 0; ++i) {
+        now += 1000;
+        if (autosaveSample(fast, now)) {
+            dueAt = now;
+        }
+    }
+    CHECK(dueAt == 225000);
+
+    // The duty cycle budget: a run of 2 s buys 100 s of quiet
+    autosaveStarted(dueAt);
+    autosaveFinished(dueAt + 2000);
+    now = dueAt + 2000;
+    int64_t nextAt = 0;
+    for (int i = 0; i < 2000 && nextAt == 0; ++i) {
+        now += 1000;
+        if (autosaveSample(fast, now)) {
+            nextAt = now;
+        }
+    }
+    CHECK(nextAt - dueAt == 225000);
+
+    autosaveStarted(nextAt);
+    autosaveFinished(nextAt + 20000);
+    CHECK(!autosaveSample(fast, nextAt + 225000));
+    CHECK(autosaveSample(fast, nextAt + static_cast<int64_t>(20000 / AUTOSAVE_MAX_DUTY)));
+}
+
+// --- .FLT comparison and repair -------------------------------------------------------------------------------------
+
+static void fltDiffAndApply() {
+    FltDocument a;
+    FltDocument b;
+    fltParse("[Main]\r\nTitle=Flight\r\nFlightVersion=1\r\n\r\n[Arrival]\r\nICAO=KSEA\r\n[Sim.0]\r\nSim=Cessna\r\n", a);
+    fltParse("[main]\r\ntitle=Flight\r\nFlightVersion=2\r\nOriginalFlight=\r\n[Sim.0]\r\nSim=Cessna\r\n[FreeFlight]\r\nFirstFlightState=PREFLIGHT_GATE\r\n", b);
+
+    // Names compare without case, like GetPrivateProfileString
+    CHECK(fltValue(a, "MAIN", "flightversion") == "1");
+    CHECK(fltHasSection(a, "arrival"));
+    std::string value = "x";
+    CHECK(fltFind(b, "Main", "OriginalFlight", value) && value.empty());
+    CHECK(!fltFind(b, "Main", "Missing", value));
+
+    std::vector<FltChange> changes = fltDiff(a, b);
+    CHECK(changes.size() == 4);
+    if (changes.size() == 4) {
+        CHECK(changes[0].kind == FLT_KEY_MODIFIED && changes[0].key == "FlightVersion" && changes[0].before == "1" && changes[0].after == "2");
+        CHECK(changes[1].kind == FLT_KEY_ADDED && changes[1].key == "OriginalFlight");
+        CHECK(changes[2].kind == FLT_SECTION_REMOVED && changes[2].section == "Arrival");
+        CHECK(changes[3].kind == FLT_SECTION_ADDED && changes[3].section == "FreeFlight");
+    }
+    CHECK(fltDiff(a, a).empty());
+
+    // Applying the changes gives a file without differences to b
+    FltChangeSet set = {
+        {"Main", {{"FlightVersion", "2"}, {"OriginalFlight", ""}}},
+        {"Arrival", {{FLT_DELETE_SECTION_MARKER, FLT_DELETE_MARKER}}},
+        {"FreeFlight", {{"FirstFlightState", "PREFLIGHT_GATE"}}},
+    };
+    CHECK(fltPreview(a, set).size() == 4);
+    FltDocument applied;
+    fltParse(fltApply(a, set), applied);
+    CHECK(fltDiff(applied, b).empty());
+    CHECK(fltPreview(applied, set).empty());
+    CHECK(fltValue(applied, "Main", "Title") == "Flight");
+}
+
+static void fltRepairRules() {
+    FltRepairResult result;
+    FltDocument landing;
+    fltParse("[Main]\nOriginalFlight=X.FLT\n[Arrival]\nICAO=KSEA\n[Sim.0]\nSim=PMDG 737-800\n[LocalVars.0]\nL:A=1\n[FreeFlight]\nFirstFlightState=LANDING_GATE\n", landing);
+    CHECK(fltRepair(landing, "PREFLIGHT_GATE", result) == FLT_REPAIR_FIXED);
+    FltDocument repaired;
+    fltParse(result.text, repaired);
+    CHECK(result.state == "LANDING_GATE");
+    CHECK(fltValue(repaired, "FreeFlight", "FirstFlightState") == "PREFLIGHT_GATE");
+    CHECK(!fltHasSection(repaired, "Arrival"));
+    CHECK(fltValue(repaired, "Main", "OriginalFlight").empty());
+    CHECK(fltValue(repaired, "LocalVars.0", "FLT_File_Loaded") == "2");
+    CHECK(fltValue(repaired, "LocalVars.0", "L:A").empty());
+
+    FltDocument good;
+    fltParse("[FreeFlight]\nFirstFlightState=PREFLIGHT_GATE\n", good);
+    CHECK(fltRepair(good, "PREFLIGHT_GATE", result) == FLT_REPAIR_NONE);
+
+    // A free flight save without the state gets one, a mission is left alone
+    FltDocument missing;
+    fltParse("[FreeFlight]\nX=1\n", missing);
+    CHECK(fltRepair(missing, "PREFLIGHT_GATE", result) == FLT_REPAIR_FIXED);
+    FltDocument mission;
+    fltParse("[Main]\nTitle=Mission\n", mission);
+    CHECK(fltRepair(mission, "PREFLIGHT_GATE", result) == FLT_REPAIR_SKIPPED);
+    CHECK(result.text.empty());
+}
+
+// --- Save history ---------------------------------------------------------------------------------------------------
+
+static SnapshotFile historyFile(const std::string& name, const std::string& contents) {
+    return { name, hash64(contents), contents.size(), std::make_shared<const std::string>(fszCompress(contents)) };
+}
+
+// Incompressible contents, stored in chunks of their own
+static std::string historyNoise(uint32_t seed, size_t size) {
+    std::string noise(size, '\0');
+    for (char& c : noise) {
+        seed = seed * 1664525u + 1013904223u;
+        c = static_cast<char>(seed >> 24);
+    }
+    return noise;
+}
+
+static SaveBundle historyBundle(int64_t takenAt, const std::string& flt, const std::string& weather) {
+    return { 0, takenAt, "CUSTOMFLIGHT", { historyFile("LAST.FLT", flt), historyFile("LAST.WX", weather) } };
+}
+
+static bool historyRestores(uint64_t id, const std::string& directory, const std::string& flt, const std::string& weather) {
+    return historyRestore(id, directory) && readFile(fs::path(directory) / "LAST.FLT") == flt && readFile(fs::path(directory) / "LAST.WX") == weather;
+}
+
+static uint32_t historyPack(const std::string& directory) {
+    uint32_t pack = 0;
+    std::ifstream(fs::path(directory) / "CURRENT") >> pack;
+    return pack;
+}
+
+static void historyStore() {
+    std::string directory = testDirectory("History");
+    std::string restored = testDirectory("HistoryRestored");
+    CHECK(historyOpen(directory));
+
+    FakeFlight flight;
+    flight.aircraft = "PMDG 737-800";
+    flight.bytes = 256 * 1024;
+    std::string flt = fakeSimFlt(flight);
+    std::string weather = historyNoise(7, 100000);
+
+    // Commit and restore, byte for byte
+    const int64_t day = 24 * 60 * 60 * 1000ll;
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    uint64_t first = historyCommit(historyBundle(now, flt, weather));
+    CHECK(first != 0);
+    CHECK(historyRestores(first, restored, flt, weather));
+
+    // The same save again is not a new generation, a changed section only adds that section
+    CHECK(historyCommit(historyBundle(now + 1000, flt, weather)) == 0);
+    uint64_t packBefore = fs::file_size(fs::path(directory) / ("chunks-" + std::to_string(historyPack(directory)) + ".pack"));
+    flight.simTime = 1500;
+    std::string changed = fakeSimFlt(flight);
+    uint64_t second = historyCommit(historyBundle(now + 2000, changed, weather));
+    CHECK(second == first + 1);
+    uint64_t packAfter = fs::file_size(fs::path(directory) / ("chunks-" + std::to_string(historyPack(directory)) + ".pack"));
+    CHECK(packAfter > packBefore && packAfter - packBefore < changed.size() / 16);
+
+    // Both generations survive a restart
+    CHECK(historyOpen(directory));
+    std::vector<HistoryGeneration> generations = historyList();
+    CHECK(generations.size() == 2);
+    if (generations.size() == 2) {
+        CHECK(generations[1].id == second && generations[1].flight == "CUSTOMFLIGHT" && generations[1].bytes == changed.size() + weather.size());
+    }
+    CHECK(historyRestores(first, restored, flt, weather));
+    CHECK(historyRestores(second, restored, changed, weather));
+    CHECK(!historyRestore(second + 1, restored));
+
+    // A generation whose manifest can not be written is not committed, the next commit stores it
+    uint64_t third = second + 1;
+    fs::create_directory(fs::path(directory) / (std::to_string(third) + ".gen.tmp"));
+    flight.simTime = 1800;
+    std::string failed = fakeSimFlt(flight);
+    CHECK(historyCommit(historyBundle(now + 3000, failed, weather)) == 0);
+    fs::remove(fs::path(directory) / (std::to_string(third) + ".gen.tmp"));
+    CHECK(historyList().size() == 2);
+    CHECK(historyCommit(historyBundle(now + 3000, failed, weather)) == third);
+    CHECK(historyRestores(third, restored, failed, weather));
+    CHECK(historyOpen(directory));
+    CHECK(historyRestores(third, restored, failed, weather));
+
+    // Retention: the newest HISTORY_KEEP_RECENT, then the newest of each day. Older days are dropped, and with them the
+    // chunks only they used (their weather), in a new pack
+    directory = testDirectory("HistoryRetention");
+    CHECK(historyOpen(directory));
+    std::vector<std::string> flts;
+    std::vector<std::string> weathers;
+    std::vector<uint64_t> ids;
+    for (int i = 0; i < HISTORY_KEEP_RECENT + 20; ++i) {
+        flight.simTime = 2000 + i;
+        flts.push_back(fakeSimFlt(flight));
+        weathers.push_back(i < 20 ? historyNoise(100 + i, 100000) : weather);
+        // 10 generations two a day 40 to 36 days ago, 10 two a day 5 to 1 days ago, the rest today
+        int64_t takenAt = i < 10 ? now - (40 - i / 2) * day + i % 2 : i < 20 ? now - (5 - (i - 10) / 2) * day + i % 2 : now - 1000000 + i;
+        ids.push_back(historyCommit(historyBundle(takenAt, flts.back(), weathers.back())));
+        CHECK(ids.back() != 0);
+    }
+    generations = historyList();
+    CHECK(generations.size() == HISTORY_KEEP_RECENT + 5);
+    for (size_t i = 0; i < generations.size() && i < 5; ++i) {
+        CHECK(generations[i].id == ids[11 + 2 * i]);    // The newest of each of the 5 recent days
+    }
+    CHECK(historyPack(directory) > 1);
+    CHECK(!fs::exists(fs::path(directory) / "chunks-1.pack"));
+    CHECK(historyRestores(ids[11], restored, flts[11], weathers[11]));
+    CHECK(historyRestores(ids.back(), restored, flts.back(), weather));
+    CHECK(historyOpen(directory));
+    CHECK(historyRestores(ids[13], restored, flts[13], weathers[13]));
+
+    std::error_code ec;
+    fs::remove_all(fs::path(directory).parent_path() / "FSAutoSaveCoreTests-History", ec);
+    fs::remove_all(directory, ec);
+    fs::remove_all(restored, ec);
+}
+
+// --- Airport index --------------------------------------------------------------------------------------------------
+
+static SIMCONNECT_DATA_FACILITY_AIRPORT indexAirport(const char* ident, double latitude, double longitude) {
+    SIMCONNECT_DATA_FACILITY_AIRPORT airport = {};
+    strncpy(airport.Ident, ident, sizeof(airport.Ident) - 1);
+    memcpy(airport.Region, "XX", 2);
+    airport.Latitude = latitude;
+    airport.Longitude = longitude;
+    return airport;
+}
+
+static std::vector<std::string> indexWithin(double latitude, double longitude, double radius) {
+    std::vector<AirportIndexEntry> found;
+    airportIndexWithin(latitude, longitude, radius, found);
+    std::vector<std::string> idents;
+    for (const AirportIndexEntry& entry : found) {
+        idents.push_back(entry.ident);
+    }
+    std::sort(idents.begin(), idents.end());
+    return idents;
+}
+
+static void airportIndexQueries() {
+    airportIndexClear();
+    AirportIndexEntry nearest;
+    double distance = 0;
+    CHECK(!airportIndexNearest(0, 0, nearest, distance));
+
+    // Around the antimeridian: EAST is 0.15 degrees of longitude away across it, WEST 0.4 degrees on the same side
+    std::vector<SIMCONNECT_DATA_FACILITY_AIRPORT> airports = {
+        indexAirport("EAST", -17.0, -179.95),
+        indexAirport("WEST", -17.0, 179.5),
+        indexAirport("FAR", -17.0, -179.0),
+        indexAirport("POLE", 89.9, 0.0),
+    };
+    // And a grid of airports everywhere else
+    for (int latitude = -80; latitude <= 80; latitude += 10) {
+        for (int longitude = -170; longitude <= 170; longitude += 10) {
+            airports.push_back(indexAirport(("G" + std::to_string(airports.size())).c_str(), latitude + 0.5, longitude + 0.5));
+        }
+    }
+    airportIndexAdd(airports.data(), static_cast<unsigned>(airports.size()));
+    CHECK(airportIndexSize() == airports.size());
+
+    CHECK(airportIndexNearest(-17.0, 179.9, nearest, distance) && std::string(nearest.ident) == "EAST");
+    DistanceAndBearing expected = calculateDistanceAndBearing(-17.0, 179.9, -17.0, -179.95);
+    CHECK(std::fabs(distance - expected.distance) < 1.0);
+    CHECK(airportIndexNearest(-17.0, -179.9, nearest, distance) && std::string(nearest.ident) == "EAST");
+    CHECK(indexWithin(-17.0, 179.9, 50000) == std::vector<std::string>({ "EAST", "WEST" }));
+    CHECK(indexWithin(-17.0, 179.9, 200000) == std::vector<std::string>({ "EAST", "FAR", "WEST" }));
+    CHECK(indexWithin(-17.0, 179.9, 10000).empty());
+    CHECK(airportIndexNearest(89.95, 180.0, nearest, distance) && std::string(nearest.ident) == "POLE");
+
+    // The tree answers like a scan of every airport
+    uint32_t state = 3;
+    auto random = [&state](double low, double high) {
+        state = state * 1664525u + 1013904223u;
+        return low + (high - low) * (state >> 8) / 16777216.0;
+    };
+    bool same = true;
+    for (int i = 0; i < 500; ++i) {
+        double latitude = random(-89, 89), longitude = random(-180, 180);
+        std::string closest;
+        double closestDistance = 1e12;
+        std::vector<std::string> inside;    // Within the radius, allowing a meter of rounding either way
+        std::vector<std::string> near;
+        for (const SIMCONNECT_DATA_FACILITY_AIRPORT& airport : airports) {
+            double meters = calculateDistanceAndBearing(latitude, longitude, airport.Latitude, airport.Longitude).distance;
+            if (meters < closestDistance) {
+                closestDistance = meters;
+                closest = airport.Ident;
+            }
+            if (meters <= 600000 - 1) {
+                inside.push_back(airport.Ident);
+            }
+            if (meters <= 600000 + 1) {
+                near.push_back(airport.Ident);
+            }
+        }
+        std::sort(inside.begin(), inside.end());
+        std::sort(near.begin(), near.end());
+        std::vector<std::string> found = indexWithin(latitude, longitude, 600000);
+        same = same && airportIndexNearest(latitude, longitude, nearest, distance) && closest == nearest.ident &&
+            std::includes(found.begin(), found.end(), inside.begin(), inside.end()) && std::includes(near.begin(), near.end(), found.begin(), found.end());
+    }
+    CHECK(same);
+
+    // An airport sent again moves, a removed one is no longer found
+    SIMCONNECT_DATA_FACILITY_AIRPORT moved = indexAirport("EAST", 10.0, 10.0);
+    airportIndexAdd(&moved, 1);
+    CHECK(airportIndexSize() == airports.size());
+    CHECK(airportIndexNearest(-17.0, 179.9, nearest, distance) && std::string(nearest.ident) == "WEST");
+    airportIndexRemove(&airports[1], 1);
+    CHECK(airportIndexNearest(-17.0, 179.9, nearest, distance) && std::string(nearest.ident) == "FAR");
+    CHECK(airportIndexNearest(10.0, 10.0, nearest, distance) && std::string(nearest.ident) == "EAST" && distance < 1.0);
+    CHECK(airportIndexSize() == airports.size() - 1);
+    airportIndexClear();
+    CHECK(airportIndexSize() == 0);
+}
+
+// --- Facility database ----------------------------------------------------------------------------------------------
+
+// Airport i: parkings on a grid around the reference point, a jetway at every third one
+static FacilityAirportRecord dbTestAirport(unsigned i, const std::string& name) {
+    FacilityAirportRecord airport;
+    char ident[8];
+    snprintf(ident, sizeof(ident), "K%03u", i);
+    airport.ident = ident;
+    airport.name = name;
+    airport.latitude = 30.0 + i * 0.5;
+    airport.longitude = -120.0 + i * 0.25;
+    airport.altitude = 100.0 + i;
+    airport.flags = FACILITY_DB_PARKINGS | (i % 2 == 0 ? FACILITY_DB_JETWAYS : 0);
+    for (unsigned parking = 0; parking < 10 + i; ++parking) {
+        airport.parkings.push_back({ 12 + static_cast<int>(parking % 26), static_cast<int>(parking % 3), parking + 1,
+            40.0f * (parking % 6) - 100.0f, 35.0f * (parking / 6) - 50.0f, 15.0f });
+        if (parking % 3 == 0) {
+            airport.jetways.push_back({ static_cast<int>(parking), airport.latitude + 0.001 * parking, airport.longitude - 0.001 * parking });
+        }
+    }
+    return airport;
+}
+
+static bool dbMatches(const FacilityAirportRecord& expected) {
+    FacilityDbAirport airport;
+    if (!facilityDbFind(expected.ident.c_str(), airport) || expected.name != airport.name || airport.latitude != expected.latitude ||
+        airport.longitude != expected.longitude || airport.altitude != expected.altitude || airport.flags != expected.flags ||
+        airport.parkingCount != expected.parkings.size() || airport.jetwayCount != expected.jetways.size()) {
+        return false;
+    }
+    for (uint32_t i = 0; i < airport.parkingCount; ++i) {
+        FacilityParking parking;
+        const FacilityParking& want = expected.parkings[i];
+        if (!facilityDbParking(airport, i, parking) || parking.name != want.name || parking.suffix != want.suffix || parking.number != want.number ||
+            parking.biasX != want.biasX || parking.biasZ != want.biasZ || parking.radius != want.radius) {
+            return false;
+        }
+    }
+
+    // The closest jetway and the nearest parking are the ones a scan finds
+    const double PI = 3.14159265358979323846;
+    const double metersPerDegree = 6371000 * PI / 180;
+    for (int probe = 0; probe < 20; ++probe) {
+        double latitude = expected.latitude + 0.0002 * (probe - 10), longitude = expected.longitude + 0.0003 * (probe % 7 - 3);
+        DistanceAndBearing found;
+        int jetway = facilityDbClosestJetway(airport, latitude, longitude, found);
+        double best = 1e12;
+        int want = -1;
+        for (const FacilityJetway& candidate : expected.jetways) {
+            double distance = calculateDistanceAndBearing(latitude, longitude, candidate.latitude, candidate.longitude).distance;
+            if (distance < best) {
+                best = distance;
+                want = candidate.parkingIndex;
+            }
+        }
+        if (jetway != want || (want >= 0 && std::fabs(found.distance - best) > 0.01)) {
+            return false;
+        }
+
+        double x = (longitude - expected.longitude) * cos(expected.latitude * PI / 180) * metersPerDegree;
+        double z = (latitude - expected.latitude) * metersPerDegree;
+        best = 1e12;
+        want = -1;
+        for (size_t i = 0; i < expected.parkings.size(); ++i) {
+            double dx = expected.parkings[i].biasX - x, dz = expected.parkings[i].biasZ - z;
+            if (dx * dx + dz * dz < best) {
+                best = dx * dx + dz * dz;
+                want = static_cast<int>(i);
+            }
+        }
+        if (facilityDbNearestParking(airport, latitude, longitude, found) != want) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void facilityDbRoundTrip() {
+    std::string directory = testDirectory("FacilityDb");
+    std::string path = (fs::path(directory) / "facilities.fdb").string();
+    CHECK(facilityDbOpen(path, 1, 2));
+    CHECK(facilityDbCount() == 0);
+
+    // More airports than a batch: the first ones are in the file, the last ones still in memory. Stored out of order
+    const unsigned count = FACILITY_DB_BATCH + 5;
+    std::vector<FacilityAirportRecord> airports;
+    for (unsigned i = 0; i < count; ++i) {
+        airports.push_back(dbTestAirport(i, "Airport " + std::to_string(i)));
+    }
+    for (unsigned i = 0; i < count; ++i) {
+        CHECK(facilityDbStore(airports[(i * 5) % count]));
+    }
+    CHECK(facilityDbCount() == count);
+    FacilityDbAirport airport;
+    CHECK(facilityDbFind(airports[(5 * (count - 1)) % count].ident.c_str(), airport) && airport.pending);
+    CHECK(facilityDbFind(airports[0].ident.c_str(), airport) && !airport.pending);
+    CHECK(fs::exists(path));
+    bool all = true;
+    for (const FacilityAirportRecord& expected : airports) {
+        all = all && dbMatches(expected);
+    }
+    CHECK(all);
+    CHECK(!facilityDbFind("KXYZ", airport));
+
+    // Stored again replaces it, in memory and in the file
+    airports[3] = dbTestAirport(3, "Renamed");
+    airports[3].parkings.resize(4);
+    airports[3].jetways.resize(1);
+    CHECK(facilityDbStore(airports[3]));
+    CHECK(facilityDbCount() == count);
+    CHECK(dbMatches(airports[3]));
+    CHECK(facilityDbFlush());
+    CHECK(facilityDbCount() == count);
+    CHECK(facilityDbFind(airports[3].ident.c_str(), airport) && !airport.pending && dbMatches(airports[3]));
+    airports[count - 1] = dbTestAirport(count - 1, "Renamed too");
+    CHECK(facilityDbStore(airports[count - 1]));
+
+    // Close writes what is still in memory, the same signatures read it all back
+    facilityDbClose();
+    CHECK(facilityDbOpen(path, 1, 2));
+    CHECK(facilityDbCount() == count);
+    all = true;
+    for (const FacilityAirportRecord& expected : airports) {
+        all = all && dbMatches(expected);
+    }
+    CHECK(all);
+
+    // Another simulator version or scenery empties it, so does a damaged file
+    facilityDbClose();
+    CHECK(facilityDbOpen(path, 1, 3));
+    CHECK(facilityDbCount() == 0 && !fs::exists(path));
+    CHECK(facilityDbStore(airports[0]) && facilityDbFlush());
+    facilityDbClose();
+    CHECK(facilityDbOpen(path, 2, 3));
+    CHECK(facilityDbCount() == 0);
+    CHECK(facilityDbStore(airports[0]) && facilityDbFlush());
+    facilityDbClose();
+    std::string file = readFile(path);
+    memset(&file[sizeof(FacilityDbHeader)], 'X', 8);   // The first ident is no longer NUL terminated
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(file.data(), static_cast<std::streamsize>(file.size()));
+    CHECK(facilityDbOpen(path, 2, 3));
+    CHECK(facilityDbCount() == 0);
+
+    // Cleared: nothing in memory or on disk
+    CHECK(facilityDbStore(airports[1]) && facilityDbStore(airports[2]) && facilityDbFlush() && facilityDbStore(airports[4]));
+    CHECK(facilityDbCount() == 3);
+    facilityDbClear();
+    CHECK(facilityDbCount() == 0 && !facilityDbFind(airports[4].ident.c_str(), airport) && !fs::exists(path));
+    facilityDbClose();
+    CHECK(!fs::exists(path));
+
+    std::error_code ec;
+    fs::remove_all(directory, ec);
+}
+
+// --- Taxi routes ----------------------------------------------------------------------------------------------------
+
+static const double TAXI_LATITUDE = 10.0, TAXI_LONGITUDE = 20.0;    // Reference point of the test airports
+
+// Route from the point x meters east, z meters north of the reference point
+static bool taxiRoute(const char* ident, double x, double z, uint32_t parking, TaxiRoute& route) {
+    const double PI = 3.14159265358979323846;
+    const double metersPerDegree = 6371000 * PI / 180;
+    return taxiGraphRoute(ident, TAXI_LATITUDE + z / metersPerDegree, TAXI_LONGITUDE + x / (cos(TAXI_LATITUDE * PI / 180) * metersPerDegree), parking, route);
+}
+
+static void taxiGraphRoutes() {
+    // A square with a diagonal 0 - 4 - 2 across it, parking 0 north of 2, parking 1 off the taxiways
+    //
+    //   3 ---- 2 - P0
+    //   |  4   |
+    //   0 ---- 1
+    TaxiGraphRecord square;
+    square.ident = "SQRE";
+    square.latitude = TAXI_LATITUDE;
+    square.longitude = TAXI_LONGITUDE;
+    square.pointX = { 0, 100, 100, 0, 50 };
+    square.pointZ = { 0, 0, 100, 120, 50 };
+    square.parkingX = { 100, 300 };
+    square.parkingZ = { 150, 300 };
+    square.paths = { { TAXI_PATH_TAXI, 0, 1 }, { TAXI_PATH_RUNWAY, 1, 2 }, { TAXI_PATH_TAXI, 2, 3 }, { TAXI_PATH_PATH, 3, 0 },
+        { TAXI_PATH_CLOSED, 0, 4 }, { TAXI_PATH_VEHICLE, 4, 2 }, { TAXI_PATH_PARKING, 2, 0 }, { TAXI_PATH_TAXI, 1, 7 } };
+    taxiGraphBuild(square);
+    CHECK(taxiGraphCached("SQRE"));
+
+    // Closed and vehicle paths are not taxiways: around the square, joining at point 0 10 m south of it
+    TaxiRoute route;
+    CHECK(taxiRoute("SQRE", 0, -10, 0, route));
+    CHECK(std::fabs(route.distance - 260) < 0.05);
+    CHECK(route.nodes == std::vector<uint32_t>({ 0, 1, 2, 5 }));
+    CHECK(!taxiRoute("SQRE", 0, -10, 1, route) && route.nodes.empty());  // No path to it
+    CHECK(!taxiRoute("SQRE", 0, -10, 2, route));                        // No such parking
+    CHECK(!taxiRoute("NONE", 0, -10, 0, route));
+
+    // Built again with the diagonal open: it replaces the graph and is the shorter way
+    square.paths[4].type = TAXI_PATH_TAXI;
+    square.paths[5].type = TAXI_PATH_TAXI;
+    taxiGraphBuild(square);
+    CHECK(taxiRoute("SQRE", 0, -10, 0, route));
+    CHECK(std::fabs(route.distance - (10 + 100 * std::sqrt(2.0) + 50)) < 0.05);
+    CHECK(route.nodes == std::vector<uint32_t>({ 0, 4, 2, 5 }));
+    CHECK(taxiRoute("SQRE", 100, 140, 0, route) && route.nodes == std::vector<uint32_t>({ 5 }) && std::fabs(route.distance - 10) < 0.05);
+
+    // A* finds the length Dijkstra finds on a grid with random paths missing
+    const int SIDE = 12, POINTS = SIDE * SIDE, PARKINGS = 10;
+    uint32_t state = 5;
+    auto random = [&state](double low, double high) {
+        state = state * 1664525u + 1013904223u;
+        return low + (high - low) * (state >> 8) / 16777216.0;
+    };
+    TaxiGraphRecord grid;
+    grid.ident = "GRID";
+    grid.latitude = TAXI_LATITUDE;
+    grid.longitude = TAXI_LONGITUDE;
+    for (int i = 0; i < POINTS; ++i) {
+        grid.pointX.push_back(static_cast<float>((i % SIDE) * 60 + random(-15, 15)));
+        grid.pointZ.push_back(static_cast<float>((i / SIDE) * 60 + random(-15, 15)));
+        if (i % SIDE + 1 < SIDE && random(0, 1) < 0.7) {
+            grid.paths.push_back({ TAXI_PATH_TAXI, i, i + 1 });
+        }
+        if (i + SIDE < POINTS && random(0, 1) < 0.7) {
+            grid.paths.push_back({ TAXI_PATH_TAXI, i, i + SIDE });
+        }
+    }
+    for (int parking = 0; parking < PARKINGS; ++parking) {
+        int point = static_cast<int>(random(0, POINTS));
+        grid.parkingX.push_back(grid.pointX[point] + 20);
+        grid.parkingZ.push_back(grid.pointZ[point] + 20);
+        grid.paths.push_back({ TAXI_PATH_PARKING, point, parking });
+    }
+    taxiGraphBuild(grid);
+
+    const int NODES = POINTS + PARKINGS;
+    std::vector<float> x(grid.pointX), z(grid.pointZ);
+    x.insert(x.end(), grid.parkingX.begin(), grid.parkingX.end());
+    z.insert(z.end(), grid.parkingZ.begin(), grid.parkingZ.end());
+    std::vector<std::vector<std::pair<int, double>>> edges(NODES);
+    for (const TaxiGraphPath& path : grid.paths) {
+        int to = path.type == TAXI_PATH_PARKING ? POINTS + path.end : path.end;
+        double length = std::hypot(x[to] - x[path.start], z[to] - z[path.start]);
+        edges[path.start].push_back({ to, length });
+        edges[to].push_back({ path.start, length });
+    }
+    int routes = 0;
+    bool same = true;
+    for (int query = 0; query < 40; ++query) {
+        double px = random(-30, SIDE * 60), pz = random(-30, SIDE * 60);
+        uint32_t parking = static_cast<uint32_t>(query % PARKINGS);
+
+        // Joins at the closest node with paths
+        int start = -1;
+        double startDistance = 1e12;
+        for (int node = 0; node < NODES; ++node) {
+            double distance = std::hypot(x[node] - px, z[node] - pz);
+            if (!edges[node].empty() && distance < startDistance) {
+                startDistance = distance;
+                start = node;
+            }
+        }
+        std::vector<double> cost(NODES, 1e12);
+        std::vector<bool> done(NODES, false);
+        cost[start] = 0;
+        for (int step = 0; step < NODES; ++step) {
+            int node = -1;
+            for (int candidate = 0; candidate < NODES; ++candidate) {
+                if (!done[candidate] && (node < 0 || cost[candidate] < cost[node])) {
+                    node = candidate;
+                }
+            }
+            done[node] = true;
+            for (const auto& edge : edges[node]) {
+                cost[edge.first] = std::min(cost[edge.first], cost[node] + edge.second);
+            }
+        }
+
+        bool found = taxiRoute("GRID", px, pz, parking, route);
+        bool reachable = cost[POINTS + parking] < 1e11;
+        routes += found ? 1 : 0;
+        if (found != reachable || (found && (std::fabs(route.distance - (startDistance + cost[POINTS + parking])) > 0.05 ||
+            route.nodes.front() != static_cast<uint32_t>(start) || route.nodes.back() != POINTS + parking))) {
+            same = false;
+        }
+    }
+    CHECK(same);
+    CHECK(routes > 20);
+
+    // The airports used longest ago make room for new ones
+    CHECK(taxiRoute("SQRE", 0, -10, 0, route));
+    for (int i = 0; i < TAXI_GRAPH_CACHE - 1; ++i) {
+        square.ident = "SQ" + std::to_string(i);
+        taxiGraphBuild(square);
+    }
+    CHECK(taxiGraphCached("SQRE") && !taxiGraphCached("GRID"));
+    taxiGraphClear();
+    CHECK(!taxiGraphCached("SQRE") && !taxiGraphCached("SQ0"));
+}
+
+// --- Runway test ----------------------------------------------------------------------------------------------------
+
+// Aircraft east and north meters of the point, pointing heading (true)
+static RUNWAY_POSITION runwayAt(double latitude, double longitude, double east, double north, double heading, RunwayState& state, bool onGround = true) {
+    const double PI = 3.14159265358979323846;
+    const double metersPerDegree = 6371000 * PI / 180;
+    double aircraftLongitude = longitude + east / (cos(latitude * PI / 180) * metersPerDegree);
+    aircraftLongitude -= aircraftLongitude > 180 ? 360 : 0;
+    return runwayIndexTest(latitude + north / metersPerDegree, aircraftLongitude, heading, onGround, state);
+}
+
+static void runwayIndexPositions() {
+    // 09/27 3000 x 45 m crossed in its middle by 18/36 2000 x 45 m, 08L/26R 2000 x 60 m across the antimeridian
+    const double LATITUDE = 47.0, LONGITUDE = 8.0;
+    const RunwayRecord crossing[] = {
+        { LATITUDE, LONGITUDE, 90, 3000, 45, 9, 0, 27, 0 },
+        { LATITUDE, LONGITUDE, 180, 2000, 45, 18, 0, 36, 0 },
+    };
+    const RunwayRecord dateline[] = { { -17.0, 179.995, 80, 2000, 60, 8, 1, 26, 2 } };
+    runwayIndexStore("CROS", crossing, 2);
+    runwayIndexStore("DATE", dateline, 1);
+    CHECK(runwayIndexSize() == 3);
+
+    // Lined up either way, with what is left of the runway ahead
+    RunwayState state;
+    CHECK(runwayAt(LATITUDE, LONGITUDE, 1000, 5, 93, state) == RUNWAY_LINED_UP);
+    CHECK(std::string(state.airport) == "CROS" && std::string(state.runway) == "09" && std::fabs(state.remaining - 500) < 1);
+    CHECK(runwayAt(LATITUDE, LONGITUDE, 1000, -5, 265, state) == RUNWAY_LINED_UP);
+    CHECK(std::string(state.runway) == "27" && std::fabs(state.remaining - 2500) < 1);
+
+    // On it but turning or crossing
+    CHECK(runwayAt(LATITUDE, LONGITUDE, 1000, 0, 90 + RUNWAY_INDEX_ALIGNED + 5, state) == RUNWAY_ON && std::string(state.runway) == "09/27");
+    CHECK(runwayAt(LATITUDE, LONGITUDE, -600, 10, 0, state) == RUNWAY_ON && std::string(state.runway) == "09/27");
+
+    // Off it: beside, past the end, in the air
+    CHECK(runwayAt(LATITUDE, LONGITUDE, 1000, 30, 90, state) == RUNWAY_NONE && state.airport[0] == '\0');
+    CHECK(runwayAt(LATITUDE, LONGITUDE, 1520, 0, 90, state) == RUNWAY_NONE);
+    CHECK(runwayAt(LATITUDE, LONGITUDE, 1000, 0, 90, state, false) == RUNWAY_NONE);
+    CHECK(runwayAt(LATITUDE, LONGITUDE, 3000, 3000, 90, state) == RUNWAY_NONE);
+
+    // Where they cross, lined up on one wins over standing across the other
+    CHECK(runwayAt(LATITUDE, LONGITUDE, 0, 0, 178, state) == RUNWAY_LINED_UP && std::string(state.runway) == "18");
+    CHECK(runwayAt(LATITUDE, LONGITUDE, 10, -10, 2, state) == RUNWAY_LINED_UP && std::string(state.runway) == "36");
+    CHECK(runwayAt(LATITUDE, LONGITUDE, 0, 0, 90, state) == RUNWAY_LINED_UP && std::string(state.runway) == "09");
+    CHECK(runwayAt(LATITUDE, LONGITUDE, 0, 0, 45, state) == RUNWAY_ON);
+    CHECK(runwayAt(LATITUDE, LONGITUDE, 0, -700, 90, state) == RUNWAY_ON && std::string(state.runway) == "18/36");
+
+    // Across the antimeridian: the aircraft east of it, the runway center west of it
+    const double PI = 3.14159265358979323846;
+    CHECK(runwayAt(-17.0, 179.995, 700 * sin(80 * PI / 180), 700 * cos(80 * PI / 180), 260, state) == RUNWAY_LINED_UP);
+    CHECK(std::string(state.airport) == "DATE" && std::string(state.runway) == "26R" && std::fabs(state.remaining - 1700) < 1);
+
+    // Stored again replaces the runways of the airport, cleared forgets them all
+    runwayIndexStore("CROS", crossing + 1, 1);
+    CHECK(runwayIndexSize() == 2);
+    CHECK(runwayAt(LATITUDE, LONGITUDE, 1000, 0, 90, state) == RUNWAY_NONE);
+    runwayIndexClear();
+    CHECK(runwayIndexSize() == 0 && runwayAt(LATITUDE, LONGITUDE, 0, 0, 180, state) == RUNWAY_NONE);
+}
+
+int main(int argc, char** argv) {
+    const char* filter = argc == 3 && strcmp(argv[1], "--filter") == 0 ? argv[2] : "";
+    struct Test {
+        const char* name;
+        std::function<void()> run;
+    } tests[] = {
+        { "codec round trip", codecRoundTrip },
+        { "scheduler coalescing", schedulerCoalescing },
+        { "phase detector", phaseDetector },
+        { "flt diff and apply", fltDiffAndApply },
+        { "flt repair", fltRepairRules },
+        { "history store", historyStore },
+        { "airport index", airportIndexQueries },
+        { "facility database", facilityDbRoundTrip },
+        { "taxi routes", taxiGraphRoutes },
+        { "runway test", runwayIndexPositions },
+    };
+
+    for (const Test& test : tests) {
+        if (strstr(test.name, filter) == nullptr) {
+            continue;
+        }
+        int before = failures;
+        test.run();
+        printf("[%s] %s\n", failures == before ? "PASS" : "FAIL", test.name);
+    }
+    printf("\n%d checks, %d failed\n", checks, failures);
+    return failures == 0 ? 0 : 1;
+}
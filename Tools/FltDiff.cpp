@@ -0,0 +1,31 @@
+// FltDiff: section and key aware comparison of two .FLT files, for the command line and scripts.
+//
+//   FltDiff old.FLT new.FLT
+//
+// Exit code 0 when nothing changed, 1 when something did, 2 when a file can not be read (like diff).
+// FSAutoSave.exe -DIFF:old.FLT new.FLT prints the same thing on a machine without this tool.
+//
+// Build from the repository root:
+//   g++ -O2 -std=c++17 -IFSAutoSave Tools/FltDiff.cpp FSAutoSave/FltDiff.cpp -o FltDiff
+
+#include <cstdio>
+#include "FltDiff.h"
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        printf("Usage: %s <first.FLT> <second.FLT>\n", argv[0]);
+        return 2;
+    }
+
+    FltDocument a, b;
+    for (int i = 1; i <= 2; ++i) {
+        if (!fltLoad(argv[i], i == 1 ? a : b)) {
+            printf("Could not read %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    std::vector<FltChange> changes = fltDiff(a, b);
+    fputs(fltFormatChanges(changes).c_str(), stdout);
+    return changes.empty() ? 0 : 1;
+}
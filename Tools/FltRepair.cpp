@@ -0,0 +1,170 @@
+// FltRepair: applies the FSAutoSave save repairs (see FltRepair.h) to every .FLT under a directory, using all cores.
+//
+//   FltRepair [--dry-run] [--diff] [--jobs N] [--state PREFLIGHT_GATE] <directory>
+//
+//   --dry-run   report what would be repaired, write nothing
+//   --diff      print the changes of every repaired file
+//   --jobs N    worker threads (default: one per core)
+//   --state S   FirstFlightState to write (same as FSAutoSave -FFSTATE:)
+//
+// Files without a [FreeFlight] section (missions) are reported as skipped and left as they are.
+// Repaired files are written next to the original and renamed over it, an interrupted run never leaves half a file.
+// Exit code 0 when every file could be read (and written), 1 otherwise.
+//
+// Build from the repository root:
+//   g++ -O2 -std=c++17 -pthread -IFSAutoSave Tools/FltRepair.cpp FSAutoSave/FltRepair.cpp FSAutoSave/FltDiff.cpp -o FltRepair
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FltRepair.h"
+
+namespace fs = std::filesystem;
+
+struct Options {
+    bool dryRun = false;
+    bool diff = false;
+    unsigned jobs = 0;
+    std::string state = "PREFLIGHT_GATE";
+    std::string directory;
+};
+
+static bool isFlt(const fs::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(toupper(c)); });
+    return extension == ".FLT";
+}
+
+static bool writeAtomically(const fs::path& path, const std::string& contents) {
+    fs::path temp = path;
+    temp += ".fltrepair.tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        out.flush();
+        if (!out) {
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(temp, path, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--dry-run") == 0) {
+            options.dryRun = true;
+        }
+        else if (strcmp(argv[i], "--diff") == 0) {
+            options.diff = true;
+        }
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            options.jobs = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--state") == 0 && i + 1 < argc) {
+            options.state = argv[++i];
+        }
+        else if (argv[i][0] != '-' && options.directory.empty()) {
+            options.directory = argv[i];
+        }
+        else {
+            return false;
+        }
+    }
+    return !options.directory.empty();
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printf("Usage: %s [--dry-run] [--diff] [--jobs N] [--state PREFLIGHT_GATE] <directory>\n", argv[0]);
+        return 1;
+    }
+    if (options.jobs == 0) {
+        options.jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<fs::path> files;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(options.directory, fs::directory_options::skip_permission_denied, ec), end; it != end; it.increment(ec)) {
+        if (!ec && it->is_regular_file(ec) && isFlt(it->path())) {
+            files.push_back(it->path());
+        }
+    }
+    if (ec) {
+        printf("Could not read %s (%s)\n", options.directory.c_str(), ec.message().c_str());
+        return 1;
+    }
+
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> repaired(0);
+    std::atomic<size_t> skipped(0);
+    std::atomic<size_t> failed(0);
+    std::atomic<uint64_t> bytes(0);
+    std::mutex outputMutex;
+
+    auto worker = [&]() {
+        FltDocument document;
+        FltRepairResult result;
+        for (size_t i = next++; i < files.size(); i = next++) {
+            const fs::path& path = files[i];
+            if (!fltLoad(path.string(), document)) {
+                std::lock_guard<std::mutex> lock(outputMutex);
+                printf("[ERROR] Could not read %s\n", path.string().c_str());
+                failed++;
+                continue;
+            }
+            bytes += document.text.size();
+            FLT_REPAIR_STATUS status = fltRepair(document, options.state, result);
+            if (status == FLT_REPAIR_SKIPPED) {
+                std::lock_guard<std::mutex> lock(outputMutex);
+                printf("[SKIP] %s (no [FreeFlight] section)\n", path.string().c_str());
+                skipped++;
+                continue;
+            }
+            if (status != FLT_REPAIR_FIXED) {
+                continue;
+            }
+            bool written = options.dryRun || writeAtomically(path, result.text);
+            (written ? repaired : failed)++;
+
+            // One block per file so the output of the workers does not interleave
+            std::string report = std::string(written ? (options.dryRun ? "[WOULD FIX] " : "[FIX] ") : "[ERROR] Could not write ") + path.string() +
+                " (FirstFlightState " + (result.state.empty() ? "missing" : result.state) + ")\n";
+            if (options.diff) {
+                report += fltFormatChanges(result.changes);
+            }
+            std::lock_guard<std::mutex> lock(outputMutex);
+            fputs(report.c_str(), stdout);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < options.jobs; ++i) {
+        workers.emplace_back(worker);
+    }
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("\n%zu .FLT files (%.1f MB), %zu %s, %zu skipped, %zu failed in %.2f s with %u threads: %.0f files/s, %.1f MB/s\n", files.size(),
+        bytes / (1024.0 * 1024.0), repaired.load(), options.dryRun ? "need a repair" : "repaired", skipped.load(), failed.load(), seconds, options.jobs,
+        files.size() / std::max(seconds, 1e-9), bytes / (1024.0 * 1024.0) / std::max(seconds, 1e-9));
+    return failed == 0 ? 0 : 1;
+}